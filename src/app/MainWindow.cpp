@@ -10,9 +10,13 @@
 #include "PlaybackController.h"
 #include "OverlayRenderer.h"
 #include "FitTrack.h"
-#include "FitParser.h"
+#include "FitTrackLoader.h"
+#include "FitSessionRegistry.h"
+#include "FitSegments.h"
+#include "FitSegmentStore.h"
 #include "TimeSync.h"
 #include "VideoPlaybackEngine.h"
+#include "FrameCompositor.h"
 #include "OverlayPanelFactory.h"
 #include "ProjectManager.h"
 
@@ -20,6 +24,7 @@
 #include <QMenuBar>
 #include <QMenu>
 #include <QAction>
+#include <QActionGroup>
 #include <QStatusBar>
 #include <QFileDialog>
 #include <QMessageBox>
@@ -31,13 +36,56 @@
 #include <QDialogButtonBox>
 #include <QtMath>
 #include <QCloseEvent>
+#include <QDateTime>
 #include <QDir>
 #include <QRegularExpression>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+// Timeline highlights for a track's best 20, 5 and 1 minute efforts (power,
+// or heart rate without a power meter); shorter ones are drawn on top
+std::vector<TimelineMarker> peakMarkers(const FitTrack& track) {
+    const FitPeakCurves& peaks = track.peaks();
+    const bool power = !peaks.curve(FitChannel::Power).empty();
+    const FitChannel channel = power ? FitChannel::Power : FitChannel::HeartRate;
+    std::vector<TimelineMarker> markers;
+    for (int minutes : {20, 5, 1}) {
+        FitPeak peak = peaks.best(channel, minutes * 60.0);
+        if (peak.empty() || peak.duration != minutes * 60.0) continue;
+        markers.push_back({peak.startTime, peak.duration,
+                           QString("Best %1 min: %2 %3").arg(minutes).arg(qRound(peak.value)).arg(power ? "W" : "bpm")});
+    }
+    return markers;
+}
+
+// Matched segments and climbs under the best efforts
+std::vector<TimelineMarker> trackMarkers(const FitTrack& track) {
+    std::vector<TimelineMarker> markers;
+    for (const FitSegmentEffort& effort : FitSegmentLibrary::current()->match(track)) {
+        const int seconds = qRound(effort.elapsed());
+        markers.push_back({effort.startTime, effort.elapsed(),
+                           QString("%1: %2:%3").arg(effort.name).arg(seconds / 60).arg(seconds % 60, 2, 10, QChar('0'))});
+    }
+    for (const FitClimb& climb : track.climbs()) {
+        QString category = climb.category == 0 ? QString("HC") : QString("Cat %1").arg(climb.category);
+        markers.push_back({climb.startTime, climb.endTime - climb.startTime,
+                           QString("Climb %1 km at %2% (%3)").arg(climb.length / 1000.0f, 0, 'f', 1)
+                               .arg(climb.averageGrade, 0, 'f', 1).arg(category)});
+    }
+    std::vector<TimelineMarker> peaks = peakMarkers(track);
+    markers.insert(markers.end(), peaks.begin(), peaks.end());
+    return markers;
+}
+
+} // namespace
 
 MainWindow::MainWindow(QWidget* parent)
     : QMainWindow(parent)
     , m_overlayRenderer(std::make_unique<OverlayRenderer>())
-    , m_previewFitTrack(std::make_unique<FitTrack>())
+    , m_fitLoader(std::make_unique<FitTrackLoader>())
     , m_timeSync(std::make_unique<TimeSync>())
     , m_playbackEngine(std::make_unique<VideoPlaybackEngine>())
     , m_projectManager(std::make_unique<ProjectManager>())
@@ -45,6 +93,15 @@ MainWindow::MainWindow(QWidget* parent)
     setWindowTitle(QString("%1 v%2").arg(AppConstants::AppName, AppConstants::AppVersion));
     resize(AppConstants::DefaultWindowWidth, AppConstants::DefaultWindowHeight);
 
+    // Segments saved in earlier sessions; none yet is fine
+    auto segments = std::make_shared<FitSegmentLibrary>();
+    FitSegmentStore segmentStore;
+    if (segmentStore.load(FitSegmentStore::defaultPath(), *segments))
+        FitSegmentLibrary::setCurrent(std::move(segments));
+
+    // Preview frames stay YUV until they are composed onto the canvas
+    m_playbackEngine->setYuvOutput(true);
+
     setupUi();
     setupMenuBar();
     setupDockWidgets();
@@ -116,6 +173,9 @@ void MainWindow::setupMenuBar() {
         if (!path.isEmpty()) onFitFileOpened(path);
     });
 
+    auto* saveClimbsAction = fileMenu->addAction("Save Climbs as &Segments");
+    connect(saveClimbsAction, &QAction::triggered, this, &MainWindow::onSaveClimbsAsSegments);
+
     fileMenu->addSeparator();
 
     auto* exportAction = fileMenu->addAction("&Export...");
@@ -132,6 +192,20 @@ void MainWindow::setupMenuBar() {
     auto* canvasAction = viewMenu->addAction("Canvas &Settings...");
     connect(canvasAction, &QAction::triggered, this, &MainWindow::onCanvasSettings);
 
+    // Preview only; the canvas size itself is what gets exported
+    auto* resolutionMenu = viewMenu->addMenu("Preview &Resolution");
+    auto* resolutionGroup = new QActionGroup(this);
+    const std::pair<const char*, int> resolutions[] = {{"&Full", 1}, {"&Half", 2}, {"&Quarter", 4}};
+    for (const auto& [label, divisor] : resolutions) {
+        auto* action = resolutionMenu->addAction(label);
+        action->setCheckable(true);
+        action->setChecked(divisor == m_previewDivisor);
+        resolutionGroup->addAction(action);
+        connect(action, &QAction::triggered, this, [this, divisor = divisor]() {
+            setPreviewResolution(divisor);
+        });
+    }
+
     viewMenu->addSeparator();
 
     auto* helpMenu = menuBar()->addMenu("&Help");
@@ -230,18 +304,52 @@ void MainWindow::connectSignals() {
     connect(m_timelineWidget, &TimelineWidget::clipAdded, this, [this](const QString& path, double offset, double dur) {
         m_projectModified = true;
         if (QFileInfo(path).suffix().toLower() == "fit") {
-            FitParser parser;
-            if (parser.parse(path)) {
-                auto fitTrack = std::make_unique<FitTrack>();
-                fitTrack->loadSession(parser.session());
-                m_fitTracks[path] = std::move(fitTrack);
-
-                // For TimeSync offset logic, set based on the first FIT clip added
-                if (m_fitTracks.size() == 1) {
-                    m_timeSync->setFitTimeOffset(parser.session().startTime - offset);
+            // The clip was placed from a summary probe; its start time is all
+            // the offset needs, so the records wait until an overlay reaches it
+            const Clip* added = nullptr;
+            int fitClips = 0;
+            auto* model = m_timelineWidget->model();
+            for (int ti = 0; ti < model->trackCount(); ++ti) {
+                Track* track = model->track(ti);
+                if (!track || track->type() != TrackType::FitData) continue;
+                for (int ci = 0; ci < track->clipCount(); ++ci) {
+                    const Clip& clip = track->clip(ci);
+                    if (clip.type != ClipType::FitData) continue;
+                    ++fitClips;
+                    if (clip.sourcePath == path) added = &clip;
                 }
             }
+
+            // For TimeSync offset logic, set based on the first FIT clip added
+            if (added && fitClips == 1) {
+                m_timeSync->setFitTimeOffset(added->absoluteStartTime - offset);
+            }
+        }
+    });
+
+    // Project FIT clips load in parallel; tracks appear as they finish, and
+    // large files show their decoded part while the rest streams in
+    auto adoptFitTrack = [this](const QString& path) {
+        if (auto fitTrack = m_fitLoader->takeTrack(path)) {
+            m_timelineWidget->setClipMarkers(path, trackMarkers(*fitTrack));
+            m_mediaBrowser->setFitThumbnail(path, *fitTrack);
+            m_fitTracks[path] = std::move(fitTrack);
+            m_overlayCursor.reset();
+        }
+        if (m_playbackFromTimeline && m_playbackController->state() != PlaybackState::Playing)
+            onPlaybackTick(m_timelineWidget->model()->playheadPosition());
+    };
+    connect(m_fitLoader.get(), &FitTrackLoader::trackLoaded, this, adoptFitTrack);
+    connect(m_fitLoader.get(), &FitTrackLoader::trackPartiallyLoaded, this, adoptFitTrack);
+    connect(m_fitLoader.get(), &FitTrackLoader::progress, this, [this](int done, int total) {
+        statusBar()->showMessage(QString("Loading FIT data: %1/%2").arg(done).arg(total));
+    });
+    connect(m_fitLoader.get(), &FitTrackLoader::loadFailed, this, [this](const QString& path, const QString& message) {
+        if (m_fitTracks.erase(path)) {
+            m_timelineWidget->setClipMarkers(path, {});
+            m_overlayCursor.reset();
         }
+        statusBar()->showMessage(QString("Failed to parse FIT file %1: %2").arg(QFileInfo(path).fileName(), message));
     });
 
     connect(m_timelineWidget, &TimelineWidget::clipMoved, this, [this](int trackIndex, int clipIndex, double newOffset) {
@@ -330,6 +438,43 @@ void MainWindow::connectSignals() {
     });
 }
 
+void MainWindow::onSaveClimbsAsSegments() {
+    std::vector<std::pair<QString, std::shared_ptr<const FitTrack>>> tracks(m_fitTracks.begin(), m_fitTracks.end());
+    if (m_previewFitTrack) tracks.push_back({m_currentClipPath, m_previewFitTrack});
+
+    // Climbs already timed by a segment are skipped
+    auto library = std::make_shared<FitSegmentLibrary>(*FitSegmentLibrary::current());
+    int added = 0;
+    for (const auto& [path, track] : tracks) {
+        const std::vector<FitSegmentEffort> efforts = library->match(*track);
+        const QString date = QDateTime::fromSecsSinceEpoch(static_cast<qint64>(track->startTime())).toString("yyyy-MM-dd");
+        for (const FitClimb& climb : track->climbs()) {
+            bool known = std::any_of(efforts.begin(), efforts.end(), [&](const FitSegmentEffort& e) {
+                return std::abs(e.startTime - climb.startTime) < 30.0 && std::abs(e.endTime - climb.endTime) < 30.0;
+            });
+            if (known) continue;
+            QString name = QString("Climb %1 km at %2% (%3)").arg(climb.length / 1000.0f, 0, 'f', 1)
+                               .arg(climb.averageGrade, 0, 'f', 1).arg(date);
+            if (library->add(FitSegmentLibrary::fromTrack(*track, climb.startTime, climb.endTime, name)) >= 0)
+                ++added;
+        }
+    }
+    if (added == 0) {
+        statusBar()->showMessage("No new climbs to save");
+        return;
+    }
+
+    FitSegmentStore store;
+    if (!store.save(FitSegmentStore::defaultPath(), *library)) {
+        QMessageBox::warning(this, "Save Segments", store.errorString());
+        return;
+    }
+    FitSegmentLibrary::setCurrent(library);
+    for (const auto& [path, track] : m_fitTracks)
+        m_timelineWidget->setClipMarkers(path, trackMarkers(*track));
+    statusBar()->showMessage(QString("Saved %1 climb segment(s)").arg(added));
+}
+
 void MainWindow::onCanvasSettings() {
     QDialog dlg(this);
     dlg.setWindowTitle("Canvas Settings");
@@ -381,7 +526,7 @@ void MainWindow::onMediaSelected(const QString& path) {
         m_playbackController->stop();
         m_playbackEngine->close();
         m_previewFitData = false;
-        if (m_previewFitTrack) m_previewFitTrack->clear();
+        m_previewFitTrack.reset();
 
         QImage img(path);
         if (!img.isNull()) {
@@ -400,7 +545,7 @@ void MainWindow::onMediaSelected(const QString& path) {
     m_playbackController->stop();
     m_playbackEngine->close();
     m_previewFitData = false;
-    if (m_previewFitTrack) m_previewFitTrack->clear();
+    m_previewFitTrack.reset();
 
     m_currentClipPath = path;
 
@@ -422,8 +567,8 @@ void MainWindow::onMediaSelected(const QString& path) {
     // Show first frame — pull from decode queue (give decode thread a moment)
     QThread::msleep(50);
     TimedFrame firstFrame = m_playbackEngine->nextFrame();
-    if (!firstFrame.image.isNull()) {
-        m_previewWidget->displayFrame(firstFrame.image);
+    if (!firstFrame.isNull()) {
+        m_previewWidget->displayFrame(frameImage(firstFrame, previewSize(QSize(vi.width, vi.height))));
         m_lastFramePts = firstFrame.pts;
     }
     // Duration will be corrected once we see the last frame; for now use metadata
@@ -440,9 +585,7 @@ void MainWindow::onMediaSelected(const QString& path) {
 void MainWindow::onPlaybackTick(double currentTime) {
     if (!m_playbackFromTimeline) {
         if (m_previewFitData) {
-            QImage renderImage(m_canvasSize, QImage::Format_ARGB32);
-            renderImage.fill(Qt::black);
-
+            QImage renderImage = blankCanvas();
             renderOverlay(renderImage, currentTime);
             m_previewWidget->setComposited(true);
             m_previewWidget->displayFrame(renderImage);
@@ -455,13 +598,13 @@ void MainWindow::onPlaybackTick(double currentTime) {
         if (!m_playbackEngine->isOpen()) return;
 
         TimedFrame frame = m_playbackEngine->nextFrame();
-        if (!frame.image.isNull()) {
+        if (!frame.isNull()) {
             // Sync controller to actual frame PTS to prevent timer drift
             m_playbackController->syncTime(frame.pts);
 
-            QImage renderImage = frame.image.convertToFormat(QImage::Format_ARGB32);
-            renderImage.detach();
-
+            // Sole owner of the pooled buffer: the overlay is drawn in place
+            const VideoInfo& vi = m_playbackEngine->info();
+            QImage renderImage = frameImage(frame, previewSize(QSize(vi.width, vi.height)));
             renderOverlay(renderImage, frame.pts);
             m_previewWidget->displayFrame(renderImage);
 
@@ -513,9 +656,7 @@ void MainWindow::onPlaybackTick(double currentTime) {
         m_currentClipPath.clear();
         m_lastSourceTime = -1.0;
 
-        QImage blackFrame(m_canvasSize, QImage::Format_ARGB32);
-        blackFrame.fill(Qt::black);
-
+        QImage blackFrame = blankCanvas();
         renderOverlay(blackFrame, currentTime);
 
         m_previewWidget->setComposited(true);
@@ -526,26 +667,6 @@ void MainWindow::onPlaybackTick(double currentTime) {
         return;
     }
 
-    // Helper lambda: compose a source frame onto the canvas with the clip's transform
-    auto composeFrame = [this](const QImage& source, const ClipTransform& transform) -> QImage {
-        QImage canvas(m_canvasSize, QImage::Format_ARGB32);
-        canvas.fill(Qt::black);
-        QPainter painter(&canvas);
-        painter.setRenderHint(QPainter::SmoothPixmapTransform);
-
-        QPointF center(canvas.width() / 2.0, canvas.height() / 2.0);
-        painter.translate(center + QPointF(transform.panX, transform.panY));
-        painter.rotate(transform.rotation);
-        double sx = transform.flipH ? -transform.scale : transform.scale;
-        double sy = transform.flipV ? -transform.scale : transform.scale;
-        painter.scale(sx, sy);
-        // Draw source centered
-        painter.drawImage(QPointF(-source.width() / 2.0, -source.height() / 2.0), source);
-        painter.end();
-
-        return canvas;
-    };
-
     if (currentVisualClip->type == ClipType::Image) {
         if (m_currentClipPath != currentVisualClip->sourcePath) {
             if (m_playbackEngine->isOpen()) m_playbackEngine->close();
@@ -553,11 +674,12 @@ void MainWindow::onPlaybackTick(double currentTime) {
         }
         QImage img(m_currentClipPath);
         if (!img.isNull()) {
-            img = img.convertToFormat(QImage::Format_ARGB32);
-            QImage composited = composeFrame(img, currentVisualClip->transform);
+            const QSize imageSize = img.size();
+            QImage composited = applyTransform(img.convertToFormat(QImage::Format_ARGB32_Premultiplied),
+                                               previewTransform(currentVisualClip->transform, imageSize, imageSize));
             renderOverlay(composited, currentTime);
             m_previewWidget->setComposited(true);
-            m_previewWidget->setSourceSize(img.size());
+            m_previewWidget->setSourceSize(imageSize);
             m_previewWidget->showVideo();
             m_previewWidget->displayFrame(composited);
         }
@@ -607,12 +729,10 @@ void MainWindow::onPlaybackTick(double currentTime) {
             for (int i = 0; i < 50; ++i) { // Wait up to 500ms
                 QThread::msleep(10);
                 frame = m_playbackEngine->nextFrame();
-                if (!frame.image.isNull()) break;
+                if (!frame.isNull()) break;
             }
-            if (!frame.image.isNull()) {
-                QImage renderImage = frame.image.convertToFormat(QImage::Format_ARGB32);
-                renderImage.detach();
-                QImage composited = composeFrame(renderImage, currentVisualClip->transform);
+            if (!frame.isNull()) {
+                QImage composited = composeFrame(frame, currentVisualClip->transform, srcSize);
                 renderOverlay(composited, currentTime);
                 m_previewWidget->setComposited(true);
                 m_previewWidget->setSourceSize(srcSize);
@@ -626,16 +746,14 @@ void MainWindow::onPlaybackTick(double currentTime) {
     }
 
     TimedFrame frame = m_playbackEngine->nextFrame();
-    if (!frame.image.isNull()) {
+    if (!frame.isNull()) {
         // Use actual frame PTS to derive the correct timeline time,
         // preventing drift between the synthetic timer and real video time.
         double actualTimelineTime = frame.pts - currentVisualClip->sourceIn + currentVisualClip->timelineOffset;
         m_playbackController->syncTime(actualTimelineTime);
         m_timelineWidget->model()->setPlayheadPosition(actualTimelineTime);
 
-        QImage renderImage = frame.image.convertToFormat(QImage::Format_ARGB32);
-        renderImage.detach();
-        QImage composited = composeFrame(renderImage, currentVisualClip->transform);
+        QImage composited = composeFrame(frame, currentVisualClip->transform, srcSize);
         renderOverlay(composited, actualTimelineTime);
         m_previewWidget->setComposited(true);
         m_previewWidget->setSourceSize(srcSize);
@@ -654,9 +772,14 @@ void MainWindow::onTimelineSeek(double relativeSeconds) {
     onTimelineScrub(relativeSeconds);
 }
 
+FitRecord MainWindow::overlayRecordAt(const FitTrack* track, double fitTime) {
+    if (m_overlayCursor.track() != track) m_overlayCursor.reset(track);
+    return m_overlayCursor.recordAt(fitTime);
+}
+
 void MainWindow::renderOverlay(QImage& frame, double currentTime) {
     FitRecord rec;
-    const FitSession* sessionToRender = nullptr;
+    const FitTrack* trackToRender = nullptr;
     FitSession dummySesh; // Used only if hasFitData is false
 
     bool hasFitData = false;
@@ -679,18 +802,20 @@ void MainWindow::renderOverlay(QImage& frame, double currentTime) {
 
         if (currentFitClip) {
             auto it = m_fitTracks.find(currentFitClip->sourcePath);
-            if (it != m_fitTracks.end() && it->second && !it->second->isEmpty()) {
+            if (it == m_fitTracks.end())
+                requestFitTrack(currentFitClip->sourcePath);
+            else if (it->second && !it->second->isEmpty()) {
                 double sourceTime = currentTime - currentFitClip->timelineOffset + currentFitClip->absoluteStartTime;
-                rec = it->second->getRecordAtTime(sourceTime);
-                sessionToRender = &it->second->session();
+                trackToRender = it->second.get();
+                rec = overlayRecordAt(trackToRender, sourceTime);
                 hasFitData = true;
             }
         }
     } else {
         if (m_previewFitTrack && !m_previewFitTrack->isEmpty()) {
             double searchTime = m_previewFitData ? currentTime + m_previewFitTrack->startTime() : currentTime + m_timeSync->fitTimeOffset();
-            rec = m_previewFitTrack->getRecordAtTime(searchTime);
-            sessionToRender = &m_previewFitTrack->session();
+            trackToRender = m_previewFitTrack.get();
+            rec = overlayRecordAt(trackToRender, searchTime);
             hasFitData = true;
         }
     }
@@ -699,7 +824,7 @@ void MainWindow::renderOverlay(QImage& frame, double currentTime) {
         return;
     }
 
-    m_overlayRenderer->render(frame, rec, *sessionToRender);
+    m_overlayRenderer->render(frame, rec, *trackToRender, 1.0 / m_previewDivisor);
 }
 
 void MainWindow::onTimelineScrub(double relativeSeconds) {
@@ -724,13 +849,11 @@ void MainWindow::onTimelineScrub(double relativeSeconds) {
 void MainWindow::onFitFileOpened(const QString& path) {
     statusBar()->showMessage(QString("Opening FIT file: %1").arg(path));
 
-    FitParser parser;
-    if (parser.parse(path)) {
-        if (!m_previewFitTrack) {
-            m_previewFitTrack = std::make_unique<FitTrack>();
-        }
-        m_previewFitTrack->loadSession(parser.session());
-        statusBar()->showMessage(QString("Loaded FIT file: %1 (Records: %2)").arg(QFileInfo(path).fileName()).arg(m_previewFitTrack->records().size()));
+    QString error;
+    if (auto fitTrack = FitSessionRegistry::instance().acquire(path, &error)) {
+        m_previewFitTrack = std::move(fitTrack);
+        m_mediaBrowser->setFitThumbnail(path, *m_previewFitTrack);
+        statusBar()->showMessage(QString("Loaded FIT file: %1 (Records: %2)").arg(QFileInfo(path).fileName()).arg(m_previewFitTrack->recordCount()));
 
         m_playbackFromTimeline = false;  // must be before stop() to prevent timeline playhead reset
         m_playbackController->stop();
@@ -750,7 +873,7 @@ void MainWindow::onFitFileOpened(const QString& path) {
         // Force an update to show the first frame
         onPlaybackTick(0.0);
     } else {
-        statusBar()->showMessage(QString("Failed to parse FIT file: %1").arg(parser.errorString()));
+        statusBar()->showMessage(QString("Failed to parse FIT file: %1").arg(error));
     }
 }
 
@@ -817,13 +940,14 @@ void MainWindow::onClipSelectionChanged(int trackIndex, int clipIndex) {
         info.type = "FIT Data";
         auto it = m_fitTracks.find(clip.sourcePath);
         if (it != m_fitTracks.end() && it->second) {
-            const auto& session = it->second->session();
-            info.totalRecords = static_cast<int>(session.records.size());
+            const FitTrack& track = *it->second;
+            const auto& session = track.session();
+            info.totalRecords = static_cast<int>(track.recordCount());
             info.totalSeconds = session.totalElapsedTime;
             info.totalDistance = session.totalDistance;
-            if (!session.records.empty()) {
+            if (!track.isEmpty()) {
                 QDateTime dt = QDateTime::fromSecsSinceEpoch(
-                    static_cast<qint64>(session.records.front().timestamp),
+                    static_cast<qint64>(track.startTime()),
                     QTimeZone(8 * 3600));
                 info.firstTimestamp = dt.toString("yyyy-MM-dd HH:mm:ss");
             }
@@ -847,12 +971,10 @@ void MainWindow::onClipSelectionChanged(int trackIndex, int clipIndex) {
     m_propertiesPanel->setClipPlacement(placement);
 }
 
-QImage MainWindow::applyTransform(const QImage& source, const ClipTransform& transform) {
-    if (transform.isIdentity()) return source;
-
-    QImage canvas(m_canvasSize, QImage::Format_ARGB32);
-    canvas.fill(Qt::black);
+QImage MainWindow::applyTransform(QImage source, const ClipTransform& transform) {
+    if (transform.isIdentity() && source.size() == previewSize(m_canvasSize)) return source;
 
+    QImage canvas = blankCanvas();
     QPainter painter(&canvas);
     painter.setRenderHint(QPainter::SmoothPixmapTransform);
 
@@ -868,6 +990,80 @@ QImage MainWindow::applyTransform(const QImage& source, const ClipTransform& tra
     return canvas;
 }
 
+QImage MainWindow::composeFrame(TimedFrame& frame, const ClipTransform& transform, QSize sourceSize) {
+    const QSize frameSize = frame.yuv.isNull() ? frame.image.size() : QSize(frame.yuv.width, frame.yuv.height);
+    const ClipTransform placed = previewTransform(transform, sourceSize, frameSize);
+    if (!frame.yuv.isNull() && FrameCompositor::supports(placed)) {
+        // compose() covers the whole canvas, so no clearing first
+        const QSize canvasSize = previewSize(m_canvasSize);
+        if (m_canvasPool.size() != canvasSize)
+            m_canvasPool.reset(canvasSize, QImage::Format_ARGB32_Premultiplied);
+        QImage canvas = m_canvasPool.acquire();
+        if (FrameCompositor::compose(frame.yuv, placed, canvas)) return canvas;
+    }
+    return applyTransform(frameImage(frame, frameSize), placed);
+}
+
+QImage MainWindow::frameImage(TimedFrame& frame, QSize size) {
+    // RGB frames already come from the decoder at the preview size
+    if (frame.yuv.isNull()) return std::move(frame.image);
+
+    if (m_sourcePool.size() != size)
+        m_sourcePool.reset(size, QImage::Format_RGB32);
+    QImage image = m_sourcePool.acquire();
+    ClipTransform fit;
+    fit.scale = static_cast<double>(size.width()) / frame.yuv.width;
+    if (!FrameCompositor::compose(frame.yuv, fit, image)) return QImage();
+    return image;
+}
+
+QSize MainWindow::previewSize(QSize size) const {
+    // Rounded up, as VideoDecoder::frameSize() is
+    return QSize((size.width() + m_previewDivisor - 1) / m_previewDivisor,
+                 (size.height() + m_previewDivisor - 1) / m_previewDivisor);
+}
+
+ClipTransform MainWindow::previewTransform(const ClipTransform& transform, QSize sourceSize, QSize frameSize) const {
+    // Pan is in output pixels and scale relative to the source, while the
+    // preview canvas is reduced and the frame may be decoded smaller
+    ClipTransform placed = transform;
+    const double frameScale = frameSize.width() > 0
+        ? static_cast<double>(sourceSize.width()) / frameSize.width() : 1.0;
+    placed.scale = transform.scale * frameScale / m_previewDivisor;
+    placed.panX = transform.panX / m_previewDivisor;
+    placed.panY = transform.panY / m_previewDivisor;
+    return placed;
+}
+
+QImage MainWindow::blankCanvas() {
+    const QSize canvasSize = previewSize(m_canvasSize);
+    if (m_canvasPool.size() != canvasSize)
+        m_canvasPool.reset(canvasSize, QImage::Format_ARGB32_Premultiplied);
+    QImage canvas = m_canvasPool.acquire();
+    canvas.fill(Qt::black);
+    return canvas;
+}
+
+void MainWindow::setPreviewResolution(int divisor) {
+    if (divisor == m_previewDivisor) return;
+    m_previewDivisor = divisor;
+    m_playbackEngine->setDownscale(divisor);
+
+    // The decoder settles its resolution when it opens; timeline playback
+    // reopens the clip on the next tick
+    if (m_playbackEngine->isOpen()) {
+        m_playbackEngine->close();
+        if (!m_playbackFromTimeline && m_playbackEngine->open(m_currentClipPath))
+            m_playbackEngine->seek(m_lastFramePts);
+    }
+    if (m_playbackFromTimeline) {
+        onPlaybackTick(m_timelineWidget->model()->playheadPosition());
+    }
+
+    const QSize size = previewSize(m_canvasSize);
+    statusBar()->showMessage(QString("Preview resolution %1x%2").arg(size.width()).arg(size.height()));
+}
+
 void MainWindow::onExportRequested() {
     // TODO: Phase 10 - export dialog
     QMessageBox::information(this, "Export", "Export functionality coming soon.");
@@ -906,8 +1102,13 @@ void MainWindow::onNewProject()
     m_mediaBrowser->clearMedia();
 
     // Clear FIT tracks
+    m_fitLoader->cancel();
     m_fitTracks.clear();
-    m_previewFitTrack->clear();
+    m_requestedFitLoads.clear();
+    m_timelineWidget->clearClipMarkers();
+    m_previewFitTrack.reset();
+    m_overlayCursor.reset();
+    FitSessionRegistry::instance().releaseUnused();
 
     // Reset settings
     m_canvasSize = QSize(1920, 1080);
@@ -1094,24 +1295,31 @@ void MainWindow::updateProjectSettings()
 void MainWindow::loadFitDataForClips()
 {
     m_fitTracks.clear();
-    
+    m_timelineWidget->clearClipMarkers();
+    m_overlayCursor.reset();
+
+    QStringList paths;
     auto* model = m_timelineWidget->model();
     for (int ti = 0; ti < model->trackCount(); ++ti) {
         Track* track = model->track(ti);
         if (!track || track->type() != TrackType::FitData) continue;
-        
+
         for (int ci = 0; ci < track->clipCount(); ++ci) {
             const Clip& clip = track->clip(ci);
-            if (clip.type == ClipType::FitData) {
-                FitParser parser;
-                if (parser.parse(clip.sourcePath)) {
-                    auto fitTrack = std::make_unique<FitTrack>();
-                    fitTrack->loadSession(parser.session());
-                    m_fitTracks[clip.sourcePath] = std::move(fitTrack);
-                }
-            }
+            if (clip.type == ClipType::FitData && !paths.contains(clip.sourcePath))
+                paths.append(clip.sourcePath);
         }
     }
+
+    m_requestedFitLoads = std::set<QString>(paths.begin(), paths.end());
+    m_fitLoader->load(paths);
+}
+
+void MainWindow::requestFitTrack(const QString& path)
+{
+    // Queued once; a failed decode is not retried on every frame
+    if (m_requestedFitLoads.insert(path).second)
+        m_fitLoader->enqueue({path});
 }
 
 void MainWindow::closeEvent(QCloseEvent* event)
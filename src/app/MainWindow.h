@@ -4,7 +4,10 @@
 #include <QDockWidget>
 #include <QSize>
 #include <map>
+#include <set>
 #include <memory>
+#include "FitTrack.h"
+#include "FramePool.h"
 
 class MediaBrowser;
 class PreviewWidget;
@@ -12,11 +15,12 @@ class PropertiesPanel;
 class TimelineWidget;
 class PlaybackController;
 class OverlayRenderer;
-class FitTrack;
+class FitTrackLoader;
 class TimeSync;
 class VideoPlaybackEngine;
 class ProjectManager;
 struct ClipTransform;
+struct TimedFrame;
 struct ProjectSettings;
 
 class MainWindow : public QMainWindow {
@@ -37,6 +41,7 @@ private slots:
     void onTimelineScrub(double relativeSeconds);
     void onClipSelectionChanged(int trackIndex, int clipIndex);
     void onCanvasSettings();
+    void onSaveClimbsAsSegments();
     
     // Project file operations
     void onNewProject();
@@ -51,7 +56,19 @@ private:
     void setupDockWidgets();
     void connectSignals();
     void renderOverlay(QImage& frame, double currentTime);
-    QImage applyTransform(const QImage& source, const ClipTransform& transform);
+    FitRecord overlayRecordAt(const FitTrack* track, double fitTime);
+    // Source placed on the canvas; an untransformed canvas-sized source is
+    // returned as is, so pass frames in by move
+    QImage applyTransform(QImage source, const ClipTransform& transform);
+    // A decoded frame on the canvas; YUV frames are composed directly
+    // unless the rotation needs QPainter
+    QImage composeFrame(TimedFrame& frame, const ClipTransform& transform, QSize sourceSize);
+    QImage frameImage(TimedFrame& frame, QSize size); // RGB32, YUV frames scaled to size
+    QImage blankCanvas(); // black, preview-sized, from m_canvasPool
+    // The preview works at 1/m_previewDivisor of the output
+    QSize previewSize(QSize size) const;
+    ClipTransform previewTransform(const ClipTransform& transform, QSize sourceSize, QSize frameSize) const;
+    void setPreviewResolution(int divisor);
     bool maybeSaveModified(); // returns false if the user cancelled
 
     QDockWidget* m_mediaDock = nullptr;
@@ -65,8 +82,11 @@ private:
     PlaybackController* m_playbackController = nullptr;
 
     std::unique_ptr<OverlayRenderer> m_overlayRenderer;
-    std::map<QString, std::unique_ptr<FitTrack>> m_fitTracks; // per-clip FIT data keyed by source path
-    std::unique_ptr<FitTrack> m_previewFitTrack;
+    std::map<QString, std::shared_ptr<const FitTrack>> m_fitTracks; // per-clip FIT data keyed by source path
+    std::shared_ptr<const FitTrack> m_previewFitTrack;
+    FitTrack::Cursor m_overlayCursor; // follows playback through the track being rendered
+    std::unique_ptr<FitTrackLoader> m_fitLoader; // parallel FIT loading for project clips
+    std::set<QString> m_requestedFitLoads; // clip tracks already handed to m_fitLoader
     std::unique_ptr<TimeSync> m_timeSync;
     std::unique_ptr<VideoPlaybackEngine> m_playbackEngine;
     double m_lastFramePts = 0.0;  // tracks actual video duration from decoded PTS
@@ -78,6 +98,9 @@ private:
     double m_lastSourceTime = -1.0; // previous tick's source time
 
     QSize m_canvasSize{1920, 1080}; // output canvas dimensions
+    FramePool m_canvasPool;         // canvas-sized buffers for composited frames
+    FramePool m_sourcePool;         // source-sized buffers for converted YUV frames
+    int m_previewDivisor = 1;       // preview at full, half or quarter size (1, 2, 4)
     int m_selectedTrackIndex = -1;
     int m_selectedClipIndex = -1;
     
@@ -90,4 +113,6 @@ private:
     ProjectSettings collectProjectSettings() const;
     void applyProjectSettings(const ProjectSettings& settings);
     void loadFitDataForClips();
+    // Decodes a placed clip's records the first time an overlay needs them
+    void requestFitTrack(const QString& path);
 };
@@ -0,0 +1,271 @@
+#include "FitAnalytics.h"
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// Whether the interval from sample i to i + 1 carries data for a channel
+// with the given validity flag (-1 for always valid)
+bool intervalCounts(const FitColumns& columns, int flag, size_t i) {
+    const double dt = columns.timestamp[i + 1] - columns.timestamp[i];
+    if (dt > FitAnalytics::MaxGapSeconds) return false;
+    return flag < 0 || (columns.flags[flag].test(i) && columns.flags[flag].test(i + 1));
+}
+
+// Orders the ends and clamps them to the samples
+void normalize(FitTimePoint& from, FitTimePoint& to, size_t n) {
+    if (to.index < from.index || (to.index == from.index && to.t < from.t))
+        std::swap(from, to);
+    for (FitTimePoint* p : {&from, &to}) {
+        // A point on a sample is that sample, not the end of the interval
+        // before it
+        if (p->t >= 1.0) *p = {p->index + 1, 0.0};
+        if (p->index >= n - 1) *p = {n - 1, 0.0};
+        if (p->t < 0.0) p->t = 0.0;
+    }
+}
+
+} // anonymous namespace
+
+void FitAnalytics::build(const FitColumns& columns, size_t first) {
+    if (m_columns != &columns || first == 0) {
+        clear();
+        first = 0;
+    }
+    m_columns = &columns;
+    const size_t n = columns.size();
+    if (n == 0) return;
+    const std::vector<double>& time = columns.timestamp;
+
+    // Sums up to every BlockSize-th sample; queries add the rest of the
+    // block (see intervalSum). Interval first - 1 ends on the first changed
+    // sample, so the sums restart at the mark before it.
+    const size_t marks = (n - 1) / BlockSize + 1;
+    auto prefix = [&](std::vector<double>& sums, auto&& area) {
+        size_t mark = first > 0 ? (first - 1) / BlockSize : 0;
+        if (mark >= sums.size()) mark = 0;
+        double sum = mark > 0 ? sums[mark] : 0.0;
+        sums.resize(marks);
+        for (size_t i = mark * BlockSize; i + 1 < n; ++i) {
+            if (i % BlockSize == 0) sums[i / BlockSize] = sum;
+            sum += area(i);
+        }
+        if ((n - 1) % BlockSize == 0) sums[marks - 1] = sum;
+    };
+
+    bool coveredDone[static_cast<int>(FitFlag::Count) + 1] = {};
+    for (int c = 0; c < static_cast<int>(FitChannel::Count); ++c) {
+        const FitChannel channel = static_cast<FitChannel>(c);
+        const int flag = channelFlag(channel);
+        const std::vector<float>& v = columns.channel(channel);
+
+        if (!coveredDone[flag + 1]) {
+            prefix(m_covered[flag + 1], [&](size_t i) {
+                return intervalCounts(columns, flag, i) ? time[i + 1] - time[i] : 0.0;
+            });
+            coveredDone[flag + 1] = true;
+        }
+
+        // Trapezoids of the interpolated signal
+        prefix(m_integral[c], [&](size_t i) {
+            if (!intervalCounts(columns, flag, i)) return 0.0;
+            return 0.5 * (static_cast<double>(v[i]) + v[i + 1]) * (time[i + 1] - time[i]);
+        });
+
+        // Sparse table over blocks: level k combines two halves of level
+        // k - 1. Entries that only cover blocks before `first` are kept.
+        auto& table = m_sparse[c];
+        const size_t blocks = (n + BlockSize - 1) / BlockSize;
+        const size_t firstBlock = first / BlockSize;
+        if (table.empty()) table.emplace_back();
+        std::vector<FitMinMax>& base = table.front();
+        size_t from = std::min(firstBlock, base.size());
+        base.resize(blocks);
+        for (size_t b = from; b < blocks; ++b) {
+            base[b] = FitMinMax{};
+            scan(channel, b * BlockSize, std::min(n, (b + 1) * BlockSize), base[b]);
+        }
+        size_t k = 1;
+        for (size_t width = 2; width <= blocks; width *= 2, ++k) {
+            if (k == table.size()) table.emplace_back();
+            const std::vector<FitMinMax>& below = table[k - 1];
+            std::vector<FitMinMax>& level = table[k];
+            const size_t size = blocks - width + 1;
+            from = std::min(firstBlock >= width - 1 ? firstBlock - (width - 1) : 0, level.size());
+            level.resize(size);
+            for (size_t b = from; b < size; ++b) {
+                level[b] = below[b];
+                level[b].add(below[b + width / 2]);
+            }
+        }
+        table.resize(k);
+    }
+
+    const size_t blocks = m_sparse[0].front().size();
+    m_log2.assign(blocks + 1, 0);
+    for (size_t i = 2; i <= blocks; ++i)
+        m_log2[i] = static_cast<uint8_t>(m_log2[i / 2] + 1);
+}
+
+void FitAnalytics::clear() {
+    m_columns = nullptr;
+    for (auto& v : m_integral) v.clear();
+    for (auto& v : m_covered) v.clear();
+    for (auto& t : m_sparse) t.clear();
+    m_log2.clear();
+}
+
+bool FitAnalytics::covers(FitChannel channel, size_t i) const {
+    if (empty() || i + 1 >= m_columns->size()) return false;
+    return intervalCounts(*m_columns, channelFlag(channel), i);
+}
+
+float FitAnalytics::valueAt(FitChannel channel, const FitTimePoint& p) const {
+    const std::vector<float>& v = m_columns->channel(channel);
+    if (p.t <= 0.0) return v[p.index];
+    return v[p.index] + static_cast<float>(p.t) * (v[p.index + 1] - v[p.index]);
+}
+
+void FitAnalytics::intervalSum(FitChannel channel, size_t first, size_t last,
+                               double& integral, double& covered) const {
+    const std::vector<double>& time = m_columns->timestamp;
+    const std::vector<float>& v = m_columns->channel(channel);
+    const int flag = channelFlag(channel);
+    for (size_t i = first; i < last; ++i) {
+        if (!intervalCounts(*m_columns, flag, i)) continue;
+        const double dt = time[i + 1] - time[i];
+        integral += 0.5 * (static_cast<double>(v[i]) + v[i + 1]) * dt;
+        covered += dt;
+    }
+}
+
+double FitAnalytics::integralTo(FitChannel channel, const FitTimePoint& p) const {
+    const size_t block = p.index / BlockSize;
+    double sum = m_integral[static_cast<int>(channel)][block];
+    double seconds = 0.0;
+    intervalSum(channel, block * BlockSize, p.index, sum, seconds);
+    if (p.t > 0.0 && covers(channel, p.index)) {
+        const std::vector<double>& time = m_columns->timestamp;
+        const double start = m_columns->channel(channel)[p.index];
+        sum += 0.5 * (start + valueAt(channel, p)) * p.t * (time[p.index + 1] - time[p.index]);
+    }
+    return sum;
+}
+
+double FitAnalytics::coveredTo(FitChannel channel, const FitTimePoint& p) const {
+    const size_t block = p.index / BlockSize;
+    double sum = 0.0;
+    double seconds = m_covered[channelFlag(channel) + 1][block];
+    intervalSum(channel, block * BlockSize, p.index, sum, seconds);
+    if (p.t > 0.0 && covers(channel, p.index)) {
+        const std::vector<double>& time = m_columns->timestamp;
+        seconds += p.t * (time[p.index + 1] - time[p.index]);
+    }
+    return seconds;
+}
+
+FitRangeStats FitAnalytics::stats(FitChannel channel, FitTimePoint from, FitTimePoint to) const {
+    FitRangeStats result;
+    if (empty()) return result;
+    normalize(from, to, m_columns->size());
+
+    result.integral = integralTo(channel, to) - integralTo(channel, from);
+    result.duration = coveredTo(channel, to) - coveredTo(channel, from);
+
+    // Samples inside the range, plus the blended values at its ends
+    const size_t first = from.t > 0.0 ? from.index + 1 : from.index;
+    result.extremes = extremes(channel, first, to.index + 1);
+    for (const FitTimePoint& p : {from, to}) {
+        if (p.t > 0.0 && covers(channel, p.index))
+            result.extremes.add(valueAt(channel, p));
+    }
+    return result;
+}
+
+void FitAnalytics::scan(FitChannel channel, size_t first, size_t last, FitMinMax& out) const {
+    const std::vector<float>& v = m_columns->channel(channel);
+    const int flag = channelFlag(channel);
+    if (flag < 0) {
+        for (size_t i = first; i < last; ++i) out.add(v[i]);
+        return;
+    }
+    const FitBitmap& valid = m_columns->flags[flag];
+    for (size_t i = first; i < last; ++i)
+        if (valid.test(i)) out.add(v[i]);
+}
+
+FitMinMax FitAnalytics::extremes(FitChannel channel, size_t first, size_t last) const {
+    FitMinMax result;
+    if (empty()) return result;
+    last = std::min(last, m_columns->size());
+    if (first >= last) return result;
+
+    const size_t firstBlock = first / BlockSize;
+    const size_t lastBlock = (last - 1) / BlockSize;
+    if (lastBlock <= firstBlock + 1) {
+        scan(channel, first, last, result);
+        return result;
+    }
+
+    // Partial blocks at the ends, then two overlapping table entries
+    // covering the whole blocks between them
+    scan(channel, first, (firstBlock + 1) * BlockSize, result);
+    scan(channel, lastBlock * BlockSize, last, result);
+    const size_t lo = firstBlock + 1;
+    const size_t count = lastBlock - lo;
+    const int k = m_log2[count];
+    const auto& level = m_sparse[static_cast<int>(channel)][k];
+    result.add(level[lo]);
+    result.add(level[lastBlock - (size_t(1) << k)]);
+    return result;
+}
+
+void FitBandIndex::build(const FitColumns& columns, FitChannel channel, std::vector<float> edges) {
+    clear();
+    m_columns = &columns;
+    m_channel = channel;
+    std::sort(edges.begin(), edges.end());
+    if (edges.size() >= NoBand) edges.resize(NoBand - 1);
+    m_edges = std::move(edges);
+
+    const size_t n = columns.size();
+    m_seconds.assign(m_edges.size() + 1, std::vector<double>(n, 0.0));
+    if (n == 0) return;
+
+    const std::vector<double>& time = columns.timestamp;
+    const std::vector<float>& v = columns.channel(channel);
+    const int flag = channelFlag(channel);
+    m_band.assign(n - 1, NoBand);
+    for (size_t i = 0; i + 1 < n; ++i) {
+        if (intervalCounts(columns, flag, i))
+            m_band[i] = static_cast<uint8_t>(bandOf(0.5f * (v[i] + v[i + 1])));
+        for (size_t b = 0; b < m_seconds.size(); ++b)
+            m_seconds[b][i + 1] = m_seconds[b][i] + (m_band[i] == b ? time[i + 1] - time[i] : 0.0);
+    }
+}
+
+void FitBandIndex::clear() {
+    m_columns = nullptr;
+    m_edges.clear();
+    m_band.clear();
+    m_seconds.clear();
+}
+
+size_t FitBandIndex::bandOf(float value) const {
+    return static_cast<size_t>(std::upper_bound(m_edges.begin(), m_edges.end(), value) - m_edges.begin());
+}
+
+double FitBandIndex::secondsTo(size_t band, const FitTimePoint& p) const {
+    double seconds = m_seconds[band][p.index];
+    if (p.t > 0.0 && m_band[p.index] == band) {
+        const std::vector<double>& time = m_columns->timestamp;
+        seconds += p.t * (time[p.index + 1] - time[p.index]);
+    }
+    return seconds;
+}
+
+double FitBandIndex::seconds(size_t band, FitTimePoint from, FitTimePoint to) const {
+    if (empty() || band >= m_seconds.size()) return 0.0;
+    normalize(from, to, m_columns->size());
+    return secondsTo(band, to) - secondsTo(band, from);
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "FitColumns.h"
+#include "FitPyramid.h"
+
+// Position on a track's time axis: the interval from sample `index` to the
+// next one, and how far into it (FitTrack::locate)
+struct FitTimePoint {
+    size_t index = 0;
+    double t = 0.0;     // 0 at the sample, towards 1 at the next
+};
+
+// Time-weighted statistics of one channel over a time range
+struct FitRangeStats {
+    double duration = 0.0;  // seconds covered by valid samples
+    double integral = 0.0;  // value x seconds (for power: joules)
+    FitMinMax extremes;     // including the interpolated range ends
+
+    bool empty() const { return duration <= 0.0 && extremes.empty(); }
+    double average() const { return duration > 0.0 ? integral / duration : 0.0; }
+};
+
+// Running statistics over any time range of a track in O(1), built once per
+// track: prefix sums of the linearly interpolated signal at every block of
+// records for sums and averages, and a sparse table over the blocks for
+// min/max. The partial blocks at the ends are scanned, at most 2 * BlockSize
+// records; storing only block sums keeps the index at a few bytes per record.
+//
+// An interval between two samples counts when both have the value (heart
+// rate, cadence, power) and it is no longer than MaxGapSeconds, so pauses do
+// not pull averages down. Refers to the columns it was built from.
+class FitAnalytics {
+public:
+    static constexpr double MaxGapSeconds = 30.0;
+
+    // Samples before first are taken as unchanged since the last build from
+    // the same columns, so appending costs about the new samples
+    void build(const FitColumns& columns, size_t first = 0);
+    void clear();
+
+    bool empty() const { return !m_columns || m_columns->empty(); }
+
+    // Statistics over [from, to]; swapped ends are put in order
+    FitRangeStats stats(FitChannel channel, FitTimePoint from, FitTimePoint to) const;
+
+    // Min/max of the records [first, last)
+    FitMinMax extremes(FitChannel channel, size_t first, size_t last) const;
+
+    // Whether interval i (samples i and i + 1) counts for the channel
+    bool covers(FitChannel channel, size_t i) const;
+
+    // Integral and covered seconds from the first sample up to p, which must
+    // lie on the track (index below the last sample unless t is 0)
+    double integralTo(FitChannel channel, const FitTimePoint& p) const;
+    double coveredTo(FitChannel channel, const FitTimePoint& p) const;
+
+private:
+    static constexpr size_t BlockSize = 64;
+
+    // Value at a point, blended towards the next sample
+    float valueAt(FitChannel channel, const FitTimePoint& p) const;
+    // Adds the counted intervals [first, last) to the integral and seconds
+    void intervalSum(FitChannel channel, size_t first, size_t last,
+                     double& integral, double& covered) const;
+    void scan(FitChannel channel, size_t first, size_t last, FitMinMax& out) const;
+
+    const FitColumns* m_columns = nullptr;
+    // [b] = up to sample b * BlockSize
+    std::vector<double> m_integral[static_cast<int>(FitChannel::Count)];
+    std::vector<double> m_covered[static_cast<int>(FitFlag::Count) + 1]; // by channelFlag() + 1
+
+    // table[k][b] = min/max of blocks [b, b + 2^k)
+    std::vector<std::vector<FitMinMax>> m_sparse[static_cast<int>(FitChannel::Count)];
+    std::vector<uint8_t> m_log2;    // floor(log2(n)) for block counts
+};
+
+// Seconds a channel spends in each of a few bands (e.g. heart rate zones)
+// over any time range in O(1). Band 0 is below edges[0], band k is
+// [edges[k - 1], edges[k]), the last band is at or above edges.back(). An
+// interval is assigned by its mid value. Intervals are counted as in
+// FitAnalytics; refers to the columns it was built from.
+class FitBandIndex {
+public:
+    void build(const FitColumns& columns, FitChannel channel, std::vector<float> edges);
+    void clear();
+
+    bool empty() const { return !m_columns || m_columns->empty(); }
+    size_t bandCount() const { return m_seconds.size(); }
+    const std::vector<float>& edges() const { return m_edges; }
+    FitChannel channel() const { return m_channel; }
+
+    // Band a value falls into
+    size_t bandOf(float value) const;
+
+    // Seconds in the band over [from, to]
+    double seconds(size_t band, FitTimePoint from, FitTimePoint to) const;
+
+private:
+    static constexpr uint8_t NoBand = 0xff;
+
+    double secondsTo(size_t band, const FitTimePoint& p) const;
+
+    const FitColumns* m_columns = nullptr;
+    FitChannel m_channel = FitChannel::HeartRate;
+    std::vector<float> m_edges;
+    std::vector<uint8_t> m_band;                // per interval, NoBand if not counted
+    std::vector<std::vector<double>> m_seconds; // [band][i] = up to sample i
+};
@@ -0,0 +1,82 @@
+#include "FitClimbs.h"
+#include "FitColumns.h"
+#include "FitData.h"
+#include "FitDistanceIndex.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// A descent this deep (metres) ends a climb; shallower dips are part of it
+constexpr double DIP_TOLERANCE = 10.0;
+// Height (metres) within which the flat ends of a climb are trimmed off
+constexpr double EDGE_TOLERANCE = 1.0;
+constexpr double MIN_AVERAGE_GRADE = 3.0;   // percent
+// Category thresholds of length (m) x average grade (%), hardest first
+constexpr double CATEGORY_SCORES[] = {80000.0, 64000.0, 32000.0, 16000.0, 8000.0};
+
+} // anonymous namespace
+
+std::vector<FitClimb> detectClimbs(const FitColumns& columns, const FitDistanceIndex& distance) {
+    std::vector<FitClimb> climbs;
+    const size_t n = columns.size();
+    if (n < 2 || distance.size() != n || distance.empty()) return climbs;
+
+    // Smoothed elevation relative to the start; the grade channel is in
+    // degrees, whether computed or recorded
+    const std::vector<float>& grade = columns.channel(FitChannel::Grade);
+    std::vector<double> elevation(n, 0.0);
+    for (size_t i = 1; i < n; ++i) {
+        const double slope = percentFromGrade(0.5 * (grade[i - 1] + grade[i])) / 100.0;
+        elevation[i] = elevation[i - 1] + slope * (distance.at(i) - distance.at(i - 1));
+    }
+
+    auto close = [&](size_t low, size_t high) {
+        // Start where the road leaves the low point's level and end where it
+        // reaches the top's, so flats at either end do not dilute the grade
+        const double foot = elevation[low], top = elevation[high];
+        while (low + 1 < high && elevation[low + 1] - foot < EDGE_TOLERANCE) ++low;
+        while (high > low + 1 && top - elevation[high - 1] < EDGE_TOLERANCE) --high;
+        const double length = distance.at(high) - distance.at(low);
+        const double gain = elevation[high] - elevation[low];
+        if (length <= 0.0) return;
+        const double average = gain / length * 100.0;
+        const double score = length * average;
+        if (average < MIN_AVERAGE_GRADE || score < CATEGORY_SCORES[4]) return;
+
+        FitClimb climb;
+        climb.first = low;
+        climb.last = high;
+        climb.startTime = columns.timestamp[low];
+        climb.endTime = columns.timestamp[high];
+        climb.startDistance = distance.at(low);
+        climb.length = static_cast<float>(length);
+        climb.gain = static_cast<float>(gain);
+        climb.averageGrade = static_cast<float>(average);
+        float steepest = grade[low];
+        for (size_t i = low + 1; i <= high; ++i) steepest = std::max(steepest, grade[i]);
+        climb.maxGrade = static_cast<float>(percentFromGrade(steepest));
+        climb.category = 0;
+        while (score < CATEGORY_SCORES[climb.category]) ++climb.category;
+        climbs.push_back(climb);
+    };
+
+    // low: lowest point since the last climb (the latest one on a flat);
+    // high: top of the climb in progress
+    size_t low = 0, high = 0;
+    bool climbing = false;
+    for (size_t i = 1; i < n; ++i) {
+        if (!climbing) {
+            if (elevation[i] <= elevation[low]) low = i;
+            else if (elevation[i] - elevation[low] > DIP_TOLERANCE) { climbing = true; high = i; }
+        } else if (elevation[i] > elevation[high]) {
+            high = i;
+        } else if (elevation[high] - elevation[i] > DIP_TOLERANCE) {
+            close(low, high);
+            climbing = false;
+            low = i;
+        }
+    }
+    if (climbing) close(low, high);
+    return climbs;
+}
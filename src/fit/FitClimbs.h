@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+struct FitColumns;
+class FitDistanceIndex;
+
+// A climb found on a track's elevation profile
+struct FitClimb {
+    size_t first = 0;           // record at the foot
+    size_t last = 0;            // record at the top
+    double startTime = 0.0;
+    double endTime = 0.0;
+    float startDistance = 0.0f; // metres, on the monotonic distance axis
+    float length = 0.0f;        // metres
+    float gain = 0.0f;          // metres climbed, on the smoothed profile
+    float averageGrade = 0.0f;  // percent
+    float maxGrade = 0.0f;      // percent, highest record grade on the way
+    int category = 0;           // 4 (easiest) .. 1, 0 = hors catégorie
+
+    float endDistance() const { return startDistance + length; }
+};
+
+// Finds the climbs of a track in one pass over the smoothed elevation that
+// the grade column describes (the grade integrated along distance), so GPS
+// and barometer noise does not split or invent climbs. A climb runs from a
+// low point to the highest point before the road drops more than a few
+// metres below it, and counts when its length times its average grade
+// reaches the category 4 threshold (8000, e.g. 2 km at 4%).
+std::vector<FitClimb> detectClimbs(const FitColumns& columns, const FitDistanceIndex& distance);
@@ -0,0 +1,123 @@
+#include "FitColumns.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace {
+
+template <typename T>
+void gather(std::vector<T>& column, const std::vector<size_t>& order) {
+    std::vector<T> sorted(column.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        sorted[i] = column[order[i]];
+    column.swap(sorted);
+}
+
+} // anonymous namespace
+
+void FitColumns::clear() {
+    timestamp.clear();
+    latitude.clear();
+    longitude.clear();
+    for (auto& c : channels) c.clear();
+    for (auto& f : flags) f.clear();
+}
+
+void FitColumns::reserve(size_t n) {
+    timestamp.reserve(n);
+    latitude.reserve(n);
+    longitude.reserve(n);
+    for (auto& c : channels) c.reserve(n);
+    for (auto& f : flags) f.reserve(n);
+}
+
+void FitColumns::resize(size_t n) {
+    timestamp.resize(n, 0.0);
+    latitude.resize(n, 0.0);
+    longitude.resize(n, 0.0);
+    for (auto& c : channels) c.resize(n, 0.0f);
+    for (auto& f : flags) f.resize(n);
+}
+
+void FitColumns::append(const FitRecord& r) {
+    resize(size() + 1);
+    set(size() - 1, r);
+}
+
+void FitColumns::appendRow(const FitColumns& src, size_t i) {
+    timestamp.push_back(src.timestamp[i]);
+    latitude.push_back(src.latitude[i]);
+    longitude.push_back(src.longitude[i]);
+    for (int c = 0; c < static_cast<int>(FitChannel::Count); ++c)
+        channels[c].push_back(src.channels[c][i]);
+    for (int f = 0; f < static_cast<int>(FitFlag::Count); ++f)
+        flags[f].push_back(src.flags[f].test(i));
+}
+
+void FitColumns::set(size_t i, const FitRecord& r) {
+    timestamp[i] = r.timestamp;
+    latitude[i] = r.latitude;
+    longitude[i] = r.longitude;
+    channel(FitChannel::Altitude)[i] = r.altitude;
+    channel(FitChannel::Speed)[i] = r.speed;
+    channel(FitChannel::HeartRate)[i] = r.heartRate;
+    channel(FitChannel::Cadence)[i] = r.cadence;
+    channel(FitChannel::Power)[i] = r.power;
+    channel(FitChannel::Distance)[i] = r.distance;
+    channel(FitChannel::Temperature)[i] = r.temperature;
+    channel(FitChannel::Grade)[i] = r.grade;
+    flag(FitFlag::Gps).set(i, r.hasGps);
+    flag(FitFlag::HeartRate).set(i, r.hasHeartRate);
+    flag(FitFlag::Cadence).set(i, r.hasCadence);
+    flag(FitFlag::Power).set(i, r.hasPower);
+    flag(FitFlag::Grade).set(i, r.hasGrade);
+}
+
+FitRecord FitColumns::record(size_t i) const {
+    FitRecord r;
+    r.timestamp = timestamp[i];
+    r.latitude = latitude[i];
+    r.longitude = longitude[i];
+    r.altitude = channel(FitChannel::Altitude)[i];
+    r.speed = channel(FitChannel::Speed)[i];
+    r.heartRate = channel(FitChannel::HeartRate)[i];
+    r.cadence = channel(FitChannel::Cadence)[i];
+    r.power = channel(FitChannel::Power)[i];
+    r.distance = channel(FitChannel::Distance)[i];
+    r.temperature = channel(FitChannel::Temperature)[i];
+    r.grade = channel(FitChannel::Grade)[i];
+    r.hasGps = has(FitFlag::Gps, i);
+    r.hasHeartRate = has(FitFlag::HeartRate, i);
+    r.hasCadence = has(FitFlag::Cadence, i);
+    r.hasPower = has(FitFlag::Power, i);
+    r.hasGrade = has(FitFlag::Grade, i);
+    return r;
+}
+
+void FitColumns::sortByTime() {
+    if (std::is_sorted(timestamp.begin(), timestamp.end())) return;
+
+    std::vector<size_t> order(size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(),
+        [this](size_t a, size_t b) { return timestamp[a] < timestamp[b]; });
+
+    gather(timestamp, order);
+    gather(latitude, order);
+    gather(longitude, order);
+    for (auto& c : channels) gather(c, order);
+    for (auto& f : flags) {
+        FitBitmap sorted;
+        sorted.resize(f.size());
+        for (size_t i = 0; i < order.size(); ++i)
+            sorted.set(i, f.test(order[i]));
+        f = std::move(sorted);
+    }
+}
+
+size_t FitSampleTable::frameAt(double unixTimestamp) const {
+    if (columns.empty() || step <= 0.0) return 0;
+    double frame = std::round((unixTimestamp - startTime) / step);
+    if (frame <= 0.0) return 0;
+    return std::min(static_cast<size_t>(frame), columns.size() - 1);
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "FitData.h"
+
+// Float channels stored as one contiguous column each. Time and GPS
+// coordinates are kept as double columns outside this enum.
+enum class FitChannel {
+    Altitude,
+    Speed,
+    HeartRate,
+    Cadence,
+    Power,
+    Distance,
+    Temperature,
+    Grade,
+    // Derived from the channels above once per track (FitDerived.h)
+    Power3s,            // W, mean over the trailing 3 s
+    Power30s,           // W, mean over the trailing 30 s
+    NormalizedPower,    // W, normalized power of the ride so far
+    Vam,                // m/h, climbing rate over the trailing 60 s
+    WPrimeBalance,      // J, W' left in the tank
+    HeartRateZone,      // 1-5 (0 without heart rate)
+    Count
+};
+
+// Channels FitRecord carries (Altitude .. Grade)
+constexpr int FitRecordChannelCount = static_cast<int>(FitChannel::Grade) + 1;
+
+// Per-record validity flags (the hasX bools of FitRecord)
+enum class FitFlag {
+    Gps,
+    HeartRate,
+    Cadence,
+    Power,
+    Grade,
+    Count
+};
+
+// Flag a record needs for the channel to count, or -1 if always valid
+inline int channelFlag(FitChannel channel) {
+    switch (channel) {
+    case FitChannel::HeartRate: return static_cast<int>(FitFlag::HeartRate);
+    case FitChannel::Cadence:   return static_cast<int>(FitFlag::Cadence);
+    case FitChannel::Power:     return static_cast<int>(FitFlag::Power);
+    default:                    return -1;
+    }
+}
+
+// Packed bit-per-record validity mask
+class FitBitmap {
+public:
+    size_t size() const { return m_size; }
+
+    bool test(size_t i) const { return (m_words[i >> 6] >> (i & 63)) & 1u; }
+
+    void set(size_t i, bool value) {
+        const uint64_t bit = uint64_t(1) << (i & 63);
+        if (value) m_words[i >> 6] |= bit;
+        else m_words[i >> 6] &= ~bit;
+    }
+
+    void resize(size_t n) {
+        m_words.resize((n + 63) / 64, 0);
+        // Clear stale bits past the end so any() and later growth stay correct
+        if (n & 63) m_words.back() &= (uint64_t(1) << (n & 63)) - 1;
+        m_size = n;
+    }
+
+    void reserve(size_t n) { m_words.reserve((n + 63) / 64); }
+
+    // Adopts n bits from a packed word array (e.g. a cache file)
+    void assign(const uint64_t* words, size_t n) {
+        m_words.assign(words, words + (n + 63) / 64);
+        resize(n);
+    }
+    void push_back(bool value) { resize(m_size + 1); set(m_size - 1, value); }
+    void clear() { m_words.clear(); m_size = 0; }
+
+    bool any() const {
+        for (uint64_t w : m_words)
+            if (w) return true;
+        return false;
+    }
+
+    const std::vector<uint64_t>& words() const { return m_words; }
+
+private:
+    std::vector<uint64_t> m_words;
+    size_t m_size = 0;
+};
+
+// Structure-of-arrays storage for a time-sorted track. A consumer that needs
+// a single channel touches only that column (and the timestamp column).
+struct FitColumns {
+    std::vector<double> timestamp;
+    std::vector<double> latitude;
+    std::vector<double> longitude;
+    std::vector<float> channels[static_cast<int>(FitChannel::Count)];
+    FitBitmap flags[static_cast<int>(FitFlag::Count)];
+
+    size_t size() const { return timestamp.size(); }
+    bool empty() const { return timestamp.empty(); }
+
+    std::vector<float>& channel(FitChannel c) { return channels[static_cast<int>(c)]; }
+    const std::vector<float>& channel(FitChannel c) const { return channels[static_cast<int>(c)]; }
+    FitBitmap& flag(FitFlag f) { return flags[static_cast<int>(f)]; }
+    const FitBitmap& flag(FitFlag f) const { return flags[static_cast<int>(f)]; }
+    bool has(FitFlag f, size_t i) const { return flags[static_cast<int>(f)].test(i); }
+
+    void clear();
+    void reserve(size_t n);
+    void resize(size_t n);
+    void append(const FitRecord& r);
+    // Appends row i of another column set without going through FitRecord
+    void appendRow(const FitColumns& src, size_t i);
+    void set(size_t i, const FitRecord& r);
+
+    // Materializes one row as a FitRecord
+    FitRecord record(size_t i) const;
+
+    // Stable sort of all columns by timestamp (no-op when already sorted)
+    void sortByTime();
+};
+
+// Track values resampled on a regular frame grid (FitTrack::sampleRange).
+// Row i holds the values at startTime + i * step, so an exporter computes the
+// table once and reads frames by index instead of searching the track.
+struct FitSampleTable {
+    double startTime = 0.0;
+    double step = 0.0;
+    FitColumns columns; // timestamp column holds the clamped sample times
+
+    size_t size() const { return columns.size(); }
+    bool empty() const { return columns.empty(); }
+    const std::vector<float>& channel(FitChannel c) const { return columns.channel(c); }
+
+    // Nearest row for a time on (or near) the grid, clamped to the table
+    size_t frameAt(double unixTimestamp) const;
+    FitRecord record(size_t frame) const { return columns.record(frame); }
+};
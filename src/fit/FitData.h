@@ -1,9 +1,19 @@
 #pragma once
 
+#include <cmath>
 #include <cstdint>
 #include <vector>
 #include <QString>
 
+// FIT files record grade as a percentage; the grade channel holds the slope
+// angle in degrees, like the grades FitGrade computes
+inline float gradeFromPercent(double percent) {
+    return static_cast<float>(std::atan(percent / 100.0) * 180.0 / 3.14159265358979323846);
+}
+inline double percentFromGrade(double degrees) {
+    return std::tan(degrees * 3.14159265358979323846 / 180.0) * 100.0;
+}
+
 struct FitRecord {
     double timestamp = 0.0;       // Unix timestamp (seconds)
     double latitude = 0.0;        // degrees
@@ -15,7 +25,7 @@ struct FitRecord {
     float power = 0.0f;           // watts
     float distance = 0.0f;        // meters (cumulative)
     float temperature = 0.0f;     // celsius
-    float grade = 0.0f;           // inclination / slope degree
+    float grade = 0.0f;           // inclination / slope degree (see gradeFromPercent)
     bool hasGps = false;
     bool hasHeartRate = false;
     bool hasCadence = false;
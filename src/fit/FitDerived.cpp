@@ -0,0 +1,140 @@
+#include "FitDerived.h"
+#include "FitColumns.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+constexpr double SHORT_WINDOW = 3.0;
+constexpr double NP_WINDOW = 30.0;
+constexpr double VAM_WINDOW = 60.0;
+// Shorter spans (the first seconds, right after a pause) give no VAM
+constexpr double VAM_MIN_SPAN = 10.0;
+
+// First record in [0, first) with a timestamp above t
+size_t firstAfter(const std::vector<double>& time, size_t first, double t) {
+    return static_cast<size_t>(std::upper_bound(time.begin(), time.begin() + first, t) - time.begin());
+}
+
+// Mean of the valid power samples in (t - window, t] for records [first, n)
+void trailingPower(const FitColumns& columns, double window, size_t first, std::vector<float>& out) {
+    const std::vector<double>& time = columns.timestamp;
+    const std::vector<float>& power = columns.channel(FitChannel::Power);
+    const FitBitmap& valid = columns.flag(FitFlag::Power);
+    const size_t n = columns.size();
+
+    double sum = 0.0;
+    size_t count = 0;
+    size_t lo = first < n ? firstAfter(time, first, time[first] - window) : first;
+    for (size_t j = lo; j < first; ++j) {
+        if (valid.test(j)) { sum += power[j]; ++count; }
+    }
+    for (size_t i = first; i < n; ++i) {
+        if (valid.test(i)) { sum += power[i]; ++count; }
+        for (; time[lo] <= time[i] - window; ++lo) {
+            if (valid.test(lo)) { sum -= power[lo]; --count; }
+        }
+        out[i] = count > 0 ? static_cast<float>(sum / static_cast<double>(count)) : 0.0f;
+    }
+}
+
+void normalizedPower(FitColumns& columns, size_t first, std::vector<FitDerivedState::Mark>& marks) {
+    constexpr size_t Interval = FitDerivedState::MarkInterval;
+    const std::vector<double>& time = columns.timestamp;
+    const std::vector<float>& rolling = columns.channel(FitChannel::Power30s);
+    const FitBitmap& valid = columns.flag(FitFlag::Power);
+    std::vector<float>& out = columns.channel(FitChannel::NormalizedPower);
+    const size_t n = columns.size();
+    const double warm = time.front() + NP_WINDOW;
+
+    // Continue from the last mark at or before first; the records from it
+    // up to first only add to the sum
+    marks.resize(std::min(marks.size(), first / Interval + 1));
+    if (marks.empty()) marks.emplace_back();
+    double sum = marks.back().sum;
+    size_t count = marks.back().count;
+
+    for (size_t i = (marks.size() - 1) * Interval; i < n; ++i) {
+        if (i % Interval == 0 && i / Interval == marks.size()) marks.push_back({sum, count});
+        if (valid.test(i) && time[i] >= warm) {
+            const double p = rolling[i];
+            sum += p * p * p * p;
+            ++count;
+        }
+        if (i >= first)
+            out[i] = count > 0 ? static_cast<float>(std::pow(sum / static_cast<double>(count), 0.25)) : 0.0f;
+    }
+}
+
+void vam(FitColumns& columns, size_t first) {
+    const std::vector<double>& time = columns.timestamp;
+    const std::vector<float>& altitude = columns.channel(FitChannel::Altitude);
+    std::vector<float>& out = columns.channel(FitChannel::Vam);
+    const size_t n = columns.size();
+
+    size_t lo = first < n ? firstAfter(time, first, std::nextafter(time[first] - VAM_WINDOW, -HUGE_VAL)) : first;
+    for (size_t i = first; i < n; ++i) {
+        while (time[lo] < time[i] - VAM_WINDOW) ++lo;
+        const double span = time[i] - time[lo];
+        out[i] = span >= VAM_MIN_SPAN
+            ? static_cast<float>((altitude[i] - altitude[lo]) / span * 3600.0) : 0.0f;
+    }
+}
+
+void wPrimeBalance(FitColumns& columns, const FitDerivedSettings& settings, size_t first) {
+    const std::vector<double>& time = columns.timestamp;
+    const std::vector<float>& power = columns.channel(FitChannel::Power);
+    const FitBitmap& valid = columns.flag(FitFlag::Power);
+    std::vector<float>& out = columns.channel(FitChannel::WPrimeBalance);
+    const double cp = settings.criticalPower;
+    const double wPrime = settings.wPrime;
+
+    // The stored (float) balance is the state, so resuming at first gives
+    // the same values as a full pass
+    float balance = first > 0 ? out[first - 1] : settings.wPrime;
+    for (size_t i = first; i < columns.size(); ++i) {
+        const double dt = i > 0 ? time[i] - time[i - 1] : 0.0;
+        const double p = valid.test(i) ? power[i] : 0.0;
+        double b = balance;
+        if (p > cp) b -= (p - cp) * dt;
+        else if (wPrime > 0.0) b = wPrime - (wPrime - b) * std::exp(-(cp - p) * dt / wPrime);
+        balance = static_cast<float>(b);
+        out[i] = balance;
+    }
+}
+
+void heartRateZone(FitColumns& columns, float maxHeartRate, size_t first) {
+    const std::vector<float>& hr = columns.channel(FitChannel::HeartRate);
+    const FitBitmap& valid = columns.flag(FitFlag::HeartRate);
+    std::vector<float>& out = columns.channel(FitChannel::HeartRateZone);
+    const std::vector<float> edges = heartRateZoneEdges(maxHeartRate);
+
+    for (size_t i = first; i < columns.size(); ++i) {
+        if (!(maxHeartRate > 0.0f) || !valid.test(i)) {
+            out[i] = 0.0f;
+            continue;
+        }
+        out[i] = static_cast<float>(1 + (std::upper_bound(edges.begin(), edges.end(), hr[i]) - edges.begin()));
+    }
+}
+
+} // anonymous namespace
+
+std::vector<float> heartRateZoneEdges(float maxHeartRate) {
+    std::vector<float> edges;
+    for (float fraction : {0.6f, 0.7f, 0.8f, 0.9f})
+        edges.push_back(fraction * maxHeartRate);
+    return edges;
+}
+
+void computeDerived(FitColumns& columns, const FitDerivedSettings& settings, size_t first,
+                    FitDerivedState& state) {
+    if (first >= columns.size()) return;
+    trailingPower(columns, SHORT_WINDOW, first, columns.channel(FitChannel::Power3s));
+    trailingPower(columns, NP_WINDOW, first, columns.channel(FitChannel::Power30s));
+    normalizedPower(columns, first, state.npMarks);
+    vam(columns, first);
+    wPrimeBalance(columns, settings, first);
+    heartRateZone(columns, settings.maxHeartRate, first);
+}
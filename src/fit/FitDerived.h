@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+struct FitColumns;
+
+// State computeDerived() resumes from that the columns do not hold: the
+// normalized power's fourth-power sum and sample count before every
+// MarkInterval-th record, kept in double so resuming matches a full pass
+struct FitDerivedState {
+    static constexpr size_t MarkInterval = 64;
+
+    struct Mark {
+        double sum = 0.0;
+        size_t count = 0;
+    };
+    std::vector<Mark> npMarks;  // [m] = before record m * MarkInterval
+};
+
+struct FitDerivedSettings {
+    float criticalPower = 250.0f;   // W
+    float wPrime = 20000.0f;        // J, anaerobic work capacity above CP
+    float maxHeartRate = 0.0f;      // bpm; 0 = FitTrack uses the track maximum
+};
+
+// Fills the derived channels (Power3s .. HeartRateZone, see FitChannel) for
+// records [first, size). Every metric is causal: a record's value depends
+// only on records up to it, so values before first stay valid and the state
+// at first is picked up from the columns and `state` (trailing windows are
+// re-summed, W' balance continues from record first - 1, NP from the mark
+// before first). Appending records costs about the size of the new data plus
+// one trailing window. Without marks NP is re-summed from the start.
+//
+// - Power3s / Power30s: mean of the valid power samples in the trailing
+//   window (0 without any)
+// - NormalizedPower: fourth-power mean of Power30s over the valid power
+//   samples from 30 s after the start, to the fourth root
+// - Vam: altitude gained over the trailing 60 s, in metres per hour
+// - WPrimeBalance: Skiba's model; depletes by (P - CP) * dt above CP and
+//   recovers exponentially towards W' below it (missing power counts as 0 W)
+// - HeartRateZone: 1-5 at 60/70/80/90% of maxHeartRate, 0 without heart rate
+//   or a maximum
+void computeDerived(FitColumns& columns, const FitDerivedSettings& settings, size_t first,
+                    FitDerivedState& state);
+
+// Lower edges of heart rate zones 2-5 for a maximum heart rate, as the
+// HeartRateZone channel uses them
+std::vector<float> heartRateZoneEdges(float maxHeartRate);
@@ -0,0 +1,54 @@
+#include "FitDistanceIndex.h"
+#include "FitColumns.h"
+#include <algorithm>
+
+void FitDistanceIndex::build(const FitColumns& columns, size_t first) {
+    const std::vector<float>& dist = columns.channel(FitChannel::Distance);
+    first = std::min({first, m_distance.size(), dist.size()});
+    m_distance.resize(dist.size());
+    float reached = first > 0 ? m_distance[first - 1] : 0.0f;
+    for (size_t i = first; i < dist.size(); ++i) {
+        reached = std::max(reached, dist[i]);
+        m_distance[i] = reached;
+    }
+}
+
+void FitDistanceIndex::clear() {
+    m_distance.clear();
+}
+
+float FitDistanceIndex::at(const FitTimePoint& p) const {
+    if (m_distance.empty()) return 0.0f;
+    if (p.index + 1 >= m_distance.size()) return m_distance.back();
+    const float a = m_distance[p.index];
+    return a + static_cast<float>(p.t) * (m_distance[p.index + 1] - a);
+}
+
+FitTimePoint FitDistanceIndex::pointIn(size_t a, float distance) const {
+    // a is the last sample below distance, so the next one is above it
+    const float span = m_distance[a + 1] - m_distance[a];
+    const double t = static_cast<double>(distance - m_distance[a]) / span;
+    if (t >= 1.0) return {a + 1, 0.0};
+    return {a, t};
+}
+
+FitTimePoint FitDistanceIndex::locate(float distance) const {
+    if (m_distance.empty() || distance <= m_distance.front()) return {};
+    if (distance > m_distance.back()) return {m_distance.size() - 1, 0.0};
+
+    // First sample at or past distance; the one before is below it
+    auto it = std::lower_bound(m_distance.begin(), m_distance.end(), distance);
+    return pointIn(static_cast<size_t>(it - m_distance.begin()) - 1, distance);
+}
+
+FitTimePoint FitDistanceIndex::locate(float distance, size_t hint) const {
+    if (m_distance.empty() || distance <= m_distance.front()) return {};
+    if (distance > m_distance.back()) return {m_distance.size() - 1, 0.0};
+
+    size_t a = std::min(hint, m_distance.size() - 2);
+    if (m_distance[a] >= distance) return locate(distance);
+    int steps = 0;
+    while (m_distance[a + 1] < distance && steps++ < MaxForwardSteps) ++a;
+    if (m_distance[a + 1] < distance) return locate(distance);
+    return pointIn(a, distance);
+}
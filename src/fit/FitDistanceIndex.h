@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "FitAnalytics.h"
+
+struct FitColumns;
+
+// Monotonic distance axis of a track, built once per track: the running
+// maximum of the distance column, so GPS jitter that steps backwards and
+// samples that lose the distance (logged as 0) never make it drop. Lookups
+// are a binary search; FitTrack::Cursor steps forward for sequential ones.
+//
+// While stopped the distance stays flat over many samples. A distance on
+// such a plateau maps to the first sample that reached it, i.e. the moment
+// the rider arrived, so distance-aligned views never jump across the stop.
+class FitDistanceIndex {
+public:
+    // Samples before first are taken as unchanged since the last build
+    void build(const FitColumns& columns, size_t first = 0);
+    void clear();
+
+    bool empty() const { return total() <= 0.0f; }
+    size_t size() const { return m_distance.size(); }
+    // Distance at the last sample, 0 without distance data
+    float total() const { return m_distance.empty() ? 0.0f : m_distance.back(); }
+    // Monotonic distance of sample i
+    float at(size_t i) const { return m_distance[i]; }
+    const std::vector<float>& distances() const { return m_distance; }
+    // Monotonic distance at a point between samples (FitTrack::locate)
+    float at(const FitTimePoint& p) const;
+
+    // Where the track first reaches distance (clamped to the track)
+    FitTimePoint locate(float distance) const;
+    // Same, stepping forward from the interval of a previous lookup
+    FitTimePoint locate(float distance, size_t hint) const;
+
+private:
+    static constexpr int MaxForwardSteps = 16;
+
+    FitTimePoint pointIn(size_t a, float distance) const;
+
+    std::vector<float> m_distance;
+};
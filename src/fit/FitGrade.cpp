@@ -0,0 +1,178 @@
+#include "FitGrade.h"
+#include "FitColumns.h"
+#include "FitDistanceIndex.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// Filters even[] (grid cells base .. base + even.size() - 1) into
+// smooth[m0 - base .. m1 - base]. numSamples is the full grid length; the
+// caller guarantees even[] covers every cell the window reaches.
+class GradeSmoother {
+public:
+    GradeSmoother(const std::vector<double>& even, long base, long numSamples, int halfWindow)
+        : m_even(even), m_base(base), m_last(numSamples - 1), m_w(halfWindow) {}
+
+    // Sample at a grid cell, repeating the end values past the track ends
+    double at(long cell) const { return m_even[std::clamp(cell, 0L, m_last) - m_base]; }
+
+    void movingAverage(long m0, long m1, std::vector<double>& smooth) const {
+        // Prefix sums over the local samples; the window shrinks at the ends
+        std::vector<double> prefix(m_even.size() + 1, 0.0);
+        for (size_t i = 0; i < m_even.size(); ++i) prefix[i + 1] = prefix[i] + m_even[i];
+        for (long i = m0; i <= m1; ++i) {
+            long lo = std::max(0L, i - m_w) - m_base;
+            long hi = std::min(m_last, i + m_w) - m_base;
+            smooth[i - m_base] = (prefix[hi + 1] - prefix[lo]) / static_cast<double>(hi - lo + 1);
+        }
+    }
+
+    void savitzkyGolay(long m0, long m1, std::vector<double>& smooth) const {
+        // Quadratic fit over 2w+1 points: c_j = (A - B j^2) / D. Running sums
+        // of y, k*y and k^2*y (k relative to m0) give sum(j^2 y) per window.
+        const double m = m_w;
+        const double a = 3.0 * (3.0 * m * m + 3.0 * m - 1.0);
+        const double d = (2.0 * m - 1.0) * (2.0 * m + 1.0) * (2.0 * m + 3.0);
+        double s0 = 0.0, s1 = 0.0, s2 = 0.0;
+        for (long j = -m_w; j <= m_w; ++j) {
+            double y = at(m0 + j), k = static_cast<double>(j);
+            s0 += y; s1 += k * y; s2 += k * k * y;
+        }
+        for (long i = m0; i <= m1; ++i) {
+            double c = static_cast<double>(i - m0);
+            double sumJ2 = s2 - 2.0 * c * s1 + c * c * s0;
+            smooth[i - m_base] = (a * s0 - 15.0 * sumJ2) / d;
+            if (i == m1) break;
+
+            double yIn = at(i + m_w + 1), kIn = static_cast<double>(i + m_w + 1 - m0);
+            double yOut = at(i - m_w), kOut = static_cast<double>(i - m_w - m0);
+            s0 += yIn - yOut;
+            s1 += kIn * yIn - kOut * yOut;
+            s2 += kIn * kIn * yIn - kOut * kOut * yOut;
+        }
+    }
+
+    void median(long m0, long m1, std::vector<double>& smooth) const {
+        // Sorted sliding window: one erase and one insert per step
+        std::vector<double> window;
+        window.reserve(2 * m_w + 2);
+        for (long j = -m_w; j <= m_w; ++j) window.push_back(at(m0 + j));
+        std::sort(window.begin(), window.end());
+        for (long i = m0; i <= m1; ++i) {
+            smooth[i - m_base] = window[m_w];
+            if (i == m1) break;
+            window.erase(std::lower_bound(window.begin(), window.end(), at(i - m_w)));
+            double y = at(i + m_w + 1);
+            window.insert(std::upper_bound(window.begin(), window.end(), y), y);
+        }
+    }
+
+private:
+    const std::vector<double>& m_even;
+    long m_base;
+    long m_last;
+    long m_w;
+};
+
+} // anonymous namespace
+
+void computeGrade(FitColumns& columns, const FitDistanceIndex& distanceIndex,
+                  const FitGradeSettings& settings, size_t first, size_t last) {
+    const size_t n = columns.size();
+    last = std::min(last, n);
+    if (n < 2 || first >= last) return;
+
+    const FitBitmap& recorded = columns.flag(FitFlag::Grade);
+    const auto& distance = columns.channel(FitChannel::Distance);
+    const auto& altitude = columns.channel(FitChannel::Altitude);
+    auto& grade = columns.channel(FitChannel::Grade);
+
+    double maxDist = distance.back();
+    if (maxDist <= 0.0) return;
+
+    const double dx = settings.spacing > 0.0 ? settings.spacing : 5.0;
+    const int w = std::max(0, settings.halfWindow);
+    const long numSamples = static_cast<long>(std::ceil(maxDist / dx)) + 1;
+
+    // Grid cells read by the records that need a computed grade
+    long c0 = numSamples, c1 = -1;
+    for (size_t k = first; k < last; ++k) {
+        if (recorded.test(k)) continue;
+        long cell = std::clamp(static_cast<long>(distance[k] / dx), 0L, numSamples - 1);
+        c0 = std::min(c0, cell);
+        c1 = std::max(c1, cell);
+    }
+    if (c1 < 0) return;
+
+    // Smoothed cells needed for the central difference, and the altitude
+    // samples the filter window reaches from them
+    const long m0 = std::max(0L, c0 - 1), m1 = std::min(numSamples - 1, c1 + 1);
+    const long s0 = std::max(0L, m0 - w), s1 = std::min(numSamples - 1, m1 + w);
+
+    // Step 1: Resample with even delta x. The walk starts from a binary
+    // search rather than the first record. Distance can step back (GPS
+    // jitter, dropouts logged as 0), so the search runs on the monotonic
+    // axis: no record before the first one that reaches the first cell on
+    // it stops a walk from record 0.
+    std::vector<double> evenAlt(static_cast<size_t>(s1 - s0 + 1), 0.0);
+    size_t recIdx = 0;
+    const std::vector<float>& reached = distanceIndex.distances();
+    if (s0 > 0 && reached.size() == n) {
+        auto it = std::lower_bound(reached.begin() + 1, reached.end(), s0 * dx,
+                                   [](float v, double d) { return v < d; });
+        recIdx = static_cast<size_t>(it - reached.begin()) - 1;
+    }
+    for (long i = s0; i <= s1; ++i) {
+        double d = i * dx;
+
+        while (recIdx < n - 1 && distance[recIdx + 1] < d) {
+            recIdx++;
+        }
+
+        double& out = evenAlt[i - s0];
+        if (recIdx >= n - 1) {
+            out = altitude.back();
+        } else {
+            double distRange = distance[recIdx + 1] - distance[recIdx];
+            if (distRange < 1e-6) {
+                out = altitude[recIdx + 1];
+            } else {
+                double t = (d - distance[recIdx]) / distRange;
+                out = altitude[recIdx] + t * (altitude[recIdx + 1] - altitude[recIdx]);
+            }
+        }
+    }
+
+    // Step 2: Low-pass filter
+    std::vector<double> smoothAlt(evenAlt.size(), 0.0);
+    GradeSmoother smoother(evenAlt, s0, numSamples, w);
+    switch (settings.filter) {
+    case FitGradeFilter::MovingAverage: smoother.movingAverage(m0, m1, smoothAlt); break;
+    case FitGradeFilter::SavitzkyGolay: smoother.savitzkyGolay(m0, m1, smoothAlt); break;
+    case FitGradeFilter::Median: smoother.median(m0, m1, smoothAlt); break;
+    }
+    auto smooth = [&](long cell) { return smoothAlt[cell - s0]; };
+
+    // Step 3: Compute inclination for each record without a recorded grade
+    for (size_t k = first; k < last; ++k) {
+        if (recorded.test(k)) continue;
+        long i = static_cast<long>(distance[k] / dx);
+
+        double dz = 0.0;
+        double currentDx = dx;
+
+        if (i > 0 && i < numSamples - 1) {
+            dz = smooth(i + 1) - smooth(i - 1);
+            currentDx = 2.0 * dx;
+        } else if (i == 0) {
+            dz = smooth(1) - smooth(0);
+        } else if (i >= numSamples - 1) {
+            dz = smooth(numSamples - 1) - smooth(numSamples - 2);
+        }
+
+        double angle = std::atan2(dz, currentDx) * 180.0 / 3.14159265358979323846;
+        grade[k] = static_cast<float>(angle);
+    }
+}
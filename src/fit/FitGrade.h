@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+
+struct FitColumns;
+class FitDistanceIndex;
+
+enum class FitGradeFilter {
+    MovingAverage, // mean over the window, truncated at the track ends
+    SavitzkyGolay, // local quadratic fit; keeps short steep ramps sharper
+    Median         // rejects isolated altitude spikes
+};
+
+struct FitGradeSettings {
+    FitGradeFilter filter = FitGradeFilter::MovingAverage;
+    double spacing = 5.0;  // resampling step along distance (metres)
+    int halfWindow = 10;   // filter half-width in samples (10 * 5 m = 50 m)
+
+    // Distance over which one altitude sample affects computed grades
+    double reach() const { return (halfWindow + 2) * spacing; }
+};
+
+// Fills the grade column (degrees) for records in [first, last) that carry
+// no recorded grade. Altitude is resampled on an even distance grid, smoothed
+// and differentiated; only the part of the grid that those records and the
+// filter window reach is evaluated, in time linear in its length.
+// distanceIndex must be built from the same columns; it locates where the
+// evaluated part of the grid starts.
+void computeGrade(FitColumns& columns, const FitDistanceIndex& distanceIndex,
+                  const FitGradeSettings& settings, size_t first, size_t last);
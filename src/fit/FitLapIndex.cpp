@@ -0,0 +1,76 @@
+#include "FitLapIndex.h"
+#include "FitColumns.h"
+#include <algorithm>
+#include <numeric>
+
+void FitLapIndex::build(const std::vector<FitLap>& laps, const FitColumns& columns) {
+    clear();
+    const size_t n = laps.size();
+
+    std::vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+        [&](int a, int b) { return laps[a].startTime < laps[b].startTime; });
+
+    const auto& time = columns.timestamp;
+    const auto& dist = columns.channel(FitChannel::Distance);
+    m_start.reserve(n);
+    m_end.reserve(n);
+    m_startDistance.reserve(n);
+    m_lap = order;
+    m_entry.resize(n);
+    for (size_t e = 0; e < n; ++e) {
+        const FitLap& lap = laps[order[e]];
+        m_start.push_back(lap.startTime);
+        m_end.push_back(lap.endTime);
+        m_entry[order[e]] = static_cast<int>(e);
+
+        // Track distance at the first sample of the lap
+        float startDistance = 0.0f;
+        if (!time.empty()) {
+            auto it = std::lower_bound(time.begin(), time.end(), lap.startTime);
+            size_t i = std::min(static_cast<size_t>(it - time.begin()), time.size() - 1);
+            startDistance = dist[i];
+        }
+        m_startDistance.push_back(startDistance);
+    }
+}
+
+void FitLapIndex::clear() {
+    m_start.clear();
+    m_end.clear();
+    m_startDistance.clear();
+    m_lap.clear();
+    m_entry.clear();
+}
+
+int FitLapIndex::find(double unixTimestamp, int hint) const {
+    if (m_start.empty()) return -1;
+
+    // Sequential access: still in the hinted lap, or just moved to the next
+    if (hint >= 0 && hint < static_cast<int>(m_entry.size())) {
+        size_t e = static_cast<size_t>(m_entry[hint]);
+        bool earlierWins = e > 0 && contains(e - 1, unixTimestamp);
+        if (contains(e, unixTimestamp) && !earlierWins) return lapAt(e);
+        if (e + 1 < m_start.size() && contains(e + 1, unixTimestamp) && !contains(e, unixTimestamp))
+            return lapAt(e + 1);
+    }
+
+    // Last lap starting at or before the time
+    auto it = std::upper_bound(m_start.begin(), m_start.end(), unixTimestamp);
+    if (it == m_start.begin()) return -1;
+    size_t e = static_cast<size_t>(it - m_start.begin()) - 1;
+    if (e > 0 && contains(e - 1, unixTimestamp)) --e;
+    return contains(e, unixTimestamp) ? lapAt(e) : -1;
+}
+
+FitLapPosition FitLapIndex::position(double unixTimestamp, float distance, int hint) const {
+    FitLapPosition pos;
+    pos.lap = find(unixTimestamp, hint);
+    if (pos.lap < 0) return pos;
+
+    size_t e = static_cast<size_t>(m_entry[pos.lap]);
+    pos.elapsed = unixTimestamp - m_start[e];
+    pos.distance = std::max(0.0f, distance - m_startDistance[e]);
+    return pos;
+}
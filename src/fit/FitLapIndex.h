@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "FitData.h"
+
+struct FitColumns;
+
+// Where a time falls within the lap structure
+struct FitLapPosition {
+    int lap = -1;             // index into FitTrack::laps(), -1 outside every lap
+    double elapsed = 0.0;     // seconds since the lap started
+    float distance = 0.0f;    // metres since the lap started
+};
+
+// Lap intervals sorted by start time, built once per track. Lookups are a
+// binary search, or O(1) when the caller passes the lap it found last time
+// (playback moves through laps in order).
+class FitLapIndex {
+public:
+    void build(const std::vector<FitLap>& laps, const FitColumns& columns);
+    void clear();
+
+    size_t size() const { return m_start.size(); }
+    bool empty() const { return m_start.empty(); }
+
+    // Lap containing unixTimestamp, or -1. Where one lap ends exactly as the
+    // next starts, the earlier lap wins.
+    int find(double unixTimestamp, int hint = -1) const;
+
+    // Lap plus time and distance into it; distance is measured from the
+    // track's distance at the lap start
+    FitLapPosition position(double unixTimestamp, float distance, int hint = -1) const;
+
+private:
+    bool contains(size_t entry, double unixTimestamp) const {
+        return unixTimestamp >= m_start[entry] && unixTimestamp <= m_end[entry];
+    }
+    int lapAt(size_t entry) const { return m_lap[entry]; }
+
+    // Parallel arrays ordered by start time
+    std::vector<double> m_start;
+    std::vector<double> m_end;
+    std::vector<float> m_startDistance;
+    std::vector<int> m_lap;     // entry -> index into the lap vector
+    std::vector<int> m_entry;   // index into the lap vector -> entry
+};
@@ -0,0 +1,875 @@
+#include "FitNativeDecoder.h"
+#include "TimeUtil.h"
+#include <QFile>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr double SEMICIRCLES_TO_DEGREES = 180.0 / 2147483648.0;
+
+constexpr uint16_t MesgSession = 18;
+constexpr uint16_t MesgLap = 19;
+constexpr uint16_t MesgRecord = 20;
+constexpr uint8_t FieldTimestamp = 253;
+
+// How far back from the end probe() looks for the last record and session
+constexpr size_t ProbeTailBytes = 16 * 1024;
+
+// Where a decoded field value goes. Only the fields FitParser's SDK listener
+// reads are mapped; everything else is skipped by size.
+enum class Target : uint8_t {
+    Timestamp,
+    RecordLat, RecordLon, RecordAltitude, RecordEnhancedAltitude,
+    RecordHeartRate, RecordCadence, RecordDistance, RecordSpeed,
+    RecordEnhancedSpeed, RecordPower, RecordTemperature, RecordGrade,
+    SessionStartTime, SessionTotalElapsedTime, SessionTotalDistance,
+    SessionAvgSpeed, SessionEnhancedAvgSpeed, SessionMaxSpeed,
+    SessionEnhancedMaxSpeed, SessionAvgHeartRate, SessionMaxHeartRate,
+    SessionAvgCadence, SessionAvgPower, SessionTotalAscent, SessionTotalDescent,
+    LapStartTime, LapTotalElapsedTime, LapTotalDistance, LapAvgSpeed,
+    LapAvgHeartRate, LapAvgCadence, LapAvgPower
+};
+
+struct FieldSlot {
+    uint32_t offset;    // byte offset inside the message payload
+    uint8_t size;
+    uint8_t baseType;
+    Target target;
+};
+
+// Decode plan compiled from a definition message
+struct Definition {
+    bool valid = false;
+    bool bigEndian = false;
+    uint16_t globalNum = 0;
+    uint32_t size = 0;  // payload size, developer fields included
+    std::vector<FieldSlot> fields;
+};
+
+bool lookupTarget(uint16_t mesg, uint8_t field, Target& target) {
+    if (field == FieldTimestamp) {
+        target = Target::Timestamp;
+        return true;
+    }
+    switch (mesg) {
+    case MesgRecord:
+        switch (field) {
+        case 0:  target = Target::RecordLat; return true;
+        case 1:  target = Target::RecordLon; return true;
+        case 2:  target = Target::RecordAltitude; return true;
+        case 3:  target = Target::RecordHeartRate; return true;
+        case 4:  target = Target::RecordCadence; return true;
+        case 5:  target = Target::RecordDistance; return true;
+        case 6:  target = Target::RecordSpeed; return true;
+        case 7:  target = Target::RecordPower; return true;
+        case 9:  target = Target::RecordGrade; return true;
+        case 13: target = Target::RecordTemperature; return true;
+        case 73: target = Target::RecordEnhancedSpeed; return true;
+        case 78: target = Target::RecordEnhancedAltitude; return true;
+        }
+        return false;
+    case MesgSession:
+        switch (field) {
+        case 2:   target = Target::SessionStartTime; return true;
+        case 7:   target = Target::SessionTotalElapsedTime; return true;
+        case 9:   target = Target::SessionTotalDistance; return true;
+        case 14:  target = Target::SessionAvgSpeed; return true;
+        case 15:  target = Target::SessionMaxSpeed; return true;
+        case 16:  target = Target::SessionAvgHeartRate; return true;
+        case 17:  target = Target::SessionMaxHeartRate; return true;
+        case 18:  target = Target::SessionAvgCadence; return true;
+        case 20:  target = Target::SessionAvgPower; return true;
+        case 22:  target = Target::SessionTotalAscent; return true;
+        case 23:  target = Target::SessionTotalDescent; return true;
+        case 124: target = Target::SessionEnhancedAvgSpeed; return true;
+        case 125: target = Target::SessionEnhancedMaxSpeed; return true;
+        }
+        return false;
+    case MesgLap:
+        switch (field) {
+        case 2:  target = Target::LapStartTime; return true;
+        case 7:  target = Target::LapTotalElapsedTime; return true;
+        case 9:  target = Target::LapTotalDistance; return true;
+        case 13: target = Target::LapAvgSpeed; return true;
+        case 15: target = Target::LapAvgHeartRate; return true;
+        case 17: target = Target::LapAvgCadence; return true;
+        case 19: target = Target::LapAvgPower; return true;
+        }
+        return false;
+    }
+    return false;
+}
+
+// FIT CRC-16 (reflected polynomial 0xA001), table-driven one byte at a time
+uint16_t crc16(uint16_t crc, const uint8_t* data, size_t size) {
+    static const std::array<uint16_t, 256> table = [] {
+        std::array<uint16_t, 256> t{};
+        for (int i = 0; i < 256; ++i) {
+            uint16_t c = static_cast<uint16_t>(i);
+            for (int bit = 0; bit < 8; ++bit)
+                c = (c & 1) ? static_cast<uint16_t>((c >> 1) ^ 0xA001) : static_cast<uint16_t>(c >> 1);
+            t[i] = c;
+        }
+        return t;
+    }();
+    for (size_t i = 0; i < size; ++i)
+        crc = static_cast<uint16_t>((crc >> 8) ^ table[(crc ^ data[i]) & 0xFF]);
+    return crc;
+}
+
+inline uint16_t readU16(const uint8_t* p, bool bigEndian) {
+    return bigEndian ? static_cast<uint16_t>((p[0] << 8) | p[1])
+                     : static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+inline uint32_t readU32Le(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// Reads the first element of a field and rejects the base type's invalid
+// sentinel, mirroring the SDK's IsXxxValid() checks.
+bool readValue(const uint8_t* p, uint8_t size, uint8_t baseType, bool bigEndian, double& out) {
+    static constexpr uint8_t typeSizes[17] = {1, 1, 1, 2, 2, 4, 4, 1, 4, 8, 1, 2, 4, 1, 8, 8, 8};
+    const uint8_t type = baseType & 0x1F;
+    if (type > 16 || type == 7) return false; // unknown or string
+    const uint8_t typeSize = typeSizes[type];
+    if (size < typeSize) return false;
+
+    uint64_t raw = 0;
+    for (uint8_t i = 0; i < typeSize; ++i) {
+        const uint8_t b = bigEndian ? p[i] : p[typeSize - 1 - i];
+        raw = (raw << 8) | b;
+    }
+
+    switch (type) {
+    case 0: case 2: case 13: // enum, uint8, byte
+        if (raw == 0xFF) return false;
+        out = static_cast<double>(raw);
+        return true;
+    case 1: // sint8
+        if (raw == 0x7F) return false;
+        out = static_cast<double>(static_cast<int8_t>(raw));
+        return true;
+    case 3: // sint16
+        if (raw == 0x7FFF) return false;
+        out = static_cast<double>(static_cast<int16_t>(raw));
+        return true;
+    case 4: // uint16
+        if (raw == 0xFFFF) return false;
+        out = static_cast<double>(raw);
+        return true;
+    case 5: // sint32
+        if (raw == 0x7FFFFFFF) return false;
+        out = static_cast<double>(static_cast<int32_t>(raw));
+        return true;
+    case 6: // uint32
+        if (raw == 0xFFFFFFFF) return false;
+        out = static_cast<double>(raw);
+        return true;
+    case 8: { // float32
+        if (raw == 0xFFFFFFFF) return false;
+        uint32_t bits = static_cast<uint32_t>(raw);
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        out = f;
+        return true;
+    }
+    case 9: { // float64
+        if (raw == ~0ULL) return false;
+        double d;
+        std::memcpy(&d, &raw, sizeof(d));
+        out = d;
+        return true;
+    }
+    case 10: case 11: case 12: case 16: // uint8z, uint16z, uint32z, uint64z
+        if (raw == 0) return false;
+        out = static_cast<double>(raw);
+        return true;
+    case 14: // sint64
+        if (raw == 0x7FFFFFFFFFFFFFFFULL) return false;
+        out = static_cast<double>(static_cast<int64_t>(raw));
+        return true;
+    case 15: // uint64
+        if (raw == ~0ULL) return false;
+        out = static_cast<double>(raw);
+        return true;
+    }
+    return false;
+}
+
+inline double fitTime(double v) {
+    return TimeUtil::fitTimestampToUnix(static_cast<uint32_t>(v));
+}
+
+// Fixed-size record buffer handed to the sink whenever it fills up
+class RecordBatch {
+public:
+    RecordBatch(std::vector<FitRecord>& buffer, const FitNativeDecoder::RecordSink& sink)
+        : m_buffer(buffer), m_sink(sink) {}
+
+    FitRecord& next() {
+        if (m_count == m_buffer.size()) flush();
+        m_buffer[m_count] = FitRecord{};
+        return m_buffer[m_count++];
+    }
+
+    void flush() {
+        if (m_count) m_sink(m_buffer.data(), m_count);
+        m_count = 0;
+    }
+
+private:
+    std::vector<FitRecord>& m_buffer;
+    const FitNativeDecoder::RecordSink& m_sink;
+    size_t m_count = 0;
+};
+
+// Decoder state for one FIT file (chained files each get a fresh one)
+class MessageWalker {
+public:
+    MessageWalker(FitSession& session, RecordBatch* batch, const uint8_t* data, size_t end)
+        : m_session(session), m_batch(batch), m_data(data), m_end(end) {}
+
+    // Decodes messages in [pos, end) and folds them into crc.
+    // Returns false only for malformed input; a message cut off by the end of
+    // the buffer stops the walk and sets truncated.
+    bool walk(size_t pos, uint16_t& crc, bool& truncated, QString& error);
+
+private:
+    bool readDefinition(size_t& pos, uint8_t header);
+    void dispatch(const Definition& def, const uint8_t* payload, bool hasTimestamp, uint32_t timestamp);
+    void decodeRecord(const Definition& def, const uint8_t* payload, bool hasTimestamp, uint32_t timestamp);
+    void decodeSession(const Definition& def, const uint8_t* payload, bool hasTimestamp, uint32_t timestamp);
+    void decodeLap(const Definition& def, const uint8_t* payload, bool hasTimestamp, uint32_t timestamp);
+
+    FitSession& m_session;
+    RecordBatch* m_batch; // null: collect into m_session.records
+    const uint8_t* m_data;
+    size_t m_end;
+    Definition m_defs[16];
+    uint32_t m_lastTimestamp = 0;
+    uint8_t m_lastTimeOffset = 0;
+};
+
+bool MessageWalker::walk(size_t pos, uint16_t& crc, bool& truncated, QString& error) {
+    truncated = false;
+    while (pos < m_end) {
+        const size_t msgStart = pos;
+        const uint8_t header = m_data[pos++];
+
+        if (!(header & 0x80) && (header & 0x40)) {
+            if (!readDefinition(pos, header)) {
+                truncated = true;
+                return true;
+            }
+            crc = crc16(crc, m_data + msgStart, pos - msgStart);
+            continue;
+        }
+
+        int local;
+        bool hasTimestamp = false;
+        if (header & 0x80) {
+            // Compressed timestamp header: 5-bit offset from the last full timestamp
+            local = (header >> 5) & 0x03;
+            const uint8_t offset = header & 0x1F;
+            m_lastTimestamp += static_cast<uint32_t>((offset - m_lastTimeOffset) & 0x1F);
+            m_lastTimeOffset = offset;
+            hasTimestamp = true;
+        } else {
+            local = header & 0x0F;
+        }
+
+        const Definition& def = m_defs[local];
+        if (!def.valid) {
+            error = QString("Data message for undefined local type %1").arg(local);
+            return false;
+        }
+        if (pos + def.size > m_end) {
+            truncated = true;
+            return true;
+        }
+
+        dispatch(def, m_data + pos, hasTimestamp, m_lastTimestamp);
+        pos += def.size;
+        crc = crc16(crc, m_data + msgStart, pos - msgStart);
+    }
+    return true;
+}
+
+bool MessageWalker::readDefinition(size_t& pos, uint8_t header) {
+    if (pos + 5 > m_end) return false;
+    const uint8_t* p = m_data + pos;
+    Definition def;
+    def.bigEndian = p[1] == 1;
+    def.globalNum = readU16(p + 2, def.bigEndian);
+    const uint8_t numFields = p[4];
+    pos += 5;
+
+    if (pos + numFields * 3u > m_end) return false;
+    const bool interesting = def.globalNum == MesgRecord || def.globalNum == MesgSession ||
+                             def.globalNum == MesgLap;
+    uint32_t offset = 0;
+    for (uint8_t i = 0; i < numFields; ++i) {
+        const uint8_t* f = m_data + pos + i * 3;
+        Target target;
+        // Timestamps of other messages are still tracked for compressed headers
+        if ((interesting || f[0] == FieldTimestamp) && lookupTarget(def.globalNum, f[0], target))
+            def.fields.push_back({offset, f[1], f[2], target});
+        offset += f[1];
+    }
+    pos += numFields * 3u;
+
+    if (header & 0x20) {
+        // Developer fields are not decoded, only skipped by size
+        if (pos + 1 > m_end) return false;
+        const uint8_t numDevFields = m_data[pos++];
+        if (pos + numDevFields * 3u > m_end) return false;
+        for (uint8_t i = 0; i < numDevFields; ++i)
+            offset += m_data[pos + i * 3 + 1];
+        pos += numDevFields * 3u;
+    }
+
+    def.size = offset;
+    def.valid = true;
+
+    // Pre-size the record vector: every remaining record costs at least one
+    // header byte plus its payload, so this bounds the count from above.
+    if (def.globalNum == MesgRecord && !m_batch) {
+        auto& records = m_session.records;
+        const size_t estimate = records.size() + (m_end - pos) / (def.size + 1);
+        if (estimate > records.capacity())
+            records.reserve(estimate);
+    }
+
+    m_defs[header & 0x0F] = std::move(def);
+    return true;
+}
+
+void MessageWalker::dispatch(const Definition& def, const uint8_t* payload,
+                             bool hasTimestamp, uint32_t timestamp) {
+    switch (def.globalNum) {
+    case MesgRecord:  decodeRecord(def, payload, hasTimestamp, timestamp); return;
+    case MesgSession: decodeSession(def, payload, hasTimestamp, timestamp); return;
+    case MesgLap:     decodeLap(def, payload, hasTimestamp, timestamp); return;
+    }
+
+    for (const auto& slot : def.fields) {
+        double v;
+        if (slot.target == Target::Timestamp &&
+            readValue(payload + slot.offset, slot.size, slot.baseType, def.bigEndian, v)) {
+            m_lastTimestamp = static_cast<uint32_t>(v);
+            m_lastTimeOffset = m_lastTimestamp & 0x1F;
+        }
+    }
+}
+
+void MessageWalker::decodeRecord(const Definition& def, const uint8_t* payload,
+                                 bool hasTimestamp, uint32_t timestamp) {
+    FitRecord& r = m_batch ? m_batch->next() : m_session.records.emplace_back();
+    bool hasLat = false, hasLon = false;
+    bool hasEnhancedSpeed = false, hasEnhancedAltitude = false;
+    double lat = 0.0, lon = 0.0;
+
+    for (const auto& slot : def.fields) {
+        double v;
+        if (!readValue(payload + slot.offset, slot.size, slot.baseType, def.bigEndian, v))
+            continue;
+        switch (slot.target) {
+        case Target::Timestamp:
+            m_lastTimestamp = static_cast<uint32_t>(v);
+            m_lastTimeOffset = m_lastTimestamp & 0x1F;
+            timestamp = m_lastTimestamp;
+            hasTimestamp = true;
+            break;
+        case Target::RecordLat: lat = v; hasLat = true; break;
+        case Target::RecordLon: lon = v; hasLon = true; break;
+        case Target::RecordAltitude:
+            if (!hasEnhancedAltitude) r.altitude = static_cast<float>(v / 5.0 - 500.0);
+            break;
+        case Target::RecordEnhancedAltitude:
+            r.altitude = static_cast<float>(v / 5.0 - 500.0);
+            hasEnhancedAltitude = true;
+            break;
+        case Target::RecordSpeed:
+            if (!hasEnhancedSpeed) r.speed = static_cast<float>(v / 1000.0);
+            break;
+        case Target::RecordEnhancedSpeed:
+            r.speed = static_cast<float>(v / 1000.0);
+            hasEnhancedSpeed = true;
+            break;
+        case Target::RecordHeartRate:
+            r.heartRate = static_cast<float>(v);
+            r.hasHeartRate = true;
+            break;
+        case Target::RecordCadence:
+            r.cadence = static_cast<float>(v);
+            r.hasCadence = true;
+            break;
+        case Target::RecordPower:
+            r.power = static_cast<float>(v);
+            r.hasPower = true;
+            break;
+        case Target::RecordDistance: r.distance = static_cast<float>(v / 100.0); break;
+        case Target::RecordTemperature: r.temperature = static_cast<float>(v); break;
+        case Target::RecordGrade:
+            r.grade = gradeFromPercent(v / 100.0);
+            r.hasGrade = true;
+            break;
+        default: break;
+        }
+    }
+
+    if (hasTimestamp) r.timestamp = fitTime(timestamp);
+    if (hasLat && hasLon) {
+        r.latitude = lat * SEMICIRCLES_TO_DEGREES;
+        r.longitude = lon * SEMICIRCLES_TO_DEGREES;
+        r.hasGps = true;
+    }
+}
+
+void MessageWalker::decodeSession(const Definition& def, const uint8_t* payload,
+                                  bool hasTimestamp, uint32_t timestamp) {
+    FitSession& s = m_session;
+    bool hasAvgSpeed = false, hasMaxSpeed = false;
+
+    for (const auto& slot : def.fields) {
+        double v;
+        if (!readValue(payload + slot.offset, slot.size, slot.baseType, def.bigEndian, v))
+            continue;
+        switch (slot.target) {
+        case Target::Timestamp:
+            m_lastTimestamp = static_cast<uint32_t>(v);
+            m_lastTimeOffset = m_lastTimestamp & 0x1F;
+            timestamp = m_lastTimestamp;
+            hasTimestamp = true;
+            break;
+        case Target::SessionStartTime: s.startTime = fitTime(v); break;
+        case Target::SessionTotalElapsedTime: s.totalElapsedTime = static_cast<float>(v / 1000.0); break;
+        case Target::SessionTotalDistance: s.totalDistance = static_cast<float>(v / 100.0); break;
+        // Plain avg/max speed win over the enhanced fields, as in the SDK listener
+        case Target::SessionAvgSpeed:
+            s.avgSpeed = static_cast<float>(v / 1000.0);
+            hasAvgSpeed = true;
+            break;
+        case Target::SessionEnhancedAvgSpeed:
+            if (!hasAvgSpeed) s.avgSpeed = static_cast<float>(v / 1000.0);
+            break;
+        case Target::SessionMaxSpeed:
+            s.maxSpeed = static_cast<float>(v / 1000.0);
+            hasMaxSpeed = true;
+            break;
+        case Target::SessionEnhancedMaxSpeed:
+            if (!hasMaxSpeed) s.maxSpeed = static_cast<float>(v / 1000.0);
+            break;
+        case Target::SessionAvgHeartRate: s.avgHeartRate = static_cast<float>(v); break;
+        case Target::SessionMaxHeartRate: s.maxHeartRate = static_cast<float>(v); break;
+        case Target::SessionAvgCadence: s.avgCadence = static_cast<float>(v); break;
+        case Target::SessionAvgPower: s.avgPower = static_cast<float>(v); break;
+        case Target::SessionTotalAscent: s.totalAscent = static_cast<float>(v); break;
+        case Target::SessionTotalDescent: s.totalDescent = static_cast<float>(v); break;
+        default: break;
+        }
+    }
+
+    if (hasTimestamp) s.endTime = fitTime(timestamp);
+}
+
+void MessageWalker::decodeLap(const Definition& def, const uint8_t* payload,
+                              bool hasTimestamp, uint32_t timestamp) {
+    FitLap lap;
+    lap.lapIndex = static_cast<int>(m_session.laps.size());
+
+    for (const auto& slot : def.fields) {
+        double v;
+        if (!readValue(payload + slot.offset, slot.size, slot.baseType, def.bigEndian, v))
+            continue;
+        switch (slot.target) {
+        case Target::Timestamp:
+            m_lastTimestamp = static_cast<uint32_t>(v);
+            m_lastTimeOffset = m_lastTimestamp & 0x1F;
+            timestamp = m_lastTimestamp;
+            hasTimestamp = true;
+            break;
+        case Target::LapStartTime: lap.startTime = fitTime(v); break;
+        case Target::LapTotalElapsedTime: lap.totalElapsedTime = static_cast<float>(v / 1000.0); break;
+        case Target::LapTotalDistance: lap.totalDistance = static_cast<float>(v / 100.0); break;
+        case Target::LapAvgSpeed: lap.avgSpeed = static_cast<float>(v / 1000.0); break;
+        case Target::LapAvgHeartRate: lap.avgHeartRate = static_cast<float>(v); break;
+        case Target::LapAvgCadence: lap.avgCadence = static_cast<float>(v); break;
+        case Target::LapAvgPower: lap.avgPower = static_cast<float>(v); break;
+        default: break;
+        }
+    }
+
+    if (hasTimestamp) lap.endTime = fitTime(timestamp);
+    m_session.laps.push_back(lap);
+}
+
+// Walker for probe(): keeps the layout of each local type but reads only
+// timestamps and the session start/elapsed/distance fields
+class ProbeWalker {
+public:
+    enum class Result { End, Records, Invalid };
+
+    ProbeWalker(const uint8_t* data, size_t end, FitProbeInfo& info)
+        : m_data(data), m_end(end), m_info(info) {}
+
+    // Starts out with the definitions another walker has seen, so data
+    // messages can be resynchronised on before any definition is reached
+    ProbeWalker(const ProbeWalker& layout, FitProbeInfo& info)
+        : m_data(layout.m_data), m_end(layout.m_end), m_info(info) {
+        std::copy(std::begin(layout.m_defs), std::end(layout.m_defs), std::begin(m_defs));
+    }
+
+    // stopInRecords returns Records once two records in a row share a layout,
+    // i.e. the record stream has started and its definition is known.
+    // strict rejects anything an encoder would not write; used when starting
+    // from a guessed offset near the end of the file.
+    Result walk(size_t pos, bool stopInRecords, bool strict);
+
+    // Whether the byte at pos could start a message for a strict walk
+    bool canStart(size_t pos) const {
+        const uint8_t header = m_data[pos];
+        if ((header & 0xD0) == 0x40) return true;
+        return !(header & 0xF0) && m_defs[header].valid;
+    }
+
+    bool sawRecord() const { return m_sawRecord; }
+
+private:
+    bool readDefinition(size_t& pos, uint8_t header, bool strict);
+    void handle(const Definition& def, const uint8_t* payload, bool hasTimestamp, uint32_t timestamp);
+
+    const uint8_t* m_data;
+    size_t m_end;
+    FitProbeInfo& m_info;
+    Definition m_defs[16];
+    uint32_t m_lastTimestamp = 0;
+    uint8_t m_lastTimeOffset = 0;
+    bool m_haveTimestamp = false; // compressed headers are relative to a full one
+    bool m_sawRecord = false;
+    int m_recordLocal = -1; // local type of the previous message if it was a record
+};
+
+ProbeWalker::Result ProbeWalker::walk(size_t pos, bool stopInRecords, bool strict) {
+    while (pos < m_end) {
+        const uint8_t header = m_data[pos++];
+
+        if (!(header & 0x80) && (header & 0x40)) {
+            if (!readDefinition(pos, header, strict)) return Result::Invalid;
+            m_recordLocal = -1;
+            continue;
+        }
+
+        int local;
+        bool hasTimestamp = false;
+        if (header & 0x80) {
+            local = (header >> 5) & 0x03;
+            const uint8_t offset = header & 0x1F;
+            m_lastTimestamp += static_cast<uint32_t>((offset - m_lastTimeOffset) & 0x1F);
+            m_lastTimeOffset = offset;
+            hasTimestamp = m_haveTimestamp;
+        } else {
+            if (strict && (header & 0x30)) return Result::Invalid;
+            local = header & 0x0F;
+        }
+
+        const Definition& def = m_defs[local];
+        if (!def.valid || pos + def.size > m_end) return Result::Invalid;
+        handle(def, m_data + pos, hasTimestamp, m_lastTimestamp);
+        pos += def.size;
+
+        const bool record = def.globalNum == MesgRecord;
+        const bool steady = record && m_recordLocal == local;
+        m_sawRecord = m_sawRecord || record;
+        m_recordLocal = record ? local : -1;
+        if (stopInRecords && steady && m_info.firstRecordTime > 0.0) return Result::Records;
+    }
+    return pos == m_end ? Result::End : Result::Invalid;
+}
+
+bool ProbeWalker::readDefinition(size_t& pos, uint8_t header, bool strict) {
+    static constexpr uint8_t typeSizes[17] = {1, 1, 1, 2, 2, 4, 4, 1, 4, 8, 1, 2, 4, 1, 8, 8, 8};
+    if (pos + 5 > m_end) return false;
+    const uint8_t* p = m_data + pos;
+    if (strict && (p[0] != 0 || p[1] > 1 || p[4] == 0 || (header & 0x10))) return false;
+
+    Definition def;
+    def.bigEndian = p[1] == 1;
+    def.globalNum = readU16(p + 2, def.bigEndian);
+    const uint8_t numFields = p[4];
+    pos += 5;
+
+    if (pos + numFields * 3u > m_end) return false;
+    uint32_t offset = 0;
+    for (uint8_t i = 0; i < numFields; ++i) {
+        const uint8_t* f = m_data + pos + i * 3;
+        if (strict) {
+            const uint8_t type = f[2] & 0x1F;
+            if (f[1] == 0 || type > 16 || (f[2] & 0x60) || f[1] % typeSizes[type] != 0) return false;
+        }
+        Target target;
+        if (lookupTarget(def.globalNum, f[0], target) &&
+            (target == Target::Timestamp || target == Target::SessionStartTime ||
+             target == Target::SessionTotalElapsedTime || target == Target::SessionTotalDistance))
+            def.fields.push_back({offset, f[1], f[2], target});
+        offset += f[1];
+    }
+    pos += numFields * 3u;
+
+    if (header & 0x20) {
+        if (pos + 1 > m_end) return false;
+        const uint8_t numDevFields = m_data[pos++];
+        if (pos + numDevFields * 3u > m_end) return false;
+        for (uint8_t i = 0; i < numDevFields; ++i) {
+            if (strict && m_data[pos + i * 3 + 1] == 0) return false;
+            offset += m_data[pos + i * 3 + 1];
+        }
+        pos += numDevFields * 3u;
+    }
+
+    def.size = offset;
+    def.valid = true;
+    m_defs[header & 0x0F] = std::move(def);
+    return true;
+}
+
+void ProbeWalker::handle(const Definition& def, const uint8_t* payload,
+                         bool hasTimestamp, uint32_t timestamp) {
+    const bool session = def.globalNum == MesgSession;
+    if (session) {
+        // The last session message wins, as in the full decode
+        m_info.hasSession = true;
+        m_info.startTime = 0.0;
+        m_info.endTime = 0.0;
+        m_info.totalElapsedTime = 0.0f;
+        m_info.totalDistance = 0.0f;
+    }
+
+    for (const auto& slot : def.fields) {
+        double v;
+        if (!readValue(payload + slot.offset, slot.size, slot.baseType, def.bigEndian, v))
+            continue;
+        switch (slot.target) {
+        case Target::Timestamp:
+            m_lastTimestamp = static_cast<uint32_t>(v);
+            m_lastTimeOffset = m_lastTimestamp & 0x1F;
+            m_haveTimestamp = true;
+            timestamp = m_lastTimestamp;
+            hasTimestamp = true;
+            break;
+        case Target::SessionStartTime: m_info.startTime = fitTime(v); break;
+        case Target::SessionTotalElapsedTime: m_info.totalElapsedTime = static_cast<float>(v / 1000.0); break;
+        case Target::SessionTotalDistance: m_info.totalDistance = static_cast<float>(v / 100.0); break;
+        default: break;
+        }
+    }
+
+    if (!hasTimestamp) return;
+    if (session) {
+        m_info.endTime = fitTime(timestamp);
+    } else if (def.globalNum == MesgRecord) {
+        if (m_info.firstRecordTime == 0.0) m_info.firstRecordTime = fitTime(timestamp);
+        m_info.lastRecordTime = fitTime(timestamp);
+    }
+}
+
+// Summary fields the session did not provide, as FitParser::finalizeSession
+void finishProbe(FitProbeInfo& info) {
+    if (info.startTime == 0.0) info.startTime = info.firstRecordTime;
+    if (info.endTime == 0.0) info.endTime = info.lastRecordTime;
+    if (info.totalElapsedTime == 0.0f)
+        info.totalElapsedTime = static_cast<float>(info.endTime - info.startTime);
+}
+
+} // anonymous namespace
+
+bool FitNativeDecoder::decode(const QString& filePath, FitSession& session) {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        m_error = QString("Cannot open file: %1").arg(filePath);
+        return false;
+    }
+
+    const qint64 size = file.size();
+    if (size < 12) {
+        m_error = QString("Not a valid FIT file: %1").arg(filePath);
+        return false;
+    }
+
+    uchar* data = file.map(0, size);
+    if (!data) {
+        m_error = QString("Cannot map file: %1").arg(filePath);
+        return false;
+    }
+
+    bool ok = decode(data, static_cast<size_t>(size), session);
+    file.unmap(data);
+    if (!ok) m_error = QString("%1: %2").arg(m_error).arg(filePath);
+    return ok;
+}
+
+void FitNativeDecoder::setRecordSink(RecordSink sink, size_t batchSize) {
+    m_sink = std::move(sink);
+    m_batch.assign(m_sink ? std::max<size_t>(batchSize, 1) : 0, FitRecord{});
+}
+
+bool FitNativeDecoder::decode(const uint8_t* data, size_t size, FitSession& session) {
+    m_error.clear();
+    m_crcValid = true;
+    session = FitSession{};
+
+    RecordBatch batch(m_batch, m_sink);
+    RecordBatch* batchPtr = m_sink ? &batch : nullptr;
+
+    size_t pos = 0;
+    bool decodedAny = false;
+
+    // A file may hold several FIT files back to back (chained FIT)
+    while (pos + 12 <= size) {
+        const uint8_t* header = data + pos;
+        const uint8_t headerSize = header[0];
+        if (headerSize < 12 || pos + headerSize > size || std::memcmp(header + 8, ".FIT", 4) != 0) {
+            if (decodedAny) break; // trailing bytes after a complete file
+            m_error = "Not a valid FIT file";
+            return false;
+        }
+
+        uint16_t crc = crc16(0, header, headerSize);
+        if (headerSize >= 14) {
+            const uint16_t headerCrc = readU16(header + 12, false);
+            if (headerCrc != 0 && headerCrc != crc16(0, header, 12))
+                m_crcValid = false;
+        }
+
+        const size_t dataStart = pos + headerSize;
+        size_t dataEnd = dataStart + readU32Le(header + 4);
+        if (dataEnd > size) dataEnd = size;
+
+        MessageWalker walker(session, batchPtr, data, dataEnd);
+        bool truncated = false;
+        if (!walker.walk(dataStart, crc, truncated, m_error))
+            return false;
+        decodedAny = true;
+
+        // Keep whatever was decoded from a cut-off file, but flag it
+        if (truncated || dataEnd + 2 > size) {
+            m_crcValid = false;
+            break;
+        }
+        if (readU16(data + dataEnd, false) != crc)
+            m_crcValid = false;
+        pos = dataEnd + 2;
+    }
+
+    if (!decodedAny) {
+        m_error = "Not a valid FIT file";
+        return false;
+    }
+    if (batchPtr) batchPtr->flush();
+    return true;
+}
+
+bool FitNativeDecoder::probe(const QString& filePath, FitProbeInfo& info) {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        m_error = QString("Cannot open file: %1").arg(filePath);
+        return false;
+    }
+
+    const qint64 size = file.size();
+    if (size < 12) {
+        m_error = QString("Not a valid FIT file: %1").arg(filePath);
+        return false;
+    }
+
+    // Mapped, so only the pages the probe touches are read from disk
+    uchar* data = file.map(0, size);
+    if (!data) {
+        m_error = QString("Cannot map file: %1").arg(filePath);
+        return false;
+    }
+
+    bool ok = probe(data, static_cast<size_t>(size), info);
+    file.unmap(data);
+    if (!ok) m_error = QString("%1: %2").arg(m_error).arg(filePath);
+    return ok;
+}
+
+bool FitNativeDecoder::probe(const uint8_t* data, size_t size, FitProbeInfo& info) {
+    m_error.clear();
+    info = FitProbeInfo{};
+
+    const uint8_t headerSize = size >= 12 ? data[0] : 0;
+    if (headerSize < 12 || headerSize > size || std::memcmp(data + 8, ".FIT", 4) != 0) {
+        m_error = "Not a valid FIT file";
+        return false;
+    }
+    const size_t dataStart = headerSize;
+    size_t dataEnd = dataStart + readU32Le(data + 4);
+    if (dataEnd > size) dataEnd = size;
+    const bool chained = dataEnd + 2 + 12 <= size && std::memcmp(data + dataEnd + 2 + 8, ".FIT", 4) == 0;
+
+    // Start of the file up to the record stream
+    ProbeWalker head(data, dataEnd, info);
+    ProbeWalker::Result result = head.walk(dataStart, true, false);
+    if (result == ProbeWalker::Result::Invalid && !head.sawRecord()) {
+        m_error = "Malformed FIT data";
+        return false;
+    }
+    info.lastRecordTime = 0.0;
+
+    // Tail: walk back from the end until a message chain that runs exactly
+    // to the end holds the last record (and the session, for files that
+    // write their summary last). Known layouts come from the head.
+    if (!chained && result == ProbeWalker::Result::Records) {
+        const size_t window = std::min(dataEnd - dataStart, ProbeTailBytes);
+        bool haveSession = info.hasSession;
+        for (size_t back = 1; back <= window; ++back) {
+            const size_t pos = dataEnd - back;
+            if (!head.canStart(pos)) continue;
+
+            FitProbeInfo tail;
+            ProbeWalker walker(head, tail);
+            if (walker.walk(pos, false, true) != ProbeWalker::Result::End) continue;
+
+            if (tail.hasSession && !haveSession) {
+                info.hasSession = true;
+                info.startTime = tail.startTime;
+                info.endTime = tail.endTime;
+                info.totalElapsedTime = tail.totalElapsedTime;
+                info.totalDistance = tail.totalDistance;
+                haveSession = true;
+            }
+            if (tail.lastRecordTime >= info.firstRecordTime) {
+                info.lastRecordTime = tail.lastRecordTime;
+                break;
+            }
+        }
+        if (haveSession) {
+            finishProbe(info);
+            return true;
+        }
+    }
+
+    // Fallback: every message header of every chained file, payloads skipped
+    info = FitProbeInfo{};
+    info.fullScan = true;
+    size_t pos = 0;
+    while (pos + 12 <= size) {
+        const uint8_t* header = data + pos;
+        if (header[0] < 12 || pos + header[0] > size || std::memcmp(header + 8, ".FIT", 4) != 0)
+            break;
+        size_t end = pos + header[0] + readU32Le(header + 4);
+        if (end > size) end = size;
+        ProbeWalker walker(data, end, info);
+        if (walker.walk(pos + header[0], false, false) != ProbeWalker::Result::End) break;
+        pos = end + 2;
+    }
+    finishProbe(info);
+    return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QString>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "FitData.h"
+
+// File summary read without decoding the records (FitNativeDecoder::probe).
+// Times are Unix seconds; fields are filled like FitParser fills FitSession.
+struct FitProbeInfo {
+    double startTime = 0.0;        // session start, else first record
+    double endTime = 0.0;          // session end, else last record
+    float totalElapsedTime = 0.0f; // session value, else endTime - startTime
+    float totalDistance = 0.0f;
+    double firstRecordTime = 0.0;
+    double lastRecordTime = 0.0;   // 0 if the last record was not located
+    bool hasSession = false;
+    bool fullScan = false;         // the summary was not found near the end
+};
+
+// In-tree FIT decoder that does not depend on the Garmin SDK.
+// The file is memory-mapped and walked exactly once: the CRC is accumulated
+// over each message as it is decoded, and record/lap/session fields are
+// written straight into the session's (pre-reserved) vectors through a field
+// plan compiled from each definition message.
+class FitNativeDecoder {
+public:
+    using RecordSink = std::function<void(const FitRecord* records, size_t count)>;
+
+    // Streams records to sink in batches of at most batchSize instead of
+    // collecting them in session.records. The batch buffer is allocated once
+    // and reused, so the sink must copy whatever it keeps.
+    void setRecordSink(RecordSink sink, size_t batchSize = 1024);
+
+    bool decode(const QString& filePath, FitSession& session);
+    bool decode(const uint8_t* data, size_t size, FitSession& session);
+
+    // Summary only: reads the header and the messages up to the first record
+    // (some devices write the session there), then resynchronises on message
+    // headers in the last few KB for the last record and a trailing session.
+    // Falls back to walking every message header, payloads skipped, when no
+    // session turns up that way and for chained files.
+    bool probe(const QString& filePath, FitProbeInfo& info);
+    bool probe(const uint8_t* data, size_t size, FitProbeInfo& info);
+
+    // False if a header or file CRC did not match. Like the SDK path, a bad
+    // CRC does not fail the decode; callers may still use the data.
+    bool crcValid() const { return m_crcValid; }
+    QString errorString() const { return m_error; }
+
+private:
+    QString m_error;
+    bool m_crcValid = true;
+    RecordSink m_sink;
+    std::vector<FitRecord> m_batch;
+};
@@ -1,5 +1,7 @@
 #include "FitParser.h"
+#include "FitNativeDecoder.h"
 #include "TimeUtil.h"
+#include <algorithm>
 #include <fstream>
 
 #ifdef HAS_FIT_SDK
@@ -72,7 +74,7 @@ public:
             r.temperature = static_cast<float>(mesg.GetTemperature());
 
         if (mesg.IsGradeValid()) {
-            r.grade = mesg.GetGrade();
+            r.grade = gradeFromPercent(mesg.GetGrade());
             r.hasGrade = true;
         }
 
@@ -149,19 +151,93 @@ public:
 FitParser::FitParser(QObject* parent) : QObject(parent) {}
 FitParser::~FitParser() = default;
 
-bool FitParser::parse(const QString& filePath) {
+bool FitParser::parse(const QString& filePath, FitDecoderBackend backend) {
+    m_session = FitSession{};
+    m_error.clear();
+
+    bool ok = false;
+    if (backend != FitDecoderBackend::Sdk) {
+        FitNativeDecoder decoder;
+        ok = decoder.decode(filePath, m_session);
+        if (!ok) m_error = decoder.errorString();
+    }
+
+#ifdef HAS_FIT_SDK
+    if (!ok && backend != FitDecoderBackend::Native) {
+        m_session = FitSession{};
+        ok = parseWithSdk(filePath);
+    }
+#else
+    if (backend == FitDecoderBackend::Sdk)
+        m_error = "FIT SDK not available - build with HAS_FIT_SDK";
+#endif
+
+    if (!ok) {
+        emit error(m_error);
+        return false;
+    }
+
+    RecordStats stats;
+    stats.add(m_session.records.data(), m_session.records.size());
+    finalizeSession(stats);
+    emit parsed(m_session);
+    return true;
+}
+
+bool FitParser::parseStreaming(const QString& filePath, size_t batchSize) {
+    m_session = FitSession{};
+    m_error.clear();
+    batchSize = std::max<size_t>(batchSize, 1);
+
+    RecordStats stats;
+    FitNativeDecoder decoder;
+    decoder.setRecordSink([this, &stats](const FitRecord* records, size_t count) {
+        stats.add(records, count);
+        emit recordsDecoded(records, static_cast<int>(count));
+    }, batchSize);
+
+    bool ok = decoder.decode(filePath, m_session);
+    if (!ok) m_error = decoder.errorString();
+
+#ifdef HAS_FIT_SDK
+    // The SDK cannot stream, so replay its records in batches. Only valid if
+    // the native pass failed before delivering anything.
+    if (!ok && stats.count == 0) {
+        m_session = FitSession{};
+        ok = parseWithSdk(filePath);
+        if (ok) {
+            std::vector<FitRecord> records;
+            records.swap(m_session.records);
+            for (size_t i = 0; i < records.size(); i += batchSize) {
+                const size_t n = std::min(batchSize, records.size() - i);
+                stats.add(records.data() + i, n);
+                emit recordsDecoded(records.data() + i, static_cast<int>(n));
+            }
+        }
+    }
+#endif
+
+    if (!ok) {
+        emit error(m_error);
+        return false;
+    }
+
+    finalizeSession(stats);
+    emit parsed(m_session);
+    return true;
+}
+
 #ifdef HAS_FIT_SDK
+bool FitParser::parseWithSdk(const QString& filePath) {
     std::fstream file(filePath.toStdString(), std::ios::in | std::ios::binary);
     if (!file.is_open()) {
         m_error = QString("Cannot open file: %1").arg(filePath);
-        emit error(m_error);
         return false;
     }
 
     fit::Decode decode;
     if (!decode.IsFIT(file)) {
         m_error = QString("Not a valid FIT file: %1").arg(filePath);
-        emit error(m_error);
         return false;
     }
 
@@ -184,43 +260,53 @@ bool FitParser::parse(const QString& filePath) {
         decode.Read(file, broadcaster, broadcaster);
     } catch (const fit::RuntimeException& e) {
         m_error = QString("FIT decode error: %1").arg(e.what());
-        emit error(m_error);
         return false;
     } catch (const std::exception& e) {
         m_error = QString("Error reading FIT file: %1").arg(e.what());
-        emit error(m_error);
         return false;
     }
 
     m_session = std::move(listener.session);
-    m_session.updateBounds();
+    return true;
+}
+#endif // HAS_FIT_SDK
 
-    // Compute session averages from records if session message didn't provide them
-    if (!m_session.records.empty()) {
-        float totalSpeed = 0, totalHr = 0;
-        int speedCount = 0, hrCount = 0;
-        for (const auto& r : m_session.records) {
-            if (r.speed > 0) { totalSpeed += r.speed; speedCount++; }
-            if (r.hasHeartRate && r.heartRate > 0) { totalHr += r.heartRate; hrCount++; }
+void FitParser::RecordStats::add(const FitRecord* records, size_t n) {
+    if (n == 0) return;
+    if (count == 0) firstTime = records[0].timestamp;
+    lastTime = records[n - 1].timestamp;
+    count += n;
+
+    for (size_t i = 0; i < n; ++i) {
+        const FitRecord& r = records[i];
+        if (r.speed > 0) { totalSpeed += r.speed; speedCount++; }
+        if (r.hasHeartRate && r.heartRate > 0) { totalHr += r.heartRate; hrCount++; }
+        if (r.hasGps) {
+            if (r.latitude < minLat) minLat = r.latitude;
+            if (r.latitude > maxLat) maxLat = r.latitude;
+            if (r.longitude < minLon) minLon = r.longitude;
+            if (r.longitude > maxLon) maxLon = r.longitude;
         }
-        if (m_session.avgSpeed == 0 && speedCount > 0)
-            m_session.avgSpeed = totalSpeed / speedCount;
-        if (m_session.avgHeartRate == 0 && hrCount > 0)
-            m_session.avgHeartRate = totalHr / hrCount;
-        if (m_session.startTime == 0 && !m_session.records.empty())
-            m_session.startTime = m_session.records.front().timestamp;
-        if (m_session.endTime == 0 && !m_session.records.empty())
-            m_session.endTime = m_session.records.back().timestamp;
+    }
+}
+
+void FitParser::finalizeSession(const RecordStats& stats) {
+    m_session.minLat = stats.minLat;
+    m_session.maxLat = stats.maxLat;
+    m_session.minLon = stats.minLon;
+    m_session.maxLon = stats.maxLon;
+
+    // Compute session averages from records if session message didn't provide them
+    if (stats.count > 0) {
+        if (m_session.avgSpeed == 0 && stats.speedCount > 0)
+            m_session.avgSpeed = stats.totalSpeed / stats.speedCount;
+        if (m_session.avgHeartRate == 0 && stats.hrCount > 0)
+            m_session.avgHeartRate = stats.totalHr / stats.hrCount;
+        if (m_session.startTime == 0)
+            m_session.startTime = stats.firstTime;
+        if (m_session.endTime == 0)
+            m_session.endTime = stats.lastTime;
         if (m_session.totalElapsedTime == 0)
             m_session.totalElapsedTime = static_cast<float>(m_session.endTime - m_session.startTime);
     }
-
-    emit parsed(m_session);
-    return true;
-#else
-    Q_UNUSED(filePath);
-    m_error = "FIT SDK not available - build with HAS_FIT_SDK";
-    emit error(m_error);
-    return false;
-#endif
 }
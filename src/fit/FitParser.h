@@ -5,21 +5,56 @@
 #include <memory>
 #include "FitData.h"
 
+enum class FitDecoderBackend {
+    Auto,   // native decoder, falling back to the SDK if it fails
+    Native, // in-tree single-pass decoder (FitNativeDecoder)
+    Sdk     // Garmin FIT SDK (requires HAS_FIT_SDK)
+};
+
 class FitParser : public QObject {
     Q_OBJECT
 public:
     explicit FitParser(QObject* parent = nullptr);
     ~FitParser();
 
-    bool parse(const QString& filePath);
+    bool parse(const QString& filePath, FitDecoderBackend backend = FitDecoderBackend::Auto);
+
+    // Decodes the file and delivers its records through recordsDecoded() in
+    // batches of at most batchSize, without collecting them: session() only
+    // holds the summary and laps afterwards. Peak memory stays at one batch.
+    bool parseStreaming(const QString& filePath, size_t batchSize = DefaultBatchSize);
+    static constexpr size_t DefaultBatchSize = 1024;
+
     const FitSession& session() const { return m_session; }
+    // Moves the decoded session out, leaving the parser empty
+    FitSession takeSession() { return std::move(m_session); }
     QString errorString() const { return m_error; }
 
 signals:
     void parsed(const FitSession& session);
+    // Emitted per batch by parseStreaming(). The buffer is reused for the
+    // next batch: connect with Qt::DirectConnection and copy what you keep.
+    void recordsDecoded(const FitRecord* records, int count);
     void error(const QString& message);
 
 private:
+#ifdef HAS_FIT_SDK
+    bool parseWithSdk(const QString& filePath);
+#endif
+    // Per-record aggregates used to fill in a missing session summary
+    struct RecordStats {
+        float totalSpeed = 0, totalHr = 0;
+        int speedCount = 0, hrCount = 0;
+        size_t count = 0;
+        double firstTime = 0.0, lastTime = 0.0;
+        double minLat = 90.0, maxLat = -90.0;
+        double minLon = 180.0, maxLon = -180.0;
+
+        void add(const FitRecord* records, size_t n);
+    };
+
+    void finalizeSession(const RecordStats& stats);
+
     FitSession m_session;
     QString m_error;
 };
@@ -0,0 +1,201 @@
+#include "FitPeakCurves.h"
+#include "FitAnalytics.h"
+#include <QSemaphore>
+#include <QThreadPool>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace {
+
+// Runs work(i) for every i in [0, count) on the calling thread plus any idle
+// threads of the global pool. Never waits for a busy pool: helpers are only
+// started where a thread is free right now.
+template <typename Work>
+void parallelFor(size_t count, const Work& work) {
+    std::atomic<size_t> next{0};
+    auto drain = [&]() {
+        for (size_t i = next++; i < count; i = next++)
+            work(i);
+    };
+
+    QThreadPool* pool = QThreadPool::globalInstance();
+    QSemaphore finished;
+    int helpers = 0;
+    const int wanted = static_cast<int>(std::min<size_t>(count, static_cast<size_t>(pool->maxThreadCount()))) - 1;
+    for (int h = 0; h < wanted; ++h) {
+        if (!pool->tryStart([&]() { drain(); finished.release(); })) break;
+        ++helpers;
+    }
+    drain();
+    finished.acquire(helpers);
+}
+
+} // anonymous namespace
+
+const FitChannel FitPeakCurves::Channels[ChannelCount] = {
+    FitChannel::Power, FitChannel::HeartRate, FitChannel::Speed
+};
+
+std::vector<double> FitPeakCurves::durations(double longest) {
+    std::vector<double> out;
+    for (double d = 1.0; d <= std::min(60.0, longest); d += 1.0)
+        out.push_back(d);
+    for (double d = 60.0;;) {
+        d = std::max(d + 1.0, std::round(d * 1.02));
+        if (d > longest) break;
+        out.push_back(d);
+    }
+    for (double d : {300.0, 1200.0, 3600.0})
+        if (d <= longest) out.push_back(d);
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return out;
+}
+
+void FitPeakCurves::build(const FitColumns& columns, const FitAnalytics& analytics, size_t first) {
+    // Windows that end before the first new record keep their result
+    const size_t n = columns.size();
+    if (first == 0 || first != m_records || first >= n) {
+        clear();
+        first = 0;
+    }
+    m_records = n;
+    if (n < 2 || analytics.empty()) return;
+
+    const std::vector<double>& time = columns.timestamp;
+    const double t0 = time.front();
+
+    std::vector<FitChannel> present;
+    for (FitChannel channel : Channels) {
+        const int flag = channelFlag(channel);
+        const std::vector<float>& values = columns.channel(channel);
+        if (flag >= 0 ? columns.flags[flag].any()
+                      : std::any_of(values.begin(), values.end(), [](float v) { return v != 0.0f; }))
+            present.push_back(channel);
+    }
+    if (present.empty()) return;
+
+    // Stretches of records without a longer gap, so the grid only spans
+    // recorded time however far apart the sessions are
+    struct Stretch {
+        size_t first, last; // records
+        size_t from, to;    // whole seconds from t0 on the grid
+    };
+    std::vector<Stretch> stretches;
+    size_t longest = 0;
+    for (size_t begin = 0, i = 0; i < n; ++i) {
+        if (i + 1 < n && time[i + 1] - time[i] <= SplitGapSeconds) continue;
+        const size_t from = static_cast<size_t>(std::ceil(time[begin] - t0));
+        const size_t to = static_cast<size_t>(time[i] - t0);
+        if (i > begin && to > from) {
+            stretches.push_back({begin, i, from, to});
+            longest = std::max(longest, to - from);
+        }
+        begin = i + 1;
+    }
+    if (longest == 0) return;
+
+    const std::vector<double> windows = durations(static_cast<double>(longest));
+    std::vector<std::vector<FitPeak>> curves(present.size(), std::vector<FitPeak>(windows.size()));
+    for (size_t c = 0; c < present.size(); ++c) {
+        for (const FitPeak& peak : m_curves[static_cast<int>(present[c])]) {
+            auto it = std::lower_bound(windows.begin(), windows.end(), peak.duration);
+            if (it != windows.end() && *it == peak.duration) curves[c][it - windows.begin()] = peak;
+        }
+    }
+    const size_t kept = first > 0 ? static_cast<size_t>(time[first - 1] - t0) : 0;
+
+    // Running integral and covered time per channel on a 1 s grid
+    struct Prefix {
+        std::vector<double> integral;
+        std::vector<double> covered;
+    };
+    std::vector<FitTimePoint> grid;
+    std::vector<Prefix> prefixes(present.size());
+    for (const Stretch& s : stretches) {
+        if (first > 0 && s.last < first) continue;
+        const size_t seconds = s.to - s.from;
+        grid.resize(seconds + 1);
+        size_t a = s.first;
+        for (size_t g = 0; g <= seconds; ++g) {
+            const double at = t0 + static_cast<double>(s.from + g);
+            while (a + 1 < s.last && time[a + 1] <= at) ++a;
+            const double dt = time[a + 1] - time[a];
+            grid[g] = {a, dt > 0.0 ? std::clamp((at - time[a]) / dt, 0.0, 1.0) : 0.0};
+        }
+        for (size_t c = 0; c < present.size(); ++c) {
+            Prefix& p = prefixes[c];
+            p.integral.resize(seconds + 1);
+            p.covered.resize(seconds + 1);
+            for (size_t g = 0; g <= seconds; ++g) {
+                p.integral[g] = analytics.integralTo(present[c], grid[g]);
+                p.covered[g] = analytics.coveredTo(present[c], grid[g]);
+            }
+        }
+
+        // One sliding pass per (channel, window length), spread over threads,
+        // over the windows that end after `kept`; earlier results only give
+        // way to a better average
+        size_t fitting = 0;
+        while (fitting < windows.size() && static_cast<size_t>(windows[fitting]) <= seconds) ++fitting;
+        if (fitting == 0) continue;
+        parallelFor(present.size() * fitting, [&](size_t job) {
+            const Prefix& p = prefixes[job / fitting];
+            const size_t k = job % fitting;
+            const size_t w = static_cast<size_t>(windows[k]);
+            const double needed = MinCoverage * static_cast<double>(w);
+            if (p.covered[seconds] - p.covered[0] < needed) return;
+
+            FitPeak& peak = curves[job / fitting][k];
+            double best = peak.value;
+            size_t bestStart = 0;
+            bool found = !peak.empty();
+            bool improved = false;
+            const size_t start = first > 0 && kept + 1 > s.from + w ? kept + 1 - s.from - w : 0;
+            for (size_t g = start; g + w <= seconds; ++g) {
+                const double covered = p.covered[g + w] - p.covered[g];
+                if (covered < needed) continue;
+                // mean > best without a division per position
+                const double integral = p.integral[g + w] - p.integral[g];
+                if (!found || integral > best * covered) {
+                    best = integral / covered;
+                    bestStart = g;
+                    found = improved = true;
+                }
+            }
+            if (improved)
+                peak = {windows[k], t0 + static_cast<double>(s.from + bestStart), static_cast<float>(best)};
+        });
+    }
+
+    for (size_t c = 0; c < present.size(); ++c) {
+        std::vector<FitPeak>& curve = curves[c];
+        curve.erase(std::remove_if(curve.begin(), curve.end(), [](const FitPeak& p) { return p.empty(); }),
+                    curve.end());
+        m_curves[static_cast<int>(present[c])] = std::move(curve);
+    }
+}
+
+void FitPeakCurves::clear() {
+    for (auto& curve : m_curves) curve.clear();
+    m_records = 0;
+}
+
+bool FitPeakCurves::empty() const {
+    for (const auto& curve : m_curves)
+        if (!curve.empty()) return false;
+    return true;
+}
+
+FitPeak FitPeakCurves::best(FitChannel channel, double duration) const {
+    const std::vector<FitPeak>& curve = m_curves[static_cast<int>(channel)];
+    auto it = std::upper_bound(curve.begin(), curve.end(), duration,
+        [](double d, const FitPeak& p) { return d < p.duration; });
+    return it == curve.begin() ? FitPeak{} : *(it - 1);
+}
+
+void FitPeakCurves::setCurve(FitChannel channel, std::vector<FitPeak> curve) {
+    m_curves[static_cast<int>(channel)] = std::move(curve);
+    m_records = 0;
+}
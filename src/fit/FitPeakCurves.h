@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include "FitColumns.h"
+
+class FitAnalytics;
+
+// Best average of a channel over one window length
+struct FitPeak {
+    double duration = 0.0;   // window length in seconds
+    double startTime = 0.0;  // unix time the best window starts
+    float value = 0.0f;      // average over the window
+
+    bool empty() const { return duration <= 0.0; }
+};
+
+// Mean-maximal curves (best 5 s, 1 min, 20 min, ...) for power, heart rate
+// and speed, built once per track. The signal is integrated onto a 1 s grid
+// with FitAnalytics' prefix sums, so each window length is one O(n) sliding
+// pass; window lengths are spread over the global thread pool.
+//
+// A window counts when at least MinCoverage of it has data (see
+// FitAnalytics), and its average is over the covered time, so short dropouts
+// do not disqualify it and a pause never scores as a low effort.
+//
+// The grid is split where the records stop for more than SplitGapSeconds
+// (an overnight stop, files days apart), so its size follows the recorded
+// time rather than the wall clock. Only windows at least ten times the gap
+// (see MinCoverage) could have spanned one.
+class FitPeakCurves {
+public:
+    static constexpr double MinCoverage = 0.9;
+    static constexpr double SplitGapSeconds = 3600.0;
+    static constexpr int ChannelCount = 3;
+    static const FitChannel Channels[ChannelCount]; // power, heart rate, speed
+
+    // Window lengths with a point on every curve: each second up to a
+    // minute, then about 2% apart up to `longest`. 5 s, 1, 5, 20 and 60 min
+    // are always included when they fit.
+    static std::vector<double> durations(double longest);
+
+    // When the previous build covered exactly the records before first, and
+    // they are unchanged, only windows ending after them are evaluated
+    void build(const FitColumns& columns, const FitAnalytics& analytics, size_t first = 0);
+    void clear();
+
+    bool empty() const;
+    // Points in ascending duration; empty if the track lacks the channel
+    const std::vector<FitPeak>& curve(FitChannel channel) const { return m_curves[static_cast<int>(channel)]; }
+    // Best window of the longest computed length not above duration
+    FitPeak best(FitChannel channel, double duration) const;
+
+    // Adopts a curve computed earlier (FitTrackCache)
+    void setCurve(FitChannel channel, std::vector<FitPeak> curve);
+
+private:
+    std::vector<FitPeak> m_curves[static_cast<int>(FitChannel::Count)];
+    size_t m_records = 0; // records the curves were built from
+};
@@ -0,0 +1,185 @@
+#include "FitPolylineLod.h"
+#include "FitColumns.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr double METERS_PER_DEGREE = 111320.0;
+constexpr double PI = 3.14159265358979323846;
+
+// Tolerances of the simplified levels: 0.25 m doubling up to about 0.5 km
+constexpr double FIRST_TOLERANCE = 0.25;
+constexpr int SIMPLIFIED_LEVELS = 12;
+
+// Douglas–Peucker runs per window of this many points, whose ends are always
+// kept, so a pathological track costs O(n * window) rather than O(n^2)
+constexpr size_t DP_WINDOW = 8192;
+
+struct Point {
+    double x;
+    double y;
+};
+
+// Distance from p to the segment a-b
+double segmentDistance(const Point& p, const Point& a, const Point& b) {
+    const double dx = b.x - a.x;
+    const double dy = b.y - a.y;
+    const double len2 = dx * dx + dy * dy;
+    double t = len2 > 0.0 ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / len2 : 0.0;
+    t = std::clamp(t, 0.0, 1.0);
+    const double ex = a.x + t * dx - p.x;
+    const double ey = a.y + t * dy - p.y;
+    return std::sqrt(ex * ex + ey * ey);
+}
+
+// Largest tolerance at which Douglas–Peucker still keeps each point: its own
+// split distance, capped by that of every enclosing split
+std::vector<double> importance(const std::vector<Point>& pts) {
+    const size_t n = pts.size();
+    const double always = std::numeric_limits<double>::infinity();
+    std::vector<double> result(n, 0.0);
+    if (n == 0) return result;
+
+    struct Span { size_t a, b; double cap; };
+    std::vector<Span> stack;
+    for (size_t a = 0; a + 1 < n; a += DP_WINDOW) {
+        const size_t b = std::min(a + DP_WINDOW, n - 1);
+        result[a] = result[b] = always;
+        stack.push_back({a, b, always});
+    }
+    result.front() = always;
+    while (!stack.empty()) {
+        const Span s = stack.back();
+        stack.pop_back();
+        if (s.b <= s.a + 1) continue;
+
+        size_t split = s.a + 1;
+        double farthest = -1.0;
+        for (size_t i = s.a + 1; i < s.b; ++i) {
+            const double d = segmentDistance(pts[i], pts[s.a], pts[s.b]);
+            if (d > farthest) {
+                farthest = d;
+                split = i;
+            }
+        }
+        const double kept = std::min(farthest, s.cap);
+        result[split] = kept;
+        stack.push_back({s.a, split, kept});
+        stack.push_back({split, s.b, kept});
+    }
+    return result;
+}
+
+// Chunks of the level's vertices from vertex `from` on; earlier chunks are
+// kept
+void buildChunks(FitPolylineLod::Level& level, const FitColumns& columns, size_t from = 0) {
+    const size_t n = level.vertices.size();
+    // Chunks share their last vertex with the next one
+    const size_t keep = std::min(from > 0 ? (from - 1) / FitPolylineLod::ChunkSize : 0, level.chunks.size());
+    level.chunks.resize(keep);
+    if (n == 0) {
+        level.index.clear();
+        return;
+    }
+    std::vector<FitGeoBox> boxes;
+    for (const FitPolylineLod::Chunk& chunk : level.chunks) boxes.push_back(chunk.box);
+    for (size_t first = keep * FitPolylineLod::ChunkSize;; first += FitPolylineLod::ChunkSize) {
+        FitPolylineLod::Chunk chunk;
+        chunk.first = first;
+        chunk.last = std::min(first + FitPolylineLod::ChunkSize, n - 1);
+        const uint32_t start = level.vertices[first];
+        chunk.box = {columns.latitude[start], columns.latitude[start],
+                     columns.longitude[start], columns.longitude[start]};
+        for (size_t v = first + 1; v <= chunk.last; ++v)
+            chunk.box.expand(columns.latitude[level.vertices[v]], columns.longitude[level.vertices[v]]);
+        level.chunks.push_back(chunk);
+        boxes.push_back(chunk.box);
+        if (chunk.last == n - 1) break;
+    }
+    level.index.build(boxes);
+}
+
+} // anonymous namespace
+
+void FitPolylineLod::build(const FitColumns& columns, size_t first) {
+    if (first == 0 || m_levels.empty()) {
+        clear();
+        first = 0;
+    }
+
+    // GPS samples from `first` on replace the ones there were
+    std::vector<uint32_t> gps = first > 0 ? std::move(m_levels[0].vertices) : std::vector<uint32_t>();
+    gps.erase(std::lower_bound(gps.begin(), gps.end(), static_cast<uint32_t>(first)), gps.end());
+    const size_t kept = gps.size();
+    const FitBitmap& flag = columns.flag(FitFlag::Gps);
+    for (size_t i = first; i < columns.size(); ++i) {
+        // Some devices log 0/0 until they have a fix
+        if (flag.test(i) && columns.latitude[i] != 0.0 && columns.longitude[i] != 0.0)
+            gps.push_back(static_cast<uint32_t>(i));
+    }
+    if (gps.empty()) {
+        clear();
+        return;
+    }
+
+    // Local equirectangular projection in metres around the track's middle;
+    // an extended track keeps the scale it was first built with
+    if (first == 0) {
+        double midLat = 0.0;
+        for (uint32_t i : gps) midLat += columns.latitude[i];
+        midLat /= static_cast<double>(gps.size());
+        m_lonScale = METERS_PER_DEGREE * std::cos(midLat * PI / 180.0);
+    }
+
+    // Douglas–Peucker again from the window holding the last unchanged
+    // point, which ends the windows before it
+    const size_t from = kept > 0 ? (kept - 1) / DP_WINDOW * DP_WINDOW : 0;
+    std::vector<Point> pts(gps.size() - from);
+    for (size_t k = 0; k < pts.size(); ++k)
+        pts[k] = {columns.longitude[gps[from + k]] * m_lonScale, columns.latitude[gps[from + k]] * METERS_PER_DEGREE};
+    const std::vector<double> keep = importance(pts);
+
+    m_levels.resize(SIMPLIFIED_LEVELS + 1);
+    double tolerance = FIRST_TOLERANCE;
+    for (int l = 1; l <= SIMPLIFIED_LEVELS; ++l, tolerance *= 2.0) {
+        Level& level = m_levels[l];
+        level.tolerance = tolerance;
+        level.vertices.erase(std::lower_bound(level.vertices.begin(), level.vertices.end(), gps[from]),
+                             level.vertices.end());
+        for (size_t k = 0; k < keep.size(); ++k)
+            if (keep[k] > tolerance) level.vertices.push_back(gps[from + k]);
+    }
+    const uint32_t redone = gps[from];
+    m_levels[0].vertices = std::move(gps);
+    for (Level& level : m_levels) {
+        auto changed = std::lower_bound(level.vertices.begin(), level.vertices.end(), redone);
+        buildChunks(level, columns, static_cast<size_t>(changed - level.vertices.begin()));
+    }
+}
+
+void FitPolylineLod::clear() {
+    m_levels.clear();
+    m_lonScale = 0.0;
+}
+
+const FitPolylineLod::Level& FitPolylineLod::levelFor(double maxErrorMeters) const {
+    size_t best = 0;
+    for (size_t l = 1; l < m_levels.size() && m_levels[l].tolerance <= maxErrorMeters; ++l)
+        best = l;
+    return m_levels[best];
+}
+
+void FitPolylineLod::Level::visibleRanges(const FitGeoBox& box, std::vector<Range>& out) const {
+    // Chunk runs from the index, turned into vertex ranges in place
+    index.query(box, out);
+    for (Range& run : out)
+        run = {chunks[run.first].first, chunks[run.last].last};
+}
+
+size_t FitPolylineLod::Level::splitAt(double unixTimestamp, const FitColumns& columns) const {
+    auto it = std::upper_bound(vertices.begin(), vertices.end(), unixTimestamp,
+        [&columns](double t, uint32_t i) { return t < columns.timestamp[i]; });
+    return static_cast<size_t>(it - vertices.begin());
+}
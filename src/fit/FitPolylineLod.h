@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "FitSpatialIndex.h"
+
+struct FitColumns;
+
+// GPS track simplified at several tolerances, built once per track.
+// Douglas–Peucker runs once (per window of a few thousand points) and records
+// for every point the largest error at which it is still kept, so each level
+// is the exact DP result for its tolerance. Levels are split into chunks
+// indexed by an R-tree, so a map that shows a small area only visits the
+// chunks it can see.
+class FitPolylineLod {
+public:
+    static constexpr size_t ChunkSize = 64; // vertices per chunk
+
+    struct Chunk {
+        size_t first = 0;   // vertex range [first, last], sharing an end
+        size_t last = 0;    // vertex with the next chunk
+        FitGeoBox box;
+    };
+
+    // Vertex range [first, last] of a level
+    using Range = FitIndexRange;
+
+    struct Level {
+        double tolerance = 0.0;          // metres; 0 keeps every GPS sample
+        std::vector<uint32_t> vertices;  // record indices, in time order
+        std::vector<Chunk> chunks;
+        FitSpatialIndex index;           // over the chunk boxes
+
+        // Stretches of the path whose chunks intersect the box, in time
+        // order. Adjacent visible chunks come back as one range.
+        void visibleRanges(const FitGeoBox& box, std::vector<Range>& out) const;
+
+        // First vertex recorded after unixTimestamp (vertices.size() if none)
+        size_t splitAt(double unixTimestamp, const FitColumns& columns) const;
+    };
+
+    // Records before first are taken as unchanged since the last build:
+    // only the Douglas–Peucker window they end in and the chunks after it
+    // are redone, in the projection of the first build
+    void build(const FitColumns& columns, size_t first = 0);
+    void clear();
+
+    bool empty() const { return m_levels.empty(); }
+    size_t levelCount() const { return m_levels.size(); }
+    const Level& level(size_t i) const { return m_levels[i]; }
+
+    // Coarsest level whose tolerance does not exceed maxErrorMeters (for a
+    // map, about half a pixel in metres). Requires !empty().
+    const Level& levelFor(double maxErrorMeters) const;
+
+private:
+    std::vector<Level> m_levels; // finest first
+    double m_lonScale = 0.0;     // metres per degree of longitude
+};
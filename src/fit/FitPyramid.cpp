@@ -0,0 +1,169 @@
+#include "FitPyramid.h"
+#include <algorithm>
+
+namespace {
+
+// First index >= start whose value reaches `value` (passes it when `after`).
+// Gallops forward from start, so consecutive seeks cost O(log gap).
+template <typename T>
+size_t gallop(const std::vector<T>& v, double value, size_t start, bool after) {
+    auto before = [value, after](T x) { return after ? x <= value : x < value; };
+    const size_t n = v.size();
+    if (start >= n || !before(v[start])) return start;
+
+    size_t lo = start;
+    size_t step = 1;
+    size_t hi;
+    for (;;) {
+        hi = lo + step;
+        if (hi >= n) { hi = n; break; }
+        if (!before(v[hi])) break;
+        lo = hi;
+        step *= 2;
+    }
+    // v[lo] is before the value; the answer lies in (lo, hi]
+    auto it = std::partition_point(v.begin() + lo + 1, v.begin() + hi, before);
+    return static_cast<size_t>(it - v.begin());
+}
+
+} // anonymous namespace
+
+void FitPyramid::build(const FitColumns& columns, const std::vector<float>* distanceAxis, size_t first) {
+    if (m_columns != &columns) first = 0;
+    m_columns = &columns;
+    const size_t n = columns.size();
+
+    m_distanceAxis = distanceAxis && distanceAxis->size() == n ? distanceAxis : nullptr;
+    if (m_distanceAxis) {
+        m_distance.clear();
+    } else {
+        const std::vector<float>& distance = columns.channel(FitChannel::Distance);
+        const size_t from = std::min(first, m_distance.size());
+        m_distance.resize(n);
+        float reached = from > 0 ? m_distance[from - 1] : 0.0f;
+        for (size_t i = from; i < n; ++i) {
+            reached = std::max(reached, distance[i]);
+            m_distance[i] = reached;
+        }
+    }
+
+    for (int c = 0; c < static_cast<int>(FitChannel::Count); ++c) {
+        Levels& levels = m_levels[c];
+        if (n <= Fanout) {
+            levels.clear();
+            continue;
+        }
+
+        // Blocks of Fanout records, then blocks of Fanout blocks, up to a
+        // level small enough to scan. Only blocks from the one holding
+        // `first` on are recomputed.
+        size_t from = first / Fanout;
+        size_t size = (n + Fanout - 1) / Fanout;
+        size_t l = 0;
+        for (;; ++l) {
+            if (l == levels.size()) {
+                levels.emplace_back();
+                from = 0;
+            }
+            std::vector<FitMinMax>& level = levels[l];
+            from = std::min(from, level.size());
+            level.resize(size);
+            for (size_t b = from; b < size; ++b) {
+                level[b] = FitMinMax{};
+                if (l == 0) {
+                    const size_t end = std::min(n, (b + 1) * Fanout);
+                    for (size_t i = b * Fanout; i < end; ++i)
+                        addRaw(static_cast<FitChannel>(c), i, level[b]);
+                } else {
+                    const std::vector<FitMinMax>& below = levels[l - 1];
+                    const size_t end = std::min(below.size(), (b + 1) * Fanout);
+                    for (size_t i = b * Fanout; i < end; ++i)
+                        level[b].add(below[i]);
+                }
+            }
+            if (size <= Fanout) break;
+            from /= Fanout;
+            size = (size + Fanout - 1) / Fanout;
+        }
+        levels.resize(l + 1);
+    }
+}
+
+void FitPyramid::clear() {
+    m_columns = nullptr;
+    m_distanceAxis = nullptr;
+    m_distance.clear();
+    for (Levels& levels : m_levels)
+        levels.clear();
+}
+
+void FitPyramid::addRaw(FitChannel channel, size_t i, FitMinMax& out) const {
+    const int flag = channelFlag(channel);
+    if (flag >= 0 && !m_columns->flags[flag].test(i)) return;
+    out.add(m_columns->channel(channel)[i]);
+}
+
+FitMinMax FitPyramid::range(FitChannel channel, size_t first, size_t last) const {
+    FitMinMax result;
+    if (empty()) return result;
+    last = std::min(last, m_columns->size());
+    if (first >= last) return result;
+
+    const Levels& levels = m_levels[static_cast<int>(channel)];
+    auto add = [&](int level, size_t i) {
+        if (level < 0) addRaw(channel, i, result);
+        else result.add(levels[level][i]);
+    };
+
+    // Peel unaligned entries off both ends, then continue one level up with
+    // the aligned middle; -1 is the raw records
+    size_t lo = first;
+    size_t hi = last;
+    int level = -1;
+    for (;;) {
+        const bool top = level + 1 >= static_cast<int>(levels.size());
+        if (top || hi - lo < 2 * Fanout) {
+            for (size_t i = lo; i < hi; ++i) add(level, i);
+            break;
+        }
+        while (lo % Fanout) add(level, lo++);
+        while (hi % Fanout) add(level, --hi);
+        lo /= Fanout;
+        hi /= Fanout;
+        ++level;
+    }
+    return result;
+}
+
+FitMinMax FitPyramid::overall(FitChannel channel) const {
+    return range(channel, 0, empty() ? 0 : m_columns->size());
+}
+
+size_t FitPyramid::seekAxis(FitAxis axis, double value, size_t start, bool after) const {
+    if (axis == FitAxis::Time) return gallop(m_columns->timestamp, value, start, after);
+    return gallop(m_distanceAxis ? *m_distanceAxis : m_distance, value, start, after);
+}
+
+void FitPyramid::buckets(FitChannel channel, FitAxis axis, double from, double to,
+                         FitMinMax* out, size_t count) const {
+    std::fill(out, out + count, FitMinMax{});
+    if (empty() || count == 0 || !(to > from)) return;
+
+    const double width = (to - from) / static_cast<double>(count);
+    size_t begin = seekAxis(axis, from, 0, false);
+    for (size_t b = 0; b < count; ++b) {
+        const bool lastBucket = b + 1 == count;
+        const size_t end = lastBucket
+            ? seekAxis(axis, to, begin, true)
+            : seekAxis(axis, from + static_cast<double>(b + 1) * width, begin, false);
+        out[b] = range(channel, begin, end);
+        begin = end;
+    }
+}
+
+std::vector<FitMinMax> FitPyramid::buckets(FitChannel channel, FitAxis axis,
+                                           double from, double to, size_t count) const {
+    std::vector<FitMinMax> out(count);
+    buckets(channel, axis, from, to, out.data(), count);
+    return out;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include "FitColumns.h"
+
+// Smallest and largest value of a channel over some span. Empty when no
+// valid sample fell inside it.
+struct FitMinMax {
+    float min = std::numeric_limits<float>::infinity();
+    float max = -std::numeric_limits<float>::infinity();
+
+    bool empty() const { return min > max; }
+    float span() const { return empty() ? 0.0f : max - min; }
+
+    void add(float v) {
+        if (v < min) min = v;
+        if (v > max) max = v;
+    }
+    void add(const FitMinMax& o) {
+        if (o.min < min) min = o.min;
+        if (o.max > max) max = o.max;
+    }
+};
+
+// Axis a bucket query splits evenly
+enum class FitAxis {
+    Time,       // unix seconds
+    Distance    // metres along the track
+};
+
+// Per-channel min/max decimation pyramid over a track's records, built once
+// per track. Level k aggregates blocks of 4^k records, so the min/max of any
+// record span costs O(log) block reads, and N buckets over an axis range
+// cost about N block lookups whatever the record count.
+//
+// Heart rate, cadence and power only count records flagged as having the
+// value. The pyramid refers to the columns (and distance axis) it was built
+// from; rebuild it whenever they change.
+class FitPyramid {
+public:
+    // distanceAxis is the monotonic distance per record (FitDistanceIndex);
+    // without it the pyramid keeps its own running maximum of the column.
+    // Records before first are taken as unchanged since the last build from
+    // the same columns, so appending costs about the new records.
+    void build(const FitColumns& columns, const std::vector<float>* distanceAxis = nullptr,
+               size_t first = 0);
+    void clear();
+
+    bool empty() const { return !m_columns || m_columns->empty(); }
+
+    // Records [first, last)
+    FitMinMax range(FitChannel channel, size_t first, size_t last) const;
+    FitMinMax overall(FitChannel channel) const;
+
+    // Splits [from, to] on the axis into count equal buckets; bucket i holds
+    // the records with axis value in [from + i*w, from + (i+1)*w), the last
+    // bucket includes `to`. Distance is taken as the running maximum of the
+    // column, so GPS jitter and dropouts logged as 0 never step it back.
+    void buckets(FitChannel channel, FitAxis axis, double from, double to,
+                 FitMinMax* out, size_t count) const;
+    std::vector<FitMinMax> buckets(FitChannel channel, FitAxis axis,
+                                   double from, double to, size_t count) const;
+
+private:
+    static constexpr size_t Fanout = 4;
+
+    using Levels = std::vector<std::vector<FitMinMax>>;
+
+    // First record from `start` on at or past value (strictly past if after)
+    size_t seekAxis(FitAxis axis, double value, size_t start, bool after) const;
+    void addRaw(FitChannel channel, size_t i, FitMinMax& out) const;
+
+    const FitColumns* m_columns = nullptr;
+    const std::vector<float>* m_distanceAxis = nullptr;
+    std::vector<float> m_distance; // own running maximum, without an axis
+    Levels m_levels[static_cast<int>(FitChannel::Count)]; // [0] = blocks of 4
+};
@@ -0,0 +1,82 @@
+#include "FitSegmentStore.h"
+#include "FitSegments.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace {
+
+constexpr int kVersion = 1;
+
+} // anonymous namespace
+
+QString FitSegmentStore::defaultPath() {
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/segments.json";
+}
+
+bool FitSegmentStore::load(const QString& path, FitSegmentLibrary& library) {
+    m_error.clear();
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        m_error = QString("Cannot read: %1").arg(path);
+        return false;
+    }
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    if (!doc.isObject()) {
+        m_error = "Invalid segment file format";
+        return false;
+    }
+    QJsonObject root = doc.object();
+    if (root["version"].toInt() > kVersion) {
+        m_error = "Unsupported segment file version";
+        return false;
+    }
+
+    library.clear();
+    for (const QJsonValue& value : root["segments"].toArray()) {
+        QJsonObject obj = value.toObject();
+        FitSegment segment;
+        segment.name = obj["name"].toString();
+        for (const QJsonValue& point : obj["points"].toArray()) {
+            QJsonArray latLon = point.toArray();
+            segment.points.push_back({latLon.at(0).toDouble(), latLon.at(1).toDouble()});
+        }
+        library.add(std::move(segment));
+    }
+    return true;
+}
+
+bool FitSegmentStore::save(const QString& path, const FitSegmentLibrary& library) {
+    m_error.clear();
+    QJsonArray segments;
+    for (const FitSegment& segment : library.segments()) {
+        QJsonArray points;
+        for (const FitGeoPoint& p : segment.points)
+            points.append(QJsonArray{p.lat, p.lon});
+        QJsonObject obj;
+        obj["name"] = segment.name;
+        obj["points"] = points;
+        segments.append(obj);
+    }
+    QJsonObject root;
+    root["version"] = kVersion;
+    root["segments"] = segments;
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        m_error = QString("Cannot write to: %1").arg(path);
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+    if (!file.commit()) {
+        m_error = QString("Cannot write to: %1").arg(path);
+        return false;
+    }
+    return true;
+}
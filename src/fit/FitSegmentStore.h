@@ -0,0 +1,22 @@
+#pragma once
+
+#include <QString>
+
+class FitSegmentLibrary;
+
+// Reads and writes the segment library as JSON (segments.json in the
+// application data directory by default):
+// {"version": 1, "segments": [{"name": "...", "points": [[lat, lon], ...]}]}
+class FitSegmentStore {
+public:
+    static QString defaultPath();
+
+    // Replaces the library's segments with those in the file
+    bool load(const QString& path, FitSegmentLibrary& library);
+    bool save(const QString& path, const FitSegmentLibrary& library);
+
+    QString errorString() const { return m_error; }
+
+private:
+    QString m_error;
+};
@@ -0,0 +1,224 @@
+#include "FitSegments.h"
+#include "FitTrack.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr double METERS_PER_DEGREE = 111320.0;
+constexpr double PI = 3.14159265358979323846;
+
+struct Point {
+    double x;
+    double y;
+};
+
+// Local equirectangular projection in metres
+class Projection {
+public:
+    explicit Projection(double lat) : m_lonScale(METERS_PER_DEGREE * std::cos(lat * PI / 180.0)) {}
+    Point operator()(double lat, double lon) const { return {lon * m_lonScale, lat * METERS_PER_DEGREE}; }
+    Point operator()(const FitGeoPoint& p) const { return (*this)(p.lat, p.lon); }
+
+    // Box around p reaching `meters` in every direction
+    FitGeoBox around(const FitGeoPoint& p, double meters) const {
+        const double dLat = meters / METERS_PER_DEGREE;
+        const double dLon = meters / std::max(m_lonScale, 1.0);
+        return {p.lat - dLat, p.lat + dLat, p.lon - dLon, p.lon + dLon};
+    }
+
+private:
+    double m_lonScale;
+};
+
+double distance(const Point& a, const Point& b) {
+    return std::hypot(b.x - a.x, b.y - a.y);
+}
+
+// Distance from p to the segment a-b
+double segmentDistance(const Point& p, const Point& a, const Point& b) {
+    const double dx = b.x - a.x;
+    const double dy = b.y - a.y;
+    const double len2 = dx * dx + dy * dy;
+    double t = len2 > 0.0 ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / len2 : 0.0;
+    t = std::clamp(t, 0.0, 1.0);
+    return std::hypot(a.x + t * dx - p.x, a.y + t * dy - p.y);
+}
+
+QMutex s_currentMutex;
+std::shared_ptr<const FitSegmentLibrary> s_current = std::make_shared<FitSegmentLibrary>();
+
+} // anonymous namespace
+
+void FitSegment::updateGeometry() {
+    length = 0.0;
+    box = {};
+    if (points.empty()) return;
+    box = {points[0].lat, points[0].lat, points[0].lon, points[0].lon};
+    for (size_t i = 1; i < points.size(); ++i) {
+        const Projection project(points[i].lat);
+        length += distance(project(points[i - 1]), project(points[i]));
+        box.expand(points[i].lat, points[i].lon);
+    }
+}
+
+std::shared_ptr<const FitSegmentLibrary> FitSegmentLibrary::current() {
+    QMutexLocker lock(&s_currentMutex);
+    return s_current;
+}
+
+void FitSegmentLibrary::setCurrent(std::shared_ptr<const FitSegmentLibrary> library) {
+    if (!library) library = std::make_shared<FitSegmentLibrary>();
+    QMutexLocker lock(&s_currentMutex);
+    s_current = std::move(library);
+}
+
+FitSegment FitSegmentLibrary::fromTrack(const FitTrack& track, double from, double to, const QString& name) {
+    FitSegment segment;
+    segment.name = name;
+    const FitPolylineLod& lod = track.polyline();
+    if (lod.empty()) return segment;
+
+    // GPS samples in the range, thinned to about PointSpacing apart
+    const FitPolylineLod::Level& level = lod.level(0);
+    const FitColumns& columns = track.columns();
+    const size_t first = level.splitAt(std::nextafter(from, -HUGE_VAL), columns);
+    const size_t last = level.splitAt(to, columns);
+    double sinceKept = 0.0;
+    for (size_t k = first; k < last; ++k) {
+        const uint32_t i = level.vertices[k];
+        const FitGeoPoint p{columns.latitude[i], columns.longitude[i]};
+        if (!segment.points.empty()) {
+            const Projection project(p.lat);
+            sinceKept += distance(project(columns.latitude[level.vertices[k - 1]], columns.longitude[level.vertices[k - 1]]),
+                                  project(p));
+            if (sinceKept < PointSpacing && k + 1 < last) continue;
+        }
+        segment.points.push_back(p);
+        sinceKept = 0.0;
+    }
+    segment.updateGeometry();
+    return segment;
+}
+
+int FitSegmentLibrary::add(FitSegment segment) {
+    if (segment.points.size() < 2) return -1;
+    segment.updateGeometry();
+    m_segments.push_back(std::move(segment));
+    buildIndex();
+    return static_cast<int>(m_segments.size()) - 1;
+}
+
+void FitSegmentLibrary::remove(size_t i) {
+    if (i >= m_segments.size()) return;
+    m_segments.erase(m_segments.begin() + static_cast<std::ptrdiff_t>(i));
+    buildIndex();
+}
+
+void FitSegmentLibrary::clear() {
+    m_segments.clear();
+    m_index.clear();
+}
+
+void FitSegmentLibrary::buildIndex() {
+    std::vector<FitGeoBox> boxes;
+    boxes.reserve(m_segments.size());
+    for (const FitSegment& segment : m_segments) boxes.push_back(segment.box);
+    m_index.build(boxes);
+}
+
+std::vector<FitSegmentEffort> FitSegmentLibrary::match(const FitTrack& track) const {
+    std::vector<FitSegmentEffort> efforts;
+    const FitPolylineLod& lod = track.polyline();
+    if (m_segments.empty() || lod.empty()) return efforts;
+
+    // Segments whose bounds meet the track's, with room for the tolerance
+    const std::vector<FitPolylineLod::Chunk>& chunks = lod.level(0).chunks;
+    FitGeoBox bounds = chunks.front().box;
+    for (const FitPolylineLod::Chunk& chunk : chunks) bounds.expand(chunk.box);
+    const Projection projection((bounds.minLat + bounds.maxLat) / 2.0);
+    bounds.expand(projection.around({bounds.minLat, bounds.minLon}, MatchTolerance));
+    bounds.expand(projection.around({bounds.maxLat, bounds.maxLon}, MatchTolerance));
+
+    std::vector<FitIndexRange> runs;
+    m_index.query(bounds, runs);
+    for (const FitIndexRange& run : runs) {
+        for (size_t s = run.first; s <= run.last; ++s)
+            matchSegment(track, static_cast<int>(s), efforts);
+    }
+    std::sort(efforts.begin(), efforts.end(), [](const FitSegmentEffort& a, const FitSegmentEffort& b) {
+        return a.startTime < b.startTime || (a.startTime == b.startTime && a.segment < b.segment);
+    });
+    return efforts;
+}
+
+void FitSegmentLibrary::matchSegment(const FitTrack& track, int s, std::vector<FitSegmentEffort>& out) const {
+    const FitSegment& segment = m_segments[s];
+    const FitPolylineLod::Level& level = track.polyline().level(0);
+    const std::vector<uint32_t>& vertices = level.vertices;
+    const FitColumns& columns = track.columns();
+
+    const Projection project(segment.points.front().lat);
+    std::vector<Point> path;
+    path.reserve(segment.points.size());
+    for (const FitGeoPoint& p : segment.points) path.push_back(project(p));
+    auto vertex = [&](size_t k) {
+        return project(columns.latitude[vertices[k]], columns.longitude[vertices[k]]);
+    };
+
+    // Vertices near the start, from the track's index; each run of
+    // consecutive ones is a pass, starting at its closest vertex
+    std::vector<FitIndexRange> ranges;
+    level.visibleRanges(project.around(segment.points.front(), MatchTolerance), ranges);
+    std::vector<size_t> starts;
+    double closest = 0.0;
+    size_t lastNear = SIZE_MAX;
+    for (const FitIndexRange& range : ranges) {
+        for (size_t k = range.first; k <= range.last; ++k) {
+            if (lastNear != SIZE_MAX && k <= lastNear) continue; // ranges share end vertices
+            const double d = distance(vertex(k), path.front());
+            if (d > MatchTolerance) continue;
+            if (lastNear == SIZE_MAX || k != lastNear + 1) {
+                starts.push_back(k);
+                closest = d;
+            } else if (d < closest) {
+                starts.back() = k;
+                closest = d;
+            }
+            lastNear = k;
+        }
+    }
+
+    const double limit = segment.length * MaxDetour + 2.0 * MatchTolerance;
+    size_t resume = 0; // efforts do not overlap
+    for (size_t start : starts) {
+        if (start < resume) continue;
+        size_t next = 1;
+        double travelled = 0.0;
+        for (size_t k = start + 1; k < vertices.size() && travelled <= limit; ++k) {
+            const Point a = vertex(k - 1), b = vertex(k);
+            travelled += distance(a, b);
+            while (next < path.size() && segmentDistance(path[next], a, b) <= MatchTolerance) ++next;
+            if (next < path.size()) continue;
+
+            // End at the vertex closest to the segment's end
+            size_t end = distance(a, path.back()) < distance(b, path.back()) ? k - 1 : k;
+            while (end + 1 < vertices.size() && distance(vertex(end + 1), path.back()) < distance(vertex(end), path.back()))
+                ++end;
+
+            FitSegmentEffort effort;
+            effort.segment = s;
+            effort.name = segment.name;
+            effort.length = segment.length;
+            effort.first = vertices[start];
+            effort.last = vertices[end];
+            effort.startTime = columns.timestamp[effort.first];
+            effort.endTime = columns.timestamp[effort.last];
+            out.push_back(effort);
+            resume = end;
+            break;
+        }
+    }
+}
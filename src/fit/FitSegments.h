@@ -0,0 +1,81 @@
+#pragma once
+
+#include <QString>
+#include <memory>
+#include <vector>
+#include "FitSpatialIndex.h"
+
+class FitTrack;
+
+struct FitGeoPoint {
+    double lat = 0.0;
+    double lon = 0.0;
+};
+
+// A stretch of road to be timed whenever a ride covers it, start to end
+struct FitSegment {
+    QString name;
+    std::vector<FitGeoPoint> points;    // path, about PointSpacing apart
+    double length = 0.0;                // metres along points
+    FitGeoBox box;                      // bounds of points
+
+    void updateGeometry();              // length and box from points
+};
+
+// One ride over a segment
+struct FitSegmentEffort {
+    int segment = -1;           // index into the library
+    QString name;
+    double length = 0.0;        // segment length, metres
+    size_t first = 0;           // record closest to the segment start
+    size_t last = 0;            // record closest to the segment end
+    double startTime = 0.0;
+    double endTime = 0.0;
+
+    double elapsed() const { return endTime - startTime; }
+};
+
+// The user's segments, with an R-tree over their bounds. Matching a track
+// asks the segment index for the segments near the track, then the track's
+// own GPS index (FitPolylineLod) for the passes near each segment's start,
+// and follows the path from there only; a library of hundreds of segments
+// costs a few index queries per ride rather than a comparison of all pairs
+// of points. Matching is const and safe from several threads.
+//
+// A pass matches when the path comes within MatchTolerance of every point
+// of the segment in order, and reaches its end within MaxDetour times the
+// segment's length; riding it backwards or leaving it part way does not.
+class FitSegmentLibrary {
+public:
+    static constexpr double MatchTolerance = 25.0;  // metres
+    static constexpr double MaxDetour = 1.2;
+    static constexpr double PointSpacing = 50.0;    // metres
+
+    // The library in use; replaced as a whole, so readers keep a consistent
+    // snapshot while it is edited
+    static std::shared_ptr<const FitSegmentLibrary> current();
+    static void setCurrent(std::shared_ptr<const FitSegmentLibrary> library);
+
+    // Segment over a track's GPS path between two times
+    static FitSegment fromTrack(const FitTrack& track, double from, double to, const QString& name);
+
+    size_t size() const { return m_segments.size(); }
+    bool empty() const { return m_segments.empty(); }
+    const FitSegment& segment(size_t i) const { return m_segments[i]; }
+    const std::vector<FitSegment>& segments() const { return m_segments; }
+
+    // Adds a segment of at least two points; returns its index or -1
+    int add(FitSegment segment);
+    void remove(size_t i);
+    void clear();
+
+    // Efforts on the track, ordered by start time
+    std::vector<FitSegmentEffort> match(const FitTrack& track) const;
+
+private:
+    void buildIndex();
+    void matchSegment(const FitTrack& track, int s, std::vector<FitSegmentEffort>& out) const;
+
+    std::vector<FitSegment> m_segments;
+    FitSpatialIndex m_index;    // over segment boxes, in library order
+};
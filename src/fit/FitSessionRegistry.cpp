@@ -0,0 +1,112 @@
+#include "FitSessionRegistry.h"
+#include "FitParser.h"
+#include "FitTrackCache.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+FitSessionRegistry& FitSessionRegistry::instance() {
+    static FitSessionRegistry registry;
+    return registry;
+}
+
+namespace {
+
+// Shared tracks belong to the GUI thread regardless of who loaded them
+void moveToGuiThread(FitTrack& track) {
+    if (QCoreApplication::instance())
+        track.moveToThread(QCoreApplication::instance()->thread());
+}
+
+} // anonymous namespace
+
+std::unique_ptr<FitTrack> FitSessionRegistry::loadTrack(const QString& path, QString* error,
+                                                        const PartialTrack& partial) {
+    auto track = std::make_unique<FitTrack>();
+
+    // Fast path: mapped .fvtrack sidecar, no FIT decoding
+    FitTrackCache cache;
+    if (cache.load(path, *track))
+        return track;
+
+    // Stream batches straight into the columns; no full record vector is built
+    FitParser parser;
+    FitTrack* target = track.get();
+    size_t nextPartial = FirstPartialRecords;
+    QObject::connect(&parser, &FitParser::recordsDecoded, &parser,
+        [target, &partial, &nextPartial](const FitRecord* records, int count) {
+            target->appendRecords(records, static_cast<size_t>(count));
+            if (!partial || target->recordCount() < nextPartial) return;
+            nextPartial = target->recordCount() * 2;
+            std::unique_ptr<FitTrack> snapshot = target->snapshot();
+            moveToGuiThread(*snapshot);
+            partial(std::move(snapshot));
+        }, Qt::DirectConnection);
+    if (!parser.parseStreaming(path)) {
+        if (error) *error = parser.errorString();
+        return nullptr;
+    }
+    track->finishRecords(parser.takeSession());
+    FitTrackCache::storeInBackground(path, *track);
+    return track;
+}
+
+std::shared_ptr<const FitTrack> FitSessionRegistry::acquire(const QString& path, QString* error,
+                                                            const PartialTrack& partial) {
+    QFileInfo info(path);
+    if (!info.exists()) {
+        if (error) *error = QString("Cannot open file: %1").arg(path);
+        return nullptr;
+    }
+    const QString key = info.absoluteFilePath();
+    const qint64 size = info.size();
+    const qint64 mtimeMs = info.lastModified().toMSecsSinceEpoch();
+
+    std::shared_ptr<Entry> entry;
+    {
+        QMutexLocker lock(&m_mutex);
+        std::shared_ptr<Entry>& slot = m_entries[key];
+        if (!slot) slot = std::make_shared<Entry>();
+        entry = slot;
+    }
+
+    // Per-entry lock: loading one file does not block lookups of others
+    QMutexLocker lock(&entry->mutex);
+    if (entry->track && entry->size == size && entry->mtimeMs == mtimeMs)
+        return entry->track;
+
+    std::unique_ptr<FitTrack> track = loadTrack(key, error, partial);
+    if (!track) return nullptr;
+    moveToGuiThread(*track);
+
+    entry->track = std::move(track);
+    entry->size = size;
+    entry->mtimeMs = mtimeMs;
+    return entry->track;
+}
+
+std::shared_ptr<const FitTrack> FitSessionRegistry::find(const QString& path) const {
+    const QString key = QFileInfo(path).absoluteFilePath();
+    std::shared_ptr<Entry> entry;
+    {
+        QMutexLocker lock(&m_mutex);
+        auto it = m_entries.find(key);
+        if (it == m_entries.end()) return nullptr;
+        entry = it->second;
+    }
+    QMutexLocker lock(&entry->mutex);
+    return entry->track;
+}
+
+void FitSessionRegistry::releaseUnused() {
+    QMutexLocker lock(&m_mutex);
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        // An entry's own lock is taken by acquire() only while it holds a
+        // reference to the entry, so a sole owner here means nobody is loading.
+        const auto& entry = it->second;
+        bool unused = entry.use_count() == 1 && (!entry->track || entry->track.use_count() == 1);
+        if (unused) it = m_entries.erase(it);
+        else ++it;
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QMutex>
+#include <QString>
+#include <functional>
+#include <map>
+#include <memory>
+#include "FitTrack.h"
+
+// Process-wide table of loaded FIT tracks keyed by absolute path. The media
+// browser, the timeline and the overlay renderer all receive the same
+// immutable FitTrack for a file, so each file is decoded (or read from its
+// .fvtrack cache) once per process rather than once per consumer.
+class FitSessionRegistry {
+public:
+    static FitSessionRegistry& instance();
+
+    // Receives snapshots of a file that is still decoding (FitTrack::snapshot),
+    // on the loading thread. They are taken each time the record count
+    // doubles, so the copies cost about one extra pass over the file.
+    using PartialTrack = std::function<void(std::shared_ptr<const FitTrack>)>;
+
+    // Returns the shared track for path, loading it on first use. Concurrent
+    // callers asking for the same path wait for a single load. A file whose
+    // size or mtime changed since it was loaded is loaded again. Only the
+    // caller that decodes the file gets partial tracks.
+    std::shared_ptr<const FitTrack> acquire(const QString& path, QString* error = nullptr,
+                                            const PartialTrack& partial = PartialTrack());
+
+    // Returns the track only if it is already loaded
+    std::shared_ptr<const FitTrack> find(const QString& path) const;
+
+    // Drops entries no consumer holds any more
+    void releaseUnused();
+
+    // Cache-or-parse load without registering the result
+    static std::unique_ptr<FitTrack> loadTrack(const QString& path, QString* error = nullptr,
+                                               const PartialTrack& partial = PartialTrack());
+
+private:
+    FitSessionRegistry() = default;
+
+    // Records decoded before the first partial track
+    static constexpr size_t FirstPartialRecords = 1 << 16;
+
+    struct Entry {
+        QMutex mutex; // held while the entry loads
+        std::shared_ptr<const FitTrack> track;
+        qint64 size = -1;
+        qint64 mtimeMs = -1;
+    };
+
+    mutable QMutex m_mutex; // guards m_entries only
+    std::map<QString, std::shared_ptr<Entry>> m_entries;
+};
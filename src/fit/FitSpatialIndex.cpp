@@ -0,0 +1,52 @@
+#include "FitSpatialIndex.h"
+#include <algorithm>
+
+void FitSpatialIndex::build(const std::vector<FitGeoBox>& boxes) {
+    clear();
+    if (boxes.empty()) return;
+
+    m_levels.push_back(boxes);
+    while (m_levels.back().size() > 1) {
+        const std::vector<FitGeoBox>& below = m_levels.back();
+        std::vector<FitGeoBox> above((below.size() + Fanout - 1) / Fanout);
+        for (size_t n = 0; n < above.size(); ++n) {
+            const size_t first = n * Fanout;
+            const size_t last = std::min(below.size(), first + Fanout);
+            above[n] = below[first];
+            for (size_t i = first + 1; i < last; ++i)
+                above[n].expand(below[i]);
+        }
+        m_levels.push_back(std::move(above));
+    }
+}
+
+void FitSpatialIndex::clear() {
+    m_levels.clear();
+}
+
+void FitSpatialIndex::query(const FitGeoBox& box,
+                            std::vector<FitIndexRange>& runs) const {
+    runs.clear();
+    if (m_levels.empty()) return;
+
+    // Depth-first, children pushed last-first so hits come out in order
+    struct Node { size_t level, index; };
+    std::vector<Node> stack;
+    stack.push_back({m_levels.size() - 1, 0});
+    while (!stack.empty()) {
+        const Node node = stack.back();
+        stack.pop_back();
+        if (!m_levels[node.level][node.index].intersects(box)) continue;
+
+        if (node.level == 0) {
+            if (!runs.empty() && runs.back().last + 1 == node.index) runs.back().last = node.index;
+            else runs.push_back({node.index, node.index});
+            continue;
+        }
+
+        const size_t first = node.index * Fanout;
+        const size_t last = std::min(m_levels[node.level - 1].size(), first + Fanout);
+        for (size_t i = last; i-- > first;)
+            stack.push_back({node.level - 1, i});
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Latitude/longitude rectangle in degrees
+struct FitGeoBox {
+    double minLat = 0.0, maxLat = 0.0;
+    double minLon = 0.0, maxLon = 0.0;
+
+    bool intersects(const FitGeoBox& o) const {
+        return minLat <= o.maxLat && maxLat >= o.minLat &&
+               minLon <= o.maxLon && maxLon >= o.minLon;
+    }
+    void expand(double lat, double lon) {
+        if (lat < minLat) minLat = lat;
+        if (lat > maxLat) maxLat = lat;
+        if (lon < minLon) minLon = lon;
+        if (lon > maxLon) maxLon = lon;
+    }
+    void expand(const FitGeoBox& o) {
+        expand(o.minLat, o.minLon);
+        expand(o.maxLat, o.maxLon);
+    }
+};
+
+// Inclusive index range [first, last]
+struct FitIndexRange {
+    size_t first = 0;
+    size_t last = 0;
+};
+
+// Packed R-tree over boxes given in track order. Consecutive pieces of a
+// track lie next to each other, so packing them in that order gives tight
+// nodes without sorting; a query touches O(log n) nodes plus the hits.
+class FitSpatialIndex {
+public:
+    void build(const std::vector<FitGeoBox>& boxes);
+    void clear();
+
+    bool empty() const { return m_levels.empty(); }
+    size_t size() const { return m_levels.empty() ? 0 : m_levels.front().size(); }
+
+    // Runs [first, last] of consecutive boxes that intersect the query box,
+    // in ascending order
+    void query(const FitGeoBox& box, std::vector<FitIndexRange>& runs) const;
+
+private:
+    static constexpr size_t Fanout = 16;
+
+    std::vector<std::vector<FitGeoBox>> m_levels; // [0] = the boxes, last = root
+};
@@ -1,197 +1,664 @@
 #include "FitTrack.h"
+#include "SimdUtil.h"
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <iterator>
+#include <limits>
+#include <queue>
+
+namespace {
+std::atomic<uint64_t> s_generation{0};
+}
 
 FitTrack::FitTrack(QObject* parent) : QObject(parent) {}
 FitTrack::~FitTrack() = default;
 
-void FitTrack::loadSession(const FitSession& session) {
-    m_session = session;
-    m_records = session.records;
-    m_laps = session.laps;
+void FitTrack::bumpGeneration() {
+    m_generation = ++s_generation;
+}
+
+void FitTrack::loadSession(FitSession session) {
+    m_columns.clear();
+    appendRecords(session.records.data(), session.records.size());
+    finishRecords(std::move(session));
+}
+
+void FitTrack::appendRecords(const FitRecord* records, size_t count) {
+    const size_t oldSize = m_columns.size();
+    m_columns.resize(oldSize + count);
+    for (size_t i = 0; i < count; ++i)
+        m_columns.set(oldSize + i, records[i]);
+}
 
-    std::sort(m_records.begin(), m_records.end(),
-        [](const FitRecord& a, const FitRecord& b) { return a.timestamp < b.timestamp; });
-    
+void FitTrack::finishRecords(FitSession summary) {
+    m_columns.sortByTime();
+
+    // Keep only the summary; the records now live in m_columns
+    std::vector<FitRecord>().swap(summary.records);
+    m_session = std::move(summary);
+    m_laps = m_session.laps;
+
+    m_distanceIndex.build(m_columns);
     calculateInclination();
+    calculateDerived();
+    buildTimeIndex();
+    m_lapIndex.build(m_laps, m_columns);
+    m_pyramid.build(m_columns, &m_distanceIndex.distances());
+    m_analytics.build(m_columns);
+    m_peaks.build(m_columns, m_analytics);
+    m_climbs = detectClimbs(m_columns, m_distanceIndex);
+    m_polyline.build(m_columns);
+    bumpGeneration();
+}
+
+std::unique_ptr<FitTrack> FitTrack::snapshot() const {
+    auto copy = std::make_unique<FitTrack>();
+    copy->m_columns = m_columns;
+    copy->m_gradeSettings = m_gradeSettings;
+    copy->m_derivedSettings = m_derivedSettings;
+    copy->m_timeIndexEnabled = m_timeIndexEnabled;
+    FitSession summary;
+    if (!m_columns.empty()) {
+        const auto& time = m_columns.timestamp;
+        summary.startTime = *std::min_element(time.begin(), time.end());
+        summary.endTime = *std::max_element(time.begin(), time.end());
+    }
+    copy->finishRecords(std::move(summary));
+    copy->m_session.totalDistance = copy->m_distanceIndex.total();
+    copy->m_session.totalElapsedTime = static_cast<float>(copy->duration());
+    return copy;
+}
+
+void FitTrack::appendSession(FitSession session) {
+    std::vector<FitSession> sessions;
+    sessions.push_back(std::move(session));
+    appendSessions(std::move(sessions));
 }
 
-void FitTrack::appendSession(const FitSession& session) {
-    m_records.insert(m_records.end(), session.records.begin(), session.records.end());
-    m_laps.insert(m_laps.end(), session.laps.begin(), session.laps.end());
+void FitTrack::appendSessions(std::vector<FitSession> sessions) {
+    auto byTime = [](const FitRecord& a, const FitRecord& b) { return a.timestamp < b.timestamp; };
+    size_t incoming = 0;
+    for (auto& s : sessions) {
+        if (!std::is_sorted(s.records.begin(), s.records.end(), byTime))
+            std::stable_sort(s.records.begin(), s.records.end(), byTime);
+        incoming += s.records.size();
+    }
+    std::stable_sort(sessions.begin(), sessions.end(), [](const FitSession& a, const FitSession& b) {
+        return !b.records.empty() && (a.records.empty() || a.records.front().timestamp < b.records.front().timestamp);
+    });
+
+    // Totals of a track loaded without them come from its records, so the
+    // sessions' shares add up (see mergeSummary)
+    if (!isEmpty()) {
+        m_session.startTime = startTime();
+        m_session.endTime = endTime();
+        if (m_session.totalDistance <= 0.0f && m_distanceIndex.size() == m_columns.size())
+            m_session.totalDistance = m_distanceIndex.total() - m_distanceIndex.at(0);
+        if (m_session.totalElapsedTime <= 0.0f)
+            m_session.totalElapsedTime = static_cast<float>(duration());
+    }
+
+    // Chained files usually follow each other: then the samples are simply
+    // appended, otherwise they are merged
+    const size_t oldCount = m_columns.size();
+    const float oldLastDistance = oldCount > 0 ? m_columns.channel(FitChannel::Distance)[oldCount - 1] : 0.0f;
+    double end = isEmpty() ? -std::numeric_limits<double>::infinity() : endTime();
+    bool inOrder = true;
+    for (const auto& s : sessions) {
+        if (s.records.empty()) continue;
+        if (s.records.front().timestamp <= end) { inOrder = false; break; }
+        end = s.records.back().timestamp;
+    }
 
-    std::sort(m_records.begin(), m_records.end(),
-        [](const FitRecord& a, const FitRecord& b) { return a.timestamp < b.timestamp; });
-    std::sort(m_laps.begin(), m_laps.end(),
-        [](const FitLap& a, const FitLap& b) { return a.startTime < b.startTime; });
+    size_t firstChanged = oldCount;
+    if (inOrder) {
+        m_columns.reserve(oldCount + incoming);
+        for (const auto& s : sessions) appendRecords(s.records.data(), s.records.size());
+    } else {
+        firstChanged = mergeRecords(sessions);
+    }
 
-    // Rebuild m_session to reflect all accumulated records
-    m_session.records = m_records;
+    for (auto& s : sessions) {
+        mergeSummary(s);
+        std::sort(s.laps.begin(), s.laps.end(),
+            [](const FitLap& a, const FitLap& b) { return a.startTime < b.startTime; });
+        const auto mid = m_laps.insert(m_laps.end(), std::make_move_iterator(s.laps.begin()),
+                                       std::make_move_iterator(s.laps.end()));
+        std::inplace_merge(m_laps.begin(), mid, m_laps.end(),
+            [](const FitLap& a, const FitLap& b) { return a.startTime < b.startTime; });
+    }
     m_session.laps = m_laps;
-    if (!m_records.empty()) {
-        m_session.startTime = m_records.front().timestamp;
-        m_session.endTime = m_records.back().timestamp;
-        m_session.totalElapsedTime = static_cast<float>(m_session.endTime - m_session.startTime);
+    if (!m_columns.empty()) {
+        m_session.startTime = startTime();
+        m_session.endTime = endTime();
     }
-    // Merge session-level stats from incoming session
-    m_session.totalDistance = std::max(m_session.totalDistance, session.totalDistance);
-    if (session.totalDistance > m_session.totalDistance) {
-        m_session.totalDistance = session.totalDistance;
+    const auto& dist = m_columns.channel(FitChannel::Distance);
+
+    // Grades before the first changed sample stay valid unless the filter
+    // window reaches it or the old end of the grid. Distance can step back,
+    // so the first sample that reaches `from` is found on the monotonic axis.
+    m_distanceIndex.build(m_columns, firstChanged);
+    size_t gradeFrom = 0;
+    if (oldCount > 0 && firstChanged > 0 && firstChanged < m_columns.size() &&
+        dist.back() >= oldLastDistance) {
+        float from = std::min({dist[firstChanged - 1], dist[firstChanged], oldLastDistance});
+        from -= static_cast<float>(m_gradeSettings.reach());
+        const std::vector<float>& reached = m_distanceIndex.distances();
+        gradeFrom = static_cast<size_t>(
+            std::lower_bound(reached.begin(), reached.begin() + firstChanged, from) - reached.begin());
     }
-    // Recompute totalDistance from records if available
-    if (!m_records.empty() && m_records.back().distance > 0) {
-        m_session.totalDistance = m_records.back().distance;
+    calculateInclination(gradeFrom);
+    // Derived channels are causal: only samples from the first change on move
+    const size_t derivedFrom = calculateDerived(firstChanged);
+
+    // The indexes are extended from the first sample whose columns changed;
+    // the peak curves and the polyline only read recorded channels. Climbs
+    // and the lap index are one cheap pass over the track.
+    const size_t changed = std::min(gradeFrom, derivedFrom);
+    buildTimeIndex(firstChanged);
+    m_lapIndex.build(m_laps, m_columns);
+    m_pyramid.build(m_columns, &m_distanceIndex.distances(), changed);
+    m_analytics.build(m_columns, changed);
+    m_peaks.build(m_columns, m_analytics, firstChanged);
+    m_climbs = detectClimbs(m_columns, m_distanceIndex);
+    m_polyline.build(m_columns, firstChanged);
+    bumpGeneration();
+}
+
+// k-way merge of the existing columns (source 0) and the sorted sessions.
+// On equal timestamps the existing sample, then the earlier session, wins.
+// Returns the index of the first sample that was not already in place.
+size_t FitTrack::mergeRecords(const std::vector<FitSession>& sessions) {
+    struct Head {
+        double time;
+        size_t source;
+        size_t pos;
+    };
+    auto later = [](const Head& a, const Head& b) {
+        return a.time > b.time || (a.time == b.time && a.source > b.source);
+    };
+    std::priority_queue<Head, std::vector<Head>, decltype(later)> heap(later);
+
+    size_t total = m_columns.size();
+    if (!m_columns.empty()) heap.push({m_columns.timestamp[0], 0, 0});
+    for (size_t k = 0; k < sessions.size(); ++k) {
+        total += sessions[k].records.size();
+        if (!sessions[k].records.empty())
+            heap.push({sessions[k].records[0].timestamp, k + 1, 0});
     }
-    m_session.updateBounds();
 
-    calculateInclination();
+    FitColumns merged;
+    merged.reserve(total);
+    size_t firstChanged = SIZE_MAX;
+    size_t lastSource = SIZE_MAX;
+    while (!heap.empty()) {
+        Head head = heap.top();
+        heap.pop();
+
+        bool duplicate = !merged.empty() && head.time == merged.timestamp.back() && head.source != lastSource;
+        if (!duplicate) {
+            if (head.source == 0) {
+                merged.appendRow(m_columns, head.pos);
+            } else {
+                if (firstChanged == SIZE_MAX) firstChanged = merged.size();
+                merged.append(sessions[head.source - 1].records[head.pos]);
+            }
+            lastSource = head.source;
+        }
+
+        size_t next = head.pos + 1;
+        if (head.source == 0) {
+            if (next < m_columns.size()) heap.push({m_columns.timestamp[next], 0, next});
+        } else {
+            const auto& records = sessions[head.source - 1].records;
+            if (next < records.size()) heap.push({records[next].timestamp, head.source, next});
+        }
+    }
+
+    m_columns = std::move(merged);
+    return std::min(firstChanged, m_columns.size());
+}
+
+// Folds one session's summary into m_session without rescanning the track
+void FitTrack::mergeSummary(const FitSession& session) {
+    FitSession& m = m_session;
+    if (m.sport.isEmpty()) m.sport = session.sport;
+
+    double from = session.startTime, to = session.endTime;
+    float distance = session.totalDistance;
+    if (!session.records.empty()) {
+        from = session.records.front().timestamp;
+        to = session.records.back().timestamp;
+        if (distance <= 0.0f) {
+            // Span of the session's own odometer, which may restart at 0
+            float reached = 0.0f;
+            for (const auto& r : session.records) reached = std::max(reached, r.distance);
+            distance = reached - std::max(0.0f, session.records.front().distance);
+        }
+    }
+    const float elapsed = session.totalElapsedTime > 0.0f ? session.totalElapsedTime
+                                                          : static_cast<float>(to - from);
+
+    // Totals only take the share of the session outside the time the track
+    // already spans, so overlapping files are not counted twice
+    const bool spanned = m.endTime > m.startTime || m.totalElapsedTime > 0.0f;
+    double fresh = 1.0;
+    if (spanned) {
+        const double overlap = std::min(to, m.endTime) - std::max(from, m.startTime);
+        if (to > from) fresh = 1.0 - std::clamp(overlap / (to - from), 0.0, 1.0);
+        else if (overlap >= 0.0) fresh = 0.0;
+    }
+
+    // Averages weighted by elapsed time
+    const float w0 = m.totalElapsedTime, w1 = static_cast<float>(fresh * elapsed);
+    auto blend = [&](float a, float b) {
+        return (w0 + w1) > 0.0f ? (a * w0 + b * w1) / (w0 + w1) : std::max(a, b);
+    };
+    m.avgSpeed = blend(m.avgSpeed, session.avgSpeed);
+    m.avgHeartRate = blend(m.avgHeartRate, session.avgHeartRate);
+    m.avgCadence = blend(m.avgCadence, session.avgCadence);
+    m.avgPower = blend(m.avgPower, session.avgPower);
+    m.maxSpeed = std::max(m.maxSpeed, session.maxSpeed);
+    m.maxHeartRate = std::max(m.maxHeartRate, session.maxHeartRate);
+    m.totalAscent += static_cast<float>(fresh * session.totalAscent);
+    m.totalDescent += static_cast<float>(fresh * session.totalDescent);
+    m.totalDistance += static_cast<float>(fresh * distance);
+    m.totalElapsedTime = w0 + w1;
+    m.startTime = spanned ? std::min(m.startTime, from) : from;
+    m.endTime = spanned ? std::max(m.endTime, to) : to;
+
+    // Bounds grow with the incoming GPS samples only
+    for (const auto& r : session.records) {
+        if (!r.hasGps) continue;
+        m.minLat = std::min(m.minLat, r.latitude);
+        m.maxLat = std::max(m.maxLat, r.latitude);
+        m.minLon = std::min(m.minLon, r.longitude);
+        m.maxLon = std::max(m.maxLon, r.longitude);
+    }
+}
+
+void FitTrack::restore(FitColumns columns, std::vector<FitLap> laps, const FitSession& session,
+                       FitPeakCurves peaks) {
+    m_columns = std::move(columns);
+    m_laps = std::move(laps);
+    m_session = session;
+    m_session.records.clear();
+    m_session.laps = m_laps;
+    // The derived channels come with the columns; NP resumes from the start
+    m_derivedState = FitDerivedState{};
+    m_zoneMaxHeartRate = resolveZoneMaxHeartRate();
+    buildTimeIndex();
+    m_lapIndex.build(m_laps, m_columns);
+    m_distanceIndex.build(m_columns);
+    m_pyramid.build(m_columns, &m_distanceIndex.distances());
+    m_analytics.build(m_columns);
+    if (peaks.empty()) m_peaks.build(m_columns, m_analytics);
+    else m_peaks = std::move(peaks);
+    m_climbs = detectClimbs(m_columns, m_distanceIndex);
+    m_polyline.build(m_columns);
+    bumpGeneration();
 }
 
 void FitTrack::clear() {
-    m_records.clear();
+    m_columns.clear();
+    m_timeGrid.clear();
     m_laps.clear();
+    m_lapIndex.clear();
+    m_distanceIndex.clear();
+    m_pyramid.clear();
+    m_analytics.clear();
+    m_peaks.clear();
+    m_climbs.clear();
+    m_polyline.clear();
     m_session = FitSession{};
+    m_derivedState = FitDerivedState{};
+    m_zoneMaxHeartRate = 0.0f;
+    bumpGeneration();
 }
 
 double FitTrack::startTime() const {
-    return m_records.empty() ? 0.0 : m_records.front().timestamp;
+    return m_columns.empty() ? 0.0 : m_columns.timestamp.front();
 }
 
 double FitTrack::endTime() const {
-    return m_records.empty() ? 0.0 : m_records.back().timestamp;
+    return m_columns.empty() ? 0.0 : m_columns.timestamp.back();
 }
 
 double FitTrack::duration() const {
     return endTime() - startTime();
 }
 
-FitRecord FitTrack::getRecordAtTime(double unixTimestamp) const {
-    if (m_records.empty()) return FitRecord{};
-    if (unixTimestamp <= m_records.front().timestamp) return m_records.front();
-    if (unixTimestamp >= m_records.back().timestamp) return m_records.back();
+void FitTrack::setTimeIndexEnabled(bool enabled) {
+    m_timeIndexEnabled = enabled;
+    buildTimeIndex();
+}
 
-    // Binary search for the interval
-    auto it = std::lower_bound(m_records.begin(), m_records.end(), unixTimestamp,
-        [](const FitRecord& r, double t) { return r.timestamp < t; });
+void FitTrack::buildTimeIndex(size_t first) {
+    const auto& time = m_columns.timestamp;
+    const size_t n = time.size();
+    if (!m_timeIndexEnabled || n < 2 || n > UINT32_MAX || duration() <= 0.0) {
+        m_timeGrid.clear();
+        m_gridStep = 0.0;
+        return;
+    }
 
-    if (it == m_records.begin()) return *it;
-    if (it == m_records.end()) return m_records.back();
+    // One cell per sample on average; pauses leave runs of cells pointing at
+    // the same sample, bursts make the scan within a cell a little longer.
+    // After samples from first on changed, the step is kept while that stays
+    // within a factor of two, and only cells from the one holding the first
+    // changed sample are filled again.
+    size_t cell = 0;
+    size_t cells = n + 1;
+    const double span = m_gridStep > 0.0 ? duration() / m_gridStep : 0.0;
+    if (first > 0 && first < n && !m_timeGrid.empty() && span >= 0.5 * n && span <= 2.0 * n) {
+        cells = static_cast<size_t>(std::ceil(span)) + 1;
+        cell = static_cast<size_t>((time[first] - time.front()) / m_gridStep);
+        cell = std::min(cell, m_timeGrid.size() - 1);
+        if (cell > 0) --cell;
+    } else {
+        m_gridStep = duration() / static_cast<double>(n);
+    }
+    size_t a = cell > 0 ? m_timeGrid[cell] : 0;
+    m_timeGrid.resize(cells);
+    for (; cell < cells; ++cell) {
+        double cellStart = time.front() + cell * m_gridStep;
+        while (a + 1 < n && time[a + 1] < cellStart) ++a;
+        m_timeGrid[cell] = static_cast<uint32_t>(a);
+    }
+}
 
-    const auto& b = *it;
-    const auto& a = *(it - 1);
+// Index a of the interval with time[a] < unixTimestamp <= time[a + 1].
+// The timestamp must lie strictly inside the track.
+size_t FitTrack::indexBefore(double unixTimestamp) const {
+    const auto& time = m_columns.timestamp;
+    if (!m_timeGrid.empty()) {
+        size_t cell = static_cast<size_t>((unixTimestamp - time.front()) / m_gridStep);
+        cell = std::min(cell, m_timeGrid.size() - 1);
+        size_t a = m_timeGrid[cell];
+        // Rounding in the cell computation can land one cell late
+        while (a > 0 && time[a] >= unixTimestamp) --a;
+        for (int step = 0; time[a + 1] < unixTimestamp; ++step) {
+            if (step == MaxGridSteps) {
+                // A long gap (rides days apart) packs many samples into one
+                // cell; binary search up to the next cell's entry instead
+                const size_t next = m_timeGrid[std::min(cell + 1, m_timeGrid.size() - 1)];
+                const size_t hi = std::min<size_t>(next + 1, time.size() - 1);
+                auto it = std::lower_bound(time.begin() + a + 1, time.begin() + hi + 1, unixTimestamp);
+                a = static_cast<size_t>(it - time.begin()) - 1;
+                // ... or one cell early
+                while (time[a + 1] < unixTimestamp) ++a;
+                break;
+            }
+            ++a;
+        }
+        return a;
+    }
+    auto it = std::lower_bound(time.begin(), time.end(), unixTimestamp);
+    return static_cast<size_t>(it - time.begin()) - 1;
+}
 
-    double range = b.timestamp - a.timestamp;
-    if (range < 1e-9) return a;
+// Interpolation factor from sample a towards a + 1 (0 when no blending is needed)
+size_t FitTrack::fractionAt(size_t a, double unixTimestamp, double& t) const {
+    const auto& time = m_columns.timestamp;
+    double range = time[a + 1] - time[a];
+    t = range < 1e-9 ? 0.0 : (unixTimestamp - time[a]) / range;
+    return a;
+}
 
-    double t = (unixTimestamp - a.timestamp) / range;
-    return interpolate(a, b, t);
+// Returns the index of the sample at or before unixTimestamp and the
+// interpolation factor towards the next one (0 when no blending is needed).
+size_t FitTrack::intervalAt(double unixTimestamp, double& t) const {
+    const auto& time = m_columns.timestamp;
+    t = 0.0;
+    if (unixTimestamp <= time.front()) return 0;
+    if (unixTimestamp >= time.back()) return time.size() - 1;
+    return fractionAt(indexBefore(unixTimestamp), unixTimestamp, t);
 }
 
-int FitTrack::findLapAtTime(double unixTimestamp) const {
-    for (int i = 0; i < static_cast<int>(m_laps.size()); ++i) {
-        if (unixTimestamp >= m_laps[i].startTime && unixTimestamp <= m_laps[i].endTime) {
-            return i;
-        }
+size_t FitTrack::Cursor::seek(double unixTimestamp, double& t) {
+    const auto& time = m_track->m_columns.timestamp;
+    t = 0.0;
+    if (unixTimestamp <= time.front()) return m_index = 0;
+    if (unixTimestamp >= time.back()) return m_index = time.size() - 1;
+
+    size_t a = std::min(m_index, time.size() - 2);
+    if (time[a] < unixTimestamp) {
+        // Playback: the next frame is usually in the same or the next interval
+        int steps = 0;
+        while (time[a + 1] < unixTimestamp && steps++ < MaxForwardSteps) ++a;
+        if (time[a + 1] < unixTimestamp) a = m_track->indexBefore(unixTimestamp);
+    } else {
+        a = m_track->indexBefore(unixTimestamp);
     }
-    return -1;
+    m_index = a;
+    return m_track->fractionAt(a, unixTimestamp, t);
 }
 
-FitRecord FitTrack::interpolate(const FitRecord& a, const FitRecord& b, double t) const {
-    FitRecord r;
-    r.timestamp = a.timestamp + t * (b.timestamp - a.timestamp);
-    r.latitude = a.latitude + t * (b.latitude - a.latitude);
-    r.longitude = a.longitude + t * (b.longitude - a.longitude);
-    r.altitude = a.altitude + static_cast<float>(t) * (b.altitude - a.altitude);
-    r.speed = a.speed + static_cast<float>(t) * (b.speed - a.speed);
-    r.heartRate = a.heartRate + static_cast<float>(t) * (b.heartRate - a.heartRate);
-    r.cadence = a.cadence + static_cast<float>(t) * (b.cadence - a.cadence);
-    r.power = a.power + static_cast<float>(t) * (b.power - a.power);
-    r.distance = a.distance + static_cast<float>(t) * (b.distance - a.distance);
-    r.temperature = a.temperature + static_cast<float>(t) * (b.temperature - a.temperature);
-    r.grade = a.grade + static_cast<float>(t) * (b.grade - a.grade);
-    r.hasGps = a.hasGps || b.hasGps;
-    r.hasHeartRate = a.hasHeartRate || b.hasHeartRate;
-    r.hasCadence = a.hasCadence || b.hasCadence;
-    r.hasPower = a.hasPower || b.hasPower;
-    r.hasGrade = a.hasGrade || b.hasGrade;
-    return r;
+FitRecord FitTrack::Cursor::recordAt(double unixTimestamp) {
+    if (!m_track || m_track->isEmpty()) return FitRecord{};
+
+    double t;
+    size_t a = seek(unixTimestamp, t);
+    if (t <= 0.0) return m_track->m_columns.record(a);
+    return m_track->interpolate(a, a + 1, t);
 }
 
-void FitTrack::calculateInclination() {
-    if (m_records.size() < 2) return;
+float FitTrack::Cursor::valueAt(FitChannel channel, double unixTimestamp) {
+    if (!m_track || m_track->isEmpty()) return 0.0f;
 
-    // Check if grade already exists in the data
-    bool hasGradeData = false;
-    for (const auto& r : m_records) {
-        if (r.hasGrade) {
-            hasGradeData = true;
-            break;
-        }
-    }
-    if (hasGradeData) return;
+    const auto& column = m_track->m_columns.channel(channel);
+    double t;
+    size_t a = seek(unixTimestamp, t);
+    if (t <= 0.0) return column[a];
+    return column[a] + static_cast<float>(t) * (column[a + 1] - column[a]);
+}
 
-    double maxDist = m_records.back().distance;
-    if (maxDist <= 0.0) return;
+FitRecord FitTrack::Cursor::recordAtDistance(float distance) {
+    if (!m_track || m_track->isEmpty()) return FitRecord{};
 
-    // Step 1: Resample with even delta x (5.0 meters)
-    double dx = 5.0;
-    int numSamples = static_cast<int>(std::ceil(maxDist / dx)) + 1;
-    std::vector<double> evenAlt(numSamples, 0.0);
+    const FitTimePoint p = m_track->m_distanceIndex.locate(distance, m_distanceHint);
+    m_distanceHint = p.index;
+    return m_track->recordAtPoint(p);
+}
 
-    size_t recIdx = 0;
-    for (int i = 0; i < numSamples; ++i) {
-        double d = i * dx;
-        
-        while (recIdx < m_records.size() - 1 && m_records[recIdx + 1].distance < d) {
-            recIdx++;
-        }
-        
-        if (recIdx >= m_records.size() - 1) {
-            evenAlt[i] = m_records.back().altitude;
+FitRecord FitTrack::getRecordAtTime(double unixTimestamp) const {
+    if (m_columns.empty()) return FitRecord{};
+
+    double t;
+    size_t a = intervalAt(unixTimestamp, t);
+    if (t <= 0.0) return m_columns.record(a);
+    return interpolate(a, a + 1, t);
+}
+
+FitSampleTable FitTrack::sampleRange(double startTime, double step, size_t count) const {
+    FitSampleTable table;
+    table.startTime = startTime;
+    table.step = step;
+    FitColumns& out = table.columns;
+    out.resize(count);
+    if (m_columns.empty() || count == 0) return table;
+
+    const FitColumns& in = m_columns;
+    const auto& time = in.timestamp;
+    const size_t n = time.size();
+
+    // Pass 1: merge the frame times against the sample times. Each frame gets
+    // the pair of samples it blends and the weight of the second one.
+    std::vector<uint32_t> lo(count), hi(count);
+    std::vector<float> weight(count);
+    size_t a = 0;
+    bool tracking = false;
+    size_t flagsA = SIZE_MAX, flagsB = SIZE_MAX;
+    unsigned pairFlags = 0;
+    for (size_t i = 0; i < count; ++i) {
+        double q = startTime + static_cast<double>(i) * step;
+        double t = 0.0;
+        size_t ia = 0, ib = 0;
+        if (q <= time.front()) {
+            tracking = false;
+        } else if (q >= time.back()) {
+            ia = ib = n - 1;
+            tracking = false;
         } else {
-            const auto& a = m_records[recIdx];
-            const auto& b = m_records[recIdx + 1];
-            double distRange = b.distance - a.distance;
-            if (distRange < 1e-6) {
-                evenAlt[i] = b.altitude;
-            } else {
-                double t = (d - a.distance) / distRange;
-                evenAlt[i] = a.altitude + t * (b.altitude - a.altitude);
-            }
+            // Walk forward from the previous frame; search only on entry or
+            // when the step is negative
+            if (!tracking || time[a] >= q) a = indexBefore(q);
+            else while (time[a + 1] < q) ++a;
+            tracking = true;
+            fractionAt(a, q, t);
+            ia = a;
+            ib = t > 0.0 ? a + 1 : a;
         }
-    }
 
-    // Step 2: Low-pass filter (moving average)
-    int window = 10; // 50 meters (10 * 5m)
-    std::vector<double> smoothAlt(numSamples, 0.0);
-    for (int i = 0; i < numSamples; ++i) {
-        double sum = 0;
-        int count = 0;
-        for (int j = std::max(0, i - window); j <= std::min(numSamples - 1, i + window); ++j) {
-            sum += evenAlt[j];
-            count++;
+        lo[i] = static_cast<uint32_t>(ia);
+        hi[i] = static_cast<uint32_t>(ib);
+        weight[i] = static_cast<float>(t);
+        out.timestamp[i] = time[ia] + t * (time[ib] - time[ia]);
+        out.latitude[i] = in.latitude[ia] + t * (in.latitude[ib] - in.latitude[ia]);
+        out.longitude[i] = in.longitude[ia] + t * (in.longitude[ib] - in.longitude[ia]);
+
+        // Consecutive frames mostly blend the same pair; the output bitmaps
+        // start cleared, so only set bits need writing
+        if (ia != flagsA || ib != flagsB) {
+            flagsA = ia;
+            flagsB = ib;
+            pairFlags = 0;
+            for (int f = 0; f < static_cast<int>(FitFlag::Count); ++f)
+                if (in.flags[f].test(ia) || in.flags[f].test(ib)) pairFlags |= 1u << f;
         }
-        smoothAlt[i] = sum / count;
-    }
-
-    // Step 3: Compute inclination and map back to m_records
-    for (auto& r : m_records) {
-        double d = r.distance;
-        int i = static_cast<int>(d / dx);
-        
-        double dz = 0.0;
-        double currentDx = dx;
-        
-        if (i > 0 && i < numSamples - 1) {
-            dz = smoothAlt[i+1] - smoothAlt[i-1];
-            currentDx = 2.0 * dx;
-        } else if (i == 0 && numSamples > 1) {
-            dz = smoothAlt[1] - smoothAlt[0];
-        } else if (i >= numSamples - 1 && numSamples > 1) {
-            dz = smoothAlt[numSamples-1] - smoothAlt[numSamples-2];
+        if (pairFlags) {
+            for (int f = 0; f < static_cast<int>(FitFlag::Count); ++f)
+                if (pairFlags & (1u << f)) out.flags[f].set(i, true);
         }
-        
-        double angle = std::atan2(dz, currentDx) * 180.0 / 3.14159265358979323846;
-        r.grade = static_cast<float>(angle);
     }
+
+    // Pass 2: blend each float column with the vector kernel
+    for (int c = 0; c < static_cast<int>(FitChannel::Count); ++c)
+        SimdUtil::gatherLerp(in.channels[c].data(), lo.data(), hi.data(), weight.data(),
+                             out.channels[c].data(), count);
+    return table;
+}
+
+float FitTrack::valueAtTime(FitChannel channel, double unixTimestamp) const {
+    if (m_columns.empty()) return 0.0f;
+
+    const auto& column = m_columns.channel(channel);
+    double t;
+    size_t a = intervalAt(unixTimestamp, t);
+    if (t <= 0.0) return column[a];
+    return column[a] + static_cast<float>(t) * (column[a + 1] - column[a]);
+}
+
+FitTimePoint FitTrack::locate(double unixTimestamp) const {
+    FitTimePoint p;
+    if (!m_columns.empty()) p.index = intervalAt(unixTimestamp, p.t);
+    return p;
+}
+
+FitRangeStats FitTrack::rangeStats(FitChannel channel, double from, double to) const {
+    return m_analytics.stats(channel, locate(from), locate(to));
+}
+
+FitRecord FitTrack::getRecordAtDistance(float distance) const {
+    if (m_columns.empty()) return FitRecord{};
+    return recordAtPoint(m_distanceIndex.locate(distance));
+}
+
+double FitTrack::timeAtDistance(float distance) const {
+    if (m_columns.empty()) return 0.0;
+    return timeAt(m_distanceIndex.locate(distance));
+}
+
+FitRangeStats FitTrack::rangeStatsByDistance(FitChannel channel, float from, float to) const {
+    return m_analytics.stats(channel, m_distanceIndex.locate(from), m_distanceIndex.locate(to));
+}
+
+FitRecord FitTrack::recordAtPoint(const FitTimePoint& p) const {
+    if (p.t <= 0.0) return m_columns.record(p.index);
+    return interpolate(p.index, p.index + 1, p.t);
+}
+
+double FitTrack::timeAt(const FitTimePoint& p) const {
+    const std::vector<double>& time = m_columns.timestamp;
+    if (p.t <= 0.0) return time[p.index];
+    return time[p.index] + p.t * (time[p.index + 1] - time[p.index]);
+}
+
+FitRecord FitTrack::interpolate(size_t a, size_t b, double t) const {
+    const FitColumns& c = m_columns;
+    constexpr int channelCount = FitRecordChannelCount;
+
+    // All record channels blend in one vector operation
+    float lo[channelCount], hi[channelCount], v[channelCount];
+    for (int ch = 0; ch < channelCount; ++ch) {
+        lo[ch] = c.channels[ch][a];
+        hi[ch] = c.channels[ch][b];
+    }
+    SimdUtil::lerp(lo, hi, static_cast<float>(t), v, channelCount);
+    auto value = [&](FitChannel ch) { return v[static_cast<int>(ch)]; };
+
+    FitRecord r;
+    r.timestamp = c.timestamp[a] + t * (c.timestamp[b] - c.timestamp[a]);
+    r.latitude = c.latitude[a] + t * (c.latitude[b] - c.latitude[a]);
+    r.longitude = c.longitude[a] + t * (c.longitude[b] - c.longitude[a]);
+    r.altitude = value(FitChannel::Altitude);
+    r.speed = value(FitChannel::Speed);
+    r.heartRate = value(FitChannel::HeartRate);
+    r.cadence = value(FitChannel::Cadence);
+    r.power = value(FitChannel::Power);
+    r.distance = value(FitChannel::Distance);
+    r.temperature = value(FitChannel::Temperature);
+    r.grade = value(FitChannel::Grade);
+    r.hasGps = c.has(FitFlag::Gps, a) || c.has(FitFlag::Gps, b);
+    r.hasHeartRate = c.has(FitFlag::HeartRate, a) || c.has(FitFlag::HeartRate, b);
+    r.hasCadence = c.has(FitFlag::Cadence, a) || c.has(FitFlag::Cadence, b);
+    r.hasPower = c.has(FitFlag::Power, a) || c.has(FitFlag::Power, b);
+    r.hasGrade = c.has(FitFlag::Grade, a) || c.has(FitFlag::Grade, b);
+    return r;
+}
+
+void FitTrack::setGradeSettings(const FitGradeSettings& settings) {
+    m_gradeSettings = settings;
+    calculateInclination();
+    m_pyramid.build(m_columns, &m_distanceIndex.distances());
+    m_analytics.build(m_columns);
+    m_climbs = detectClimbs(m_columns, m_distanceIndex);
+    bumpGeneration();
+}
+
+void FitTrack::calculateInclination(size_t first, size_t last) {
+    computeGrade(m_columns, m_distanceIndex, m_gradeSettings, first, last);
+}
+
+void FitTrack::setDerivedSettings(const FitDerivedSettings& settings) {
+    m_derivedSettings = settings;
+    calculateDerived();
+    m_pyramid.build(m_columns, &m_distanceIndex.distances());
+    m_analytics.build(m_columns);
+    bumpGeneration();
+}
+
+float FitTrack::resolveZoneMaxHeartRate() const {
+    float maxHr = m_derivedSettings.maxHeartRate;
+    if (maxHr <= 0.0f) maxHr = m_session.maxHeartRate;
+    if (maxHr <= 0.0f) {
+        const std::vector<float>& hr = m_columns.channel(FitChannel::HeartRate);
+        const FitBitmap& valid = m_columns.flag(FitFlag::HeartRate);
+        for (size_t i = 0; i < m_columns.size(); ++i)
+            if (valid.test(i)) maxHr = std::max(maxHr, hr[i]);
+    }
+    return maxHr;
+}
+
+size_t FitTrack::calculateDerived(size_t first) {
+    const float maxHr = resolveZoneMaxHeartRate();
+    // New zone edges move every sample's zone
+    if (maxHr != m_zoneMaxHeartRate) first = 0;
+    m_zoneMaxHeartRate = maxHr;
+
+    FitDerivedSettings settings = m_derivedSettings;
+    settings.maxHeartRate = maxHr;
+    computeDerived(m_columns, settings, first, m_derivedState);
+    return first;
 }
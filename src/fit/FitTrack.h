@@ -1,8 +1,20 @@
 #pragma once
 
 #include <QObject>
+#include <cstdint>
+#include <memory>
 #include <vector>
 #include "FitData.h"
+#include "FitAnalytics.h"
+#include "FitClimbs.h"
+#include "FitColumns.h"
+#include "FitDerived.h"
+#include "FitDistanceIndex.h"
+#include "FitGrade.h"
+#include "FitLapIndex.h"
+#include "FitPeakCurves.h"
+#include "FitPolylineLod.h"
+#include "FitPyramid.h"
 
 class FitTrack : public QObject {
     Q_OBJECT
@@ -10,27 +22,166 @@ public:
     explicit FitTrack(QObject* parent = nullptr);
     ~FitTrack();
 
-    void loadSession(const FitSession& session);
-    void appendSession(const FitSession& session);
+    // Records are moved into the columns; session() keeps only the summary
+    void loadSession(FitSession session);
+
+    // Adds further sessions (e.g. consecutive files of one ride). Inputs are
+    // sorted individually, then merged with the existing samples in one pass;
+    // a sample whose timestamp is already present is dropped. Grades, derived
+    // channels and the indexes are extended from the first sample that moved.
+    // Appending after the current end costs about the size of the new data
+    // plus a linear pass for the climbs and the peak curves' 1 s grid of the
+    // last stretch; merging samples in earlier rebuilds the peak curves.
+    void appendSession(FitSession session);
+    void appendSessions(std::vector<FitSession> sessions);
+
+    // Incremental loading (FitParser::parseStreaming): appendRecords() per
+    // decoded batch, then finishRecords() with the summary to sort and grade.
+    void appendRecords(const FitRecord* records, size_t count);
+    void finishRecords(FitSession summary);
+    // Finished copy of the records appended so far, with a summary that only
+    // has the time span and distance, so views can draw a file still loading
+    std::unique_ptr<FitTrack> snapshot() const;
+
+    // Changes how computed grades are smoothed and recomputes them. Records
+    // with a grade from the device keep it.
+    void setGradeSettings(const FitGradeSettings& settings);
+    const FitGradeSettings& gradeSettings() const { return m_gradeSettings; }
+
+    // Changes the parameters of the derived channels (W' balance, heart rate
+    // zones) and recomputes them
+    void setDerivedSettings(const FitDerivedSettings& settings);
+    const FitDerivedSettings& derivedSettings() const { return m_derivedSettings; }
+    // Maximum heart rate the zones use: the setting, else the session's or
+    // the highest recorded
+    float zoneMaxHeartRate() const { return m_zoneMaxHeartRate; }
+
+    // Adopts data that is already sorted and graded (see FitTrackCache); the
+    // peak curves are computed unless given
+    void restore(FitColumns columns, std::vector<FitLap> laps, const FitSession& session,
+                 FitPeakCurves peaks = FitPeakCurves());
     void clear();
 
+    // Lookups during playback and export, where time mostly moves forward.
+    // Steps from the previous position in amortized O(1) and falls back to
+    // the time index after a seek. Not thread-safe; use one cursor per reader.
+    class Cursor {
+    public:
+        explicit Cursor(const FitTrack* track = nullptr) : m_track(track) {}
+
+        void reset(const FitTrack* track = nullptr) { m_track = track; m_index = 0; m_distanceHint = 0; }
+        const FitTrack* track() const { return m_track; }
+
+        FitRecord recordAt(double unixTimestamp);
+        float valueAt(FitChannel channel, double unixTimestamp);
+        // As FitTrack::getRecordAtDistance, stepping forward from the
+        // previous distance lookup
+        FitRecord recordAtDistance(float distance);
+
+    private:
+        static constexpr int MaxForwardSteps = 16;
+        size_t seek(double unixTimestamp, double& t);
+
+        const FitTrack* m_track;
+        size_t m_index = 0;
+        size_t m_distanceHint = 0;
+    };
+
     FitRecord getRecordAtTime(double unixTimestamp) const;
-    int findLapAtTime(double unixTimestamp) const;
+    // Evaluates count frames at startTime + i * step in one forward pass over
+    // the samples; row i equals getRecordAtTime() at that time.
+    FitSampleTable sampleRange(double startTime, double step, size_t count) const;
+    // Interpolated value of a single channel; reads only that column
+    float valueAtTime(FitChannel channel, double unixTimestamp) const;
+    int findLapAtTime(double unixTimestamp, int hint = -1) const { return m_lapIndex.find(unixTimestamp, hint); }
+
+    // Lookups along the monotonic distance axis (see FitDistanceIndex): the
+    // record where the track first reaches a distance, so a stop maps to
+    // its arrival. Distances are clamped to the track.
+    FitRecord getRecordAtDistance(float distance) const;
+    double timeAtDistance(float distance) const;
+    FitTimePoint locateDistance(float distance) const { return m_distanceIndex.locate(distance); }
+    // Statistics between two distances, e.g. over a climb or a course segment
+    FitRangeStats rangeStatsByDistance(FitChannel channel, float from, float to) const;
 
     double startTime() const;
     double endTime() const;
     double duration() const;
-    bool isEmpty() const { return m_records.empty(); }
+    bool isEmpty() const { return m_columns.empty(); }
+
+    size_t recordCount() const { return m_columns.size(); }
+    FitRecord recordAt(size_t index) const { return m_columns.record(index); }
+    const FitColumns& columns() const { return m_columns; }
+    const std::vector<float>& channel(FitChannel c) const { return m_columns.channel(c); }
+    const std::vector<double>& timestamps() const { return m_columns.timestamp; }
+
+    // Uniform time grid mapping each cell to its first sample, so random
+    // lookups are an array access plus a short scan instead of a binary
+    // search. Built whenever the records change; on by default.
+    void setTimeIndexEnabled(bool enabled);
+    bool hasTimeIndex() const { return !m_timeGrid.empty(); }
 
-    const std::vector<FitRecord>& records() const { return m_records; }
     const std::vector<FitLap>& laps() const { return m_laps; }
+    const FitLapIndex& lapIndex() const { return m_lapIndex; }
+    const FitDistanceIndex& distanceIndex() const { return m_distanceIndex; }
+    // Min/max per channel over any record span or axis range, for profiles
+    // and sparklines; rebuilt with the records
+    const FitPyramid& pyramid() const { return m_pyramid; }
+    // Sums, averages and min/max over any time range in O(1), for running
+    // stats (FitBandIndex adds time in zone); rebuilt with the records
+    const FitAnalytics& analytics() const { return m_analytics; }
+    FitTimePoint locate(double unixTimestamp) const;
+    FitRangeStats rangeStats(FitChannel channel, double from, double to) const;
+    // Climbs found on the smoothed elevation, in track order; rebuilt with
+    // the records and the grade settings
+    const std::vector<FitClimb>& climbs() const { return m_climbs; }
+    // Best efforts over every window length (power, heart rate, speed)
+    const FitPeakCurves& peaks() const { return m_peaks; }
+    // GPS path simplified per zoom level, for maps
+    const FitPolylineLod& polyline() const { return m_polyline; }
+    // Session summary (stats, bounds, laps). Its records vector is always
+    // empty: the samples live in columns().
     const FitSession& session() const { return m_session; }
+    // Changes whenever the records or the settings they are derived with
+    // do; unique across tracks, so views can key caches on it
+    uint64_t generation() const { return m_generation; }
 
 private:
-    void calculateInclination();
-    FitRecord interpolate(const FitRecord& a, const FitRecord& b, double t) const;
+    void calculateInclination(size_t first = 0, size_t last = SIZE_MAX);
+    // Returns the first sample it recomputed
+    size_t calculateDerived(size_t first = 0);
+    float resolveZoneMaxHeartRate() const;
+    size_t mergeRecords(const std::vector<FitSession>& sessions);
+    void mergeSummary(const FitSession& session);
+    // Samples before first are unchanged since the last build
+    void buildTimeIndex(size_t first = 0);
+    void bumpGeneration();
+    size_t indexBefore(double unixTimestamp) const;
+    size_t intervalAt(double unixTimestamp, double& t) const;
+    size_t fractionAt(size_t a, double unixTimestamp, double& t) const;
+    FitRecord interpolate(size_t a, size_t b, double t) const;
+    FitRecord recordAtPoint(const FitTimePoint& p) const;
+    double timeAt(const FitTimePoint& p) const;
 
-    std::vector<FitRecord> m_records;
+    FitColumns m_columns;
     std::vector<FitLap> m_laps;
+    FitLapIndex m_lapIndex;
+    FitDistanceIndex m_distanceIndex;
+    FitPyramid m_pyramid;
+    FitAnalytics m_analytics;
+    FitPeakCurves m_peaks;
+    std::vector<FitClimb> m_climbs;
+    FitPolylineLod m_polyline;
+    FitGradeSettings m_gradeSettings;
+    FitDerivedSettings m_derivedSettings;
+    FitDerivedState m_derivedState;
+    float m_zoneMaxHeartRate = 0.0f;
     FitSession m_session;
+    uint64_t m_generation = 0;
+
+    static constexpr int MaxGridSteps = 8;
+
+    bool m_timeIndexEnabled = true;
+    std::vector<uint32_t> m_timeGrid; // cell -> last sample before the cell start
+    double m_gridStep = 0.0;
 };
@@ -0,0 +1,427 @@
+#include "FitTrackCache.h"
+#include "FitTrack.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <cstring>
+
+namespace {
+
+constexpr char kMagic[4] = {'F', 'V', 'T', 'K'};
+constexpr uint32_t kVersion = 4;
+constexpr uint32_t kByteOrderMark = 0x01020304;
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t pathBytes;
+    uint64_t sourceSize;
+    int64_t sourceMtimeMs;
+    uint64_t recordCount;
+    uint32_t lapCount;
+    uint32_t sportBytes;
+};
+
+// FitSession without its record/lap vectors and sport string
+struct SessionBlock {
+    double startTime;
+    double endTime;
+    double minLat, maxLat, minLon, maxLon;
+    float totalDistance;
+    float totalElapsedTime;
+    float avgSpeed;
+    float maxSpeed;
+    float avgHeartRate;
+    float maxHeartRate;
+    float avgCadence;
+    float avgPower;
+    float totalAscent;
+    float totalDescent;
+};
+
+// FitLap and FitPeak with their tail padding spelled out as a field, so the
+// value-initialized blocks leave no uninitialized bytes in the entry
+struct LapBlock {
+    double startTime;
+    double endTime;
+    float totalDistance;
+    float totalElapsedTime;
+    float avgSpeed;
+    float avgHeartRate;
+    float avgCadence;
+    float avgPower;
+    int32_t lapIndex;
+    uint32_t reserved;
+};
+
+struct PeakBlock {
+    double duration;
+    double startTime;
+    float value;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(LapBlock) == 48 && sizeof(PeakBlock) == 24, "blocks have no implicit padding");
+
+std::vector<LapBlock> lapBlocks(const std::vector<FitLap>& laps) {
+    std::vector<LapBlock> blocks(laps.size());
+    for (size_t i = 0; i < laps.size(); ++i) {
+        const FitLap& lap = laps[i];
+        LapBlock& b = blocks[i];
+        b.startTime = lap.startTime;
+        b.endTime = lap.endTime;
+        b.totalDistance = lap.totalDistance;
+        b.totalElapsedTime = lap.totalElapsedTime;
+        b.avgSpeed = lap.avgSpeed;
+        b.avgHeartRate = lap.avgHeartRate;
+        b.avgCadence = lap.avgCadence;
+        b.avgPower = lap.avgPower;
+        b.lapIndex = lap.lapIndex;
+    }
+    return blocks;
+}
+
+std::vector<FitLap> lapsFrom(const std::vector<LapBlock>& blocks) {
+    std::vector<FitLap> laps(blocks.size());
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        const LapBlock& b = blocks[i];
+        FitLap& lap = laps[i];
+        lap.startTime = b.startTime;
+        lap.endTime = b.endTime;
+        lap.totalDistance = b.totalDistance;
+        lap.totalElapsedTime = b.totalElapsedTime;
+        lap.avgSpeed = b.avgSpeed;
+        lap.avgHeartRate = b.avgHeartRate;
+        lap.avgCadence = b.avgCadence;
+        lap.avgPower = b.avgPower;
+        lap.lapIndex = b.lapIndex;
+    }
+    return laps;
+}
+
+std::vector<PeakBlock> peakBlocks(const std::vector<FitPeak>& curve) {
+    std::vector<PeakBlock> blocks(curve.size());
+    for (size_t i = 0; i < curve.size(); ++i) {
+        blocks[i].duration = curve[i].duration;
+        blocks[i].startTime = curve[i].startTime;
+        blocks[i].value = curve[i].value;
+    }
+    return blocks;
+}
+
+std::vector<FitPeak> peaksFrom(const std::vector<PeakBlock>& blocks) {
+    std::vector<FitPeak> curve(blocks.size());
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        curve[i].duration = blocks[i].duration;
+        curve[i].startTime = blocks[i].startTime;
+        curve[i].value = blocks[i].value;
+    }
+    return curve;
+}
+
+struct SourceKey {
+    QByteArray path;
+    qint64 size = 0;
+    qint64 mtimeMs = 0;
+};
+
+bool sourceKey(const QString& fitPath, SourceKey& key) {
+    QFileInfo info(fitPath);
+    if (!info.exists()) return false;
+    key.path = info.absoluteFilePath().toUtf8();
+    key.size = info.size();
+    key.mtimeMs = info.lastModified().toMSecsSinceEpoch();
+    return true;
+}
+
+void appendRaw(QByteArray& out, const void* data, size_t bytes) {
+    out.append(static_cast<const char*>(data), static_cast<qsizetype>(bytes));
+}
+
+void pad8(QByteArray& out) {
+    while (out.size() % 8) out.append('\0');
+}
+
+template <typename T>
+void appendColumn(QByteArray& out, const std::vector<T>& column) {
+    appendRaw(out, column.data(), column.size() * sizeof(T));
+    pad8(out);
+}
+
+// Bounds-checked cursor over the mapped file
+class Reader {
+public:
+    Reader(const uchar* data, size_t size) : m_data(data), m_size(size) {}
+
+    bool ok() const { return m_ok; }
+
+    const uchar* take(size_t bytes) {
+        if (!m_ok || bytes > m_size - m_pos) {
+            m_ok = false;
+            return nullptr;
+        }
+        const uchar* p = m_data + m_pos;
+        m_pos += bytes;
+        return p;
+    }
+
+    void align8() {
+        size_t aligned = (m_pos + 7) & ~size_t(7);
+        if (aligned > m_size) m_ok = false;
+        else m_pos = aligned;
+    }
+
+    template <typename T>
+    bool read(T& out) {
+        const uchar* p = take(sizeof(T));
+        if (p) std::memcpy(&out, p, sizeof(T));
+        return p != nullptr;
+    }
+
+    template <typename T>
+    bool readColumn(std::vector<T>& column, size_t count) {
+        if (count > (m_size - m_pos) / sizeof(T)) {
+            m_ok = false;
+            return false;
+        }
+        const uchar* p = take(count * sizeof(T));
+        column.resize(count);
+        if (count) std::memcpy(column.data(), p, count * sizeof(T));
+        align8();
+        return m_ok;
+    }
+
+private:
+    const uchar* m_data;
+    size_t m_size;
+    size_t m_pos = 0;
+    bool m_ok = true;
+};
+
+} // anonymous namespace
+
+QString FitTrackCache::sidecarPath(const QString& fitPath) {
+    return fitPath + ".fvtrack";
+}
+
+QString FitTrackCache::fallbackPath(const QString& fitPath) {
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/fvtrack";
+    QByteArray key = QFileInfo(fitPath).absoluteFilePath().toUtf8();
+    return dir + "/" + QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex() + ".fvtrack";
+}
+
+bool FitTrackCache::load(const QString& fitPath, FitTrack& track) {
+    m_error.clear();
+    for (const QString& path : {sidecarPath(fitPath), fallbackPath(fitPath)}) {
+        if (QFile::exists(path) && loadFrom(path, fitPath, track))
+            return true;
+    }
+    if (m_error.isEmpty()) m_error = "No cache entry";
+    return false;
+}
+
+bool FitTrackCache::loadFrom(const QString& cachePath, const QString& fitPath, FitTrack& track) {
+    SourceKey key;
+    if (!sourceKey(fitPath, key)) {
+        m_error = QString("FIT file not found: %1").arg(fitPath);
+        return false;
+    }
+
+    QFile file(cachePath);
+    if (!file.open(QIODevice::ReadOnly) || file.size() < static_cast<qint64>(sizeof(FileHeader))) {
+        m_error = QString("Cannot read cache: %1").arg(cachePath);
+        return false;
+    }
+    uchar* data = file.map(0, file.size());
+    if (!data) {
+        m_error = QString("Cannot map cache: %1").arg(cachePath);
+        return false;
+    }
+
+    Reader in(data, static_cast<size_t>(file.size()));
+    FileHeader header;
+    in.read(header);
+
+    bool fresh = std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+                 header.version == kVersion &&
+                 header.byteOrder == kByteOrderMark &&
+                 header.sourceSize == static_cast<uint64_t>(key.size) &&
+                 header.sourceMtimeMs == key.mtimeMs &&
+                 header.pathBytes == static_cast<uint32_t>(key.path.size());
+    const uchar* path = fresh ? in.take(header.pathBytes) : nullptr;
+    if (!path || std::memcmp(path, key.path.constData(), header.pathBytes) != 0) {
+        file.unmap(data);
+        m_error = "Cache entry is stale";
+        return false;
+    }
+
+    FitSession session;
+    const uchar* sport = in.take(header.sportBytes);
+    if (sport) session.sport = QString::fromUtf8(reinterpret_cast<const char*>(sport), header.sportBytes);
+    in.align8();
+
+    SessionBlock block;
+    if (in.read(block)) {
+        session.startTime = block.startTime;
+        session.endTime = block.endTime;
+        session.minLat = block.minLat;
+        session.maxLat = block.maxLat;
+        session.minLon = block.minLon;
+        session.maxLon = block.maxLon;
+        session.totalDistance = block.totalDistance;
+        session.totalElapsedTime = block.totalElapsedTime;
+        session.avgSpeed = block.avgSpeed;
+        session.maxSpeed = block.maxSpeed;
+        session.avgHeartRate = block.avgHeartRate;
+        session.maxHeartRate = block.maxHeartRate;
+        session.avgCadence = block.avgCadence;
+        session.avgPower = block.avgPower;
+        session.totalAscent = block.totalAscent;
+        session.totalDescent = block.totalDescent;
+    }
+
+    const size_t n = static_cast<size_t>(header.recordCount);
+    FitColumns columns;
+    in.readColumn(columns.timestamp, n);
+    in.readColumn(columns.latitude, n);
+    in.readColumn(columns.longitude, n);
+    for (auto& channel : columns.channels)
+        in.readColumn(channel, n);
+
+    std::vector<uint64_t> words;
+    for (auto& flag : columns.flags) {
+        if (!in.readColumn(words, (n + 63) / 64)) break;
+        flag.assign(words.data(), n);
+    }
+
+    std::vector<LapBlock> laps;
+    in.readColumn(laps, header.lapCount);
+
+    // Peak curves: a point count, then the points, per curve channel
+    FitPeakCurves peaks;
+    for (FitChannel channel : FitPeakCurves::Channels) {
+        uint64_t count = 0;
+        std::vector<PeakBlock> curve;
+        if (!in.read(count) || !in.readColumn(curve, static_cast<size_t>(count))) break;
+        peaks.setCurve(channel, peaksFrom(curve));
+    }
+
+    file.unmap(data);
+    if (!in.ok()) {
+        m_error = QString("Truncated cache: %1").arg(cachePath);
+        return false;
+    }
+
+    track.restore(std::move(columns), lapsFrom(laps), session, std::move(peaks));
+    return true;
+}
+
+QByteArray FitTrackCache::serialize(const QString& fitPath, const FitTrack& track) {
+    SourceKey key;
+    if (!sourceKey(fitPath, key)) return QByteArray();
+
+    const FitColumns& columns = track.columns();
+    const FitSession& session = track.session();
+    const QByteArray sport = session.sport.toUtf8();
+
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byteOrder = kByteOrderMark;
+    header.pathBytes = static_cast<uint32_t>(key.path.size());
+    header.sourceSize = static_cast<uint64_t>(key.size);
+    header.sourceMtimeMs = key.mtimeMs;
+    header.recordCount = columns.size();
+    header.lapCount = static_cast<uint32_t>(track.laps().size());
+    header.sportBytes = static_cast<uint32_t>(sport.size());
+
+    SessionBlock block;
+    std::memset(&block, 0, sizeof(block));
+    block.startTime = session.startTime;
+    block.endTime = session.endTime;
+    block.minLat = session.minLat;
+    block.maxLat = session.maxLat;
+    block.minLon = session.minLon;
+    block.maxLon = session.maxLon;
+    block.totalDistance = session.totalDistance;
+    block.totalElapsedTime = session.totalElapsedTime;
+    block.avgSpeed = session.avgSpeed;
+    block.maxSpeed = session.maxSpeed;
+    block.avgHeartRate = session.avgHeartRate;
+    block.maxHeartRate = session.maxHeartRate;
+    block.avgCadence = session.avgCadence;
+    block.avgPower = session.avgPower;
+    block.totalAscent = session.totalAscent;
+    block.totalDescent = session.totalDescent;
+
+    const size_t n = columns.size();
+    QByteArray out;
+    const size_t rowBytes = 3 * sizeof(double) + static_cast<int>(FitChannel::Count) * sizeof(float);
+    out.reserve(static_cast<qsizetype>(sizeof(header) + sizeof(block) + key.path.size() + sport.size() +
+                n * rowBytes + n + track.laps().size() * sizeof(LapBlock) + 256));
+
+    appendRaw(out, &header, sizeof(header));
+    out.append(key.path);
+    out.append(sport);
+    pad8(out);
+    appendRaw(out, &block, sizeof(block));
+    appendColumn(out, columns.timestamp);
+    appendColumn(out, columns.latitude);
+    appendColumn(out, columns.longitude);
+    for (const auto& channel : columns.channels)
+        appendColumn(out, channel);
+    for (const auto& flag : columns.flags)
+        appendColumn(out, flag.words());
+    appendColumn(out, lapBlocks(track.laps()));
+    for (FitChannel channel : FitPeakCurves::Channels) {
+        const std::vector<FitPeak>& curve = track.peaks().curve(channel);
+        const uint64_t count = curve.size();
+        appendRaw(out, &count, sizeof(count));
+        appendColumn(out, peakBlocks(curve));
+    }
+    return out;
+}
+
+bool FitTrackCache::writeEntry(const QString& fitPath, const QByteArray& bytes, QString* error) {
+    if (bytes.isEmpty()) {
+        if (error) *error = QString("FIT file not found: %1").arg(fitPath);
+        return false;
+    }
+
+    auto writeTo = [&bytes](const QString& path) {
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly)) return false;
+        file.write(bytes);
+        return file.commit();
+    };
+
+    if (writeTo(sidecarPath(fitPath))) return true;
+
+    // Read-only media folder: keep the entry in the user cache instead
+    QString fallback = fallbackPath(fitPath);
+    QDir().mkpath(QFileInfo(fallback).absolutePath());
+    if (writeTo(fallback)) return true;
+
+    if (error) *error = QString("Cannot write cache for %1").arg(fitPath);
+    return false;
+}
+
+bool FitTrackCache::store(const QString& fitPath, const FitTrack& track) {
+    m_error.clear();
+    return writeEntry(fitPath, serialize(fitPath, track), &m_error);
+}
+
+void FitTrackCache::storeInBackground(const QString& fitPath, const FitTrack& track) {
+    QByteArray bytes = serialize(fitPath, track);
+    if (bytes.isEmpty()) return;
+    QThreadPool::globalInstance()->start([fitPath, bytes]() {
+        writeEntry(fitPath, bytes, nullptr);
+    });
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+class FitTrack;
+
+// Versioned binary sidecar (.fvtrack) holding a fully prepared FitTrack:
+// sorted columns including the computed grade and derived channels, the lap
+// table, the peak curves and the session summary with GPS bounds. Entries
+// are keyed by the FIT file's path, size and mtime, and are loaded by
+// memory-mapping the file and copying the columns out directly, without any
+// FIT decoding or grade recomputation.
+//
+// The sidecar lives next to the FIT file ("ride.fit.fvtrack"); if that
+// directory is not writable the entry goes to the user cache directory.
+class FitTrackCache {
+public:
+    // Fills track from a valid entry. Returns false on a miss or stale entry.
+    bool load(const QString& fitPath, FitTrack& track);
+    bool store(const QString& fitPath, const FitTrack& track);
+
+    // Serializes track on the calling thread and writes the entry from the
+    // global thread pool, so a cache miss never blocks on disk I/O.
+    static void storeInBackground(const QString& fitPath, const FitTrack& track);
+
+    static QString sidecarPath(const QString& fitPath);
+    static QString fallbackPath(const QString& fitPath);
+
+    QString errorString() const { return m_error; }
+
+private:
+    static QByteArray serialize(const QString& fitPath, const FitTrack& track);
+    static bool writeEntry(const QString& fitPath, const QByteArray& bytes, QString* error);
+    bool loadFrom(const QString& cachePath, const QString& fitPath, FitTrack& track);
+
+    QString m_error;
+};
@@ -0,0 +1,84 @@
+#include "FitTrackLoader.h"
+#include "FitSessionRegistry.h"
+#include <QMutexLocker>
+
+FitTrackLoader::FitTrackLoader(QObject* parent) : QObject(parent) {}
+
+FitTrackLoader::~FitTrackLoader() {
+    cancel();
+    m_pool.waitForDone();
+}
+
+void FitTrackLoader::load(const QStringList& paths) {
+    cancel();
+    enqueue(paths);
+}
+
+void FitTrackLoader::enqueue(const QStringList& paths) {
+    auto batch = std::make_shared<Batch>();
+    {
+        QMutexLocker lock(&m_mutex);
+        batch->generation = m_generation;
+    }
+    batch->total = static_cast<int>(paths.size());
+    if (batch->total == 0) {
+        emit finished();
+        return;
+    }
+
+    emit progress(0, batch->total);
+    for (const QString& path : paths) {
+        m_pool.start([this, path, batch]() { loadOne(path, batch); });
+    }
+}
+
+void FitTrackLoader::cancel() {
+    // Tasks that already started finish, but their results are dropped
+    m_pool.clear();
+    QMutexLocker lock(&m_mutex);
+    ++m_generation;
+    m_ready.clear();
+}
+
+bool FitTrackLoader::waitForDone(int msecs) {
+    return m_pool.waitForDone(msecs);
+}
+
+std::shared_ptr<const FitTrack> FitTrackLoader::takeTrack(const QString& path) {
+    QMutexLocker lock(&m_mutex);
+    auto it = m_ready.find(path);
+    if (it == m_ready.end()) return nullptr;
+    std::shared_ptr<const FitTrack> track = std::move(it->second);
+    m_ready.erase(it);
+    return track;
+}
+
+void FitTrackLoader::loadOne(const QString& path, const std::shared_ptr<Batch>& batch) {
+    auto partial = [this, &path, &batch](std::shared_ptr<const FitTrack> snapshot) {
+        {
+            QMutexLocker lock(&m_mutex);
+            if (batch->generation != m_generation) return;
+            m_ready[path] = std::move(snapshot);
+        }
+        emit trackPartiallyLoaded(path);
+    };
+
+    QString error;
+    std::shared_ptr<const FitTrack> track = FitSessionRegistry::instance().acquire(path, &error, partial);
+    const bool loaded = track != nullptr;
+
+    {
+        QMutexLocker lock(&m_mutex);
+        if (batch->generation != m_generation) return;
+        // A failed load drops any snapshot still parked
+        if (track) m_ready[path] = std::move(track);
+        else m_ready.erase(path);
+    }
+
+    if (loaded) emit trackLoaded(path);
+    else emit loadFailed(path, error);
+
+    int done = ++batch->done;
+    emit progress(done, batch->total);
+    if (done == batch->total) emit finished();
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QObject>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <atomic>
+#include <map>
+#include <memory>
+#include "FitTrack.h"
+
+// Loads FitTracks for many FIT files in parallel on a private thread pool,
+// through FitSessionRegistry so files already in use are not decoded again.
+// Each finished track is parked until the owner collects it with takeTrack()
+// in response to trackLoaded(), which is delivered on the loader's thread.
+// While a large file decodes, snapshots of it are parked the same way and
+// announced with trackPartiallyLoaded(), so views can draw it early.
+class FitTrackLoader : public QObject {
+    Q_OBJECT
+public:
+    explicit FitTrackLoader(QObject* parent = nullptr);
+    ~FitTrackLoader();
+
+    // Cancels any load in progress and queues the given files
+    void load(const QStringList& paths);
+    // Queues more files next to any load in progress
+    void enqueue(const QStringList& paths);
+    void cancel();
+    bool waitForDone(int msecs = -1);
+
+    std::shared_ptr<const FitTrack> takeTrack(const QString& path);
+
+    void setMaxThreadCount(int count) { m_pool.setMaxThreadCount(count); }
+    int maxThreadCount() const { return m_pool.maxThreadCount(); }
+
+signals:
+    void trackLoaded(const QString& path);
+    void trackPartiallyLoaded(const QString& path);
+    void loadFailed(const QString& path, const QString& message);
+    void progress(int done, int total);
+    void finished();
+
+private:
+    // Progress of one load()/enqueue() call, shared by its tasks
+    struct Batch {
+        int generation = 0;
+        int total = 0;
+        std::atomic<int> done{0};
+    };
+
+    void loadOne(const QString& path, const std::shared_ptr<Batch>& batch);
+
+    QThreadPool m_pool;
+    QMutex m_mutex;
+    std::map<QString, std::shared_ptr<const FitTrack>> m_ready;
+    int m_generation = 0; // guarded by m_mutex
+};
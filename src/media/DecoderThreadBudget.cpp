@@ -0,0 +1,46 @@
+#include "DecoderThreadBudget.h"
+#include <QMutexLocker>
+#include <QThread>
+#include <algorithm>
+
+DecoderThreadBudget& DecoderThreadBudget::instance() {
+    static DecoderThreadBudget budget;
+    return budget;
+}
+
+DecoderThreadBudget::DecoderThreadBudget()
+    : m_total(std::max(1, QThread::idealThreadCount())) {}
+
+int DecoderThreadBudget::total() const {
+    QMutexLocker lock(&m_mutex);
+    return m_total;
+}
+
+void DecoderThreadBudget::setTotal(int threads) {
+    QMutexLocker lock(&m_mutex);
+    m_total = std::max(1, threads);
+}
+
+int DecoderThreadBudget::acquire(DecodePriority priority) {
+    QMutexLocker lock(&m_mutex);
+    int threads;
+    if (priority == DecodePriority::Playback) {
+        threads = std::clamp(m_total - 1 - m_playback, 1, MaxThreads);
+        m_playback += threads;
+    } else {
+        threads = std::clamp(m_total - m_playback - m_background, 1, BackgroundThreads);
+        m_background += threads;
+    }
+    return threads;
+}
+
+void DecoderThreadBudget::release(DecodePriority priority, int threads) {
+    QMutexLocker lock(&m_mutex);
+    int& held = priority == DecodePriority::Playback ? m_playback : m_background;
+    held = std::max(0, held - threads);
+}
+
+int DecoderThreadBudget::inUse(DecodePriority priority) const {
+    QMutexLocker lock(&m_mutex);
+    return priority == DecodePriority::Playback ? m_playback : m_background;
+}
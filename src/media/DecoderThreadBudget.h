@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QMutex>
+
+enum class DecodePriority {
+    Playback,   // the decoder feeding the preview
+    Background  // thumbnails, hover scrub, probing
+};
+
+// Codec threads shared by every VideoDecoder in the process. A decoder
+// takes its threads when it opens and returns them when it closes; the
+// count is fixed while it is open (FFmpeg cannot change it on an open
+// codec).
+//
+// Playback comes first: it gets the whole budget less one core for the UI
+// and whatever other playback decoders hold, regardless of background
+// decoders. Background decoders get what is left, at least one thread and
+// at most BackgroundThreads each, so thumbnails never starve playback.
+class DecoderThreadBudget {
+public:
+    static constexpr int MaxThreads = 16;        // per decoder; FFmpeg's limit for frame threads
+    static constexpr int BackgroundThreads = 2;
+
+    static DecoderThreadBudget& instance();
+
+    // Threads shared out; QThread::idealThreadCount() unless set
+    int total() const;
+    void setTotal(int threads);
+
+    // Threads granted to a new decoder, at least 1; hand them back with
+    // release()
+    int acquire(DecodePriority priority);
+    void release(DecodePriority priority, int threads);
+
+    int inUse(DecodePriority priority) const;
+
+private:
+    DecoderThreadBudget();
+
+    mutable QMutex m_mutex;
+    int m_total = 1;
+    int m_playback = 0;     // threads held by playback decoders
+    int m_background = 0;   // threads held by background decoders
+};
@@ -0,0 +1,662 @@
+#include "FrameCompositor.h"
+#include "timeline/ClipTransform.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define COMPOSITOR_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define COMPOSITOR_TARGET(isa)
+#else
+#define COMPOSITOR_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace FrameCompositor {
+namespace {
+
+constexpr uint32_t Black = 0xff000000u;
+
+// Conversion factors with 6 fractional bits, small enough that every
+// product fits a 16-bit lane; sums only saturate where the result clamps
+// to 255 anyway, so all paths give identical pixels
+struct Coefficients {
+    int16_t yOffset, y, rv, gu, gv, bu;
+};
+
+const Coefficients& coefficients(YuvFrame::Matrix matrix, bool fullRange) {
+    static const Coefficients table[4] = {
+        {16, 75, 102, 25, 52, 129},     // BT.601, 16-235
+        {16, 75, 115, 14, 34, 135},     // BT.709, 16-235
+        {0, 64, 90, 22, 46, 113},       // BT.601, full range
+        {0, 64, 101, 12, 30, 119},      // BT.709, full range
+    };
+    return table[(fullRange ? 2 : 0) + (matrix == YuvFrame::Matrix::BT709 ? 1 : 0)];
+}
+
+inline uint32_t clampByte(int v) { return static_cast<uint32_t>(std::clamp(v, 0, 255)); }
+
+// Pixel i takes chroma sample (i >> chromaShift) * chromaStep; by default
+// full-resolution planes
+void convertScalar(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint32_t* out, int count,
+                   const Coefficients& k, int chromaStep = 1, int chromaShift = 0) {
+    for (int i = 0; i < count; ++i) {
+        const ptrdiff_t c = static_cast<ptrdiff_t>(i >> chromaShift) * chromaStep;
+        const int yy = (y[i] - k.yOffset) * k.y + 32;
+        const int cu = u[c] - 128;
+        const int cv = v[c] - 128;
+        out[i] = Black | clampByte((yy + k.rv * cv) >> 6) << 16
+                       | clampByte((yy - k.gu * cu - k.gv * cv) >> 6) << 8
+                       | clampByte((yy + k.bu * cu) >> 6);
+    }
+}
+
+// Luma of n canvas columns stepping `step` samples along a source row at
+// one weight w (in 1/256) between neighbours: 8-bit rows, or 16-bit rows
+// already mixed vertically (x 256)
+template <typename Sample>
+void resampleScalar(const Sample* src, int step, int w, uint8_t* out, int n) {
+    constexpr int shift = 8 * sizeof(Sample);
+    const int next = w ? 1 : 0;
+    for (int i = 0; i < n; ++i) {
+        const Sample* p = src + static_cast<ptrdiff_t>(i) * step;
+        out[i] = static_cast<uint8_t>((p[0] * (256 - w) + p[next] * w + (1 << (shift - 1))) >> shift);
+    }
+}
+
+#if defined(COMPOSITOR_X86)
+// Y, U and V as 16-bit lanes to packed 0xAARRGGBB (bytes B, G, R, A on
+// little-endian)
+COMPOSITOR_TARGET("sse4.1")
+inline void storeSse41(__m128i yv, __m128i uv, __m128i vv, uint32_t* out, const Coefficients& k) {
+    const __m128i bias = _mm_set1_epi16(128);
+    uv = _mm_sub_epi16(uv, bias);
+    vv = _mm_sub_epi16(vv, bias);
+    const __m128i yy = _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(yv, _mm_set1_epi16(k.yOffset)), _mm_set1_epi16(k.y)),
+                                     _mm_set1_epi16(32));
+    const __m128i r = _mm_srai_epi16(_mm_adds_epi16(yy, _mm_mullo_epi16(vv, _mm_set1_epi16(k.rv))), 6);
+    const __m128i g = _mm_srai_epi16(_mm_subs_epi16(_mm_subs_epi16(yy, _mm_mullo_epi16(uv, _mm_set1_epi16(k.gu))),
+                                                    _mm_mullo_epi16(vv, _mm_set1_epi16(k.gv))), 6);
+    const __m128i b = _mm_srai_epi16(_mm_adds_epi16(yy, _mm_mullo_epi16(uv, _mm_set1_epi16(k.bu))), 6);
+
+    const __m128i bg = _mm_unpacklo_epi8(_mm_packus_epi16(b, b), _mm_packus_epi16(g, g));
+    const __m128i ra = _mm_unpacklo_epi8(_mm_packus_epi16(r, r), _mm_set1_epi8(-1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi16(bg, ra));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4), _mm_unpackhi_epi16(bg, ra));
+}
+
+COMPOSITOR_TARGET("sse4.1")
+void convertSse41(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint32_t* out, int count,
+                  const Coefficients& k) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        storeSse41(_mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + i))),
+                   _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(u + i))),
+                   _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(v + i))), out + i, k);
+    }
+    convertScalar(y + i, u + i, v + i, out + i, count - i, k);
+}
+
+// Half-resolution chroma, each sample doubled: planar (step 1) or NV12's
+// interleaved pairs (step 2, v = u + 1)
+COMPOSITOR_TARGET("sse4.1")
+void convert420Sse41(const uint8_t* y, const uint8_t* u, const uint8_t* v, int chromaStep, uint32_t* out,
+                     int count, const Coefficients& k) {
+    const __m128i evens = _mm_setr_epi8(0, 0, 2, 2, 4, 4, 6, 6, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i odds = _mm_setr_epi8(1, 1, 3, 3, 5, 5, 7, 7, -1, -1, -1, -1, -1, -1, -1, -1);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i yv = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + i)));
+        __m128i uv, vv;
+        if (chromaStep == 2) {
+            const __m128i pairs = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(u + i));
+            uv = _mm_cvtepu8_epi16(_mm_shuffle_epi8(pairs, evens));
+            vv = _mm_cvtepu8_epi16(_mm_shuffle_epi8(pairs, odds));
+        } else {
+            int32_t u4, v4;
+            std::memcpy(&u4, u + i / 2, 4);
+            std::memcpy(&v4, v + i / 2, 4);
+            const __m128i us = _mm_cvtsi32_si128(u4);
+            const __m128i vs = _mm_cvtsi32_si128(v4);
+            uv = _mm_cvtepu8_epi16(_mm_unpacklo_epi8(us, us));
+            vv = _mm_cvtepu8_epi16(_mm_unpacklo_epi8(vs, vs));
+        }
+        storeSse41(yv, uv, vv, out + i, k);
+    }
+    const ptrdiff_t c = static_cast<ptrdiff_t>(i / 2) * chromaStep;
+    convertScalar(y + i, u + c, v + c, out + i, count - i, k, chromaStep, 1);
+}
+
+COMPOSITOR_TARGET("avx2")
+inline void storeAvx2(__m256i yv, __m256i uv, __m256i vv, uint32_t* out, const Coefficients& k) {
+    const __m256i bias = _mm256_set1_epi16(128);
+    uv = _mm256_sub_epi16(uv, bias);
+    vv = _mm256_sub_epi16(vv, bias);
+    const __m256i yy = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(yv, _mm256_set1_epi16(k.yOffset)),
+                                                           _mm256_set1_epi16(k.y)),
+                                        _mm256_set1_epi16(32));
+    const __m256i r = _mm256_srai_epi16(_mm256_adds_epi16(yy, _mm256_mullo_epi16(vv, _mm256_set1_epi16(k.rv))), 6);
+    const __m256i g = _mm256_srai_epi16(_mm256_subs_epi16(_mm256_subs_epi16(yy, _mm256_mullo_epi16(uv, _mm256_set1_epi16(k.gu))),
+                                                          _mm256_mullo_epi16(vv, _mm256_set1_epi16(k.gv))), 6);
+    const __m256i b = _mm256_srai_epi16(_mm256_adds_epi16(yy, _mm256_mullo_epi16(uv, _mm256_set1_epi16(k.bu))), 6);
+
+    // Packing works per 128-bit lane: pixels 0-3 and 8-11 end up in lo,
+    // 4-7 and 12-15 in hi
+    const __m256i bg = _mm256_unpacklo_epi8(_mm256_packus_epi16(b, b), _mm256_packus_epi16(g, g));
+    const __m256i ra = _mm256_unpacklo_epi8(_mm256_packus_epi16(r, r), _mm256_set1_epi8(-1));
+    const __m256i lo = _mm256_unpacklo_epi16(bg, ra);
+    const __m256i hi = _mm256_unpackhi_epi16(bg, ra);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+COMPOSITOR_TARGET("avx2")
+void convertAvx2(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint32_t* out, int count,
+                 const Coefficients& k) {
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        storeAvx2(_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y + i))),
+                  _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(u + i))),
+                  _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i))), out + i, k);
+    }
+    convertSse41(y + i, u + i, v + i, out + i, count - i, k);
+}
+
+COMPOSITOR_TARGET("avx2")
+void convert420Avx2(const uint8_t* y, const uint8_t* u, const uint8_t* v, int chromaStep, uint32_t* out,
+                    int count, const Coefficients& k) {
+    const __m128i evens = _mm_setr_epi8(0, 0, 2, 2, 4, 4, 6, 6, 8, 8, 10, 10, 12, 12, 14, 14);
+    const __m128i odds = _mm_setr_epi8(1, 1, 3, 3, 5, 5, 7, 7, 9, 9, 11, 11, 13, 13, 15, 15);
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i yv = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y + i)));
+        __m128i us, vs;
+        if (chromaStep == 2) {
+            const __m128i pairs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(u + i));
+            us = _mm_shuffle_epi8(pairs, evens);
+            vs = _mm_shuffle_epi8(pairs, odds);
+        } else {
+            const __m128i u8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(u + i / 2));
+            const __m128i v8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(v + i / 2));
+            us = _mm_unpacklo_epi8(u8, u8);
+            vs = _mm_unpacklo_epi8(v8, v8);
+        }
+        storeAvx2(yv, _mm256_cvtepu8_epi16(us), _mm256_cvtepu8_epi16(vs), out + i, k);
+    }
+    const ptrdiff_t c = static_cast<ptrdiff_t>(i / 2) * chromaStep;
+    convert420Sse41(y + i, u + c, v + c, chromaStep, out + i, count - i, k);
+}
+
+// The resampleScalar() kernels for steps 1 and 2, with sample pairs split
+// into even and odd lanes at step 2. Vector loads stay within the `avail`
+// samples that follow src.
+COMPOSITOR_TARGET("sse4.1")
+void resampleSse41(const uint8_t* src, int step, int w, int avail, uint8_t* out, int n) {
+    const __m128i w0 = _mm_set1_epi16(static_cast<int16_t>(256 - w));
+    const __m128i w1 = _mm_set1_epi16(static_cast<int16_t>(w));
+    const __m128i low = _mm_set1_epi16(0xff);
+    int i = 0;
+    for (; i + 8 <= n && i * step + 16 <= avail; i += 8) {
+        __m128i a, b;
+        if (step == 1) {
+            a = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+            b = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i + 1)));
+        } else {
+            const __m128i pairs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i));
+            a = _mm_and_si128(pairs, low);
+            b = _mm_srli_epi16(pairs, 8);
+        }
+        // At most 255 x 256 + 128, so unsigned 16-bit lanes hold the sum
+        const __m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(a, w0), _mm_mullo_epi16(b, w1)),
+                                          _mm_set1_epi16(128));
+        const __m128i r = _mm_srli_epi16(sum, 8);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(r, r));
+    }
+    resampleScalar(src + static_cast<ptrdiff_t>(i) * step, step, w, out + i, n - i);
+}
+
+// (a * w0 + b * w1 + 32768) >> 16 in 32-bit lanes
+COMPOSITOR_TARGET("sse4.1")
+inline __m128i mix16Sse41(__m128i a, __m128i b, __m128i w0, __m128i w1) {
+    const __m128i sum = _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(a, w0), _mm_mullo_epi32(b, w1)),
+                                      _mm_set1_epi32(32768));
+    return _mm_srli_epi32(sum, 16);
+}
+
+COMPOSITOR_TARGET("sse4.1")
+void resampleSse41(const uint16_t* src, int step, int w, int avail, uint8_t* out, int n) {
+    const __m128i w0 = _mm_set1_epi32(256 - w);
+    const __m128i w1 = _mm_set1_epi32(w);
+    const __m128i low = _mm_set1_epi32(0xffff);
+    int i = 0;
+    for (; i + 8 <= n && i * step + 16 <= avail; i += 8) {
+        __m128i lo, hi;
+        if (step == 1) {
+            const uint16_t* p = src + i;
+            lo = mix16Sse41(_mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))),
+                            _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p + 1))), w0, w1);
+            hi = mix16Sse41(_mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p + 4))),
+                            _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p + 5))), w0, w1);
+        } else {
+            const __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i));
+            const __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i + 8));
+            lo = mix16Sse41(_mm_and_si128(p0, low), _mm_srli_epi32(p0, 16), w0, w1);
+            hi = mix16Sse41(_mm_and_si128(p1, low), _mm_srli_epi32(p1, 16), w0, w1);
+        }
+        const __m128i r = _mm_packus_epi32(lo, hi);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(r, r));
+    }
+    resampleScalar(src + static_cast<ptrdiff_t>(i) * step, step, w, out + i, n - i);
+}
+
+COMPOSITOR_TARGET("avx2")
+void resampleAvx2(const uint8_t* src, int step, int w, int avail, uint8_t* out, int n) {
+    const __m256i w0 = _mm256_set1_epi16(static_cast<int16_t>(256 - w));
+    const __m256i w1 = _mm256_set1_epi16(static_cast<int16_t>(w));
+    const __m256i low = _mm256_set1_epi16(0xff);
+    int i = 0;
+    for (; i + 16 <= n && i * step + 32 <= avail; i += 16) {
+        __m256i a, b;
+        if (step == 1) {
+            a = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+            b = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 1)));
+        } else {
+            const __m256i pairs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 2 * i));
+            a = _mm256_and_si256(pairs, low);
+            b = _mm256_srli_epi16(pairs, 8);
+        }
+        const __m256i sum = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(a, w0), _mm256_mullo_epi16(b, w1)),
+                                             _mm256_set1_epi16(128));
+        const __m256i r = _mm256_srli_epi16(sum, 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                         _mm_packus_epi16(_mm256_castsi256_si128(r), _mm256_extracti128_si256(r, 1)));
+    }
+    resampleSse41(src + static_cast<ptrdiff_t>(i) * step, step, w, avail - i * step, out + i, n - i);
+}
+
+COMPOSITOR_TARGET("avx2")
+void resampleAvx2(const uint16_t* src, int step, int w, int avail, uint8_t* out, int n) {
+    const __m256i w0 = _mm256_set1_epi32(256 - w);
+    const __m256i w1 = _mm256_set1_epi32(w);
+    const __m256i low = _mm256_set1_epi32(0xffff);
+    int i = 0;
+    for (; i + 8 <= n && i * step + 16 <= avail; i += 8) {
+        __m256i a, b;
+        if (step == 1) {
+            a = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+            b = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 1)));
+        } else {
+            const __m256i pairs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 2 * i));
+            a = _mm256_and_si256(pairs, low);
+            b = _mm256_srli_epi32(pairs, 16);
+        }
+        const __m256i sum = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(a, w0), _mm256_mullo_epi32(b, w1)),
+                                             _mm256_set1_epi32(32768));
+        const __m256i r = _mm256_srli_epi32(sum, 16);
+        const __m128i r16 = _mm_packus_epi32(_mm256_castsi256_si128(r), _mm256_extracti128_si256(r, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(r16, r16));
+    }
+    resampleSse41(src + static_cast<ptrdiff_t>(i) * step, step, w, avail - i * step, out + i, n - i);
+}
+#endif
+
+Isa detectIsa() {
+#if defined(COMPOSITOR_X86)
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    const int leaves = info[0];
+    __cpuid(info, 1);
+    const bool sse41 = (info[2] & (1 << 19)) != 0;
+    const bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    bool avx2 = false;
+    if (leaves >= 7 && osAvx) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    const bool sse41 = __builtin_cpu_supports("sse4.1");
+    const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    if (avx2) return Isa::Avx2;
+    if (sse41) return Isa::Sse41;
+#endif
+    return Isa::Scalar;
+}
+
+std::atomic<int>& selectedIsa() {
+    static std::atomic<int> selected{static_cast<int>(bestIsa())};
+    return selected;
+}
+
+void convertWith(Isa isa, const uint8_t* y, const uint8_t* u, const uint8_t* v, uint32_t* out, int count,
+                 const Coefficients& k) {
+    switch (isa) {
+#if defined(COMPOSITOR_X86)
+    case Isa::Avx2: convertAvx2(y, u, v, out, count, k); return;
+    case Isa::Sse41: convertSse41(y, u, v, out, count, k); return;
+#endif
+    default: convertScalar(y, u, v, out, count, k); return;
+    }
+}
+
+// Pixel i takes chroma sample i / 2 (at u + (i / 2) * chromaStep)
+void convert420With(Isa isa, const uint8_t* y, const uint8_t* u, const uint8_t* v, int chromaStep,
+                    uint32_t* out, int count, const Coefficients& k) {
+    switch (isa) {
+#if defined(COMPOSITOR_X86)
+    case Isa::Avx2: convert420Avx2(y, u, v, chromaStep, out, count, k); return;
+    case Isa::Sse41: convert420Sse41(y, u, v, chromaStep, out, count, k); return;
+#endif
+    default: convertScalar(y, u, v, out, count, k, chromaStep, 1); return;
+    }
+}
+
+template <typename Sample>
+void resampleWith(Isa isa, const Sample* src, int step, int w, int avail, uint8_t* out, int n) {
+    switch (isa) {
+#if defined(COMPOSITOR_X86)
+    case Isa::Avx2: resampleAvx2(src, step, w, avail, out, n); return;
+    case Isa::Sse41: resampleSse41(src, step, w, avail, out, n); return;
+#endif
+    default: (void)avail; resampleScalar(src, step, w, out, n); return;
+    }
+}
+
+bool isArgb32(QImage::Format format) {
+    return format == QImage::Format_RGB32 || format == QImage::Format_ARGB32
+        || format == QImage::Format_ARGB32_Premultiplied;
+}
+
+bool quarterTurns(double degrees, int& turns) {
+    const double q = degrees / 90.0;
+    const double r = std::round(q);
+    if (!std::isfinite(q) || std::abs(q - r) > 1e-9) return false;
+    turns = static_cast<int>(((static_cast<long long>(r) % 4) + 4) % 4);
+    return true;
+}
+
+// Canvas-to-source mapping of a supported transform. The source axis that
+// varies along a canvas row is "fast", the one that varies down the canvas
+// "slow"; quarter turns swap them. Coordinates are continuous, with pixel
+// centres at i + 0.5: coord = scale * canvasIndex + origin.
+struct Mapping {
+    bool transposed = false;    // fast axis is the source's y
+    double fastScale = 1.0, fastOrigin = 0.0;
+    double slowScale = 1.0, slowOrigin = 0.0;
+};
+
+bool mapping(const ClipTransform& t, int canvasWidth, int canvasHeight, int width, int height, Mapping& m) {
+    int turns = 0;
+    if (!std::isfinite(t.scale) || t.scale == 0.0 || !quarterTurns(t.rotation, turns)) return false;
+
+    // Inverse of QPainter's translate(centre + pan), rotate, scale(flips),
+    // drawImage(-size / 2)
+    const double cx = canvasWidth / 2.0 + t.panX;
+    const double cy = canvasHeight / 2.0 + t.panY;
+    const double sx = t.flipH ? -t.scale : t.scale;
+    const double sy = t.flipV ? -t.scale : t.scale;
+    double fa, fc, sa, sc;
+    switch (turns) {
+    case 0: fa = 1.0 / sx; fc = width / 2.0; sa = 1.0 / sy; sc = height / 2.0; break;
+    case 1: fa = -1.0 / sy; fc = height / 2.0; sa = 1.0 / sx; sc = width / 2.0; break;
+    case 2: fa = -1.0 / sx; fc = width / 2.0; sa = -1.0 / sy; sc = height / 2.0; break;
+    default: fa = 1.0 / sy; fc = height / 2.0; sa = -1.0 / sx; sc = width / 2.0; break;
+    }
+    m.transposed = turns % 2 == 1;
+    m.fastScale = fa;
+    m.fastOrigin = fa * (0.5 - cx) + fc;
+    m.slowScale = sa;
+    m.slowOrigin = sa * (0.5 - cy) + sc;
+    return true;
+}
+
+// Bilinear taps at a coordinate: samples i0 and i1, weight of i1 in 1/256.
+// False outside [0, extent).
+bool tap(double coord, int extent, int& i0, int& i1, int& weight) {
+    if (!(coord >= 0.0 && coord < extent)) return false;
+    const double p = coord - 0.5;
+    if (p <= 0.0 || p >= extent - 1) {
+        i0 = i1 = p <= 0.0 ? 0 : extent - 1;
+        weight = 0;
+        return true;
+    }
+    i0 = static_cast<int>(p);
+    weight = static_cast<int>((p - i0) * 256.0 + 0.5);
+    if (weight >= 256) {
+        ++i0;
+        weight = 0;
+    }
+    i1 = weight ? i0 + 1 : i0;
+    return true;
+}
+
+// Nearest 4:2:0 chroma sample of a luma coordinate inside [0, extent)
+int chromaIndex(double coord, int extent) {
+    return std::min(static_cast<int>(coord) >> 1, (extent + 1) / 2 - 1);
+}
+
+// Per-thread tables and rows, reused across frames
+struct Scratch {
+    std::vector<ptrdiff_t> off0, off1, uOff, vOff;
+    std::vector<uint16_t> weight;
+    std::vector<uint8_t> y, u, v;
+    std::vector<uint16_t> blend;    // two source rows mixed, x 256
+
+    void resize(int n, int sourceWidth) {
+        for (auto* t : {&off0, &off1, &uOff, &vOff}) t->resize(n);
+        weight.resize(n);
+        y.resize(n);
+        u.resize(n);
+        v.resize(n);
+        blend.resize(sourceWidth);
+    }
+};
+
+} // anonymous namespace
+
+bool supports(const ClipTransform& transform) {
+    int turns = 0;
+    return std::isfinite(transform.scale) && transform.scale != 0.0 && quarterTurns(transform.rotation, turns);
+}
+
+bool compose(const YuvFrame& frame, const ClipTransform& transform, QImage& canvas) {
+    if (frame.isNull() || frame.width <= 0 || frame.height <= 0 || canvas.isNull()) return false;
+    if (!isArgb32(canvas.format())) return false;
+    const int cw = canvas.width();
+    const int ch = canvas.height();
+    Mapping m;
+    if (!mapping(transform, cw, ch, frame.width, frame.height, m)) return false;
+
+    const bool nv12 = frame.layout == YuvFrame::Layout::NV12;
+    const uint8_t* yPlane = frame.planes[0];
+    const uint8_t* uPlane = frame.planes[1];
+    const uint8_t* vPlane = nv12 ? frame.planes[1] + 1 : frame.planes[2];
+    const ptrdiff_t yStride = frame.strides[0];
+    const ptrdiff_t uStride = frame.strides[1];
+    const ptrdiff_t vStride = nv12 ? frame.strides[1] : frame.strides[2];
+    const ptrdiff_t chromaStep = nv12 ? 2 : 1;
+    const int fastExtent = m.transposed ? frame.height : frame.width;
+    const int slowExtent = m.transposed ? frame.width : frame.height;
+
+    // Byte offset of a sample index along the fast or slow axis of a plane
+    auto offset = [&](bool fast, ptrdiff_t index, ptrdiff_t stride, ptrdiff_t step) {
+        return fast != m.transposed ? index * step : index * stride;
+    };
+
+    // Column tables: source samples for every covered canvas column
+    static thread_local Scratch s;
+    s.resize(cw, frame.width);
+    int first = cw, last = 0;
+    // At unit horizontal scale the columns are consecutive source pixels:
+    // chroma is read straight from the source row, and so is luma when it
+    // also lines up with the pixel grid
+    const bool consecutive = !m.transposed && m.fastScale == 1.0;
+    bool direct = consecutive;
+    for (int x = 0; x < cw; ++x) {
+        const double coord = m.fastScale * x + m.fastOrigin;
+        int i0, i1, w;
+        if (!tap(coord, fastExtent, i0, i1, w)) continue;
+        if (first == cw) first = x;
+        last = x + 1;
+        s.off0[x] = offset(true, i0, yStride, 1);
+        s.off1[x] = offset(true, i1, yStride, 1);
+        s.weight[x] = static_cast<uint16_t>(w);
+        const int c = chromaIndex(coord, fastExtent);
+        s.uOff[x] = offset(true, c, uStride, chromaStep);
+        s.vOff[x] = offset(true, c, vStride, chromaStep);
+        direct = direct && w == 0;
+    }
+    // Source column whose chroma the first covered column takes
+    const int firstColumn = first < last ? static_cast<int>(m.fastScale * first + m.fastOrigin) : 0;
+
+    const Isa use = isa();
+
+    // At 1:1 and 2:1 the columns between the clamped edges step evenly
+    // through the source row at one weight; that run is resampled with
+    // vector loads instead of the tables
+    const int runStep = m.transposed ? 0 : m.fastScale == 1.0 ? 1 : m.fastScale == 2.0 ? 2 : 0;
+    int runFirst = last, runLast = last, runWeight = 0;
+    if (runStep && first < last) {
+        const int mid = first + (last - first) / 2;
+        runWeight = s.weight[mid];
+        auto even = [&](int x) {
+            return s.weight[x] == runWeight && s.off0[x] == s.off0[mid] + static_cast<ptrdiff_t>(x - mid) * runStep
+                && s.off1[x] == s.off0[x] + (runWeight ? 1 : 0);
+        };
+        runFirst = mid;
+        runLast = mid + 1;
+        while (runFirst > first && even(runFirst - 1)) --runFirst;
+        while (runLast < last && even(runLast)) ++runLast;
+    }
+    // Columns outside the run, or all of them at other scales
+    auto forEdges = [&](auto&& column) {
+        for (int x = first; x < runFirst; ++x) column(x);
+        for (int x = runLast; x < last; ++x) column(x);
+    };
+    auto resampleRun = [&](const auto* row, uint8_t* out) {
+        if (runFirst < runLast)
+            resampleWith(use, row + s.off0[runFirst], runStep, runWeight,
+                         fastExtent - static_cast<int>(s.off0[runFirst]), out + runFirst, runLast - runFirst);
+    };
+
+    const Coefficients& k = coefficients(frame.matrix, frame.fullRange);
+    uchar* bits = canvas.bits();
+    const qsizetype bytesPerLine = canvas.bytesPerLine();
+    for (int y = 0; y < ch; ++y) {
+        uint32_t* row = reinterpret_cast<uint32_t*>(bits + y * bytesPerLine);
+        const double coord = m.slowScale * y + m.slowOrigin;
+        int j0, j1, wy;
+        if (first >= last || !tap(coord, slowExtent, j0, j1, wy)) {
+            std::fill(row, row + cw, Black);
+            continue;
+        }
+        std::fill(row, row + first, Black);
+        std::fill(row + last, row + cw, Black);
+
+        // Luma: straight from the source row when it lines up, else resampled
+        const uint8_t* y0 = yPlane + offset(false, j0, yStride, 1);
+        const uint8_t* y1 = yPlane + offset(false, j1, yStride, 1);
+        const uint8_t* luma = y0 + s.off0[first];
+        if (!direct || wy != 0) {
+            const ptrdiff_t* off0 = s.off0.data();
+            const ptrdiff_t* off1 = s.off1.data();
+            const uint16_t* wx = s.weight.data();
+            uint8_t* out = s.y.data();
+            if (wy == 0) {
+                forEdges([&](int x) {
+                    out[x] = static_cast<uint8_t>((y0[off0[x]] * (256 - wx[x]) + y0[off1[x]] * wx[x] + 128) >> 8);
+                });
+                resampleRun(y0, out);
+            } else if (!m.transposed) {
+                // Mix the two source rows over the span used first (a
+                // contiguous loop that vectorises), then resample it
+                const ptrdiff_t lo = std::min(off0[first], off0[last - 1]);
+                const ptrdiff_t hi = std::max(off1[first], off1[last - 1]);
+                uint16_t* blend = s.blend.data();
+                for (ptrdiff_t i = lo; i <= hi; ++i)
+                    blend[i] = static_cast<uint16_t>(y0[i] * (256 - wy) + y1[i] * wy);
+                forEdges([&](int x) {
+                    out[x] = static_cast<uint8_t>((blend[off0[x]] * (256 - wx[x]) + blend[off1[x]] * wx[x] + 32768) >> 16);
+                });
+                resampleRun(blend, out);
+            } else {
+                for (int x = first; x < last; ++x) {
+                    const int top = y0[off0[x]] * (256 - wx[x]) + y0[off1[x]] * wx[x];
+                    const int bottom = y1[off0[x]] * (256 - wx[x]) + y1[off1[x]] * wx[x];
+                    out[x] = static_cast<uint8_t>((top * (256 - wy) + bottom * wy + 32768) >> 16);
+                }
+            }
+            luma = out + first;
+        }
+
+        // Chroma: nearest sample
+        const int c = chromaIndex(coord, slowExtent);
+        const uint8_t* u0 = uPlane + offset(false, c, uStride, chromaStep);
+        const uint8_t* v0 = vPlane + offset(false, c, vStride, chromaStep);
+        uint32_t* out = row + first;
+        int count = last - first;
+        if (consecutive) {
+            // Source columns from firstColumn on; an odd one starts halfway
+            // through a chroma sample
+            int column = firstColumn;
+            if (column & 1) {
+                const ptrdiff_t odd = static_cast<ptrdiff_t>(column >> 1) * chromaStep;
+                convertScalar(luma, u0 + odd, v0 + odd, out, 1, k);
+                ++luma, ++out, ++column, --count;
+            }
+            const ptrdiff_t even = static_cast<ptrdiff_t>(column >> 1) * chromaStep;
+            convert420With(use, luma, u0 + even, v0 + even, static_cast<int>(chromaStep), out, count, k);
+        } else {
+            for (int x = first; x < last; ++x) {
+                s.u[x] = u0[s.uOff[x]];
+                s.v[x] = v0[s.vOff[x]];
+            }
+            convertWith(use, luma, s.u.data() + first, s.v.data() + first, out, count, k);
+        }
+    }
+    return true;
+}
+
+bool convert(const YuvFrame& frame, QImage& image) {
+    if (frame.isNull()) return false;
+    const QSize size(frame.width, frame.height);
+    if (image.size() != size || !isArgb32(image.format()))
+        image = QImage(size, QImage::Format_RGB32);
+    return compose(frame, ClipTransform{}, image);
+}
+
+void convertRow(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint32_t* out, int count,
+                YuvFrame::Matrix matrix, bool fullRange) {
+    convertWith(isa(), y, u, v, out, count, coefficients(matrix, fullRange));
+}
+
+Isa bestIsa() {
+    static const Isa best = detectIsa();
+    return best;
+}
+
+Isa isa() {
+    return static_cast<Isa>(selectedIsa().load(std::memory_order_relaxed));
+}
+
+void setIsa(Isa isa) {
+    selectedIsa().store(std::min(static_cast<int>(isa), static_cast<int>(bestIsa())), std::memory_order_relaxed);
+}
+
+const char* isaName(Isa isa) {
+    switch (isa) {
+    case Isa::Avx2: return "AVX2";
+    case Isa::Sse41: return "SSE4.1";
+    default: return "scalar";
+    }
+}
+
+} // namespace FrameCompositor
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QImage>
+#include <cstdint>
+#include "YuvFrame.h"
+
+struct ClipTransform;
+
+// Places decoded YUV frames on the output canvas in one pass: every canvas
+// row is resampled straight from the source planes (bilinear luma, nearest
+// chroma) and converted to ARGB in place, with black around the frame. No
+// full-size RGB copy of the source is made.
+//
+// Handles scale, pan, flips and quarter-turn rotations, the transforms that
+// map canvas rows onto source rows or columns; other angles are left to
+// QPainter. The colour conversion, and the luma resampling at 1:1 and 2:1,
+// are chosen at runtime (AVX2, SSE4.1 or scalar) so a default build still
+// uses the vector units it finds.
+namespace FrameCompositor {
+
+enum class Isa { Scalar, Sse41, Avx2 };
+
+// Whether compose() handles the transform
+bool supports(const ClipTransform& transform);
+
+// Draws frame onto a 32-bit (A)RGB canvas of any size as QPainter would
+// with the transform applied about the canvas centre, covering the whole
+// canvas. False, leaving the canvas alone, if the frame is null, the
+// canvas format unsuitable or the transform unsupported.
+bool compose(const YuvFrame& frame, const ClipTransform& transform, QImage& canvas);
+
+// The frame at its own size in a new RGB32 image (or in image, when that
+// is already a 32-bit image of the frame's size)
+bool convert(const YuvFrame& frame, QImage& image);
+
+// One row of full-resolution Y, U and V to opaque ARGB
+void convertRow(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint32_t* out, int count,
+                YuvFrame::Matrix matrix, bool fullRange);
+
+Isa bestIsa();          // what the CPU supports
+Isa isa();              // what is in use, bestIsa() unless set
+void setIsa(Isa isa);   // clamped to bestIsa(); for tests and benchmarks
+const char* isaName(Isa isa);
+
+} // namespace FrameCompositor
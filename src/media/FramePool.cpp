@@ -0,0 +1,96 @@
+#include "FramePool.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <QtGlobal>
+#include <vector>
+
+struct FramePool::Buffer {
+    std::shared_ptr<State> owner;   // set while handed out
+    uchar* data = nullptr;
+
+    ~Buffer() { qFreeAligned(data); }
+};
+
+struct FramePool::State {
+    QMutex mutex;
+    size_t bytes = 0;
+    std::vector<std::unique_ptr<Buffer>> buffers;
+    std::vector<Buffer*> free;
+
+    Buffer* allocate() {
+        auto buffer = std::make_unique<Buffer>();
+        buffer->data = static_cast<uchar*>(qMallocAligned(bytes, Alignment));
+        if (!buffer->data) return nullptr;
+        buffers.push_back(std::move(buffer));
+        return buffers.back().get();
+    }
+};
+
+FramePool::FramePool(QSize size, QImage::Format format, int preallocate) {
+    reset(size, format, preallocate);
+}
+
+void FramePool::reset(QSize size, QImage::Format format, int preallocate) {
+    m_size = size;
+    m_format = format;
+    m_bytesPerLine = 0;
+    m_state.reset();
+    if (size.isEmpty() || format == QImage::Format_Invalid) return;
+
+    const int bits = QImage::toPixelFormat(format).bitsPerPixel();
+    m_bytesPerLine = ((size.width() * bits + 7) / 8 + Alignment - 1) / Alignment * Alignment;
+    m_state = std::make_shared<State>();
+    m_state->bytes = static_cast<size_t>(m_bytesPerLine) * static_cast<size_t>(size.height());
+    reserve(preallocate);
+}
+
+void FramePool::reserve(int count) {
+    if (!m_state) return;
+    QMutexLocker lock(&m_state->mutex);
+    while (static_cast<int>(m_state->buffers.size()) < count) {
+        Buffer* buffer = m_state->allocate();
+        if (!buffer) break;
+        m_state->free.push_back(buffer);
+    }
+}
+
+QImage FramePool::acquire() {
+    if (!m_state) return QImage();
+
+    Buffer* buffer = nullptr;
+    {
+        QMutexLocker lock(&m_state->mutex);
+        if (!m_state->free.empty()) {
+            buffer = m_state->free.back();
+            m_state->free.pop_back();
+        } else {
+            buffer = m_state->allocate();
+        }
+    }
+    if (!buffer) return QImage();
+
+    buffer->owner = m_state;
+    return QImage(buffer->data, m_size.width(), m_size.height(), m_bytesPerLine, m_format,
+                  &FramePool::release, buffer);
+}
+
+void FramePool::release(void* info) {
+    Buffer* buffer = static_cast<Buffer*>(info);
+    // Keeps the state alive until the buffer is back on its free list; if
+    // the pool is gone this is the last reference and frees everything
+    std::shared_ptr<State> state = std::move(buffer->owner);
+    QMutexLocker lock(&state->mutex);
+    state->free.push_back(buffer);
+}
+
+int FramePool::allocated() const {
+    if (!m_state) return 0;
+    QMutexLocker lock(&m_state->mutex);
+    return static_cast<int>(m_state->buffers.size());
+}
+
+int FramePool::available() const {
+    if (!m_state) return 0;
+    QMutexLocker lock(&m_state->mutex);
+    return static_cast<int>(m_state->free.size());
+}
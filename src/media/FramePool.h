@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QImage>
+#include <QSize>
+#include <memory>
+
+// Recycled frame buffers of one size and format. acquire() hands out a
+// QImage over a pooled buffer (rows aligned to Alignment bytes); when the
+// last copy of that image is destroyed the buffer goes back to the pool
+// instead of being freed, so a decoder can keep filling the same few
+// buffers. Images stay valid after the pool is reset or destroyed, their
+// buffers are freed on release then.
+//
+// Images are shared like any QImage: writing to one that is still
+// referenced elsewhere detaches it into an ordinary heap copy. Pass frames
+// on by move to keep them in the pool.
+class FramePool {
+public:
+    static constexpr int Alignment = 64;
+
+    FramePool() = default;
+    FramePool(QSize size, QImage::Format format, int preallocate = 0);
+
+    // Switches to a new size and format; buffers of the old one are freed
+    void reset(QSize size, QImage::Format format, int preallocate = 0);
+    // Allocates buffers until at least count exist
+    void reserve(int count);
+
+    // A free buffer, or a new one if all are in use; null if the pool has
+    // no size
+    QImage acquire();
+
+    QSize size() const { return m_size; }
+    QImage::Format format() const { return m_format; }
+    int bytesPerLine() const { return m_bytesPerLine; }
+
+    int allocated() const;  // buffers in use or free
+    int available() const;  // free buffers
+
+private:
+    struct State;
+    struct Buffer;
+
+    static void release(void* info);
+
+    QSize m_size;
+    QImage::Format m_format = QImage::Format_Invalid;
+    int m_bytesPerLine = 0;
+    std::shared_ptr<State> m_state;
+};
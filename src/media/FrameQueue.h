@@ -3,66 +3,103 @@
 #include <QImage>
 #include <QMutex>
 #include <QWaitCondition>
-#include <queue>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include "YuvFrame.h"
 
 struct TimedFrame {
-    QImage image;
+    QImage image;      // RGB32, unless the frame was left as YUV
+    YuvFrame yuv;
     double pts = 0.0;  // presentation timestamp in seconds
+    int serial = 0;    // seek generation the frame was decoded in
+
+    bool isNull() const { return image.isNull() && yuv.isNull(); }
 };
 
+// Fixed-capacity ring of frames between one producer (the decode thread)
+// and one consumer (the UI thread). Indices are atomics, so pushing and
+// popping never lock; only a producer waiting for a free slot sleeps on a
+// condition variable, and the consumer takes the lock just to wake it.
+//
+// Frames are moved in and out, so a pooled image has a single owner when
+// it is popped and can be painted on in place.
 class FrameQueue {
 public:
-    explicit FrameQueue(int maxSize = 30) : m_maxSize(maxSize) {}
+    explicit FrameQueue(int capacity)
+        : m_capacity(static_cast<size_t>(std::max(capacity, 1)))
+        , m_slots(std::make_unique<TimedFrame[]>(m_capacity)) {}
 
-    void push(const TimedFrame& frame) {
-        QMutexLocker lock(&m_mutex);
-        while (static_cast<int>(m_queue.size()) >= m_maxSize) {
-            m_notFull.wait(&m_mutex);
-        }
-        m_queue.push(frame);
-        m_notEmpty.wakeOne();
+    int capacity() const { return static_cast<int>(m_capacity); }
+
+    // --- Producer ---
+
+    // Moves the frame into the ring unless it is full
+    bool tryPush(TimedFrame& frame) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) >= m_capacity) return false;
+        m_slots[head % m_capacity] = std::move(frame);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
     }
 
-    TimedFrame pop() {
+    // Sleeps until a slot is free or cancelled() holds; returns whether a
+    // slot is free. Whoever makes cancelled() true must call wakeProducer().
+    template <typename Cancelled>
+    bool waitForSpace(const Cancelled& cancelled) {
         QMutexLocker lock(&m_mutex);
-        while (m_queue.empty()) {
-            m_notEmpty.wait(&m_mutex);
-        }
-        TimedFrame frame = m_queue.front();
-        m_queue.pop();
-        m_notFull.wakeOne();
-        return frame;
+        m_producerWaiting.store(true);
+        while (full() && !cancelled())
+            m_notFull.wait(&m_mutex);
+        m_producerWaiting.store(false);
+        return !full();
     }
 
+    // --- Consumer ---
+
     bool tryPop(TimedFrame& frame) {
-        QMutexLocker lock(&m_mutex);
-        if (m_queue.empty()) return false;
-        frame = m_queue.front();
-        m_queue.pop();
-        m_notFull.wakeOne();
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (m_head.load(std::memory_order_acquire) == tail) return false;
+        // Leave the slot empty so its buffer is not held until overwritten
+        frame = std::exchange(m_slots[tail % m_capacity], TimedFrame{});
+        m_tail.store(tail + 1);
+        if (m_producerWaiting.load()) wakeProducer();
         return true;
     }
 
+    // Drops everything queued
     void clear() {
+        TimedFrame frame;
+        while (tryPop(frame)) {}
+    }
+
+    // --- Either side ---
+
+    void wakeProducer() {
         QMutexLocker lock(&m_mutex);
-        while (!m_queue.empty()) m_queue.pop();
         m_notFull.wakeAll();
     }
 
     int size() const {
-        QMutexLocker lock(&m_mutex);
-        return static_cast<int>(m_queue.size());
+        const size_t tail = m_tail.load(std::memory_order_acquire);
+        return static_cast<int>(m_head.load(std::memory_order_acquire) - tail);
     }
 
-    bool isEmpty() const {
-        QMutexLocker lock(&m_mutex);
-        return m_queue.empty();
-    }
+    bool isEmpty() const { return size() == 0; }
 
 private:
-    mutable QMutex m_mutex;
-    QWaitCondition m_notEmpty;
+    bool full() const { return m_head.load(std::memory_order_relaxed) - m_tail.load() >= m_capacity; }
+
+    const size_t m_capacity;
+    std::unique_ptr<TimedFrame[]> m_slots;
+
+    // Written by one side each; kept on separate cache lines
+    alignas(64) std::atomic<size_t> m_head{0};  // frames pushed
+    alignas(64) std::atomic<size_t> m_tail{0};  // frames popped
+
+    std::atomic<bool> m_producerWaiting{false};
+    QMutex m_mutex;
     QWaitCondition m_notFull;
-    std::queue<TimedFrame> m_queue;
-    int m_maxSize;
 };
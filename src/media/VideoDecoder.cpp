@@ -13,19 +13,15 @@ struct VideoDecoder::FFmpegContext {
     AVCodecContext* codecCtx = nullptr;
     SwsContext* swsCtx = nullptr;
     AVFrame* frame = nullptr;
-    AVFrame* rgbFrame = nullptr;
     AVPacket* packet = nullptr;
     int videoStreamIdx = -1;
     double timeBase = 0.0;
-    uint8_t* rgbBuffer = nullptr;
     bool eofReached = false;   // av_read_frame returned EOF
     bool flushed = false;      // flush packet sent to codec
     double seekTarget = -1.0;  // target PTS for dropping pre-frames
 
     ~FFmpegContext() {
-        if (rgbBuffer) av_free(rgbBuffer);
         if (packet) av_packet_free(&packet);
-        if (rgbFrame) av_frame_free(&rgbFrame);
         if (frame) av_frame_free(&frame);
         if (swsCtx) sws_freeContext(swsCtx);
         if (codecCtx) avcodec_free_context(&codecCtx);
@@ -79,18 +75,40 @@ bool VideoDecoder::open(const QString& filePath) {
     m_ctx->codecCtx = avcodec_alloc_context3(codec);
     avcodec_parameters_to_context(m_ctx->codecCtx, par);
 
+    // Frame threading pipelines whole frames, which suits sequential
+    // playback but holds back the first frame by one per thread; one-off
+    // background decodes only split frames into slices
+    m_budgetThreads = m_requestedThreads <= 0;
+    m_budgetPriority = m_priority;
+    m_threads = m_budgetThreads ? DecoderThreadBudget::instance().acquire(m_priority) : m_requestedThreads;
+    m_ctx->codecCtx->thread_count = m_threads;
+    m_ctx->codecCtx->thread_type = m_priority == DecodePriority::Playback
+        ? FF_THREAD_FRAME | FF_THREAD_SLICE : FF_THREAD_SLICE;
+
+    // A reduced preview hides deblocking, so skip it; codecs with a lowres
+    // mode (MJPEG, not H.264/HEVC) also decode fewer pixels
+    if (m_downscale > 1) {
+        int lowres = 0;
+        while ((2 << lowres) <= m_downscale && lowres < codec->max_lowres) ++lowres;
+        m_ctx->codecCtx->lowres = lowres;
+        m_ctx->codecCtx->skip_loop_filter = AVDISCARD_ALL;
+        m_ctx->codecCtx->flags2 |= AV_CODEC_FLAG2_FAST;
+    }
+
     ret = avcodec_open2(m_ctx->codecCtx, codec, nullptr);
     if (ret < 0) {
-        m_ctx.reset();
+        close();
         return false;
     }
 
     // Time base for PTS conversion
     m_ctx->timeBase = av_q2d(stream->time_base);
 
-    // Fill video info
-    m_info.width = m_ctx->codecCtx->width;
-    m_info.height = m_ctx->codecCtx->height;
+    // Fill video info; the codec context is at the lowres size
+    m_info.width = par->width;
+    m_info.height = par->height;
+    m_frameSize = QSize((m_info.width + m_downscale - 1) / m_downscale,
+                        (m_info.height + m_downscale - 1) / m_downscale);
     m_info.codecName = QString(codec->name);
 
     if (stream->avg_frame_rate.den > 0 && stream->avg_frame_rate.num > 0)
@@ -108,28 +126,24 @@ bool VideoDecoder::open(const QString& filePath) {
     if (m_info.fps > 0 && m_info.duration > 0)
         m_info.totalFrames = static_cast<int64_t>(m_info.duration * m_info.fps);
 
-    // Allocate frames and packet
+    // Allocate frame and packet
     m_ctx->frame = av_frame_alloc();
-    m_ctx->rgbFrame = av_frame_alloc();
     m_ctx->packet = av_packet_alloc();
 
-    // Allocate RGB buffer
-    int numBytes = av_image_get_buffer_size(AV_PIX_FMT_RGB32, m_info.width, m_info.height, 1);
-    m_ctx->rgbBuffer = static_cast<uint8_t*>(av_malloc(numBytes));
-    av_image_fill_arrays(m_ctx->rgbFrame->data, m_ctx->rgbFrame->linesize,
-                         m_ctx->rgbBuffer, AV_PIX_FMT_RGB32,
-                         m_info.width, m_info.height, 1);
+    // Output buffers are recycled through the pool (AV_PIX_FMT_RGB32 is
+    // QImage::Format_RGB32 in memory)
+    m_framePool.reset(m_frameSize, QImage::Format_RGB32);
 
-    // Create scaler context
+    // Create scaler context, scaling to the preview size as it converts
     m_ctx->swsCtx = sws_getContext(
-        m_info.width, m_info.height,
+        m_ctx->codecCtx->width, m_ctx->codecCtx->height,
         m_ctx->codecCtx->pix_fmt,
-        m_info.width, m_info.height,
+        m_frameSize.width(), m_frameSize.height(),
         AV_PIX_FMT_RGB32,
         SWS_BILINEAR, nullptr, nullptr, nullptr);
 
     if (!m_ctx->swsCtx) {
-        m_ctx.reset();
+        close();
         return false;
     }
 
@@ -146,14 +160,108 @@ void VideoDecoder::close() {
 #ifdef HAS_FFMPEG
     m_ctx.reset();
 #endif
+    m_framePool.reset(QSize(), QImage::Format_Invalid);
+    if (m_budgetThreads) DecoderThreadBudget::instance().release(m_budgetPriority, m_threads);
+    m_budgetThreads = false;
+    m_threads = 0;
     m_isOpen = false;
     m_currentTime = 0.0;
     m_info = VideoInfo{};
+    m_frameSize = QSize();
 }
 
 QImage VideoDecoder::decodeNextFrame() {
 #ifdef HAS_FFMPEG
-    if (!m_isOpen || !m_ctx) return QImage();
+    if (!receiveFrame()) return QImage();
+    QImage result = convertFrame();
+    if (!result.isNull()) emit frameDecoded(result, m_currentTime);
+    return result;
+#else
+    return QImage();
+#endif
+}
+
+bool VideoDecoder::hasYuvOutput() const {
+#ifdef HAS_FFMPEG
+    if (!m_isOpen || !m_ctx) return false;
+    const AVPixelFormat fmt = m_ctx->codecCtx->pix_fmt;
+    return fmt == AV_PIX_FMT_NV12 || fmt == AV_PIX_FMT_YUV420P || fmt == AV_PIX_FMT_YUVJ420P;
+#else
+    return false;
+#endif
+}
+
+bool VideoDecoder::decodeNextFrameNative(YuvFrame& yuv, QImage& image) {
+    yuv = YuvFrame{};
+    image = QImage();
+#ifdef HAS_FFMPEG
+    if (!receiveFrame()) return false;
+
+    const AVFrame* src = m_ctx->frame;
+    const AVPixelFormat fmt = static_cast<AVPixelFormat>(src->format);
+    const bool planar = fmt == AV_PIX_FMT_YUV420P || fmt == AV_PIX_FMT_YUVJ420P;
+    if (!planar && fmt != AV_PIX_FMT_NV12) {
+        // Hardware or high bit depth frames go through the scaler
+        image = convertFrame();
+        return !image.isNull();
+    }
+
+    // Take a reference to the codec's buffers instead of copying them
+    AVFrame* ref = av_frame_clone(src);
+    if (!ref) return false;
+    yuv.owner = std::shared_ptr<const void>(ref, [](const void* p) {
+        AVFrame* f = static_cast<AVFrame*>(const_cast<void*>(p));
+        av_frame_free(&f);
+    });
+
+    yuv.layout = planar ? YuvFrame::Layout::YUV420P : YuvFrame::Layout::NV12;
+    yuv.width = ref->width;
+    yuv.height = ref->height;
+    for (int i = 0; i < (planar ? 3 : 2); ++i) {
+        yuv.planes[i] = ref->data[i];
+        yuv.strides[i] = ref->linesize[i];
+    }
+    // Untagged streams follow the usual convention: HD is BT.709
+    if (ref->colorspace == AVCOL_SPC_BT709)
+        yuv.matrix = YuvFrame::Matrix::BT709;
+    else if (ref->colorspace == AVCOL_SPC_UNSPECIFIED)
+        yuv.matrix = ref->height >= 720 ? YuvFrame::Matrix::BT709 : YuvFrame::Matrix::BT601;
+    else
+        yuv.matrix = YuvFrame::Matrix::BT601;
+    yuv.fullRange = ref->color_range == AVCOL_RANGE_JPEG || fmt == AV_PIX_FMT_YUVJ420P;
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef HAS_FFMPEG
+QImage VideoDecoder::convertFrame() {
+    // Frames can differ from the codec context (lowres rounding, hardware
+    // formats); the cached context is only rebuilt when they do
+    const AVFrame* frame = m_ctx->frame;
+    m_ctx->swsCtx = sws_getCachedContext(
+        m_ctx->swsCtx,
+        frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+        m_frameSize.width(), m_frameSize.height(),
+        AV_PIX_FMT_RGB32,
+        SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!m_ctx->swsCtx) return QImage();
+
+    // Convert straight into a pooled buffer
+    QImage result = m_framePool.acquire();
+    if (result.isNull()) return QImage();
+    uint8_t* dstData[4] = {result.bits(), nullptr, nullptr, nullptr};
+    int dstLinesize[4] = {static_cast<int>(result.bytesPerLine()), 0, 0, 0};
+    sws_scale(m_ctx->swsCtx,
+              frame->data, frame->linesize,
+              0, frame->height,
+              dstData, dstLinesize);
+    return result;
+}
+
+bool VideoDecoder::receiveFrame() {
+    if (!m_isOpen || !m_ctx) return false;
 
     while (true) {
         // Try to receive a frame from the codec first (handles buffered B-frames)
@@ -174,27 +282,13 @@ QImage VideoDecoder::decodeNextFrame() {
                 m_ctx->seekTarget = -1.0;
             }
 
-            // Got a frame — convert and return
-            sws_scale(m_ctx->swsCtx,
-                      m_ctx->frame->data, m_ctx->frame->linesize,
-                      0, m_info.height,
-                      m_ctx->rgbFrame->data, m_ctx->rgbFrame->linesize);
-
             m_currentTime = pts;
-
-            QImage img(m_ctx->rgbFrame->data[0],
-                       m_info.width, m_info.height,
-                       m_ctx->rgbFrame->linesize[0],
-                       QImage::Format_RGB32);
-            QImage result = img.copy();
-
-            emit frameDecoded(result, pts);
-            return result;
+            return true;
         }
 
         if (ret != AVERROR(EAGAIN)) {
             // AVERROR_EOF or real error — no more frames
-            return QImage();
+            return false;
         }
 
         // Codec needs more input
@@ -206,7 +300,7 @@ QImage VideoDecoder::decodeNextFrame() {
                 continue;  // Loop back to receive_frame
             }
             // Already flushed and no more frames
-            return QImage();
+            return false;
         }
 
         // Read next packet from file
@@ -228,9 +322,8 @@ QImage VideoDecoder::decodeNextFrame() {
         av_packet_unref(m_ctx->packet);
         // Loop back to receive_frame
     }
-#endif
-    return QImage();
 }
+#endif
 
 bool VideoDecoder::seek(double seconds) {
 #ifdef HAS_FFMPEG
@@ -3,7 +3,12 @@
 #include <QObject>
 #include <QImage>
 #include <QString>
+#include <QSize>
+#include <algorithm>
 #include <memory>
+#include "DecoderThreadBudget.h"
+#include "FramePool.h"
+#include "YuvFrame.h"
 
 struct VideoInfo {
     int width = 0;
@@ -20,15 +25,39 @@ public:
     explicit VideoDecoder(QObject* parent = nullptr);
     ~VideoDecoder();
 
+    // Codec threads come from DecoderThreadBudget by priority (Background
+    // unless set) or, with a thread count above 0, are fixed. Both take
+    // effect on the next open().
+    void setPriority(DecodePriority priority) { m_priority = priority; }
+    DecodePriority priority() const { return m_priority; }
+    void setThreadCount(int threads) { m_requestedThreads = threads; }
+    int threadCount() const { return m_threads; }  // while open
+
+    // Decode for a preview at 1/factor of the stream size (1, 2 or 4): the
+    // codec decodes at low resolution where it supports it and skips the
+    // loop filter, and RGB conversion scales down. From the next open().
+    void setDownscale(int factor) { m_downscale = std::clamp(factor, 1, 4); }
+    int downscale() const { return m_downscale; }
+    // Size of decodeNextFrame() images; info() keeps the stream size
+    QSize frameSize() const { return m_frameSize; }
+
     bool open(const QString& filePath);
     void close();
     bool isOpen() const { return m_isOpen; }
 
+    // Next frame as RGB32 in a pooled buffer; the buffer is reused once
+    // every copy of the image is gone
     QImage decodeNextFrame();
+    // Next frame left in the codec's NV12/YUV420P buffers (yuv set, image
+    // null) for FrameCompositor, at the codec's decoded size; other pixel formats are converted as by
+    // decodeNextFrame() into image. False at the end of the stream.
+    bool decodeNextFrameNative(YuvFrame& yuv, QImage& image);
+    bool hasYuvOutput() const;  // decodeNextFrameNative() yields YuvFrames
     bool seek(double seconds);
     double currentTime() const { return m_currentTime; }
 
     const VideoInfo& info() const { return m_info; }
+    FramePool& framePool() { return m_framePool; }
 
 signals:
     void frameDecoded(const QImage& frame, double pts);
@@ -37,8 +66,18 @@ private:
     bool m_isOpen = false;
     double m_currentTime = 0.0;
     VideoInfo m_info;
+    QSize m_frameSize;
+    int m_downscale = 1;
+    FramePool m_framePool;
+    DecodePriority m_priority = DecodePriority::Background;
+    int m_requestedThreads = 0;
+    int m_threads = 0;
+    bool m_budgetThreads = false;   // m_threads is held from the budget
+    DecodePriority m_budgetPriority = DecodePriority::Background; // ... under this priority
 
 #ifdef HAS_FFMPEG
+    bool receiveFrame();    // next frame into the context, sets m_currentTime
+    QImage convertFrame();  // that frame to RGB32 at m_frameSize via the scaler
     struct FFmpegContext;
     std::unique_ptr<FFmpegContext> m_ctx;
 #endif
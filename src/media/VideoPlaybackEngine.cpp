@@ -1,5 +1,6 @@
 #include "VideoPlaybackEngine.h"
 #include "VideoDecoder.h"
+#include <algorithm>
 
 // --- DecodeThread ---
 
@@ -7,21 +8,34 @@ DecodeThread::DecodeThread(VideoDecoder* decoder, FrameQueue* queue, QObject* pa
     : QThread(parent), m_decoder(decoder), m_queue(queue) {}
 
 void DecodeThread::requestSeek(double seconds) {
-    QMutexLocker lock(&m_mutex);
-    m_seekTarget = seconds;
-    m_seekRequested = true;
-    m_eof = false;
-    // Wake thread if it's waiting on a full queue or EOF sleep
+    {
+        QMutexLocker lock(&m_mutex);
+        m_seekTarget = seconds;
+        ++m_serial;
+        m_seekRequested = true;
+        m_eof = false;
+        // Wake thread if it's in the EOF sleep
+        m_seekCond.wakeOne();
+    }
+    // Frames already queued are from before the seek; frames still in
+    // flight carry the old serial and are skipped by nextFrame()
     m_queue->clear();
-    m_seekCond.wakeOne();
+    m_queue->wakeProducer();
 }
 
 void DecodeThread::requestStop() {
     m_stopRequested = true;
-    m_queue->clear();  // Unblock any push() waiting on full queue
+    {
+        QMutexLocker lock(&m_mutex);
+        m_seekCond.wakeOne();
+    }
+    m_queue->wakeProducer();  // Unblock a wait for a free slot
 }
 
 void DecodeThread::run() {
+    int serial = m_serial;
+    auto interrupted = [this]() { return m_stopRequested || m_seekRequested; };
+
     while (!m_stopRequested) {
         // Check for pending seek
         if (m_seekRequested) {
@@ -29,10 +43,10 @@ void DecodeThread::run() {
             {
                 QMutexLocker lock(&m_mutex);
                 target = m_seekTarget;
+                serial = m_serial;
                 m_seekRequested = false;
             }
             m_eof = false;
-            m_queue->clear();
             m_decoder->seek(target);
         }
 
@@ -46,27 +60,24 @@ void DecodeThread::run() {
         }
 
         // Decode next frame sequentially
-        QImage frame = m_decoder->decodeNextFrame();
-        if (frame.isNull()) {
+        TimedFrame tf;
+        if (m_yuvOutput)
+            m_decoder->decodeNextFrameNative(tf.yuv, tf.image);
+        else
+            tf.image = m_decoder->decodeNextFrame();
+        if (tf.isNull()) {
             // End of stream — all frames (including flushed B-frames) consumed
             m_eof = true;
             continue;
         }
 
-        TimedFrame tf;
-        tf.image = frame;
         tf.pts = m_decoder->currentTime();
+        tf.serial = serial;
 
-        // Push blocks if queue is full (backpressure)
-        // But we need to check stop/seek periodically
-        while (!m_stopRequested && !m_seekRequested) {
-            if (m_queue->size() < 8) {
-                m_queue->push(tf);
-                break;
-            }
-            // Queue full — wait briefly
-            QThread::msleep(2);
-        }
+        // Backpressure: sleep until the UI frees a slot; a seek or stop
+        // drops the frame
+        while (!interrupted() && !m_queue->tryPush(tf))
+            m_queue->waitForSpace(interrupted);
     }
 }
 
@@ -75,8 +86,9 @@ void DecodeThread::run() {
 VideoPlaybackEngine::VideoPlaybackEngine(QObject* parent)
     : QObject(parent)
     , m_decoder(std::make_unique<VideoDecoder>())
-    , m_frameQueue(std::make_unique<FrameQueue>(8))
-{}
+{
+    m_decoder->setPriority(DecodePriority::Playback);
+}
 
 VideoPlaybackEngine::~VideoPlaybackEngine() {
     close();
@@ -88,8 +100,18 @@ bool VideoPlaybackEngine::open(const QString& filePath) {
     if (!m_decoder->open(filePath))
         return false;
 
+    // YUV frames stay in the codec's own buffers at the decoded size; RGB
+    // frames are converted down to the preview size
+    const VideoInfo& vi = m_decoder->info();
+    const bool yuv = m_yuvOutput && m_decoder->hasYuvOutput();
+    const int depth = queueDepth(yuv ? QSize(vi.width, vi.height) : m_decoder->frameSize());
+    m_frameQueue = std::make_unique<FrameQueue>(depth);
+    // Queued frames, the one on screen and the one being composed
+    if (!yuv) m_decoder->framePool().reserve(depth + 2);
+
     // Start decode thread
     m_decodeThread = std::make_unique<DecodeThread>(m_decoder.get(), m_frameQueue.get());
+    m_decodeThread->setYuvOutput(yuv);
     m_decodeThread->start();
 
     return true;
@@ -101,7 +123,7 @@ void VideoPlaybackEngine::close() {
         m_decodeThread->wait(2000);
         m_decodeThread.reset();
     }
-    m_frameQueue->clear();
+    m_frameQueue.reset();
     m_decoder->close();
 }
 
@@ -109,10 +131,20 @@ bool VideoPlaybackEngine::isOpen() const {
     return m_decoder->isOpen();
 }
 
+int VideoPlaybackEngine::queueDepth(QSize frameSize) {
+    const qint64 frameBytes = qint64(frameSize.width()) * frameSize.height() * 4; // RGB32
+    if (frameBytes <= 0) return MaxQueueDepth;
+    return static_cast<int>(std::clamp<qint64>(ReadAheadBudget / frameBytes, MinQueueDepth, MaxQueueDepth));
+}
+
 TimedFrame VideoPlaybackEngine::nextFrame() {
     TimedFrame tf;
-    m_frameQueue->tryPop(tf);
-    return tf;
+    if (!m_decodeThread) return tf;
+    const int serial = m_decodeThread->serial();
+    while (m_frameQueue->tryPop(tf)) {
+        if (tf.serial == serial) return tf;
+    }
+    return TimedFrame{};
 }
 
 bool VideoPlaybackEngine::isFinished() const {
@@ -4,6 +4,7 @@
 #include <QThread>
 #include <QImage>
 #include <QMutex>
+#include <QSize>
 #include <QWaitCondition>
 #include <atomic>
 #include <memory>
@@ -12,7 +13,8 @@
 
 class VideoDecoder;
 
-// Background decode thread that sequentially reads frames into a FrameQueue.
+// Background decode thread that sequentially reads frames into a FrameQueue
+// (it is the ring's only producer; the UI thread is its only consumer).
 // Follows ffplay's architecture: sequential decode, seek only on request
 // (flush queue, seek to keyframe, resume sequential decode).
 class DecodeThread : public QThread {
@@ -22,7 +24,12 @@ public:
 
     void requestSeek(double seconds);
     void requestStop();
+    // Queue frames as YuvFrames where the codec allows; set before start()
+    void setYuvOutput(bool enabled) { m_yuvOutput = enabled; }
     bool isEof() const { return m_eof; }
+    // Bumped by every seek; frames are tagged with the serial they were
+    // decoded under
+    int serial() const { return m_serial; }
 
 protected:
     void run() override;
@@ -36,7 +43,9 @@ private:
     std::atomic<bool> m_stopRequested{false};
     std::atomic<bool> m_seekRequested{false};
     std::atomic<bool> m_eof{false};
+    std::atomic<int> m_serial{0};
     double m_seekTarget = 0.0;
+    bool m_yuvOutput = false;
 };
 
 // High-level playback engine: owns a VideoDecoder, DecodeThread, and FrameQueue.
@@ -44,6 +53,13 @@ private:
 class VideoPlaybackEngine : public QObject {
     Q_OBJECT
 public:
+    // Decoded frames buffered ahead: as many as fit the budget, so 1080p
+    // reads further ahead than 4K
+    static constexpr qint64 ReadAheadBudget = 256LL * 1024 * 1024; // bytes
+    static constexpr int MinQueueDepth = 3;
+    static constexpr int MaxQueueDepth = 16;
+    static int queueDepth(QSize frameSize);
+
     explicit VideoPlaybackEngine(QObject* parent = nullptr);
     ~VideoPlaybackEngine();
 
@@ -51,7 +67,15 @@ public:
     void close();
     bool isOpen() const;
 
-    // Pull the next decoded frame (non-blocking). Returns null QImage if none ready.
+    // Queue frames in the codec's YUV buffers for FrameCompositor instead
+    // of converting them to RGB32 on the decode thread; from the next open()
+    void setYuvOutput(bool enabled) { m_yuvOutput = enabled; }
+    // Decode for a preview at 1/factor size (VideoDecoder::setDownscale);
+    // from the next open()
+    void setDownscale(int factor) { m_decoder->setDownscale(factor); }
+
+    // Pull the next decoded frame (non-blocking). Returns a null frame if none ready.
+    // The image is the only reference to its pooled buffer; move it on.
     TimedFrame nextFrame();
 
     // True when decode thread finished all frames AND queue is empty.
@@ -71,4 +95,5 @@ private:
     std::unique_ptr<VideoDecoder> m_decoder;
     std::unique_ptr<FrameQueue> m_frameQueue;
     std::unique_ptr<DecodeThread> m_decodeThread;
+    bool m_yuvOutput = false;
 };
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+// A decoded frame left in the codec's 8-bit 4:2:0 buffers, shared rather
+// than copied (VideoDecoder::decodeNextFrameNative). FrameCompositor turns
+// it into ARGB on the canvas.
+struct YuvFrame {
+    enum class Layout { None, NV12, YUV420P };
+    enum class Matrix { BT601, BT709 };
+
+    Layout layout = Layout::None;
+    Matrix matrix = Matrix::BT709;
+    bool fullRange = false;             // 0-255 instead of 16-235
+    int width = 0;
+    int height = 0;
+    const uint8_t* planes[3] = {};      // Y, U (NV12: interleaved UV), V (YUV420P only)
+    int strides[3] = {};
+    std::shared_ptr<const void> owner;  // keeps the planes alive
+
+    bool isNull() const { return layout == Layout::None; }
+};
@@ -1,4 +1,5 @@
 #include "OverlayPanel.h"
+#include <algorithm>
 
 OverlayPanel::OverlayPanel(PanelType type, QObject* parent)
     : QObject(parent)
@@ -43,6 +44,25 @@ void OverlayPanel::paintValue(QPainter& painter, const QRect& rect,
     painter.drawText(valueRect, Qt::AlignLeft | Qt::AlignVCenter, text);
 }
 
+void OverlayPanel::paintDetail(QPainter& painter, const QRect& rect, const QString& text) {
+    QFont detailFont = m_config.font;
+    detailFont.setPointSize(std::max(7, m_config.font.pointSize() - 6));
+    painter.setFont(detailFont);
+    painter.setPen(QColor(180, 180, 180));
+
+    QRect detailRect = rect.adjusted(6, 4, -6, -rect.height() / 2);
+    painter.drawText(detailRect, Qt::AlignRight | Qt::AlignVCenter, text);
+}
+
+QString OverlayPanel::formatElapsed(double seconds) {
+    const int total = std::max(0, static_cast<int>(seconds));
+    const int h = total / 3600;
+    const int m = (total % 3600) / 60;
+    const int s = total % 60;
+    if (h > 0) return QString("%1:%2:%3").arg(h).arg(m, 2, 10, QChar('0')).arg(s, 2, 10, QChar('0'));
+    return QString("%1:%2").arg(m).arg(s, 2, 10, QChar('0'));
+}
+
 double OverlayPanel::drawSvgText(QPainter& painter, QPointF baselinePos, const QString& text, 
                                double fontSize, QColor color, Qt::Alignment align, bool isBold) {
     QFont font("Segoe UI", qMax(1, qRound(fontSize)));
@@ -8,6 +8,8 @@
 #include <QFont>
 #include "FitData.h"
 
+class FitTrack;
+
 enum class PanelType {
     Speed,
     HeartRate,
@@ -17,7 +19,9 @@ enum class PanelType {
     MiniMap,
     Distance,
     Lap,
-    Inclination
+    Inclination,
+    PeakEffort,
+    SegmentTimer
 };
 
 struct PanelConfig {
@@ -41,7 +45,7 @@ public:
     virtual ~OverlayPanel();
 
     virtual void paint(QPainter& painter, const QRect& panelRect,
-                       const FitRecord& record, const FitSession& session) = 0;
+                       const FitRecord& record, const FitTrack& track) = 0;
 
     virtual QString defaultLabel() const = 0;
     virtual PanelType panelType() const { return m_config.type; }
@@ -57,6 +61,10 @@ protected:
     void paintLabel(QPainter& painter, const QRect& rect, const QString& label);
     void paintValue(QPainter& painter, const QRect& rect,
                     const QString& value, const QString& unit);
+    // Small secondary text (running stats) on the label row, right-aligned
+    void paintDetail(QPainter& painter, const QRect& rect, const QString& text);
+    // m:ss, or h:mm:ss from an hour on
+    static QString formatElapsed(double seconds);
 
     // Modern SVG-styled helpers
     double drawSvgText(QPainter& painter, QPointF baselinePos, const QString& text, 
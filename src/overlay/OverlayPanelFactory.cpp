@@ -8,6 +8,8 @@
 #include "DistancePanel.h"
 #include "LapPanel.h"
 #include "InclinationPanel.h"
+#include "PeakEffortPanel.h"
+#include "SegmentTimerPanel.h"
 
 std::unique_ptr<OverlayPanel> OverlayPanelFactory::create(PanelType type, QObject* parent) {
     switch (type) {
@@ -20,6 +22,8 @@ std::unique_ptr<OverlayPanel> OverlayPanelFactory::create(PanelType type, QObjec
         case PanelType::Distance:    return std::make_unique<DistancePanel>(parent);
         case PanelType::Lap:         return std::make_unique<LapPanel>(parent);
         case PanelType::Inclination: return std::make_unique<InclinationPanel>(parent);
+        case PanelType::PeakEffort:  return std::make_unique<PeakEffortPanel>(parent);
+        case PanelType::SegmentTimer: return std::make_unique<SegmentTimerPanel>(parent);
     }
     return nullptr;
 }
@@ -5,16 +5,20 @@
 OverlayRenderer::OverlayRenderer(QObject* parent) : QObject(parent) {}
 OverlayRenderer::~OverlayRenderer() = default;
 
-void OverlayRenderer::render(QImage& frame, const FitRecord& record, const FitSession& session) {
+void OverlayRenderer::render(QImage& frame, const FitRecord& record, const FitTrack& track, double scale) {
     QPainter painter(&frame);
     painter.setRenderHint(QPainter::Antialiasing, true);
     painter.setRenderHint(QPainter::TextAntialiasing, true);
 
+    const int width = qRound(frame.width() / scale);
+    const int height = qRound(frame.height() / scale);
+    if (scale != 1.0) painter.scale(scale, scale);
+
     for (auto& panel : m_panels) {
         if (!panel->config().visible) continue;
 
-        QRect rect = panel->resolveRect(frame.width(), frame.height());
-        panel->paint(painter, rect, record, session);
+        QRect rect = panel->resolveRect(width, height);
+        panel->paint(painter, rect, record, track);
     }
 
     painter.end();
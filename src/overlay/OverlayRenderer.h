@@ -13,7 +13,10 @@ public:
     explicit OverlayRenderer(QObject* parent = nullptr);
     ~OverlayRenderer();
 
-    void render(QImage& frame, const FitRecord& record, const FitSession& session);
+    // scale is frame pixels per output pixel; below 1 (a reduced preview)
+    // panels are laid out at output size and drawn scaled down, so text
+    // and margins keep their proportions
+    void render(QImage& frame, const FitRecord& record, const FitTrack& track, double scale = 1.0);
 
     void addPanel(std::unique_ptr<OverlayPanel> panel);
     void removePanel(int index);
@@ -8,7 +8,7 @@ CadencePanel::CadencePanel(QObject* parent) : OverlayPanel(PanelType::Cadence, p
 }
 
 void CadencePanel::paint(QPainter& painter, const QRect& rect,
-                          const FitRecord& record, const FitSession&) {
+                          const FitRecord& record, const FitTrack&) {
     if (!record.hasCadence) return;
     paintBackground(painter, rect);
     paintLabel(painter, rect, m_config.label);
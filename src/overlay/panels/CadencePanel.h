@@ -5,6 +5,6 @@ class CadencePanel : public OverlayPanel {
     Q_OBJECT
 public:
     explicit CadencePanel(QObject* parent = nullptr);
-    void paint(QPainter& painter, const QRect& rect, const FitRecord& record, const FitSession& session) override;
+    void paint(QPainter& painter, const QRect& rect, const FitRecord& record, const FitTrack& track) override;
     QString defaultLabel() const override { return "CADENCE"; }
 };
@@ -9,7 +9,7 @@ DistancePanel::DistancePanel(QObject* parent) : OverlayPanel(PanelType::Distance
 }
 
 void DistancePanel::paint(QPainter& painter, const QRect& rect,
-                           const FitRecord& record, const FitSession&) {
+                           const FitRecord& record, const FitTrack&) {
     double scale = rect.height() / 100.0;
     QPointF base = rect.topLeft() + QPointF(0, 64 * scale);
     
@@ -1,5 +1,7 @@
 #include "ElevationPanel.h"
+#include "FitTrack.h"
 #include <QPainterPath>
+#include <algorithm>
 
 ElevationPanel::ElevationPanel(QObject* parent) : OverlayPanel(PanelType::Elevation, parent) {
     m_config.label = defaultLabel();
@@ -10,7 +12,7 @@ ElevationPanel::ElevationPanel(QObject* parent) : OverlayPanel(PanelType::Elevat
 }
 
 void ElevationPanel::paint(QPainter& painter, const QRect& rect,
-                           const FitRecord& record, const FitSession& session) {
+                           const FitRecord& record, const FitTrack& track) {
     // Split rect into text region (top ~35%) and graph region (bottom ~65%)
     int textHeight = static_cast<int>(rect.height() * 0.35);
     QRect textRect(rect.left(), rect.top(), rect.width(), textHeight);
@@ -30,13 +32,10 @@ void ElevationPanel::paint(QPainter& painter, const QRect& rect,
     // Determine bounds
     float minAlt = -100;
     float maxAlt = 10000;
-    if (session.records.size() > 1) {
-        minAlt = 99999;
-        maxAlt = -99999;
-        for(const auto& r : session.records) {
-            if(r.altitude < minAlt) minAlt = r.altitude;
-            if(r.altitude > maxAlt) maxAlt = r.altitude;
-        }
+    if (track.recordCount() > 1) {
+        const FitMinMax range = track.pyramid().overall(FitChannel::Altitude);
+        minAlt = range.min;
+        maxAlt = range.max;
         if (maxAlt - minAlt < 10) maxAlt = minAlt + 10;
     }
 
@@ -60,17 +59,28 @@ void ElevationPanel::paint(QPainter& painter, const QRect& rect,
     }
 
     // --- Elevation Profile Graph section (uses graphRect, full width, pushed down a bit) ---
-    if (session.records.empty()) return;
+    if (track.isEmpty()) return;
 
     QRectF gRect(graphRect.left() + 10, graphRect.top() + 15,
                  graphRect.width() - 20, graphRect.height() - 20);
 
     if (gRect.width() <= 0 || gRect.height() <= 0) return;
 
-    float maxDist = session.totalDistance > 0 ? session.totalDistance : 0.01f;
-    if (session.records.back().distance > maxDist) maxDist = session.records.back().distance;
+    // The monotonic axis ignores distance dropouts at the end of the track
+    float maxDist = std::max(track.session().totalDistance, track.distanceIndex().total());
     if (maxDist <= 0) maxDist = 0.01f;
 
+    // One bucket per pixel column; the profile follows each column's highest
+    // point, so the cost does not grow with the record count
+    const size_t columns = static_cast<size_t>(std::max(1.0, gRect.width()));
+    m_profile.resize(columns);
+    track.pyramid().buckets(FitChannel::Altitude, FitAxis::Distance, 0.0, maxDist,
+                            m_profile.data(), columns);
+    const double bucketWidth = gRect.width() / static_cast<double>(columns);
+    // The current position on the same monotonic axis the buckets use
+    const float currentDistance = track.distanceIndex().at(track.locate(record.timestamp));
+    const double currentColumn = currentDistance / maxDist * static_cast<double>(columns);
+
     QPainterPath fillPath;
     QPainterPath topPath;
     QPainterPath remainingPath;
@@ -81,12 +91,13 @@ void ElevationPanel::paint(QPainter& painter, const QRect& rect,
     bool remStarted = false;
     QPointF lastPoint(gRect.left(), gRect.bottom());
 
-    for (const auto& r : session.records) {
-        double px = gRect.left() + gRect.width() * (r.distance / maxDist);
-        double py = gRect.bottom() - gRect.height() * ((r.altitude - minAlt) / (maxAlt - minAlt));
+    for (size_t i = 0; i < columns; ++i) {
+        if (m_profile[i].empty()) continue;
+        double px = gRect.left() + bucketWidth * (static_cast<double>(i) + 0.5);
+        double py = gRect.bottom() - gRect.height() * ((m_profile[i].max - minAlt) / (maxAlt - minAlt));
         QPointF pt(px, py);
 
-        if (r.timestamp <= record.timestamp) {
+        if (static_cast<double>(i) < currentColumn) {
             fillPath.lineTo(pt);
             if (!topStarted) {
                 topPath.moveTo(pt);
@@ -1,10 +1,15 @@
 #pragma once
 #include "OverlayPanel.h"
+#include "FitPyramid.h"
+#include <vector>
 
 class ElevationPanel : public OverlayPanel {
     Q_OBJECT
 public:
     explicit ElevationPanel(QObject* parent = nullptr);
-    void paint(QPainter& painter, const QRect& rect, const FitRecord& record, const FitSession& session) override;
+    void paint(QPainter& painter, const QRect& rect, const FitRecord& record, const FitTrack& track) override;
     QString defaultLabel() const override { return "ELEVATION"; }
+
+private:
+    std::vector<FitMinMax> m_profile; // per-column altitude, reused across frames
 };
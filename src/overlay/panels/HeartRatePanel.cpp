@@ -1,4 +1,6 @@
 #include "HeartRatePanel.h"
+#include "FitDerived.h"
+#include "FitTrack.h"
 
 HeartRatePanel::HeartRatePanel(QObject* parent) : OverlayPanel(PanelType::HeartRate, parent) {
     m_config.label = defaultLabel();
@@ -8,8 +10,21 @@ HeartRatePanel::HeartRatePanel(QObject* parent) : OverlayPanel(PanelType::HeartR
     m_config.height = 0.10;
 }
 
+void HeartRatePanel::updateZones(const FitTrack& track) {
+    // The zone max is a derived setting, so the generation covers it too
+    if (m_zoneGeneration == track.generation()) return;
+    m_zoneGeneration = track.generation();
+
+    float maxHr = track.zoneMaxHeartRate();
+    if (!(maxHr > 0.0f)) {
+        m_zones.clear();
+        return;
+    }
+    m_zones.build(track.columns(), FitChannel::HeartRate, heartRateZoneEdges(maxHr));
+}
+
 void HeartRatePanel::paint(QPainter& painter, const QRect& rect,
-                            const FitRecord& record, const FitSession&) {
+                            const FitRecord& record, const FitTrack& track) {
     if (!record.hasHeartRate) return;
     double scale = rect.height() / 100.0;
     QPointF base = rect.topLeft() + QPointF(0, 64 * scale);
@@ -18,5 +33,21 @@ void HeartRatePanel::paint(QPainter& painter, const QRect& rect,
     
     double valW = drawSvgText(painter, base, hrStr, 64 * scale, Qt::white, Qt::AlignLeft, true);
     drawSvgText(painter, base + QPointF(valW + 15 * scale, 0), "Bpm", 36 * scale, Qt::white, Qt::AlignLeft, true);
-    drawSvgText(painter, base + QPointF(0, 35 * scale), m_config.label, 22 * scale, QColor(221, 221, 221), Qt::AlignLeft, false);
+    double labelW = drawSvgText(painter, base + QPointF(0, 35 * scale), m_config.label, 22 * scale, QColor(221, 221, 221), Qt::AlignLeft, false);
+
+    // Current zone with the time spent in it so far, and the average so far
+    updateZones(track);
+    QString detail;
+    if (!m_zones.empty()) {
+        size_t zone = m_zones.bandOf(record.heartRate);
+        double inZone = m_zones.seconds(zone, track.locate(track.startTime()), track.locate(record.timestamp));
+        detail = QString("Z%1 %2").arg(static_cast<int>(zone) + 1).arg(formatElapsed(inZone));
+    }
+    FitRangeStats ride = track.rangeStats(FitChannel::HeartRate, track.startTime(), record.timestamp);
+    if (ride.duration > 0.0) {
+        if (!detail.isEmpty()) detail += "  ";
+        detail += QString("AVG %1").arg(qRound(ride.average()));
+    }
+    if (!detail.isEmpty())
+        drawSvgText(painter, base + QPointF(labelW + 12 * scale, 35 * scale), detail, 18 * scale, QColor(200, 200, 200), Qt::AlignLeft, false);
 }
@@ -1,10 +1,18 @@
 #pragma once
 #include "OverlayPanel.h"
+#include "FitAnalytics.h"
 
 class HeartRatePanel : public OverlayPanel {
     Q_OBJECT
 public:
     explicit HeartRatePanel(QObject* parent = nullptr);
-    void paint(QPainter& painter, const QRect& rect, const FitRecord& record, const FitSession& session) override;
+    void paint(QPainter& painter, const QRect& rect, const FitRecord& record, const FitTrack& track) override;
     QString defaultLabel() const override { return "HR"; }
+
+private:
+    // Same zones as the track's HeartRateZone channel
+    void updateZones(const FitTrack& track);
+
+    FitBandIndex m_zones;
+    uint64_t m_zoneGeneration = 0;  // FitTrack::generation() the zones were built for
 };
@@ -11,7 +11,7 @@ InclinationPanel::InclinationPanel(QObject* parent) : OverlayPanel(PanelType::In
 }
 
 void InclinationPanel::paint(QPainter& painter, const QRect& rect,
-                             const FitRecord& record, const FitSession&) {
+                             const FitRecord& record, const FitTrack&) {
     double scale = rect.height() / 100.0;
     QPointF base = rect.topRight() + QPointF(-10 * scale, 64 * scale);
     
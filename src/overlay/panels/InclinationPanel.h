@@ -6,6 +6,6 @@ class InclinationPanel : public OverlayPanel {
 public:
     explicit InclinationPanel(QObject* parent = nullptr);
     void paint(QPainter& painter, const QRect& panelRect,
-               const FitRecord& record, const FitSession& session) override;
+               const FitRecord& record, const FitTrack& track) override;
     QString defaultLabel() const override { return "Inclination"; }
 };
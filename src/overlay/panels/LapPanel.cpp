@@ -1,4 +1,5 @@
 #include "LapPanel.h"
+#include "FitTrack.h"
 
 LapPanel::LapPanel(QObject* parent) : OverlayPanel(PanelType::Lap, parent) {
     m_config.label = defaultLabel();
@@ -7,22 +8,24 @@ LapPanel::LapPanel(QObject* parent) : OverlayPanel(PanelType::Lap, parent) {
 }
 
 void LapPanel::paint(QPainter& painter, const QRect& rect,
-                      const FitRecord& record, const FitSession& session) {
-    // Find current lap
-    int lapIdx = -1;
-    for (int i = 0; i < static_cast<int>(session.laps.size()); ++i) {
-        if (record.timestamp >= session.laps[i].startTime &&
-            record.timestamp <= session.laps[i].endTime) {
-            lapIdx = i;
-            break;
-        }
-    }
+                      const FitRecord& record, const FitTrack& track) {
+    // Find current lap, starting from the one shown last frame
+    int lapIdx = track.lapIndex().find(record.timestamp, m_lastLap);
+    m_lastLap = lapIdx;
 
     paintBackground(painter, rect);
     paintLabel(painter, rect, m_config.label);
 
     if (lapIdx >= 0) {
         paintValue(painter, rect, QString::number(lapIdx + 1), "");
+
+        // Time into the lap and its average speed so far
+        const FitLap& lap = track.laps()[lapIdx];
+        QString detail = formatElapsed(record.timestamp - lap.startTime);
+        FitRangeStats speed = track.rangeStats(FitChannel::Speed, lap.startTime, record.timestamp);
+        if (speed.duration > 0.0)
+            detail += QString("  %1 km/h").arg(speed.average() * 3.6, 0, 'f', 1);
+        paintDetail(painter, rect, detail);
     } else {
         paintValue(painter, rect, "--", "");
     }
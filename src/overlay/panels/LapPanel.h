@@ -5,6 +5,9 @@ class LapPanel : public OverlayPanel {
     Q_OBJECT
 public:
     explicit LapPanel(QObject* parent = nullptr);
-    void paint(QPainter& painter, const QRect& rect, const FitRecord& record, const FitSession& session) override;
+    void paint(QPainter& painter, const QRect& rect, const FitRecord& record, const FitTrack& track) override;
     QString defaultLabel() const override { return "LAP"; }
+
+private:
+    int m_lastLap = -1; // lookup hint for the next frame
 };
@@ -1,5 +1,7 @@
 #include "MiniMapPanel.h"
+#include "FitTrack.h"
 #include <QPainterPath>
+#include <algorithm>
 
 MiniMapPanel::MiniMapPanel(QObject* parent) : OverlayPanel(PanelType::MiniMap, parent) {
     m_config.label = defaultLabel();
@@ -10,11 +12,11 @@ MiniMapPanel::MiniMapPanel(QObject* parent) : OverlayPanel(PanelType::MiniMap, p
 }
 
 void MiniMapPanel::paint(QPainter& painter, const QRect& rect,
-                          const FitRecord& record, const FitSession& session) {
+                          const FitRecord& record, const FitTrack& track) {
     // Optional background
     // paintBackground(painter, rect);
 
-    if (session.records.empty() || !record.hasGps) return;
+    if (track.isEmpty() || !record.hasGps) return;
 
     // Use a square bounding box centered in rect
     int side = std::min(rect.width(), rect.height());
@@ -49,53 +51,51 @@ void MiniMapPanel::paint(QPainter& painter, const QRect& rect,
         return QPointF(x, y);
     };
 
-    QPainterPath completedPath;
-    QPainterPath remainingPath;
-
-    bool needMoveCompleted = true;
-    bool needMoveRemaining = true;
-    QPointF lastCompletedPoint;
-
-    for (const auto& r : session.records) {
-        if (!r.hasGps) continue;
+    // Simplified path at about half a pixel of error, and only the stretches
+    // the spatial index reports near the view, so the work per frame follows
+    // the screen, not the track
+    const FitPolylineLod& polyline = track.polyline();
+    if (polyline.empty()) return;
+    const double metersPerPixel = metersPerLat / mapScale;
+    const FitPolylineLod::Level& level = polyline.levelFor(metersPerPixel * 0.5);
+
+    const FitGeoBox view{record.latitude - halfLatRange * 2.0, record.latitude + halfLatRange * 2.0,
+                         record.longitude - halfLonRange * 2.0, record.longitude + halfLonRange * 2.0};
+    level.visibleRanges(view, m_ranges);
+
+    const FitColumns& cols = track.columns();
+    auto vertexPoint = [&](size_t v) {
+        const size_t i = level.vertices[v];
+        return toPoint(cols.latitude[i], cols.longitude[i]);
+    };
 
-        // Optimization: skip points outside the visual area (with a small margin)
-        bool outOfBounds = std::abs(r.latitude - record.latitude) > halfLatRange * 2.0 ||
-                           std::abs(r.longitude - record.longitude) > halfLonRange * 2.0;
+    // The current position lies on the segment ending at vertex `split`;
+    // the completed path ends there and the remaining path starts there
+    const size_t split = level.splitAt(record.timestamp, cols);
+    const bool onPath = split > 0 && split < level.vertices.size();
+    const QPointF current = toPoint(record.latitude, record.longitude);
 
-        if (outOfBounds) {
-            // Next in-bounds point must start a new sub-path
-            needMoveCompleted = true;
-            needMoveRemaining = true;
-            if (r.timestamp <= record.timestamp) {
-                lastCompletedPoint = toPoint(r.latitude, r.longitude);
-            }
-            continue;
+    QPainterPath completedPath;
+    QPainterPath remainingPath;
+    for (const FitPolylineLod::Range& range : m_ranges) {
+        if (range.first < split) {
+            const size_t end = std::min(range.last + 1, split);
+            completedPath.moveTo(vertexPoint(range.first));
+            for (size_t v = range.first + 1; v < end; ++v)
+                completedPath.lineTo(vertexPoint(v));
+            if (onPath && split <= range.last + 1)
+                completedPath.lineTo(current);
         }
-
-        QPointF p = toPoint(r.latitude, r.longitude);
-
-        if (r.timestamp <= record.timestamp) {
-            if (needMoveCompleted) {
-                completedPath.moveTo(p);
-                needMoveCompleted = false;
-            } else {
-                completedPath.lineTo(p);
-            }
-            lastCompletedPoint = p;
-        } else {
-            if (needMoveRemaining) {
-                // Connect from last completed point if this is the first remaining segment
-                if (!lastCompletedPoint.isNull() && remainingPath.isEmpty()) {
-                    remainingPath.moveTo(lastCompletedPoint);
-                    remainingPath.lineTo(p);
-                } else {
-                    remainingPath.moveTo(p);
-                }
-                needMoveRemaining = false;
+        if (range.last >= split) {
+            const size_t start = std::max(range.first, split);
+            if (onPath && start == split) {
+                remainingPath.moveTo(current);
+                remainingPath.lineTo(vertexPoint(start));
             } else {
-                remainingPath.lineTo(p);
+                remainingPath.moveTo(vertexPoint(start));
             }
+            for (size_t v = start + 1; v <= range.last; ++v)
+                remainingPath.lineTo(vertexPoint(v));
         }
     }
 
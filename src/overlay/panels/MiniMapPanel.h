@@ -1,10 +1,15 @@
 #pragma once
 #include "OverlayPanel.h"
+#include "FitPolylineLod.h"
+#include <vector>
 
 class MiniMapPanel : public OverlayPanel {
     Q_OBJECT
 public:
     explicit MiniMapPanel(QObject* parent = nullptr);
-    void paint(QPainter& painter, const QRect& rect, const FitRecord& record, const FitSession& session) override;
+    void paint(QPainter& painter, const QRect& rect, const FitRecord& record, const FitTrack& track) override;
     QString defaultLabel() const override { return "MAP"; }
+
+private:
+    std::vector<FitPolylineLod::Range> m_ranges; // visible stretches, reused across frames
 };
@@ -0,0 +1,50 @@
+#include "PeakEffortPanel.h"
+#include "FitTrack.h"
+
+namespace {
+
+struct Duration {
+    double seconds;
+    const char* name;
+};
+
+const Duration kDurations[] = {{5, "5s"}, {60, "1m"}, {300, "5m"}, {1200, "20m"}};
+
+} // namespace
+
+PeakEffortPanel::PeakEffortPanel(QObject* parent) : OverlayPanel(PanelType::PeakEffort, parent) {
+    m_config.label = defaultLabel();
+    m_config.x = 0.86;
+    m_config.y = 0.05;
+    m_config.width = 0.11;
+    m_config.height = 0.16;
+}
+
+void PeakEffortPanel::paint(QPainter& painter, const QRect& rect,
+                             const FitRecord& record, const FitTrack& track) {
+    const FitPeakCurves& peaks = track.peaks();
+    FitChannel channel = FitChannel::Power;
+    QString unit = "W";
+    if (peaks.curve(channel).empty()) {
+        channel = FitChannel::HeartRate;
+        unit = "Bpm";
+    }
+    if (peaks.curve(channel).empty()) return;
+
+    double scale = rect.height() / 160.0;
+    QPointF base = rect.topLeft() + QPointF(0, 24 * scale);
+    drawSvgText(painter, base, m_config.label + " " + unit.toUpper(), 22 * scale, QColor(221, 221, 221), Qt::AlignLeft, false);
+
+    for (const Duration& d : kDurations) {
+        FitPeak peak = peaks.best(channel, d.seconds);
+        if (peak.empty() || peak.duration != d.seconds) continue;
+        base += QPointF(0, 32 * scale);
+
+        // Highlight an effort while its best window is on screen
+        bool now = record.timestamp >= peak.startTime && record.timestamp <= peak.startTime + peak.duration;
+        QColor color = now ? QColor(255, 200, 50) : Qt::white;
+        drawSvgText(painter, base, d.name, 22 * scale, QColor(200, 200, 200), Qt::AlignLeft, false);
+        drawSvgText(painter, base + QPointF(rect.width(), 0), QString::number(qRound(peak.value)),
+                    28 * scale, color, Qt::AlignRight, true);
+    }
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include "OverlayPanel.h"
+
+// Best power (or heart rate without a power meter) over a few standard
+// durations, marking the ones whose best window is being ridden right now
+class PeakEffortPanel : public OverlayPanel {
+    Q_OBJECT
+public:
+    explicit PeakEffortPanel(QObject* parent = nullptr);
+    void paint(QPainter& painter, const QRect& rect, const FitRecord& record, const FitTrack& track) override;
+    QString defaultLabel() const override { return "PEAK"; }
+};
@@ -1,4 +1,5 @@
 #include "PowerPanel.h"
+#include "FitTrack.h"
 
 PowerPanel::PowerPanel(QObject* parent) : OverlayPanel(PanelType::Power, parent) {
     m_config.label = defaultLabel();
@@ -8,9 +9,31 @@ PowerPanel::PowerPanel(QObject* parent) : OverlayPanel(PanelType::Power, parent)
 }
 
 void PowerPanel::paint(QPainter& painter, const QRect& rect,
-                        const FitRecord& record, const FitSession&) {
+                        const FitRecord& record, const FitTrack& track) {
     if (!record.hasPower) return;
     paintBackground(painter, rect);
     paintLabel(painter, rect, m_config.label);
     paintValue(painter, rect, QString::number(static_cast<int>(record.power)), "W");
+
+    // Average and normalized power so far, and peak of the current lap
+    QString detail;
+    FitRangeStats ride = track.rangeStats(FitChannel::Power, track.startTime(), record.timestamp);
+    if (ride.duration > 0.0)
+        detail = QString("AVG %1").arg(qRound(ride.average()));
+    float np = track.valueAtTime(FitChannel::NormalizedPower, record.timestamp);
+    if (np > 0.0f) {
+        if (!detail.isEmpty()) detail += "  ";
+        detail += QString("NP %1").arg(qRound(np));
+    }
+    int lapIdx = track.findLapAtTime(record.timestamp, m_lastLap);
+    m_lastLap = lapIdx;
+    if (lapIdx >= 0) {
+        const FitLap& lap = track.laps()[lapIdx];
+        FitRangeStats lapStats = track.rangeStats(FitChannel::Power, lap.startTime, record.timestamp);
+        if (!lapStats.extremes.empty()) {
+            if (!detail.isEmpty()) detail += "  ";
+            detail += QString("LAP MAX %1").arg(qRound(lapStats.extremes.max));
+        }
+    }
+    if (!detail.isEmpty()) paintDetail(painter, rect, detail);
 }
@@ -5,6 +5,9 @@ class PowerPanel : public OverlayPanel {
     Q_OBJECT
 public:
     explicit PowerPanel(QObject* parent = nullptr);
-    void paint(QPainter& painter, const QRect& rect, const FitRecord& record, const FitSession& session) override;
+    void paint(QPainter& painter, const QRect& rect, const FitRecord& record, const FitTrack& track) override;
     QString defaultLabel() const override { return "POWER"; }
+
+private:
+    int m_lastLap = -1; // lookup hint for the next frame
 };
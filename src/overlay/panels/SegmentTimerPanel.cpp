@@ -0,0 +1,44 @@
+#include "SegmentTimerPanel.h"
+#include "FitTrack.h"
+#include <algorithm>
+
+SegmentTimerPanel::SegmentTimerPanel(QObject* parent) : OverlayPanel(PanelType::SegmentTimer, parent) {
+    m_config.label = defaultLabel();
+    m_config.x = 0.40;
+    m_config.y = 0.02;
+    m_config.width = 0.20;
+}
+
+void SegmentTimerPanel::updateEfforts(const FitTrack& track) {
+    std::shared_ptr<const FitSegmentLibrary> library = FitSegmentLibrary::current();
+    if (m_effortGeneration == track.generation() && m_library == library) return;
+    m_effortGeneration = track.generation();
+    m_library = std::move(library);
+    m_efforts = m_library->match(track);
+}
+
+void SegmentTimerPanel::paint(QPainter& painter, const QRect& rect,
+                              const FitRecord& record, const FitTrack& track) {
+    updateEfforts(track);
+
+    // Latest effort under way (overlapping segments: the one started last)
+    const FitSegmentEffort* effort = nullptr;
+    for (const FitSegmentEffort& e : m_efforts) {
+        if (e.startTime > record.timestamp) break;
+        if (record.timestamp <= e.endTime) effort = &e;
+    }
+    if (!effort) return;
+
+    paintBackground(painter, rect);
+    paintLabel(painter, rect, effort->name.isEmpty() ? m_config.label : effort->name.toUpper());
+    paintValue(painter, rect, formatElapsed(record.timestamp - effort->startTime), "");
+
+    const FitDistanceIndex& distance = track.distanceIndex();
+    if (!distance.empty()) {
+        // Both ends on the monotonic axis; the record's own distance can
+        // lag it after a dropout
+        const float here = distance.at(track.locate(record.timestamp));
+        float left = std::max(0.0f, distance.at(effort->last) - here);
+        paintDetail(painter, rect, QString("%1 km to go").arg(left / 1000.0f, 0, 'f', 1));
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "OverlayPanel.h"
+#include "FitSegments.h"
+
+// Running time on the segment being ridden (see FitSegmentLibrary), with the
+// distance left to its end; empty between segments
+class SegmentTimerPanel : public OverlayPanel {
+    Q_OBJECT
+public:
+    explicit SegmentTimerPanel(QObject* parent = nullptr);
+    void paint(QPainter& painter, const QRect& rect, const FitRecord& record, const FitTrack& track) override;
+    QString defaultLabel() const override { return "SEGMENT"; }
+
+private:
+    // Matches the current library against the track once per track
+    void updateEfforts(const FitTrack& track);
+
+    std::vector<FitSegmentEffort> m_efforts;
+    std::shared_ptr<const FitSegmentLibrary> m_library; // library the efforts came from
+    uint64_t m_effortGeneration = 0; // FitTrack::generation() the efforts were matched on
+};
@@ -11,7 +11,7 @@ SpeedPanel::SpeedPanel(QObject* parent) : OverlayPanel(PanelType::Speed, parent)
 }
 
 void SpeedPanel::paint(QPainter& painter, const QRect& rect,
-                        const FitRecord& record, const FitSession&) {
+                        const FitRecord& record, const FitTrack&) {
     double scale = rect.height() / 340.0;
     QPointF center(rect.center().x(), rect.top() + 170 * scale);
     
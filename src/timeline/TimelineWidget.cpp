@@ -3,7 +3,7 @@
 #include "Track.h"
 #include "TimeUtil.h"
 #include "MediaProbe.h"
-#include "FitParser.h"
+#include "FitNativeDecoder.h"
 #include <QPainter>
 #include <QMouseEvent>
 #include <QKeyEvent>
@@ -209,14 +209,17 @@ void TimelineWidget::addClipFromFile(const QString& path) {
     double duration = 5.0; // default for images
 
     if (isFit) {
-        FitParser parser;
-        if (!parser.parse(path)) {
-            return; // failed to parse
+        // Placement only needs the summary; records are decoded when the
+        // overlay first needs them
+        FitNativeDecoder decoder;
+        FitProbeInfo info;
+        if (!decoder.probe(path, info)) {
+            return; // not a readable FIT file
         }
-        absTimestamp = parser.session().startTime;
-        duration = parser.session().totalElapsedTime;
+        absTimestamp = info.startTime;
+        duration = info.totalElapsedTime;
         if (duration <= 0.0) {
-            duration = parser.session().endTime - parser.session().startTime;
+            duration = info.endTime - info.startTime;
         }
         if (duration <= 0.0) duration = 1.0;
     } else {
@@ -466,6 +469,8 @@ void TimelineWidget::paintTracks(QPainter& painter, const QRect& rect) {
                                  clip.displayName);
             }
 
+            paintMarkers(painter, clipRect, clip);
+
             // Lock indicator
             if (clip.locked) {
                 painter.setPen(QColor(200, 200, 200));
@@ -484,6 +489,40 @@ void TimelineWidget::paintTracks(QPainter& painter, const QRect& rect) {
     }
 }
 
+void TimelineWidget::paintMarkers(QPainter& painter, const QRect& clipRect, const Clip& clip) {
+    auto it = m_clipMarkers.find(clip.sourcePath);
+    if (it == m_clipMarkers.end()) return;
+
+    double pps = m_model->zoom();
+    QFont markerFont("Arial", 7);
+    painter.setFont(markerFont);
+    for (const TimelineMarker& marker : it->second) {
+        double start = marker.absoluteTime - clip.absoluteStartTime;
+        if (start + marker.duration < 0.0 || start > clip.duration()) continue;
+        int mx = clipRect.left() + static_cast<int>(start * pps);
+        int mw = std::max(static_cast<int>(marker.duration * pps), 2);
+        QRect markerRect = QRect(mx, clipRect.bottom() - 10, mw, 9).intersected(clipRect);
+        if (markerRect.isEmpty()) continue;
+
+        painter.fillRect(markerRect, QColor(255, 200, 50, 150));
+        if (markerRect.width() > 40) {
+            painter.setPen(QColor(30, 30, 30));
+            painter.drawText(markerRect.adjusted(2, 0, -2, 0), Qt::AlignVCenter | Qt::TextSingleLine, marker.label);
+        }
+    }
+}
+
+void TimelineWidget::setClipMarkers(const QString& sourcePath, std::vector<TimelineMarker> markers) {
+    if (markers.empty()) m_clipMarkers.erase(sourcePath);
+    else m_clipMarkers[sourcePath] = std::move(markers);
+    update();
+}
+
+void TimelineWidget::clearClipMarkers() {
+    m_clipMarkers.clear();
+    update();
+}
+
 void TimelineWidget::paintPlayhead(QPainter& painter, const QRect& rect) {
     int x = timeToX(m_model->playheadPosition());
     if (x < rect.left() || x > rect.right()) return;
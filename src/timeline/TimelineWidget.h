@@ -3,9 +3,20 @@
 #include <QWidget>
 #include <QSet>
 #include <QPair>
+#include <QString>
+#include <map>
 #include <memory>
+#include <vector>
 
 class TimelineModel;
+struct Clip;
+
+// Highlighted span of a clip's source, e.g. a best effort in a FIT file
+struct TimelineMarker {
+    double absoluteTime = 0.0;  // Unix timestamp of the span start
+    double duration = 0.0;      // seconds
+    QString label;
+};
 
 class TimelineWidget : public QWidget {
     Q_OBJECT
@@ -19,6 +30,10 @@ public:
     void deleteSelectedClips();
     void zoomToFitAll();
 
+    // Markers drawn over every clip of sourcePath, replacing earlier ones
+    void setClipMarkers(const QString& sourcePath, std::vector<TimelineMarker> markers);
+    void clearClipMarkers();
+
 signals:
     void playheadScrubbed(double seconds);
     void seekRequested(double seconds);
@@ -44,6 +59,7 @@ private:
     void paintRuler(QPainter& painter, const QRect& rect);
     void paintTracks(QPainter& painter, const QRect& rect);
     void paintPlayhead(QPainter& painter, const QRect& rect);
+    void paintMarkers(QPainter& painter, const QRect& clipRect, const Clip& clip);
 
     double xToTime(int x) const;
     int timeToX(double time) const;
@@ -64,6 +80,8 @@ private:
     // Playhead scrub state
     bool m_scrubbing = false;
 
+    std::map<QString, std::vector<TimelineMarker>> m_clipMarkers; // by source path
+
     // Clip selection: set of (trackIndex, clipIndex) pairs
     QSet<QPair<int,int>> m_selectedClips;
 
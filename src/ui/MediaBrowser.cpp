@@ -1,6 +1,7 @@
 #include "MediaBrowser.h"
 #include "VideoDecoder.h"
-#include "FitParser.h"
+#include "FitSessionRegistry.h"
+#include "FitNativeDecoder.h"
 #include "FitData.h"
 #include <QFileDialog>
 #include <QFileInfo>
@@ -13,6 +14,31 @@
 #include <cmath>
 #include <algorithm>
 
+namespace {
+
+// "12.3 km  1:02:03" caption shared by the FIT thumbnails
+QString fitSummaryText(double distanceMeters, double elapsedSeconds) {
+    double totalDistKm = distanceMeters / 1000.0;
+    QString distStr;
+    if (totalDistKm >= 1.0)
+        distStr = QString("%1 km").arg(totalDistKm, 0, 'f', 1);
+    else
+        distStr = QString("%1 m").arg(static_cast<int>(distanceMeters));
+
+    // Duration in hh:mm:ss
+    int totalSec = static_cast<int>(elapsedSeconds);
+    int h = totalSec / 3600;
+    int m = (totalSec % 3600) / 60;
+    int s = totalSec % 60;
+    QString durStr;
+    if (h > 0) durStr = QString("%1:%2:%3").arg(h).arg(m, 2, 10, QChar('0')).arg(s, 2, 10, QChar('0'));
+    else durStr = QString("%1:%2").arg(m).arg(s, 2, 10, QChar('0'));
+
+    return distStr + "  " + durStr;
+}
+
+} // namespace
+
 void MediaBrowserListWidget::startDrag(Qt::DropActions /*supportedActions*/) {
     QListWidgetItem* item = currentItem();
     if (!item) return;
@@ -163,25 +189,46 @@ QPixmap MediaBrowser::generateImageThumbnail(const QString& path) {
     return thumb;
 }
 
-QPixmap MediaBrowser::generateFitThumbnail(const QString& path) {
+QPixmap MediaBrowser::generateFitPlaceholder(const QString& path) {
     QPixmap pm(ThumbWidth, ThumbHeight);
     pm.fill(QColor(30, 30, 32));
 
-    FitParser parser;
-    if (!parser.parse(path)) {
-        QPainter p(&pm);
-        p.setPen(QColor(255, 180, 60));
-        QFont f = p.font();
-        f.setPointSize(14);
-        f.setBold(true);
-        p.setFont(f);
-        p.drawText(pm.rect(), Qt::AlignCenter, "FIT");
-        return pm;
+    QPainter p(&pm);
+    p.setPen(QColor(255, 180, 60));
+    QFont f = p.font();
+    f.setPointSize(14);
+    f.setBold(true);
+    p.setFont(f);
+    p.drawText(pm.rect(), Qt::AlignCenter, "FIT");
+
+    FitNativeDecoder decoder;
+    FitProbeInfo info;
+    if (decoder.probe(path, info)) {
+        drawInfoText(p, pm.rect().adjusted(2, 0, -2, -2),
+                     fitSummaryText(info.totalDistance, info.totalElapsedTime),
+                     Qt::AlignBottom | Qt::AlignRight);
     }
+    return pm;
+}
 
-    const FitSession& session = parser.session();
-    const auto& records = session.records;
-    if (records.empty()) {
+void MediaBrowser::setFitThumbnail(const QString& path, const FitTrack& track) {
+    for (int i = 0; i < m_listWidget->count(); ++i) {
+        QListWidgetItem* item = m_listWidget->item(i);
+        if (item->data(UserRolePath).toString() == path) {
+            item->setIcon(QIcon(generateFitThumbnail(track)));
+            break;
+        }
+    }
+}
+
+QPixmap MediaBrowser::generateFitThumbnail(const FitTrack& track) {
+    QPixmap pm(ThumbWidth, ThumbHeight);
+    pm.fill(QColor(30, 30, 32));
+
+    const FitSession& session = track.session();
+    const FitColumns& cols = track.columns();
+    const auto& altitude = cols.channel(FitChannel::Altitude);
+    if (cols.empty()) {
         QPainter p(&pm);
         p.setPen(QColor(255, 180, 60));
         p.drawText(pm.rect(), Qt::AlignCenter, "FIT (empty)");
@@ -200,23 +247,17 @@ QPixmap MediaBrowser::generateFitThumbnail(const QString& path) {
     // --- Minimap (top 2/3) ---
     p.fillRect(mapRect, QColor(25, 35, 25));
 
-    // Collect GPS points
-    std::vector<std::pair<double, double>> gpsPoints;
-    for (const auto& r : records) {
-        if (r.hasGps && r.latitude != 0.0 && r.longitude != 0.0) {
-            gpsPoints.emplace_back(r.latitude, r.longitude);
-        }
-    }
+    // Bounds from the chunk boxes; the path itself from the simplified level
+    // that matches the thumbnail's scale
+    const FitPolylineLod& polyline = track.polyline();
+    const size_t gpsCount = polyline.empty() ? 0 : polyline.level(0).vertices.size();
 
-    if (gpsPoints.size() >= 2) {
-        double minLat = gpsPoints[0].first, maxLat = minLat;
-        double minLon = gpsPoints[0].second, maxLon = minLon;
-        for (const auto& pt : gpsPoints) {
-            if (pt.first < minLat) minLat = pt.first;
-            if (pt.first > maxLat) maxLat = pt.first;
-            if (pt.second < minLon) minLon = pt.second;
-            if (pt.second > maxLon) maxLon = pt.second;
-        }
+    if (gpsCount >= 2) {
+        FitGeoBox bounds = polyline.level(0).chunks.front().box;
+        for (const FitPolylineLod::Chunk& chunk : polyline.level(0).chunks)
+            bounds.expand(chunk.box);
+        const double minLat = bounds.minLat, maxLat = bounds.maxLat;
+        const double minLon = bounds.minLon, maxLon = bounds.maxLon;
 
         double latRange = maxLat - minLat;
         double lonRange = maxLon - minLon;
@@ -235,11 +276,13 @@ QPixmap MediaBrowser::generateFitThumbnail(const QString& path) {
         double cxOff = mapRect.left() + pad + (drawW - lonRange * scale) / 2.0;
         double cyOff = mapRect.top() + pad + (drawH - latRange * scale) / 2.0;
 
+        const double metersPerPixel = 111320.0 / scale; // scale is pixels per degree
+        const std::vector<uint32_t>& vertices = polyline.levelFor(metersPerPixel * 0.5).vertices;
         QPainterPath path;
-        for (size_t i = 0; i < gpsPoints.size(); ++i) {
-            double x = cxOff + (gpsPoints[i].second - minLon) * scale;
-            double y = cyOff + (maxLat - gpsPoints[i].first) * scale; // flip Y
-            if (i == 0) path.moveTo(x, y);
+        for (size_t v = 0; v < vertices.size(); ++v) {
+            double x = cxOff + (cols.longitude[vertices[v]] - minLon) * scale;
+            double y = cyOff + (maxLat - cols.latitude[vertices[v]]) * scale; // flip Y
+            if (v == 0) path.moveTo(x, y);
             else path.lineTo(x, y);
         }
 
@@ -248,10 +291,10 @@ QPixmap MediaBrowser::generateFitThumbnail(const QString& path) {
         p.drawPath(path);
 
         // Start dot (green) and end dot (red)
-        double sx = cxOff + (gpsPoints.front().second - minLon) * scale;
-        double sy = cyOff + (maxLat - gpsPoints.front().first) * scale;
-        double ex = cxOff + (gpsPoints.back().second - minLon) * scale;
-        double ey = cyOff + (maxLat - gpsPoints.back().first) * scale;
+        double sx = cxOff + (cols.longitude[vertices.front()] - minLon) * scale;
+        double sy = cyOff + (maxLat - cols.latitude[vertices.front()]) * scale;
+        double ex = cxOff + (cols.longitude[vertices.back()] - minLon) * scale;
+        double ey = cyOff + (maxLat - cols.latitude[vertices.back()]) * scale;
 
         p.setPen(Qt::NoPen);
         p.setBrush(QColor(50, 220, 80));
@@ -266,28 +309,9 @@ QPixmap MediaBrowser::generateFitThumbnail(const QString& path) {
     }
 
     // --- Info text overlay on minimap ---
-    {
-        // Total distance
-        double totalDistKm = session.totalDistance / 1000.0;
-        QString distStr;
-        if (totalDistKm >= 1.0)
-            distStr = QString("%1 km").arg(totalDistKm, 0, 'f', 1);
-        else
-            distStr = QString("%1 m").arg(static_cast<int>(session.totalDistance));
-
-        // Duration in hh:mm:ss
-        int totalSec = static_cast<int>(session.totalElapsedTime);
-        int h = totalSec / 3600;
-        int m = (totalSec % 3600) / 60;
-        int s = totalSec % 60;
-        QString durStr;
-        if (h > 0) durStr = QString("%1:%2:%3").arg(h).arg(m, 2, 10, QChar('0')).arg(s, 2, 10, QChar('0'));
-        else durStr = QString("%1:%2").arg(m).arg(s, 2, 10, QChar('0'));
-
-        QString info = distStr + "  " + durStr;
-        drawInfoText(p, mapRect.adjusted(2, 0, -2, -2),
-                     info, Qt::AlignBottom | Qt::AlignRight);
-    }
+    drawInfoText(p, mapRect.adjusted(2, 0, -2, -2),
+                 fitSummaryText(session.totalDistance, session.totalElapsedTime),
+                 Qt::AlignBottom | Qt::AlignRight);
 
     // Separator line
     p.setPen(QColor(60, 60, 60));
@@ -296,48 +320,47 @@ QPixmap MediaBrowser::generateFitThumbnail(const QString& path) {
     // --- Elevation profile (bottom 1/3) ---
     p.fillRect(elevRect, QColor(30, 25, 20));
 
-    std::vector<float> elevations;
-    for (const auto& r : records) {
-        if (r.altitude != 0.0f || elevations.size() > 0) {
-            elevations.push_back(r.altitude);
-        }
-    }
-    // If no altitude data at all, fill from all records
-    if (elevations.empty()) {
-        for (const auto& r : records) {
-            elevations.push_back(r.altitude);
-        }
-    }
-
-    if (elevations.size() >= 2) {
-        float minElev = *std::min_element(elevations.begin(), elevations.end());
-        float maxElev = *std::max_element(elevations.begin(), elevations.end());
-        float elevRange = maxElev - minElev;
+    // Leading zeros are records from before the altitude fix
+    size_t firstElev = 0;
+    while (firstElev < altitude.size() && altitude[firstElev] == 0.0f) ++firstElev;
+    if (firstElev == altitude.size()) firstElev = 0;
+
+    int pad = 2;
+    int drawW = elevRect.width() - pad * 2;
+    int drawH = elevRect.height() - pad * 2;
+
+    // One bucket per pixel column over time, drawn through its highest point
+    const FitPyramid& pyramid = track.pyramid();
+    std::vector<FitMinMax> profile = pyramid.buckets(
+        FitChannel::Altitude, FitAxis::Time, cols.timestamp[firstElev], cols.timestamp.back(),
+        static_cast<size_t>(std::max(1, drawW)));
+    const FitMinMax elevBounds = pyramid.range(FitChannel::Altitude, firstElev, cols.size());
+
+    if (cols.size() - firstElev >= 2 && !elevBounds.empty()) {
+        float minElev = elevBounds.min;
+        float elevRange = elevBounds.span();
         if (elevRange < 1.0f) elevRange = 1.0f;
 
-        int pad = 2;
-        int drawW = elevRect.width() - pad * 2;
-        int drawH = elevRect.height() - pad * 2;
-
         // Build filled polygon for elevation
         QPainterPath elevPath;
-        int n = static_cast<int>(elevations.size());
-
-        // Downsample if too many points
-        int step = std::max(1, n / drawW);
+        QPainterPath outlinePath;
+        const int n = static_cast<int>(profile.size());
 
         double baseY = elevRect.bottom() - pad;
         bool first = true;
         double lastX = 0;
-        for (int i = 0; i < n; i += step) {
-            double x = elevRect.left() + pad + (static_cast<double>(i) / (n - 1)) * drawW;
-            double y = baseY - ((elevations[i] - minElev) / elevRange) * drawH;
+        for (int i = 0; i < n; ++i) {
+            if (profile[i].empty()) continue;
+            double x = elevRect.left() + pad + (n > 1 ? static_cast<double>(i) / (n - 1) : 0.0) * drawW;
+            double y = baseY - ((profile[i].max - minElev) / elevRange) * drawH;
             if (first) {
                 elevPath.moveTo(x, baseY);
                 elevPath.lineTo(x, y);
+                outlinePath.moveTo(x, y);
                 first = false;
             } else {
                 elevPath.lineTo(x, y);
+                outlinePath.lineTo(x, y);
             }
             lastX = x;
         }
@@ -355,15 +378,6 @@ QPixmap MediaBrowser::generateFitThumbnail(const QString& path) {
         // Outline
         p.setPen(QPen(QColor(200, 140, 70), 1.0));
         p.setBrush(Qt::NoBrush);
-
-        QPainterPath outlinePath;
-        first = true;
-        for (int i = 0; i < n; i += step) {
-            double x = elevRect.left() + pad + (static_cast<double>(i) / (n - 1)) * drawW;
-            double y = baseY - ((elevations[i] - minElev) / elevRange) * drawH;
-            if (first) { outlinePath.moveTo(x, y); first = false; }
-            else outlinePath.lineTo(x, y);
-        }
         p.drawPath(outlinePath);
     } else {
         p.setPen(QColor(100, 100, 100));
@@ -494,7 +508,7 @@ void MediaBrowser::addMediaFile(const QString& path)
     switch (type) {
         case MediaType::Video: thumb = generateVideoThumbnail(path); break;
         case MediaType::Image: thumb = generateImageThumbnail(path); break;
-        case MediaType::FIT:   thumb = generateFitThumbnail(path); break;
+        case MediaType::FIT:   thumb = generateFitPlaceholder(path); break;
     }
 
     auto* item = new QListWidgetItem(QIcon(thumb), info.fileName());
@@ -513,5 +527,10 @@ void MediaBrowser::addMediaFile(const QString& path)
     }
 
     m_listWidget->addItem(item);
+    // The placeholder stays until an overlay or preview decodes the track
+    if (type == MediaType::FIT) {
+        if (auto track = FitSessionRegistry::instance().find(path))
+            setFitThumbnail(path, *track);
+    }
     emit mediaImported(path);
 }
@@ -7,6 +7,7 @@
 #include <QStringList>
 #include <memory>
 
+class FitTrack;
 class VideoDecoder;
 
 enum class MediaType {
@@ -38,6 +39,9 @@ public:
     // Add a media file to the browser (used during project load)
     void addMediaFile(const QString& path);
 
+    // Redraw a FIT thumbnail from its decoded (or partly decoded) track
+    void setFitThumbnail(const QString& path, const FitTrack& track);
+
 signals:
     void mediaSelected(const QString& path);
     void fitFileSelected(const QString& path);
@@ -59,7 +63,9 @@ private:
 
     QPixmap generateVideoThumbnail(const QString& path);
     QPixmap generateImageThumbnail(const QString& path);
-    QPixmap generateFitThumbnail(const QString& path);
+    QPixmap generateFitThumbnail(const FitTrack& track);
+    // Drawn from a header/summary probe until the track is decoded
+    QPixmap generateFitPlaceholder(const QString& path);
     MediaType classifyFile(const QString& suffix) const;
 
     void drawInfoText(QPainter& painter, const QRect& rect,
@@ -176,9 +176,11 @@ void PreviewCanvas::paintEvent(QPaintEvent*) {
             double sy = m_transform->flipV ? -s : s;
             painter.scale(sx, sy);
 
-            // Draw source frame centered at origin, scaled to display
-            double fw = m_frame.width() * displayScale;
-            double fh = m_frame.height() * displayScale;
+            // Draw source frame centered at origin, scaled to display; a
+            // reduced-resolution preview frame still covers the source size
+            const QSize sourceSize = m_sourceSize.isEmpty() ? m_frame.size() : m_sourceSize;
+            double fw = sourceSize.width() * displayScale;
+            double fh = sourceSize.height() * displayScale;
             painter.drawImage(QRectF(-fw / 2.0, -fh / 2.0, fw, fh), m_frame);
             painter.restore();
         } else {
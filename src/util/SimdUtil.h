@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Vector kernels with an AVX2 path (FITVIBER_AVX2 build option), an SSE2
+// path for any x86-64 build, and a scalar fallback for everything else.
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMDUTIL_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMDUTIL_SSE2 1
+#endif
+
+namespace SimdUtil {
+
+// out[i] = lo[i] + t * (hi[i] - lo[i])
+inline void lerp(const float* lo, const float* hi, float t, float* out, size_t n) {
+    size_t i = 0;
+#if defined(SIMDUTIL_AVX2)
+    const __m256 vt = _mm256_set1_ps(t);
+    for (; i + 8 <= n; i += 8) {
+        __m256 a = _mm256_loadu_ps(lo + i);
+        __m256 b = _mm256_loadu_ps(hi + i);
+        _mm256_storeu_ps(out + i, _mm256_add_ps(a, _mm256_mul_ps(vt, _mm256_sub_ps(b, a))));
+    }
+#elif defined(SIMDUTIL_SSE2)
+    const __m128 vt = _mm_set1_ps(t);
+    for (; i + 4 <= n; i += 4) {
+        __m128 a = _mm_loadu_ps(lo + i);
+        __m128 b = _mm_loadu_ps(hi + i);
+        _mm_storeu_ps(out + i, _mm_add_ps(a, _mm_mul_ps(vt, _mm_sub_ps(b, a))));
+    }
+#endif
+    for (; i < n; ++i) out[i] = lo[i] + t * (hi[i] - lo[i]);
+}
+
+// out[i] = column[a] + t[i] * (column[b] - column[a]) with a = lo[i], b = hi[i].
+// Indices must fit in int32 (AVX2 gathers take signed offsets).
+inline void gatherLerp(const float* column, const uint32_t* lo, const uint32_t* hi,
+                       const float* t, float* out, size_t n) {
+    size_t i = 0;
+#if defined(SIMDUTIL_AVX2)
+    for (; i + 8 <= n; i += 8) {
+        __m256i ia = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lo + i));
+        __m256i ib = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hi + i));
+        __m256 a = _mm256_i32gather_ps(column, ia, 4);
+        __m256 b = _mm256_i32gather_ps(column, ib, 4);
+        __m256 vt = _mm256_loadu_ps(t + i);
+        _mm256_storeu_ps(out + i, _mm256_add_ps(a, _mm256_mul_ps(vt, _mm256_sub_ps(b, a))));
+    }
+#elif defined(SIMDUTIL_SSE2)
+    for (; i + 4 <= n; i += 4) {
+        __m128 a = _mm_setr_ps(column[lo[i]], column[lo[i + 1]], column[lo[i + 2]], column[lo[i + 3]]);
+        __m128 b = _mm_setr_ps(column[hi[i]], column[hi[i + 1]], column[hi[i + 2]], column[hi[i + 3]]);
+        __m128 vt = _mm_loadu_ps(t + i);
+        _mm_storeu_ps(out + i, _mm_add_ps(a, _mm_mul_ps(vt, _mm_sub_ps(b, a))));
+    }
+#endif
+    for (; i < n; ++i) {
+        float a = column[lo[i]];
+        out[i] = a + t[i] * (column[hi[i]] - a);
+    }
+}
+
+} // namespace SimdUtil
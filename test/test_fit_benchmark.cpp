@@ -0,0 +1,428 @@
+#include <cassert>
+#include <cstdio>
+#include "fit/FitTrackLoader.h"
+#include "fit/FitSessionRegistry.h"
+#include "fit/FitSegments.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <vector>
+
+static const char* TEST_FIT = "../testdata/2026-02-10-14-36-07.fit";
+static const int FILE_COUNT = 12;
+
+// Fresh copies per run so no .fvtrack entry exists yet
+static QStringList makeCopies(const QTemporaryDir& dir) {
+    QStringList paths;
+    for (int i = 0; i < FILE_COUNT; ++i) {
+        QString path = dir.path() + QString("/ride_%1.fit").arg(i);
+        bool copied = QFile::copy(TEST_FIT, path);
+        assert(copied);
+        paths.append(path);
+    }
+    return paths;
+}
+
+static double timedLoad(FitTrackLoader& loader, const QStringList& paths) {
+    QElapsedTimer timer;
+    timer.start();
+    loader.load(paths);
+    loader.waitForDone();
+    double ms = timer.nsecsElapsed() / 1e6;
+
+    for (const QString& path : paths) {
+        std::shared_ptr<const FitTrack> track = loader.takeTrack(path);
+        assert(track && !track->isEmpty());
+    }
+    return ms;
+}
+
+void bench_parallel_load() {
+    printf("=== bench_parallel_load (%d files) ===\n", FILE_COUNT);
+    printf("  threads   cold ms   warm ms   speedup\n");
+
+    double baseline = 0.0;
+    const int maxThreads = QThread::idealThreadCount();
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    for (int threads : threadCounts) {
+        QTemporaryDir dir;
+        assert(dir.isValid());
+        QStringList paths = makeCopies(dir);
+
+        FitTrackLoader loader;
+        loader.setMaxThreadCount(threads);
+
+        double cold = timedLoad(loader, paths);
+        // Let the cache writes land, and evict the in-memory tracks so the
+        // warm run reads the .fvtrack files
+        QThreadPool::globalInstance()->waitForDone();
+        FitSessionRegistry::instance().releaseUnused();
+        double warm = timedLoad(loader, paths);
+
+        if (threads == 1) baseline = cold;
+        printf("  %7d %9.1f %9.1f %8.2fx\n", threads, cold, warm, baseline / cold);
+    }
+    printf("PASS: bench_parallel_load\n");
+}
+
+static double nsPerLookup(const std::vector<double>& times, const std::function<float(double)>& lookup) {
+    volatile float sink = 0.0f;
+    QElapsedTimer timer;
+    timer.start();
+    for (double t : times) sink = sink + lookup(t);
+    return static_cast<double>(timer.nsecsElapsed()) / times.size();
+}
+
+void bench_record_lookup() {
+    const size_t count = 1000000;
+    printf("=== bench_record_lookup (%zu records) ===\n", count);
+
+    // 1 Hz with jitter and an occasional pause, as in a real recording
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> jitter(0.8, 1.2);
+    FitSession s;
+    s.records.resize(count);
+    double t = 1.7e9;
+    for (size_t i = 0; i < count; ++i) {
+        s.records[i].timestamp = t;
+        s.records[i].speed = static_cast<float>(i % 50);
+        t += (i % 5000 == 4999) ? 300.0 : jitter(rng);
+    }
+
+    FitTrack indexed;
+    indexed.loadSession(s);
+    FitTrack plain;
+    plain.loadSession(std::move(s));
+    plain.setTimeIndexEnabled(false);
+
+    // 30 fps playback over the whole track, and the same frames shuffled
+    std::vector<double> sequential;
+    for (double q = indexed.startTime(); q < indexed.endTime(); q += 1.0 / 30.0) sequential.push_back(q);
+    std::vector<double> random = sequential;
+    std::shuffle(random.begin(), random.end(), rng);
+
+    printf("  order        binary ns   grid ns   cursor ns\n");
+    for (const auto* order : {&sequential, &random}) {
+        FitTrack::Cursor cursor(&indexed);
+        double binary = nsPerLookup(*order, [&](double q) { return plain.getRecordAtTime(q).speed; });
+        double grid = nsPerLookup(*order, [&](double q) { return indexed.getRecordAtTime(q).speed; });
+        double cursored = nsPerLookup(*order, [&](double q) { return cursor.recordAt(q).speed; });
+        printf("  %-10s %11.1f %9.1f %11.1f\n", order == &sequential ? "sequential" : "random",
+               binary, grid, cursored);
+    }
+
+    // Whole-timeline evaluation at 30 fps, one minute of frames at a time:
+    // a record per frame through the cursor vs one sampleRange pass per chunk
+    const size_t chunk = 30 * 60;
+    const double frameStep = 1.0 / 30.0;
+    const size_t chunks = sequential.size() / chunk;
+    volatile float sink = 0.0f;
+    QElapsedTimer timer;
+    timer.start();
+    FitTrack::Cursor cursor(&indexed);
+    for (size_t c = 0; c < chunks; ++c)
+        for (size_t i = 0; i < chunk; ++i)
+            sink = sink + cursor.recordAt(sequential[c * chunk + i]).speed;
+    double perRecord = static_cast<double>(timer.nsecsElapsed()) / (chunks * chunk);
+    timer.restart();
+    for (size_t c = 0; c < chunks; ++c) {
+        FitSampleTable table = indexed.sampleRange(sequential[c * chunk], frameStep, chunk);
+        sink = sink + table.channel(FitChannel::Speed)[chunk / 2];
+    }
+    double batched = static_cast<double>(timer.nsecsElapsed()) / (chunks * chunk);
+    printf("  per-frame table: cursor %.1f ns/frame, sampleRange %.1f ns/frame\n", perRecord, batched);
+    printf("PASS: bench_record_lookup\n");
+}
+
+void bench_profile() {
+    const size_t count = 1000000;
+    printf("=== bench_profile (%zu records) ===\n", count);
+
+    FitSession s;
+    s.records.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        s.records[i].timestamp = 1.7e9 + static_cast<double>(i);
+        s.records[i].distance = static_cast<float>(i) * 5.0f;
+        s.records[i].altitude = 500.0f + 200.0f * std::sin(static_cast<float>(i) * 1e-4f);
+    }
+    FitTrack track;
+    track.loadSession(std::move(s));
+    const float totalDist = track.channel(FitChannel::Distance).back();
+
+    // What ElevationPanel did per frame: min/max plus a pass over every
+    // record, against one pyramid query per pixel column
+    const int frames = 20;
+    const size_t columns = 400;
+    volatile float sink = 0.0f;
+    QElapsedTimer timer;
+    timer.start();
+    for (int f = 0; f < frames; ++f) {
+        const auto& alt = track.channel(FitChannel::Altitude);
+        const auto& dist = track.channel(FitChannel::Distance);
+        auto range = std::minmax_element(alt.begin(), alt.end());
+        float acc = 0.0f;
+        for (size_t i = 0; i < alt.size(); ++i)
+            acc += dist[i] / totalDist * (alt[i] - *range.first);
+        sink = sink + acc;
+    }
+    double scanMs = timer.nsecsElapsed() / 1e6 / frames;
+
+    std::vector<FitMinMax> profile(columns);
+    timer.restart();
+    for (int f = 0; f < frames; ++f) {
+        FitMinMax range = track.pyramid().overall(FitChannel::Altitude);
+        track.pyramid().buckets(FitChannel::Altitude, FitAxis::Distance, 0.0, totalDist,
+                                profile.data(), columns);
+        sink = sink + profile[columns / 2].max - range.min;
+    }
+    double pyramidMs = timer.nsecsElapsed() / 1e6 / frames;
+
+    printf("  per frame: full scan %.3f ms, pyramid %.3f ms (%zu columns)\n", scanMs, pyramidMs, columns);
+    assert(pyramidMs < scanMs);
+    printf("PASS: bench_profile\n");
+}
+
+void bench_map_view() {
+    const size_t count = 1000000;
+    printf("=== bench_map_view (%zu GPS records) ===\n", count);
+
+    // 10 Hz ride wandering over roughly 30 x 30 km
+    FitSession s;
+    s.records.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        FitRecord& r = s.records[i];
+        const double a = static_cast<double>(i) * 2e-5;
+        r.timestamp = 1.7e9 + static_cast<double>(i) * 0.1;
+        r.hasGps = true;
+        r.latitude = 45.0 + 0.12 * std::sin(a) + 0.01 * std::sin(a * 13.0);
+        r.longitude = 7.0 + 0.17 * std::cos(a * 0.7);
+    }
+    FitTrack track;
+    track.loadSession(std::move(s));
+    const FitColumns& cols = track.columns();
+
+    // A 300 m window around positions spread over the ride, as MiniMapPanel
+    const int frames = 200;
+    const double half = 300.0 / 111320.0;
+    volatile size_t sink = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int f = 0; f < frames; ++f) {
+        const size_t at = count / frames * f;
+        size_t inView = 0;
+        for (size_t i = 0; i < count; ++i)
+            if (std::abs(cols.latitude[i] - cols.latitude[at]) <= half &&
+                std::abs(cols.longitude[i] - cols.longitude[at]) <= half) ++inView;
+        sink = sink + inView;
+    }
+    const double scanUs = timer.nsecsElapsed() / 1e3 / frames;
+
+    const FitPolylineLod::Level& level = track.polyline().levelFor(0.5);
+    std::vector<FitPolylineLod::Range> ranges;
+    timer.restart();
+    for (int f = 0; f < frames; ++f) {
+        const size_t at = count / frames * f;
+        FitGeoBox view{cols.latitude[at] - half, cols.latitude[at] + half,
+                       cols.longitude[at] - half, cols.longitude[at] + half};
+        level.visibleRanges(view, ranges);
+        size_t inView = 0;
+        for (const auto& range : ranges) inView += range.last - range.first + 1;
+        sink = sink + inView + level.splitAt(cols.timestamp[at], cols);
+    }
+    const double indexUs = timer.nsecsElapsed() / 1e3 / frames;
+
+    printf("  per frame: full scan %.1f us, spatial index %.1f us\n", scanUs, indexUs);
+    assert(indexUs < scanUs);
+    printf("PASS: bench_map_view\n");
+}
+
+void bench_running_stats() {
+    const size_t count = 1000000;
+    printf("=== bench_running_stats (%zu records) ===\n", count);
+
+    FitSession s;
+    s.records.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        FitRecord& r = s.records[i];
+        r.timestamp = 1.7e9 + static_cast<double>(i) * 0.1;
+        r.hasPower = true;
+        r.power = 200.0f + 80.0f * std::sin(static_cast<float>(i) * 1e-3f);
+    }
+    FitTrack track;
+    track.loadSession(std::move(s));
+
+    // Average and max power so far at frames late in the ride: a scan over
+    // the records up to the frame, against one analytics query
+    const int frames = 20;
+    const double start = track.startTime();
+    volatile double sink = 0.0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int f = 0; f < frames; ++f) {
+        const double now = track.endTime() - f * 3.0;
+        const auto& time = track.timestamps();
+        const auto& power = track.channel(FitChannel::Power);
+        double area = 0.0;
+        float peak = 0.0f;
+        for (size_t i = 0; i + 1 < time.size() && time[i + 1] <= now; ++i) {
+            area += 0.5 * (power[i] + power[i + 1]) * (time[i + 1] - time[i]);
+            peak = std::max(peak, power[i]);
+        }
+        sink = sink + area / (now - start) + peak;
+    }
+    double scanUs = timer.nsecsElapsed() / 1e3 / frames;
+
+    timer.restart();
+    for (int f = 0; f < frames; ++f) {
+        const double now = track.endTime() - f * 3.0;
+        FitRangeStats stats = track.rangeStats(FitChannel::Power, start, now);
+        sink = sink + stats.average() + stats.extremes.max;
+    }
+    double indexUs = timer.nsecsElapsed() / 1e3 / frames;
+
+    printf("  per frame: scan %.1f us, analytics %.3f us\n", scanUs, indexUs);
+    assert(indexUs < scanUs);
+    printf("PASS: bench_running_stats\n");
+}
+
+void bench_peak_curves() {
+    printf("=== bench_peak_curves (1 Hz power) ===\n");
+    printf("  hours   records   naive ms   curves ms\n");
+
+    double lastNaive = 0.0, lastCurves = 0.0;
+    for (int hours : {1, 2, 4, 8}) {
+        const size_t count = static_cast<size_t>(hours) * 3600;
+        FitSession s;
+        s.records.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            FitRecord& r = s.records[i];
+            r.timestamp = 1.7e9 + static_cast<double>(i);
+            r.hasPower = true;
+            r.power = 220.0f + 90.0f * std::sin(static_cast<float>(i) * 7e-3f) + static_cast<float>(i % 13);
+        }
+        FitTrack track;
+        track.loadSession(std::move(s));
+
+        // Naive: every window length, each a prefix-sum slide (O(n^2))
+        const auto& power = track.channel(FitChannel::Power);
+        std::vector<double> prefix(count + 1, 0.0);
+        for (size_t i = 0; i < count; ++i) prefix[i + 1] = prefix[i] + power[i];
+        volatile double sink = 0.0;
+        QElapsedTimer timer;
+        timer.start();
+        for (size_t w = 1; w <= count; ++w) {
+            double best = 0.0;
+            for (size_t g = 0; g + w <= count; ++g)
+                best = std::max(best, prefix[g + w] - prefix[g]);
+            sink = sink + best / static_cast<double>(w);
+        }
+        double naiveMs = timer.nsecsElapsed() / 1e6;
+
+        FitPeakCurves curves;
+        timer.restart();
+        curves.build(track.columns(), track.analytics());
+        double curvesMs = timer.nsecsElapsed() / 1e6;
+        sink = sink + curves.best(FitChannel::Power, 1200.0).value;
+
+        printf("  %5d  %8zu  %9.1f  %10.1f\n", hours, count, naiveMs, curvesMs);
+        lastNaive = naiveMs;
+        lastCurves = curvesMs;
+    }
+    assert(lastCurves < lastNaive);
+    printf("PASS: bench_peak_curves\n");
+}
+
+void bench_segment_matching() {
+    const int rides = 20;
+    const int librarySize = 500;
+    printf("=== bench_segment_matching (%d segments, %d rides of 3 h) ===\n", librarySize, rides);
+
+    // Rides over the same roads around a 40 x 40 km area, each starting
+    // further round the loop
+    std::vector<std::unique_ptr<FitTrack>> tracks;
+    for (int ride = 0; ride < rides; ++ride) {
+        FitSession s;
+        s.records.resize(3 * 3600);
+        for (size_t i = 0; i < s.records.size(); ++i) {
+            FitRecord& r = s.records[i];
+            const double a = (static_cast<double>(i) + ride * 1500.0) * 1.5e-4;
+            r.timestamp = 1.7e9 + ride * 86400.0 + static_cast<double>(i);
+            r.hasGps = true;
+            r.latitude = 45.0 + 0.18 * std::sin(a) + 0.004 * std::sin(a * 40.0);
+            r.longitude = 7.0 + 0.25 * std::cos(a);
+        }
+        tracks.push_back(std::make_unique<FitTrack>());
+        tracks.back()->loadSession(std::move(s));
+    }
+
+    // Segments cut from the first ride, the rest scattered over the region
+    FitSegmentLibrary library;
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<double> lat(44.7, 45.3), lon(6.6, 7.4), step(-4e-4, 4e-4);
+    const FitTrack& first = *tracks.front();
+    for (int k = 0; k < 50; ++k) {
+        const double from = first.startTime() + 200.0 * k;
+        library.add(FitSegmentLibrary::fromTrack(first, from, from + 120.0, QString("Road %1").arg(k)));
+    }
+    while (static_cast<int>(library.size()) < librarySize) {
+        FitSegment segment;
+        FitGeoPoint p{lat(rng), lon(rng)};
+        for (int j = 0; j < 30; ++j) {
+            segment.points.push_back(p);
+            p = {p.lat + step(rng), p.lon + step(rng)};
+        }
+        library.add(std::move(segment));
+    }
+
+    // All pairs for one ride: every segment point against every GPS point
+    const FitColumns& cols = first.columns();
+    volatile size_t sink = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (const FitSegment& segment : library.segments()) {
+        for (const FitGeoPoint& p : segment.points) {
+            size_t near = 0;
+            for (size_t i = 0; i < cols.size(); ++i) {
+                const double dy = (cols.latitude[i] - p.lat) * 111320.0;
+                const double dx = (cols.longitude[i] - p.lon) * 78710.0;
+                near += dx * dx + dy * dy <= 625.0;
+            }
+            sink = sink + near;
+        }
+    }
+    const double naiveMs = timer.nsecsElapsed() / 1e6;
+
+    size_t efforts = 0;
+    timer.restart();
+    for (const auto& track : tracks) efforts += library.match(*track).size();
+    const double matchMs = timer.nsecsElapsed() / 1e6 / rides;
+
+    printf("  per ride: all pairs %.1f ms (proximity only), library match %.2f ms\n", naiveMs, matchMs);
+    printf("  100-ride season: %.1f s vs %.2f s, %zu efforts over %d rides\n",
+           naiveMs * 100 / 1000.0, matchMs * 100 / 1000.0, efforts, rides);
+    assert(efforts >= 50);
+    assert(matchMs < naiveMs);
+    printf("PASS: bench_segment_matching\n");
+}
+
+int main() {
+    bench_record_lookup();
+    bench_profile();
+    bench_map_view();
+    bench_running_stats();
+    bench_peak_curves();
+    bench_segment_matching();
+    bench_parallel_load();
+    printf("All FIT benchmark tests passed.\n");
+    return 0;
+}
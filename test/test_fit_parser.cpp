@@ -2,9 +2,20 @@
 #include <cstdio>
 #include <cmath>
 #include <algorithm>
+#include <random>
 #include "fit/FitData.h"
 #include "fit/FitTrack.h"
 #include "fit/FitParser.h"
+#include "fit/FitNativeDecoder.h"
+#include "fit/FitTrackCache.h"
+#include "fit/FitSessionRegistry.h"
+#include "fit/FitSegments.h"
+#include <QFile>
+#include <QTemporaryDir>
+#include <QThreadPool>
+#include <vector>
+
+static const char* TEST_FIT = "../testdata/2026-02-10-14-36-07.fit";
 
 void test_fit_record_defaults() {
     FitRecord r;
@@ -60,10 +71,1363 @@ void test_fit_track_interpolation() {
     printf("PASS: test_fit_track_interpolation\n");
 }
 
-#ifdef HAS_FIT_SDK
+void test_fit_track_columns() {
+    // Out-of-order input with a validity flag set on only one record
+    FitSession s;
+    for (int i = 0; i < 130; ++i) {
+        FitRecord r;
+        r.timestamp = 1000.0 + (129 - i);
+        r.power = static_cast<float>(129 - i);
+        r.hasPower = (i == 0);
+        s.records.push_back(r);
+    }
+
+    FitTrack track;
+    track.loadSession(s);
+    assert(track.recordCount() == 130);
+
+    const FitColumns& cols = track.columns();
+    for (size_t i = 0; i < cols.size(); ++i) {
+        assert(cols.timestamp[i] == 1000.0 + i);
+        assert(cols.channel(FitChannel::Power)[i] == static_cast<float>(i));
+        assert(cols.has(FitFlag::Power, i) == (i == 129));
+    }
+
+    FitRecord last = track.recordAt(129);
+    assert(last.hasPower && last.power == 129.0f);
+    assert(!track.recordAt(0).hasPower);
+
+    assert(std::abs(track.valueAtTime(FitChannel::Power, 1010.5) - 10.5f) < 0.01f);
+
+    // Shrinking must clear bits past the new end
+    FitBitmap bits;
+    bits.resize(70);
+    bits.set(69, true);
+    bits.resize(65);
+    assert(!bits.any());
+    bits.resize(70);
+    assert(!bits.test(69));
+
+    printf("PASS: test_fit_track_columns\n");
+}
+
+void test_fit_track_cursor() {
+    // Irregular sampling: 1 s steps, a long pause, a burst and a duplicate
+    FitSession s;
+    double t = 500.0;
+    for (int i = 0; i < 400; ++i) {
+        FitRecord r;
+        r.timestamp = t;
+        r.speed = static_cast<float>(i);
+        s.records.push_back(r);
+        if (i == 100) t += 600.0;
+        else if (i > 200 && i < 260) t += 0.1;
+        else if (i != 300) t += 1.0;
+    }
+
+    FitTrack indexed;
+    indexed.loadSession(s);
+    FitTrack plain;
+    plain.loadSession(s);
+    plain.setTimeIndexEnabled(false);
+    assert(indexed.hasTimeIndex() && !plain.hasTimeIndex());
+
+    auto same = [](const FitRecord& a, const FitRecord& b) {
+        return a.timestamp == b.timestamp && a.speed == b.speed;
+    };
+
+    // Forward playback at 30 fps, then seeks in both directions
+    std::vector<double> times;
+    for (double q = 490.0; q < indexed.endTime() + 10.0; q += 1.0 / 30.0) times.push_back(q);
+    for (double q : {1200.0, 510.0, 1150.25, 1150.25, 499.0, 5000.0, 700.0}) times.push_back(q);
+    for (size_t i = 0; i < indexed.recordCount(); ++i) times.push_back(indexed.timestamps()[i]);
+
+    FitTrack::Cursor cursor(&indexed);
+    FitTrack::Cursor plainCursor(&plain);
+    for (double q : times) {
+        FitRecord expected = plain.getRecordAtTime(q);
+        assert(same(indexed.getRecordAtTime(q), expected));
+        assert(same(cursor.recordAt(q), expected));
+        assert(same(plainCursor.recordAt(q), expected));
+        assert(cursor.valueAt(FitChannel::Speed, q) == plain.valueAtTime(FitChannel::Speed, q));
+    }
+
+    FitTrack::Cursor empty;
+    assert(empty.recordAt(600.0).timestamp == 0.0);
+
+    printf("PASS: test_fit_track_cursor\n");
+}
+
+void test_fit_track_time_gap() {
+    // Two one-hour rides 60 days apart: the grid step is ~days, so nearly all
+    // samples share a handful of cells and lookups fall back to a binary search
+    FitSession s;
+    for (int ride = 0; ride < 2; ++ride) {
+        const double start = 1.6e9 + ride * 60.0 * 86400.0;
+        for (int i = 0; i < 3600; ++i) {
+            FitRecord r;
+            r.timestamp = start + i + (i % 5 == 0 ? 0.5 : 0.0);
+            r.speed = static_cast<float>(ride * 10000 + i);
+            s.records.push_back(r);
+        }
+    }
+
+    FitTrack indexed;
+    indexed.loadSession(s);
+    FitTrack plain;
+    plain.loadSession(s);
+    plain.setTimeIndexEnabled(false);
+    assert(indexed.hasTimeIndex());
+
+    std::vector<double> times;
+    for (size_t i = 0; i < indexed.recordCount(); i += 7) {
+        const double t = indexed.timestamps()[i];
+        times.push_back(t);
+        times.push_back(t + 0.3);
+        times.push_back(t - 0.01);
+    }
+    times.push_back(1.6e9 + 30.0 * 86400.0);
+    times.push_back(indexed.endTime() - 0.25);
+
+    FitTrack::Cursor cursor(&indexed);
+    for (double q : times) {
+        const FitRecord expected = plain.getRecordAtTime(q);
+        const FitRecord got = indexed.getRecordAtTime(q);
+        assert(got.timestamp == expected.timestamp && got.speed == expected.speed);
+        assert(indexed.valueAtTime(FitChannel::Speed, q) == plain.valueAtTime(FitChannel::Speed, q));
+        assert(cursor.valueAt(FitChannel::Speed, q) == plain.valueAtTime(FitChannel::Speed, q));
+    }
+
+    printf("PASS: test_fit_track_time_gap\n");
+}
+
+void test_fit_track_sample_range() {
+    FitSession s;
+    for (int i = 0; i < 300; ++i) {
+        FitRecord r;
+        r.timestamp = 2000.0 + i + (i % 3) * 0.25;
+        r.latitude = 47.0 + i * 1e-4;
+        r.hasGps = (i % 7) != 0;
+        r.power = static_cast<float>(i * 3 % 250);
+        r.hasPower = (i % 2) == 0;
+        r.altitude = 400.0f + i * 0.5f;
+        s.records.push_back(r);
+    }
+    FitTrack track;
+    track.loadSession(s);
+
+    // 25 fps from before the start to past the end; odd count exercises the
+    // scalar tail of the vector kernels
+    const double start = 1995.0, step = 0.04;
+    const size_t count = 7777;
+    FitSampleTable table = track.sampleRange(start, step, count);
+    assert(table.size() == count);
+    for (size_t i = 0; i < count; ++i) {
+        FitRecord expected = track.getRecordAtTime(start + i * step);
+        FitRecord row = table.record(i);
+        assert(std::abs(row.timestamp - expected.timestamp) < 1e-6);
+        assert(std::abs(row.latitude - expected.latitude) < 1e-9);
+        assert(std::abs(row.power - expected.power) < 1e-3f);
+        assert(std::abs(row.altitude - expected.altitude) < 1e-3f);
+        assert(row.hasGps == expected.hasGps && row.hasPower == expected.hasPower);
+    }
+    assert(table.frameAt(start + 100 * step + 0.001) == 100);
+    assert(table.frameAt(0.0) == 0 && table.frameAt(1e12) == count - 1);
+
+    // Empty track yields default rows
+    FitTrack empty;
+    assert(empty.sampleRange(0.0, 1.0, 3).size() == 3);
+
+    printf("PASS: test_fit_track_sample_range\n");
+}
+
+void test_fit_lap_index() {
+    FitSession s;
+    for (int i = 0; i < 300; ++i) {
+        FitRecord r;
+        r.timestamp = 1000.0 + i;
+        r.distance = i * 10.0f;
+        s.records.push_back(r);
+    }
+    // Out of order, sharing boundaries, with a gap between 1200 and 1210
+    auto lap = [](double start, double end) { FitLap l; l.startTime = start; l.endTime = end; return l; };
+    s.laps = {lap(1100, 1200), lap(1000, 1100), lap(1210, 1299)};
+
+    FitTrack track;
+    track.loadSession(s);
+    const auto& laps = track.laps();
+    assert(track.lapIndex().size() == 3);
+
+    auto linear = [&](double t) {
+        int best = -1;
+        for (int i = 0; i < static_cast<int>(laps.size()); ++i)
+            if (t >= laps[i].startTime && t <= laps[i].endTime &&
+                (best < 0 || laps[i].startTime < laps[best].startTime)) best = i;
+        return best;
+    };
+
+    int hint = -1;
+    for (double t = 990.0; t < 1310.0; t += 0.5) {
+        int expected = linear(t);
+        assert(track.findLapAtTime(t) == expected);
+        assert(track.findLapAtTime(t, hint) == expected);
+        assert(track.findLapAtTime(t, 2) == expected);
+        hint = expected;
+    }
+    assert(laps[track.findLapAtTime(1100.0)].startTime == 1000.0);
+    assert(track.findLapAtTime(1205.0) == -1);
+
+    FitLapPosition pos = track.lapIndex().position(1150.0, track.getRecordAtTime(1150.0).distance);
+    assert(laps[pos.lap].startTime == 1100.0);
+    assert(pos.elapsed == 50.0);
+    assert(std::abs(pos.distance - 500.0f) < 0.01f);
+
+    printf("PASS: test_fit_lap_index\n");
+}
+
+void test_fit_pyramid() {
+    FitSession s;
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> noise(-3.0f, 3.0f);
+    float distance = 0.0f;
+    for (int i = 0; i < 5000; ++i) {
+        FitRecord r;
+        r.timestamp = 1000.0 + i + (i > 2500 ? 120.0 : 0.0); // pause mid-track
+        distance += (i % 97 == 0) ? 0.0f : 4.0f;             // some stationary samples
+        r.distance = distance;
+        r.altitude = 300.0f + 50.0f * std::sin(i * 0.01f) + noise(rng);
+        r.hasHeartRate = i % 3 != 0;
+        r.heartRate = r.hasHeartRate ? 120.0f + noise(rng) : 0.0f;
+        s.records.push_back(r);
+    }
+    FitTrack track;
+    track.loadSession(s);
+    const FitPyramid& pyramid = track.pyramid();
+    const FitColumns& cols = track.columns();
+
+    auto brute = [&](FitChannel ch, size_t first, size_t last) {
+        FitMinMax m;
+        for (size_t i = first; i < last; ++i)
+            if (ch != FitChannel::HeartRate || cols.has(FitFlag::HeartRate, i)) m.add(cols.channel(ch)[i]);
+        return m;
+    };
+    auto same = [](const FitMinMax& a, const FitMinMax& b) {
+        return a.empty() == b.empty() && (a.empty() || (a.min == b.min && a.max == b.max));
+    };
+
+    std::uniform_int_distribution<size_t> pick(0, cols.size());
+    for (int k = 0; k < 2000; ++k) {
+        size_t a = pick(rng), b = pick(rng);
+        if (a > b) std::swap(a, b);
+        bool altOk = same(pyramid.range(FitChannel::Altitude, a, b), brute(FitChannel::Altitude, a, b));
+        bool hrOk = same(pyramid.range(FitChannel::HeartRate, a, b), brute(FitChannel::HeartRate, a, b));
+        assert(altOk && hrOk);
+    }
+    bool overallOk = same(pyramid.overall(FitChannel::HeartRate), brute(FitChannel::HeartRate, 0, cols.size()));
+    assert(overallOk);
+    assert(pyramid.overall(FitChannel::HeartRate).min > 100.0f); // unflagged zeros are skipped
+
+    // Buckets match a scan over the same axis intervals, including the pause
+    const double from = 1500.0, to = 4700.0;
+    const size_t count = 60;
+    std::vector<FitMinMax> byTime = pyramid.buckets(FitChannel::Altitude, FitAxis::Time, from, to, count);
+    const double w = (to - from) / count;
+    for (size_t b = 0; b < count; ++b) {
+        FitMinMax expected;
+        for (size_t i = 0; i < cols.size(); ++i) {
+            double t = cols.timestamp[i];
+            bool inside = t >= from + b * w && (b + 1 == count ? t <= to : t < from + (b + 1) * w);
+            if (inside) expected.add(cols.channel(FitChannel::Altitude)[i]);
+        }
+        bool ok = same(byTime[b], expected);
+        assert(ok);
+    }
+    size_t emptyBuckets = 0;
+    for (const auto& b : byTime) emptyBuckets += b.empty() ? 1 : 0;
+    assert(emptyBuckets > 0); // the pause
+
+    const float totalDist = cols.channel(FitChannel::Distance).back();
+    std::vector<FitMinMax> byDistance = pyramid.buckets(FitChannel::Altitude, FitAxis::Distance, 0.0, totalDist, 200);
+    FitMinMax merged;
+    for (const auto& b : byDistance) merged.add(b);
+    bool mergedOk = same(merged, pyramid.overall(FitChannel::Altitude));
+    assert(mergedOk);
+
+    // Distance buckets follow the running maximum: jitter that steps back
+    // and dropouts logged as 0 neither lose records nor break the seek
+    FitSession jittery;
+    for (int i = 0; i < 3000; ++i) {
+        FitRecord r;
+        r.timestamp = 1000.0 + i;
+        r.distance = i * 5.0f + ((i % 7 == 3) ? -12.0f : 0.0f);
+        if (i % 101 == 50) r.distance = 0.0f;
+        r.altitude = static_cast<float>(i % 400);
+        jittery.records.push_back(r);
+    }
+    FitTrack jitteryTrack;
+    jitteryTrack.loadSession(jittery);
+    const FitColumns& jitteryCols = jitteryTrack.columns();
+    std::vector<float> axis(jitteryCols.size());
+    float reached = 0.0f;
+    for (size_t i = 0; i < axis.size(); ++i) {
+        reached = std::max(reached, jitteryCols.channel(FitChannel::Distance)[i]);
+        axis[i] = reached;
+    }
+    const float jitteryTotal = axis.back();
+    const size_t distCount = 150;
+    std::vector<FitMinMax> byAxis = jitteryTrack.pyramid().buckets(
+        FitChannel::Altitude, FitAxis::Distance, 0.0, jitteryTotal, distCount);
+    const double dw = static_cast<double>(jitteryTotal) / distCount;
+    for (size_t b = 0; b < distCount; ++b) {
+        FitMinMax expected;
+        for (size_t i = 0; i < axis.size(); ++i) {
+            bool inside = axis[i] >= b * dw && (b + 1 == distCount ? axis[i] <= jitteryTotal : axis[i] < (b + 1) * dw);
+            if (inside) expected.add(jitteryCols.channel(FitChannel::Altitude)[i]);
+        }
+        bool ok = same(byAxis[b], expected);
+        assert(ok);
+    }
+    // A dropout sample sits at the distance already reached
+    const FitTimePoint dropout = jitteryTrack.locate(1050.0);
+    assert(jitteryTrack.distanceIndex().at(dropout) == axis[49]);
+
+    // Rebuilt when the records change
+    track.clear();
+    assert(pyramid.empty() && pyramid.overall(FitChannel::Altitude).empty());
+
+    printf("PASS: test_fit_pyramid\n");
+}
+
+void test_fit_analytics() {
+    FitSession s;
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> noise(-20.0f, 20.0f);
+    std::uniform_real_distribution<double> jitter(0.5, 1.5);
+    double t = 5000.0;
+    for (int i = 0; i < 6000; ++i) {
+        FitRecord r;
+        t += (i == 3000) ? 300.0 : jitter(rng); // one long pause
+        r.timestamp = t;
+        r.speed = 8.0f + 0.25f * noise(rng);
+        r.hasPower = i % 50 != 7;               // occasional dropouts
+        r.power = r.hasPower ? 220.0f + 4.0f * noise(rng) : 0.0f;
+        r.hasHeartRate = true;
+        r.heartRate = 140.0f + noise(rng);
+        s.records.push_back(r);
+    }
+    FitTrack track;
+    track.loadSession(s);
+    const FitColumns& cols = track.columns();
+    const std::vector<double>& time = cols.timestamp;
+
+    auto counts = [&](FitChannel ch, size_t i) {
+        if (time[i + 1] - time[i] > FitAnalytics::MaxGapSeconds) return false;
+        return ch != FitChannel::Power || (cols.has(FitFlag::Power, i) && cols.has(FitFlag::Power, i + 1));
+    };
+    auto valueAt = [&](FitChannel ch, size_t i, double at) {
+        double f = (at - time[i]) / (time[i + 1] - time[i]);
+        const std::vector<float>& v = cols.channel(ch);
+        return v[i] + static_cast<float>(f) * (v[i + 1] - v[i]);
+    };
+    // Interval by interval, clipped to [a, b]
+    auto brute = [&](FitChannel ch, double a, double b) {
+        FitRangeStats r;
+        for (size_t i = 0; i + 1 < cols.size(); ++i) {
+            double lo = std::max(a, time[i]), hi = std::min(b, time[i + 1]);
+            bool inside = time[i] >= a && time[i] <= b;
+            if (inside && (ch != FitChannel::Power || cols.has(FitFlag::Power, i)))
+                r.extremes.add(cols.channel(ch)[i]);
+            if (hi <= lo || !counts(ch, i)) continue;
+            double vlo = lo == time[i] ? cols.channel(ch)[i] : valueAt(ch, i, lo);
+            double vhi = hi == time[i + 1] ? cols.channel(ch)[i + 1] : valueAt(ch, i, hi);
+            r.integral += 0.5 * (vlo + vhi) * (hi - lo);
+            r.duration += hi - lo;
+            if (lo > time[i]) r.extremes.add(static_cast<float>(vlo));
+            if (hi < time[i + 1]) r.extremes.add(static_cast<float>(vhi));
+        }
+        size_t last = cols.size() - 1;
+        if (time[last] >= a && time[last] <= b && (ch != FitChannel::Power || cols.has(FitFlag::Power, last)))
+            r.extremes.add(cols.channel(ch)[last]);
+        return r;
+    };
+    auto close = [](double x, double y) { return std::fabs(x - y) <= 1e-6 * std::max(1.0, std::fabs(y)); };
+
+    std::uniform_real_distribution<double> when(track.startTime() - 10.0, track.endTime() + 10.0);
+    std::uniform_int_distribution<size_t> sample(0, cols.size() - 1);
+    for (int k = 0; k < 1500; ++k) {
+        double a = when(rng), b = when(rng);
+        if (k % 5 == 0) a = time[sample(rng)];  // ends exactly on samples
+        if (k % 7 == 0) b = time[sample(rng)];
+        if (k % 11 == 0) b = a + 3.0;           // short ranges within a block
+        if (a > b) std::swap(a, b);
+        for (FitChannel ch : {FitChannel::Speed, FitChannel::Power}) {
+            FitRangeStats got = track.rangeStats(ch, a, b);
+            FitRangeStats want = brute(ch, std::clamp(a, track.startTime(), track.endTime()),
+                                       std::clamp(b, track.startTime(), track.endTime()));
+            bool ok = close(got.integral, want.integral) && close(got.duration, want.duration) &&
+                      got.extremes.empty() == want.extremes.empty() &&
+                      (want.extremes.empty() || (got.extremes.min == want.extremes.min &&
+                                                 got.extremes.max == want.extremes.max));
+            assert(ok);
+        }
+    }
+
+    // The pause is not covered, so averages skip it
+    FitRangeStats all = track.rangeStats(FitChannel::Speed, track.startTime(), track.endTime());
+    assert(all.duration < track.duration() - 299.0);
+    assert(std::fabs(all.average() - 8.0) < 0.5);
+    FitRangeStats reversed = track.rangeStats(FitChannel::Speed, track.endTime(), track.startTime());
+    assert(reversed.duration == all.duration);
+
+    // Time in heart rate bands adds up to the covered time, and each band
+    // matches a clipped scan
+    FitBandIndex zones;
+    zones.build(cols, FitChannel::HeartRate, {150.0f, 130.0f});
+    assert(zones.bandCount() == 3 && zones.edges().front() == 130.0f);
+    assert(zones.bandOf(129.9f) == 0 && zones.bandOf(130.0f) == 1 && zones.bandOf(150.0f) == 2);
+    for (int k = 0; k < 200; ++k) {
+        double a = when(rng), b = when(rng);
+        if (a > b) std::swap(a, b);
+        FitTimePoint pa = track.locate(a), pb = track.locate(b);
+        double total = 0.0;
+        for (size_t band = 0; band < zones.bandCount(); ++band) {
+            double expected = 0.0;
+            for (size_t i = 0; i + 1 < cols.size(); ++i) {
+                double lo = std::max(a, time[i]), hi = std::min(b, time[i + 1]);
+                const std::vector<float>& hr = cols.channel(FitChannel::HeartRate);
+                if (hi > lo && counts(FitChannel::HeartRate, i) && zones.bandOf(0.5f * (hr[i] + hr[i + 1])) == band)
+                    expected += hi - lo;
+            }
+            double got = zones.seconds(band, pa, pb);
+            assert(close(got, expected));
+            total += got;
+        }
+        bool sumOk = close(total, track.rangeStats(FitChannel::HeartRate, a, b).duration);
+        assert(sumOk);
+    }
+
+    track.clear();
+    assert(track.analytics().empty() && track.rangeStats(FitChannel::Speed, 0.0, 1e10).empty());
+
+    printf("PASS: test_fit_analytics\n");
+}
+
+void test_fit_peak_curves() {
+    FitSession s;
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> noise(-30.0f, 30.0f);
+    double t = 20000.0;
+    for (int i = 0; i < 4000; ++i) {
+        FitRecord r;
+        t += (i == 2000) ? 600.0 : (i % 9 == 0 ? 2.0 : 1.0); // a cafe stop, some 2 s gaps
+        r.timestamp = t;
+        r.hasPower = i % 40 != 3;
+        r.power = r.hasPower ? 200.0f + noise(rng) + (i >= 900 && i < 1200 ? 150.0f : 0.0f) : 0.0f;
+        r.hasHeartRate = i < 3000;                                        // strap dies late
+        r.heartRate = r.hasHeartRate ? 130.0f + 0.2f * noise(rng) : 0.0f;
+        r.speed = 9.0f;
+        s.records.push_back(r);
+    }
+    FitTrack track;
+    track.loadSession(s);
+    const FitPeakCurves& peaks = track.peaks();
+    assert(!peaks.empty() && peaks.curve(FitChannel::Cadence).empty());
+
+    std::vector<double> durations = FitPeakCurves::durations(5000.0);
+    for (double d : {1.0, 5.0, 60.0, 300.0, 1200.0, 3600.0})
+        assert(std::find(durations.begin(), durations.end(), d) != durations.end());
+    for (size_t i = 1; i < durations.size(); ++i)
+        assert(durations[i] > durations[i - 1] && durations[i] <= durations[i - 1] * 1.03 + 1.0);
+
+    // Every point matches a brute-force slide of the same window over the
+    // 1 s grid, using the O(1) range statistics
+    const double t0 = track.startTime();
+    const size_t seconds = static_cast<size_t>(track.endTime() - t0);
+    for (FitChannel ch : {FitChannel::Power, FitChannel::HeartRate}) {
+        const std::vector<FitPeak>& curve = peaks.curve(ch);
+        assert(!curve.empty());
+        for (size_t k = 0; k < curve.size(); k += 7) {
+            const size_t w = static_cast<size_t>(curve[k].duration);
+            double best = -1.0;
+            for (size_t g = 0; g + w <= seconds; ++g) {
+                FitRangeStats r = track.rangeStats(ch, t0 + g, t0 + g + w);
+                if (r.duration >= FitPeakCurves::MinCoverage * w) best = std::max(best, r.average());
+            }
+            bool ok = std::fabs(best - curve[k].value) < 1e-3;
+            assert(ok);
+            FitRangeStats at = track.rangeStats(ch, curve[k].startTime, curve[k].startTime + w);
+            assert(std::fabs(at.average() - curve[k].value) < 1e-3);
+        }
+    }
+
+    // The 5 minute block stands out, and the pause is never part of a window
+    FitPeak fiveMin = peaks.best(FitChannel::Power, 300.0);
+    assert(fiveMin.duration == 300.0 && fiveMin.value > 330.0);
+    assert(fiveMin.startTime >= track.columns().timestamp[850] &&
+           fiveMin.startTime + 300.0 <= track.columns().timestamp[1250]);
+    assert(peaks.best(FitChannel::Power, 301.0).duration <= 301.0);
+    assert(peaks.best(FitChannel::Power, 0.5).empty());
+    // No window can bridge the pause
+    const std::vector<double>& ts = track.columns().timestamp;
+    const double stretch = std::max(ts[1999] - ts.front(), ts.back() - ts[2000]);
+    for (FitChannel ch : {FitChannel::Power, FitChannel::HeartRate})
+        assert(peaks.curve(ch).back().duration <= stretch / FitPeakCurves::MinCoverage + 1.0);
+
+    // Two rides ten days apart: the grid covers the rides, not the days
+    // between them, and the best windows come from either ride
+    FitSession apart;
+    for (int i = 0; i < 4000; ++i) {
+        FitRecord r;
+        r.timestamp = 1.0e6 + i + (i >= 2000 ? 10 * 86400.0 : 0.0);
+        r.hasPower = true;
+        r.power = 200.0f + noise(rng) + (i >= 2500 && i < 2800 ? 200.0f : 0.0f);
+        apart.records.push_back(r);
+    }
+    FitTrack twoRides;
+    twoRides.loadSession(apart);
+    const FitPeakCurves& split = twoRides.peaks();
+    const std::vector<FitPeak>& power = split.curve(FitChannel::Power);
+    assert(!power.empty() && power.back().duration <= 1999.0);
+    const std::vector<double>& at = twoRides.columns().timestamp;
+    for (size_t k = 0; k < power.size(); k += 11) {
+        const size_t w = static_cast<size_t>(power[k].duration);
+        double best = -1.0;
+        for (double rideStart : {at[0], at[2000]}) {
+            for (size_t g = 0; g + w <= 1999; ++g) {
+                FitRangeStats r = twoRides.rangeStats(FitChannel::Power, rideStart + g, rideStart + g + w);
+                if (r.duration >= FitPeakCurves::MinCoverage * w) best = std::max(best, r.average());
+            }
+        }
+        bool ok = std::fabs(best - power[k].value) < 1e-3;
+        assert(ok);
+    }
+    FitPeak effort = split.best(FitChannel::Power, 300.0);
+    assert(effort.startTime >= at[2450] && effort.startTime + 300.0 <= at[2850]);
+
+    track.clear();
+    assert(peaks.empty());
+
+    printf("PASS: test_fit_peak_curves\n");
+}
+
+void test_fit_derived() {
+    std::vector<FitRecord> records;
+    std::mt19937 rng(9);
+    std::uniform_real_distribution<float> noise(-40.0f, 40.0f);
+    double t = 30000.0;
+    for (int i = 0; i < 2400; ++i) {
+        FitRecord r;
+        t += (i == 1500) ? 120.0 : (i % 11 == 0 ? 2.0 : 1.0);
+        r.timestamp = t;
+        r.hasPower = i % 25 != 7;
+        r.power = r.hasPower ? std::max(0.0f, 220.0f + noise(rng) + (i >= 600 && i < 900 ? 180.0f : 0.0f)) : 0.0f;
+        r.hasHeartRate = i >= 10;
+        r.heartRate = r.hasHeartRate ? 110.0f + 0.03f * i + 0.1f * noise(rng) : 0.0f;
+        r.altitude = 200.0f + 0.25f * std::min(i, 1200);
+        r.distance = 8.0f * i;
+        records.push_back(r);
+    }
+    FitSession whole;
+    whole.records = records;
+    FitTrack track;
+    track.loadSession(whole);
+    const FitColumns& c = track.columns();
+    const std::vector<double>& ts = c.timestamp;
+    const size_t n = c.size();
+
+    // Brute force per record
+    for (size_t i = 0; i < n; i += 13) {
+        double sum3 = 0.0, sum30 = 0.0;
+        int n3 = 0, n30 = 0;
+        for (size_t j = 0; j <= i; ++j) {
+            if (!c.has(FitFlag::Power, j)) continue;
+            if (ts[j] > ts[i] - 3.0) { sum3 += records[j].power; ++n3; }
+            if (ts[j] > ts[i] - 30.0) { sum30 += records[j].power; ++n30; }
+        }
+        assert(std::fabs(c.channel(FitChannel::Power3s)[i] - (n3 ? sum3 / n3 : 0.0)) < 1e-2);
+        assert(std::fabs(c.channel(FitChannel::Power30s)[i] - (n30 ? sum30 / n30 : 0.0)) < 1e-2);
+
+        size_t lo = i;
+        while (lo > 0 && ts[lo - 1] >= ts[i] - 60.0) --lo;
+        const double span = ts[i] - ts[lo];
+        const double vam = span >= 10.0 ? (records[i].altitude - records[lo].altitude) / span * 3600.0 : 0.0;
+        assert(std::fabs(c.channel(FitChannel::Vam)[i] - vam) < 0.5);
+    }
+    assert(c.channel(FitChannel::Vam)[1000] > 800.0f && c.channel(FitChannel::Vam)[2000] == 0.0f);
+
+    double np4 = 0.0;
+    int npCount = 0;
+    double balance = 20000.0;
+    for (size_t i = 0; i < n; ++i) {
+        if (c.has(FitFlag::Power, i) && ts[i] >= ts[0] + 30.0) {
+            np4 += std::pow(static_cast<double>(c.channel(FitChannel::Power30s)[i]), 4.0);
+            ++npCount;
+        }
+        const double dt = i > 0 ? ts[i] - ts[i - 1] : 0.0;
+        const double p = c.has(FitFlag::Power, i) ? records[i].power : 0.0;
+        balance = p > 250.0 ? balance - (p - 250.0) * dt : 20000.0 - (20000.0 - balance) * std::exp(-(250.0 - p) * dt / 20000.0);
+        if (i % 17 == 0) {
+            const double np = npCount ? std::pow(np4 / npCount, 0.25) : 0.0;
+            assert(std::fabs(c.channel(FitChannel::NormalizedPower)[i] - np) < 1e-2);
+            assert(std::fabs(c.channel(FitChannel::WPrimeBalance)[i] - balance) < 1.0);
+        }
+    }
+    // The hard block drains W', the easy part refills it
+    assert(c.channel(FitChannel::WPrimeBalance)[899] < 5000.0f);
+    assert(c.channel(FitChannel::WPrimeBalance)[1499] > c.channel(FitChannel::WPrimeBalance)[899] + 8000.0f);
+
+    // Zones against the highest recorded heart rate
+    const float maxHr = track.zoneMaxHeartRate();
+    assert(maxHr == track.pyramid().overall(FitChannel::HeartRate).max);
+    for (size_t i = 0; i < n; i += 7) {
+        const float hr = records[i].heartRate;
+        const float expected = !records[i].hasHeartRate ? 0.0f
+            : 1.0f + (hr >= 0.6f * maxHr) + (hr >= 0.7f * maxHr) + (hr >= 0.8f * maxHr) + (hr >= 0.9f * maxHr);
+        assert(c.channel(FitChannel::HeartRateZone)[i] == expected);
+    }
+
+    // Appending continues from the stored state and matches a full pass
+    FitTrack split;
+    FitSession head, tail;
+    head.records.assign(records.begin(), records.begin() + 1700);
+    tail.records.assign(records.begin() + 1700, records.end());
+    split.loadSession(head);
+    split.appendSession(tail);
+    assert(split.recordCount() == n);
+    for (int ch = static_cast<int>(FitChannel::Power3s); ch < static_cast<int>(FitChannel::Count); ++ch) {
+        const std::vector<float>& a = split.columns().channels[ch];
+        const std::vector<float>& b = c.channels[ch];
+        for (size_t i = 0; i < n; ++i) {
+            bool ok = std::fabs(a[i] - b[i]) <= 1e-3f * std::max(1.0f, std::fabs(b[i]));
+            assert(ok);
+        }
+    }
+
+    // NP resumes from a double sum, so many small appends do not drift
+    FitTrack trickled;
+    head.records.assign(records.begin(), records.begin() + 1400);
+    trickled.loadSession(head);
+    for (size_t i = 1400; i < n; ++i) {
+        FitSession one;
+        one.records.push_back(records[i]);
+        trickled.appendSession(one);
+    }
+    bool sameNp = trickled.channel(FitChannel::NormalizedPower) == c.channel(FitChannel::NormalizedPower);
+    assert(sameNp);
+
+    // Settings recompute the channels and the range indexes over them
+    FitDerivedSettings settings;
+    settings.maxHeartRate = 140.0f;
+    settings.criticalPower = 500.0f;
+    const uint64_t before = track.generation();
+    assert(before != split.generation());
+    track.setDerivedSettings(settings);
+    assert(track.generation() != before);
+    assert(track.zoneMaxHeartRate() == 140.0f);
+    assert(c.channel(FitChannel::WPrimeBalance)[899] == 20000.0f);
+    assert(track.pyramid().overall(FitChannel::HeartRateZone).max == 5.0f);
+
+    printf("PASS: test_fit_derived\n");
+}
+
+void test_fit_distance_index() {
+    FitSession s;
+    float d = 0.0f;
+    for (int i = 0; i < 1000; ++i) {
+        FitRecord r;
+        r.timestamp = 40000.0 + i;
+        if (i < 400 || i >= 700) d += 5.0f;   // stopped from 400 to 699
+        r.distance = d;
+        if (i == 200) r.distance = d - 3.0f;  // GPS jitter steps back
+        if (i == 500) r.distance = 0.0f;      // sample without distance
+        r.altitude = static_cast<float>(i);
+        r.hasPower = true;
+        r.power = i < 400 ? 200.0f : 300.0f;
+        s.records.push_back(r);
+    }
+    FitTrack track;
+    track.loadSession(s);
+    const FitDistanceIndex& index = track.distanceIndex();
+    assert(index.size() == 1000 && index.total() == d);
+    for (size_t i = 1; i < index.size(); ++i) assert(index.at(i) >= index.at(i - 1));
+    assert(index.at(500) == index.at(499));
+
+    // Between samples the record is interpolated to the exact distance
+    FitRecord r = track.getRecordAtDistance(502.5f);
+    assert(std::fabs(r.distance - 502.5f) < 1e-3f && std::fabs(r.timestamp - 40099.5) < 1e-6);
+    // A distance on the stop maps to the arrival, past it to the departure
+    const float stop = track.columns().channel(FitChannel::Distance)[399];
+    assert(track.timeAtDistance(stop) == 40399.0);
+    assert(std::fabs(track.timeAtDistance(stop + 2.5f) - 40699.5) < 1e-6);
+    // Clamped to the track
+    assert(track.timeAtDistance(-10.0f) == track.startTime());
+    assert(track.timeAtDistance(1e9f) == track.endTime());
+    assert(track.getRecordAtDistance(1e9f).timestamp == track.endTime());
+
+    // The cursor agrees with the binary search forwards, backwards and
+    // across the stop
+    FitTrack::Cursor cursor(&track);
+    std::vector<float> queries;
+    for (float q = -5.0f; q < d + 10.0f; q += 0.7f) queries.push_back(q);
+    queries.push_back(100.0f);
+    queries.push_back(stop);
+    queries.push_back(stop + 1.0f);
+    for (float q : queries) {
+        FitRecord a = cursor.recordAtDistance(q);
+        FitRecord b = track.getRecordAtDistance(q);
+        assert(a.timestamp == b.timestamp && a.distance == b.distance);
+    }
+
+    // Ranges over distance, e.g. the part after the stop
+    FitRangeStats after = track.rangeStatsByDistance(FitChannel::Power, stop + 1.0f, d);
+    FitRangeStats byTime = track.rangeStats(FitChannel::Power, track.timeAtDistance(stop + 1.0f), track.endTime());
+    assert(std::fabs(after.duration - byTime.duration) < 1e-6 && std::fabs(after.average() - 300.0) < 1e-9);
+    FitRangeStats before = track.rangeStatsByDistance(FitChannel::Power, 500.0f, 0.0f);
+    assert(std::fabs(before.duration - 99.0) < 1e-9 && std::fabs(before.average() - 200.0) < 1e-9);
+
+    track.clear();
+    assert(track.distanceIndex().empty());
+    assert(track.getRecordAtDistance(10.0f).timestamp == 0.0);
+
+    printf("PASS: test_fit_distance_index\n");
+}
+
+void test_fit_climbs() {
+    // Flat, a 3 km climb at 6%, descent, a 2% drag too gentle to count, and
+    // a short steep ramp too small to count
+    auto altitudeAt = [](double x) {
+        if (x < 2000.0) return 100.0;
+        if (x < 5000.0) return 100.0 + 0.06 * (x - 2000.0);
+        if (x < 7000.0) return 280.0 - 0.08 * (x - 5000.0);
+        if (x < 9000.0) return 120.0 + 0.02 * (x - 7000.0);
+        if (x < 9200.0) return 160.0 + 0.10 * (x - 9000.0);
+        return 180.0;
+    };
+    FitSession s;
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<double> noise(-0.5, 0.5); // barometer
+    for (int i = 0; i < 1400; ++i) {
+        FitRecord r;
+        r.timestamp = 50000.0 + i;
+        r.distance = 8.0f * i;
+        r.altitude = static_cast<float>(altitudeAt(r.distance) + noise(rng));
+        s.records.push_back(r);
+    }
+    FitTrack track;
+    track.loadSession(s);
+    const std::vector<FitClimb>& climbs = track.climbs();
+    assert(climbs.size() == 1);
+    const FitClimb& c = climbs.front();
+    assert(std::fabs(c.startDistance - 2000.0f) < 100.0f && std::fabs(c.endDistance() - 5000.0f) < 100.0f);
+    assert(std::fabs(c.gain - 180.0f) < 10.0f);
+    assert(std::fabs(c.averageGrade - 6.0f) < 0.5f && c.maxGrade >= c.averageGrade);
+    assert(c.category == 3); // 3000 m x 6% = 18000
+    assert(c.startTime == track.columns().timestamp[c.first] && c.endTime == track.columns().timestamp[c.last]);
+
+    // Grades the device recorded (percent in the file) give the same climb
+    FitSession recorded = s;
+    for (FitRecord& r : recorded.records) {
+        const double x = r.distance;
+        r.altitude = 0.0f;
+        r.hasGrade = true;
+        r.grade = gradeFromPercent((altitudeAt(x + 4.0) - altitudeAt(x - 4.0)) / 8.0 * 100.0);
+    }
+    FitTrack device;
+    device.loadSession(recorded);
+    assert(device.climbs().size() == 1);
+    const FitClimb& d = device.climbs().front();
+    assert(std::fabs(d.averageGrade - 6.0f) < 0.5f && std::fabs(d.maxGrade - 6.0f) < 0.5f);
+    assert(std::fabs(d.startDistance - c.startDistance) < 100.0f && d.category == c.category);
+
+    // No distance, no climbs
+    for (FitRecord& r : s.records) r.distance = 0.0f;
+    track.loadSession(s);
+    assert(track.climbs().empty());
+
+    printf("PASS: test_fit_climbs\n");
+}
+
+// Laps of a 2 km square (counter-clockwise from the south-west corner) at
+// 8 m/s and 1 Hz; `detour` pushes the first lap 200 m off the first side
+// between 800 and 1200 m
+static FitSession squareRide(double startTime, int laps, bool clockwise, bool detour) {
+    const double lat0 = 45.0, lon0 = 6.0;
+    const double metersPerLon = 111320.0 * std::cos(lat0 * 3.14159265358979323846 / 180.0);
+    FitSession s;
+    const int count = laps * 1000;
+    for (int i = 0; i < count; ++i) {
+        double along = std::fmod(8.0 * i, 8000.0);
+        if (clockwise) along = std::fmod(8000.0 - along, 8000.0);
+        double x, y;
+        if (along < 2000.0) { x = along; y = 0.0; }
+        else if (along < 4000.0) { x = 2000.0; y = along - 2000.0; }
+        else if (along < 6000.0) { x = 6000.0 - along; y = 2000.0; }
+        else { x = 0.0; y = 8000.0 - along; }
+        if (detour && i < 1000 && along > 800.0 && along < 1200.0) y -= 200.0;
+        FitRecord r;
+        r.timestamp = startTime + i;
+        r.distance = 8.0f * i;
+        r.hasGps = true;
+        r.latitude = lat0 + y / 111320.0;
+        r.longitude = lon0 + x / metersPerLon;
+        s.records.push_back(r);
+    }
+    return s;
+}
+
+void test_fit_segments() {
+    FitTrack ride;
+    ride.loadSession(squareRide(60000.0, 2, false, false));
+
+    // Part of the first side, and a stretch round the first corner
+    FitSegmentLibrary library;
+    FitSegment side = FitSegmentLibrary::fromTrack(ride, 60000.0 + 300.0 / 8.0, 60000.0 + 1700.0 / 8.0, "Side");
+    assert(side.points.size() >= 20 && std::fabs(side.length - 1400.0) < 10.0);
+    assert(library.add(side) == 0);
+    assert(library.add(FitSegmentLibrary::fromTrack(ride, 60000.0 + 1500.0 / 8.0, 60000.0 + 2500.0 / 8.0, "Corner")) == 1);
+    // Far away, and too short to be a segment
+    FitSegment elsewhere;
+    elsewhere.name = "Elsewhere";
+    elsewhere.points = {{46.0, 7.0}, {46.01, 7.0}, {46.02, 7.01}};
+    assert(library.add(elsewhere) == 2);
+    FitSegment dot;
+    dot.points = {{45.0, 6.0}};
+    assert(library.add(dot) == -1 && library.size() == 3);
+
+    // Both laps count, in time order, with the expected times
+    std::vector<FitSegmentEffort> efforts = library.match(ride);
+    assert(efforts.size() == 4);
+    const int expected[] = {0, 1, 0, 1};
+    for (size_t i = 0; i < efforts.size(); ++i) {
+        const FitSegmentEffort& e = efforts[i];
+        assert(e.segment == expected[i] && e.name == library.segment(e.segment).name);
+        assert(std::fabs(e.elapsed() - e.length / 8.0) <= 8.0);
+        assert(ride.columns().timestamp[e.first] == e.startTime && e.last > e.first);
+        if (i > 0) assert(e.startTime >= efforts[i - 1].startTime);
+    }
+    assert(std::fabs(efforts[0].startTime - (60000.0 + 300.0 / 8.0)) <= 2.0);
+    assert(std::fabs(efforts[2].startTime - efforts[0].startTime - 1000.0) <= 2.0);
+
+    // Riding the loop the other way round matches nothing
+    FitTrack reversed;
+    reversed.loadSession(squareRide(70000.0, 2, true, false));
+    assert(library.match(reversed).empty());
+
+    // Leaving the side part way loses that lap's effort on it only
+    FitTrack detour;
+    detour.loadSession(squareRide(80000.0, 2, false, true));
+    efforts = library.match(detour);
+    int sides = 0, corners = 0;
+    for (const FitSegmentEffort& e : efforts) (e.segment == 0 ? sides : corners)++;
+    assert(sides == 1 && corners == 2);
+    assert(efforts.front().segment == 1);
+
+    // Shared library snapshots
+    auto shared = std::make_shared<FitSegmentLibrary>(library);
+    FitSegmentLibrary::setCurrent(shared);
+    assert(FitSegmentLibrary::current()->size() == 3);
+    library.remove(0);
+    assert(library.size() == 2 && library.match(ride).size() == 2);
+    assert(FitSegmentLibrary::current()->match(ride).size() == 4);
+    FitSegmentLibrary::setCurrent(nullptr);
+    assert(FitSegmentLibrary::current()->empty());
+
+    printf("PASS: test_fit_segments\n");
+}
+
+// Plain recursive Douglas–Peucker on projected points, for comparison
+static void referenceDp(const std::vector<std::pair<double, double>>& pts, size_t a, size_t b,
+                        double tolerance, std::vector<bool>& keep) {
+    if (b <= a + 1) return;
+    double best = -1.0;
+    size_t split = a;
+    for (size_t i = a + 1; i < b; ++i) {
+        double dx = pts[b].first - pts[a].first, dy = pts[b].second - pts[a].second;
+        double len2 = dx * dx + dy * dy;
+        double t = len2 > 0 ? ((pts[i].first - pts[a].first) * dx + (pts[i].second - pts[a].second) * dy) / len2 : 0.0;
+        t = std::clamp(t, 0.0, 1.0);
+        double d = std::hypot(pts[a].first + t * dx - pts[i].first, pts[a].second + t * dy - pts[i].second);
+        if (d > best) { best = d; split = i; }
+    }
+    if (best <= tolerance) return;
+    keep[split] = true;
+    referenceDp(pts, a, split, tolerance, keep);
+    referenceDp(pts, split, b, tolerance, keep);
+}
+
+void test_fit_polyline_lod() {
+    // A noisy loop with a few records before the GPS fix
+    FitSession s;
+    std::mt19937 rng(3);
+    std::normal_distribution<double> noise(0.0, 2e-6);
+    for (int i = 0; i < 6000; ++i) {
+        FitRecord r;
+        r.timestamp = 1000.0 + i;
+        r.hasGps = i >= 10;
+        if (r.hasGps) {
+            double a = i * 0.002;
+            r.latitude = 45.0 + 0.01 * std::sin(a) + 0.002 * std::sin(a * 7.0) + noise(rng);
+            r.longitude = 7.0 + 0.014 * std::cos(a) + noise(rng);
+        }
+        s.records.push_back(r);
+    }
+    FitTrack track;
+    track.loadSession(s);
+    const FitPolylineLod& lod = track.polyline();
+    const FitColumns& cols = track.columns();
+    assert(!lod.empty());
+    assert(lod.level(0).vertices.size() == 5990);
+    assert(lod.level(0).vertices.front() == 10);
+
+    // Same projection as the builder
+    double midLat = 0.0;
+    for (uint32_t i : lod.level(0).vertices) midLat += cols.latitude[i];
+    midLat /= lod.level(0).vertices.size();
+    const double lonScale = 111320.0 * std::cos(midLat * 3.14159265358979323846 / 180.0);
+    std::vector<std::pair<double, double>> pts;
+    for (uint32_t i : lod.level(0).vertices)
+        pts.emplace_back(cols.longitude[i] * lonScale, cols.latitude[i] * 111320.0);
+
+    size_t previous = SIZE_MAX;
+    for (size_t l = 1; l < lod.levelCount(); ++l) {
+        const FitPolylineLod::Level& level = lod.level(l);
+        assert(level.vertices.size() <= previous);
+        previous = level.vertices.size();
+
+        std::vector<bool> keep(pts.size(), false);
+        keep.front() = keep.back() = true;
+        referenceDp(pts, 0, pts.size() - 1, level.tolerance, keep);
+        std::vector<uint32_t> expected;
+        for (size_t k = 0; k < pts.size(); ++k)
+            if (keep[k]) expected.push_back(lod.level(0).vertices[k]);
+        bool sameAsReference = expected == level.vertices;
+        assert(sameAsReference);
+
+        // Chunks cover the level, share their end vertices and bound them
+        assert(level.chunks.front().first == 0 && level.chunks.back().last == level.vertices.size() - 1);
+        for (size_t c = 0; c < level.chunks.size(); ++c) {
+            const auto& chunk = level.chunks[c];
+            if (c > 0) assert(chunk.first == level.chunks[c - 1].last);
+            for (size_t v = chunk.first; v <= chunk.last; ++v) {
+                double lat = cols.latitude[level.vertices[v]], lon = cols.longitude[level.vertices[v]];
+                assert(lat >= chunk.box.minLat && lat <= chunk.box.maxLat &&
+                       lon >= chunk.box.minLon && lon <= chunk.box.maxLon);
+            }
+        }
+    }
+    assert(lod.level(lod.levelCount() - 1).vertices.size() < 100);
+
+    assert(&lod.levelFor(0.0) == &lod.level(0));
+    assert(lod.levelFor(3.0).tolerance == 2.0);
+    assert(&lod.levelFor(1e9) == &lod.level(lod.levelCount() - 1));
+
+    printf("PASS: test_fit_polyline_lod (%zu -> %zu vertices at 2 m)\n",
+           lod.level(0).vertices.size(), lod.levelFor(2.0).vertices.size());
+}
+
+void test_fit_spatial_index() {
+    // Random boxes against a linear scan
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<double> pos(0.0, 1.0), size(0.0, 0.05);
+    std::vector<FitGeoBox> boxes;
+    for (int i = 0; i < 1000; ++i) {
+        double lat = pos(rng), lon = pos(rng);
+        boxes.push_back({lat, lat + size(rng), lon, lon + size(rng)});
+    }
+    FitSpatialIndex index;
+    index.build(boxes);
+    assert(index.size() == boxes.size());
+
+    std::vector<FitIndexRange> runs;
+    for (int q = 0; q < 200; ++q) {
+        double lat = pos(rng), lon = pos(rng), h = size(rng) * 4.0;
+        FitGeoBox view{lat - h, lat + h, lon - h, lon + h};
+        index.query(view, runs);
+        std::vector<size_t> hits;
+        for (const auto& run : runs) {
+            assert(run.first <= run.last);
+            for (size_t i = run.first; i <= run.last; ++i) hits.push_back(i);
+        }
+        for (size_t r = 1; r < runs.size(); ++r) assert(runs[r].first > runs[r - 1].last + 1);
+        std::vector<size_t> expected;
+        for (size_t i = 0; i < boxes.size(); ++i)
+            if (boxes[i].intersects(view)) expected.push_back(i);
+        bool same = hits == expected;
+        assert(same);
+    }
+
+    // A track: visible ranges cover exactly the vertices of intersecting chunks
+    FitSession s;
+    for (int i = 0; i < 20000; ++i) {
+        FitRecord r;
+        r.timestamp = 1000.0 + i;
+        r.hasGps = true;
+        double a = i * 0.0007;
+        r.latitude = 45.0 + 0.02 * std::sin(a) + 0.003 * std::sin(a * 11.0);
+        r.longitude = 7.0 + 0.03 * std::cos(a * 0.5);
+        s.records.push_back(r);
+    }
+    FitTrack track;
+    track.loadSession(s);
+    const FitColumns& cols = track.columns();
+    const FitPolylineLod::Level& level = track.polyline().level(0);
+    std::vector<FitPolylineLod::Range> ranges;
+    for (int q = 0; q < 50; ++q) {
+        size_t at = static_cast<size_t>(pos(rng) * (cols.size() - 1));
+        FitGeoBox view{cols.latitude[at] - 0.001, cols.latitude[at] + 0.001,
+                       cols.longitude[at] - 0.0015, cols.longitude[at] + 0.0015};
+        level.visibleRanges(view, ranges);
+        std::vector<bool> covered(level.vertices.size(), false);
+        for (const auto& range : ranges)
+            for (size_t v = range.first; v <= range.last; ++v) covered[v] = true;
+        bool hasCurrent = false;
+        for (const auto& chunk : level.chunks) {
+            bool expectVisible = chunk.box.intersects(view);
+            for (size_t v = chunk.first; v <= chunk.last; ++v)
+                if (expectVisible) assert(covered[v]);
+            if (chunk.first <= at && at <= chunk.last) hasCurrent = hasCurrent || expectVisible;
+        }
+        assert(hasCurrent);
+
+        // Split: first vertex after the current time
+        double t = cols.timestamp[at] + 0.5;
+        size_t split = level.splitAt(t, cols);
+        assert(split == at + 1);
+    }
+    assert(level.splitAt(0.0, cols) == 0);
+    assert(level.splitAt(1e12, cols) == level.vertices.size());
+
+    printf("PASS: test_fit_spatial_index\n");
+}
+
+// Whole-track grade as computed before FitGrade: nested-loop moving average
+static std::vector<float> referenceGrade(const std::vector<FitRecord>& recs) {
+    const size_t n = recs.size();
+    const double dx = 5.0;
+    const int window = 10;
+    int numSamples = static_cast<int>(std::ceil(recs.back().distance / dx)) + 1;
+    std::vector<double> evenAlt(numSamples), smoothAlt(numSamples);
+    size_t recIdx = 0;
+    for (int i = 0; i < numSamples; ++i) {
+        double d = i * dx;
+        while (recIdx < n - 1 && recs[recIdx + 1].distance < d) recIdx++;
+        if (recIdx >= n - 1) { evenAlt[i] = recs.back().altitude; continue; }
+        double range = recs[recIdx + 1].distance - recs[recIdx].distance;
+        if (range < 1e-6) { evenAlt[i] = recs[recIdx + 1].altitude; continue; }
+        double t = (d - recs[recIdx].distance) / range;
+        evenAlt[i] = recs[recIdx].altitude + t * (recs[recIdx + 1].altitude - recs[recIdx].altitude);
+    }
+    for (int i = 0; i < numSamples; ++i) {
+        double sum = 0; int count = 0;
+        for (int j = std::max(0, i - window); j <= std::min(numSamples - 1, i + window); ++j) { sum += evenAlt[j]; count++; }
+        smoothAlt[i] = sum / count;
+    }
+    std::vector<float> grade(n);
+    for (size_t k = 0; k < n; ++k) {
+        int i = static_cast<int>(recs[k].distance / dx);
+        double dz = 0.0, cdx = dx;
+        if (i > 0 && i < numSamples - 1) { dz = smoothAlt[i + 1] - smoothAlt[i - 1]; cdx = 2.0 * dx; }
+        else if (i == 0) dz = smoothAlt[1] - smoothAlt[0];
+        else dz = smoothAlt[numSamples - 1] - smoothAlt[numSamples - 2];
+        grade[k] = static_cast<float>(std::atan2(dz, cdx) * 180.0 / 3.14159265358979323846);
+    }
+    return grade;
+}
+
+void test_fit_grade() {
+    // Rolling terrain, ~3.7 m per sample
+    std::vector<FitRecord> recs(3000);
+    for (size_t i = 0; i < recs.size(); ++i) {
+        recs[i].timestamp = 5000.0 + i;
+        recs[i].distance = i * 3.7f;
+        recs[i].altitude = 300.0f + 40.0f * std::sin(i * 0.01f) + 3.0f * std::sin(i * 0.37f);
+    }
+    const std::vector<float> expected = referenceGrade(recs);
+    auto matches = [&](const FitTrack& track, size_t from) {
+        const auto& grade = track.channel(FitChannel::Grade);
+        for (size_t k = from; k < grade.size(); ++k)
+            if (std::abs(grade[k] - expected[k]) > 1e-3f) return false;
+        return true;
+    };
+
+    FitSession s;
+    s.records = recs;
+    FitTrack track;
+    track.loadSession(s);
+    assert(matches(track, 0));
+
+    // Appending the second half recomputes only near the seam, same result
+    FitSession head, tail;
+    head.records.assign(recs.begin(), recs.begin() + 1800);
+    tail.records.assign(recs.begin() + 1800, recs.end());
+    FitTrack appended;
+    appended.loadSession(head);
+    appended.appendSession(tail);
+    assert(matches(appended, 0));
+
+    // Recorded grades are kept; the gaps between them are computed
+    FitSession partial;
+    partial.records = recs;
+    for (size_t k = 100; k < 200; ++k) { partial.records[k].grade = 99.0f; partial.records[k].hasGrade = true; }
+    FitTrack mixed;
+    mixed.loadSession(partial);
+    const auto& grade = mixed.channel(FitChannel::Grade);
+    assert(grade[150] == 99.0f);
+    assert(std::abs(grade[50] - expected[50]) < 1e-3f && std::abs(grade[2500] - expected[2500]) < 1e-3f);
+
+    // A device that records grade on part of the ride: the FIT percentages
+    // are stored as degrees, so they line up with the computed gaps
+    std::vector<uint8_t> fit = {14, 0x10, 0x54, 0x08, 0, 0, 0, 0, '.', 'F', 'I', 'T', 0, 0};
+    auto put = [&fit](uint32_t v, int bytes) {
+        for (int i = 0; i < bytes; ++i) fit.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    };
+    fit.insert(fit.end(), {0x40, 0, 0, 20, 0, 4, 253, 4, 0x86, 5, 4, 0x86, 2, 2, 0x84, 9, 2, 0x83});
+    for (uint32_t i = 0; i < 3000; ++i) {
+        fit.push_back(0x00);
+        put(1000000000 + i, 4);
+        put(i * 370, 4);                            // 3.7 m per record, in cm
+        put((100 + 500) * 5 + i * 37 * 5 / 100, 2); // 10 % climb
+        put(i >= 1000 && i < 2000 ? 1000 : 0x7FFF, 2);
+    }
+    const uint32_t fitDataSize = static_cast<uint32_t>(fit.size() - 14);
+    for (int i = 0; i < 4; ++i) fit[4 + i] = static_cast<uint8_t>(fitDataSize >> (8 * i));
+    fit.insert(fit.end(), {0, 0});
+    FitNativeDecoder decoder;
+    FitSession climbing;
+    bool decoded = decoder.decode(fit.data(), fit.size(), climbing);
+    assert(decoded);
+    FitTrack climbTrack;
+    climbTrack.loadSession(climbing);
+    const auto& climbGrade = climbTrack.channel(FitChannel::Grade);
+    const float tenPercent = static_cast<float>(std::atan(0.1) * 180.0 / 3.14159265358979323846);
+    assert(climbTrack.recordAt(1500).hasGrade && !climbTrack.recordAt(500).hasGrade);
+    assert(std::abs(climbGrade[1500] - tenPercent) < 1e-4f);
+    for (size_t k : {500, 999, 2000, 2500})
+        assert(std::abs(climbGrade[k] - tenPercent) < 0.05f);
+
+    // Distance that steps back and drops to 0: when only late records need
+    // a grade, the grid still starts where a walk from record 0 would
+    std::vector<FitRecord> jittery = recs;
+    for (size_t i = 0; i < jittery.size(); ++i) {
+        if (i % 13 == 5) jittery[i].distance -= 20.0f;
+        if (i % 151 == 75 && i < 1900) jittery[i].distance = 0.0f;
+    }
+    const std::vector<float> jitteryExpected = referenceGrade(jittery);
+    for (size_t computedFrom = 2000; computedFrom < 2400; computedFrom += 9) {
+        FitSession late;
+        late.records = jittery;
+        for (size_t k = 0; k < computedFrom; ++k) { late.records[k].grade = 0.0f; late.records[k].hasGrade = true; }
+        FitTrack lateTrack;
+        lateTrack.loadSession(late);
+        const auto& lateGrade = lateTrack.channel(FitChannel::Grade);
+        for (size_t k = computedFrom; k < lateGrade.size(); ++k)
+            assert(std::abs(lateGrade[k] - jitteryExpected[k]) < 1e-3f);
+    }
+
+    // Appending to such a track, with dropouts just before the seam,
+    // regrades from the first sample that reached the seam region, so it
+    // matches a whole load
+    for (size_t seam = 1900; seam < 2300; seam += 9) {
+        FitSession whole, head, tail;
+        whole.records = jittery;
+        for (size_t k = seam - 14; k < seam - 1; k += 3) whole.records[k].distance = 0.0f;
+        head.records.assign(whole.records.begin(), whole.records.begin() + seam);
+        tail.records.assign(whole.records.begin() + seam, whole.records.end());
+        FitTrack loaded, joined;
+        loaded.loadSession(whole);
+        joined.loadSession(head);
+        joined.appendSession(tail);
+        bool same = joined.channel(FitChannel::Grade) == loaded.channel(FitChannel::Grade);
+        assert(same);
+    }
+
+    // Every filter reproduces a constant slope away from the ends; around a
+    // single altitude spike the median stays closer to it than the others
+    FitSession ramp;
+    ramp.records = recs;
+    for (size_t i = 0; i < ramp.records.size(); ++i) ramp.records[i].altitude = 100.0f + 0.05f * i * 3.7f;
+    ramp.records[1500].altitude += 80.0f;
+    const float slope = static_cast<float>(std::atan(0.05) * 180.0 / 3.14159265358979323846);
+    float spikeError[3] = {};
+    for (FitGradeFilter filter : {FitGradeFilter::MovingAverage, FitGradeFilter::SavitzkyGolay, FitGradeFilter::Median}) {
+        FitTrack t;
+        t.loadSession(ramp);
+        FitGradeSettings settings;
+        settings.filter = filter;
+        t.setGradeSettings(settings);
+        const auto& g = t.channel(FitChannel::Grade);
+        assert(std::abs(g[1000] - slope) < 1e-2f);
+        for (size_t k = 1480; k <= 1520; ++k)
+            spikeError[static_cast<int>(filter)] = std::max(spikeError[static_cast<int>(filter)], std::abs(g[k] - slope));
+    }
+    assert(spikeError[2] < spikeError[0] && spikeError[2] < spikeError[1]);
+
+    printf("PASS: test_fit_grade\n");
+}
+
+void test_fit_track_append() {
+    std::vector<FitRecord> recs(1200);
+    for (size_t i = 0; i < recs.size(); ++i) {
+        recs[i].timestamp = 7000.0 + i;
+        recs[i].distance = i * 4.0f;
+        recs[i].altitude = 200.0f + 20.0f * std::sin(i * 0.02f);
+        recs[i].latitude = 46.0 + i * 1e-4;
+        recs[i].longitude = 7.0 - i * 1e-4;
+        recs[i].hasGps = true;
+    }
+    auto part = [&](size_t from, size_t to, float maxSpeed) {
+        FitSession s;
+        s.records.assign(recs.begin() + from, recs.begin() + to);
+        s.maxSpeed = maxSpeed;
+        s.totalElapsedTime = static_cast<float>(to - from);
+        FitLap lap;
+        lap.startTime = recs[from].timestamp;
+        lap.endTime = recs[to - 1].timestamp;
+        s.laps.push_back(lap);
+        return s;
+    };
+
+    FitSession whole;
+    whole.records = recs;
+    FitTrack reference;
+    reference.loadSession(whole);
+
+    // Out of order and overlapping by 50 samples; the last part is reversed
+    FitTrack merged;
+    merged.loadSession(part(400, 850, 9.0f));
+    std::vector<FitSession> more;
+    more.push_back(part(800, 1200, 12.0f));
+    more.push_back(part(0, 450, 7.0f));
+    std::reverse(more.back().records.begin(), more.back().records.end());
+    merged.appendSessions(std::move(more));
+
+    assert(merged.recordCount() == reference.recordCount());
+    for (size_t i = 0; i < merged.recordCount(); ++i) {
+        assert(merged.timestamps()[i] == reference.timestamps()[i]);
+        assert(merged.channel(FitChannel::Grade)[i] == reference.channel(FitChannel::Grade)[i]);
+    }
+    assert(merged.laps().size() == 3);
+    assert(merged.laps()[0].startTime == 7000.0 && merged.laps()[2].startTime == 7800.0);
+    const FitSession& s = merged.session();
+    assert(s.records.empty());
+    assert(s.startTime == 7000.0 && s.endTime == 8199.0);
+    assert(s.maxSpeed == 12.0f);
+    assert(s.minLat == recs.front().latitude && s.maxLat == recs.back().latitude);
+    assert(s.minLon == recs.back().longitude && s.maxLon == recs.front().longitude);
+    // Totals count the 50 overlapping seconds once
+    assert(std::fabs(s.totalDistance - recs.back().distance) < 1e-2f);
+    assert(std::fabs(s.totalElapsedTime - 1199.0f) < 5.0f);
+
+    // A file whose odometer restarts adds its own distance
+    FitSession first = part(0, 600, 1.0f), second = part(600, 1200, 1.0f);
+    for (auto& r : second.records) r.distance -= recs[600].distance;
+    first.totalAscent = second.totalAscent = 50.0f;
+    FitTrack restarted;
+    restarted.loadSession(first);
+    restarted.appendSession(second);
+    const FitSession& joined = restarted.session();
+    assert(joined.totalAscent == 100.0f && joined.totalElapsedTime == 1200.0f);
+    assert(std::fabs(joined.totalDistance - 2.0f * (recs[599].distance - recs[0].distance)) < 1e-2f);
+
+    // Appending a following file takes the in-order path and matches too
+    FitTrack chained;
+    chained.loadSession(part(0, 600, 1.0f));
+    chained.appendSession(part(600, 1200, 1.0f));
+    assert(chained.recordCount() == reference.recordCount());
+    for (size_t i = 0; i < chained.recordCount(); ++i)
+        assert(chained.channel(FitChannel::Grade)[i] == reference.channel(FitChannel::Grade)[i]);
+
+    // The indexes extended over appended files match ones built in one go:
+    // a long ride in three files, the last after a night's break
+    std::vector<FitRecord> ride(21000);
+    std::mt19937 rng(21);
+    std::uniform_real_distribution<float> noise(-30.0f, 30.0f);
+    for (size_t i = 0; i < ride.size(); ++i) {
+        FitRecord& r = ride[i];
+        r.timestamp = 50000.0 + i + (i >= 15000 ? 9 * 3600.0 : 0.0) + (i % 7 == 0 ? 0.5 : 0.0);
+        r.distance = i * 6.0f;
+        r.altitude = 300.0f + 80.0f * std::sin(i * 0.001f);
+        r.hasPower = i % 31 != 4;
+        r.power = r.hasPower ? 210.0f + noise(rng) + (i >= 12000 && i < 12400 ? 150.0f : 0.0f) : 0.0f;
+        r.hasHeartRate = true;
+        r.heartRate = 130.0f + 0.1f * noise(rng);
+        r.speed = 6.0f + 0.01f * noise(rng);
+        r.hasGps = true;
+        const double a = i * 0.0004;
+        r.latitude = 45.0 + 0.02 * std::sin(a * 3.0) + 1e-6 * noise(rng);
+        r.longitude = 7.0 + 0.03 * std::cos(a) + 1e-6 * noise(rng);
+    }
+    FitSession all;
+    all.records = ride;
+    FitTrack full, extended;
+    full.loadSession(all);
+    FitSession piece;
+    piece.records.assign(ride.begin(), ride.begin() + 9000);
+    extended.loadSession(piece);
+    piece.records.assign(ride.begin() + 9000, ride.begin() + 15000);
+    extended.appendSession(piece);
+    piece.records.assign(ride.begin() + 15000, ride.end());
+    extended.appendSession(piece);
+
+    const size_t n = full.recordCount();
+    assert(extended.recordCount() == n);
+    std::uniform_int_distribution<size_t> pick(0, n - 1);
+    // Grades and NP resumed mid-track may differ in the last float bits
+    auto close = [](double x, double y) { return std::fabs(x - y) <= 1e-5 * std::max(1.0, std::fabs(x)); };
+    for (int k = 0; k < 300; ++k) {
+        size_t a = pick(rng), b = pick(rng);
+        if (a > b) std::swap(a, b);
+        for (FitChannel ch : {FitChannel::Power, FitChannel::Grade, FitChannel::NormalizedPower}) {
+            FitMinMax x = full.pyramid().range(ch, a, b + 1), y = extended.pyramid().range(ch, a, b + 1);
+            assert(close(x.min, y.min) && close(x.max, y.max));
+            FitRangeStats p = full.rangeStats(ch, full.timestamps()[a], full.timestamps()[b]);
+            FitRangeStats q = extended.rangeStats(ch, full.timestamps()[a], full.timestamps()[b]);
+            bool same = close(p.integral, q.integral) && p.duration == q.duration &&
+                        close(p.extremes.min, q.extremes.min) && close(p.extremes.max, q.extremes.max);
+            assert(same);
+        }
+        const double t = full.startTime() + (full.duration() * k) / 300.0;
+        assert(full.valueAtTime(FitChannel::Power, t) == extended.valueAtTime(FitChannel::Power, t));
+    }
+    for (FitChannel ch : FitPeakCurves::Channels) {
+        const std::vector<FitPeak>& x = full.peaks().curve(ch);
+        const std::vector<FitPeak>& y = extended.peaks().curve(ch);
+        assert(!x.empty() && x.size() == y.size());
+        for (size_t k = 0; k < x.size(); ++k) {
+            bool same = x[k].duration == y[k].duration && x[k].startTime == y[k].startTime &&
+                        std::fabs(x[k].value - y[k].value) <= 1e-4f * x[k].value;
+            assert(same);
+        }
+    }
+    // The extended polyline keeps the projection of the first file, so a
+    // near tie may fall the other way; the chunks follow the vertices
+    assert(full.polyline().levelCount() == extended.polyline().levelCount());
+    for (size_t l = 0; l < full.polyline().levelCount(); ++l) {
+        const FitPolylineLod::Level& x = full.polyline().level(l);
+        const FitPolylineLod::Level& y = extended.polyline().level(l);
+        assert(l > 0 || x.vertices == y.vertices);
+        assert(std::max(x.vertices.size(), y.vertices.size()) - std::min(x.vertices.size(), y.vertices.size()) <=
+               x.vertices.size() / 1000);
+        size_t next = 0;
+        for (const FitPolylineLod::Chunk& chunk : y.chunks) {
+            assert(chunk.first == next && chunk.last >= chunk.first);
+            for (size_t v = chunk.first; v <= chunk.last; ++v) {
+                const uint32_t i = y.vertices[v];
+                const FitColumns& c = extended.columns();
+                assert(c.latitude[i] >= chunk.box.minLat && c.latitude[i] <= chunk.box.maxLat &&
+                       c.longitude[i] >= chunk.box.minLon && c.longitude[i] <= chunk.box.maxLon);
+            }
+            next = chunk.last;
+        }
+        assert(next == y.vertices.size() - 1);
+    }
+
+    printf("PASS: test_fit_track_append\n");
+}
+
 void test_parse_real_fit_file() {
     FitParser parser;
-    bool ok = parser.parse("../testdata/2026-02-10-14-36-07.fit");
+    bool ok = parser.parse(TEST_FIT);
 
     if (!ok) {
         printf("FAIL: test_parse_real_fit_file - %s\n", parser.errorString().toUtf8().constData());
@@ -132,16 +1496,378 @@ void test_parse_real_fit_file() {
 
     printf("PASS: test_parse_real_fit_file\n");
 }
+
+void test_native_decoder_crc() {
+    FitNativeDecoder decoder;
+    FitSession session;
+    bool ok = decoder.decode(TEST_FIT, session);
+    assert(ok);
+    assert(decoder.crcValid());
+    assert(!session.records.empty());
+
+    // A corrupted file CRC is reported but does not fail the decode
+    QFile file(TEST_FIT);
+    bool opened = file.open(QIODevice::ReadOnly);
+    assert(opened);
+    QByteArray bytes = file.readAll();
+    bytes[bytes.size() - 1] = static_cast<char>(bytes[bytes.size() - 1] ^ 0xFF);
+
+    FitSession corrupted;
+    ok = decoder.decode(reinterpret_cast<const uint8_t*>(bytes.constData()),
+                        static_cast<size_t>(bytes.size()), corrupted);
+    assert(ok);
+    assert(!decoder.crcValid());
+    assert(corrupted.records.size() == session.records.size());
+
+    // Garbage is rejected
+    std::vector<uint8_t> junk(64, 0x42);
+    ok = decoder.decode(junk.data(), junk.size(), corrupted);
+    assert(!ok);
+
+    printf("PASS: test_native_decoder_crc\n");
+}
+
+void test_streaming_parse() {
+    FitParser full;
+    bool ok = full.parse(TEST_FIT);
+    assert(ok);
+    const std::vector<FitRecord>& expected = full.session().records;
+
+    FitParser streaming;
+    std::vector<FitRecord> received;
+    const FitRecord* buffer = nullptr;
+    bool sameBuffer = true;
+    int batches = 0;
+    QObject::connect(&streaming, &FitParser::recordsDecoded, &streaming,
+        [&](const FitRecord* records, int count) {
+            assert(count > 0 && count <= 100);
+            if (buffer && records != buffer) sameBuffer = false;
+            buffer = records;
+            received.insert(received.end(), records, records + count);
+            ++batches;
+        }, Qt::DirectConnection);
+
+    ok = streaming.parseStreaming(TEST_FIT, 100);
+    assert(ok);
+    assert(sameBuffer);
+    assert(batches == static_cast<int>((expected.size() + 99) / 100));
+    assert(streaming.session().records.empty());
+    assert(received.size() == expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        assert(received[i].timestamp == expected[i].timestamp);
+        assert(received[i].distance == expected[i].distance);
+    }
+
+    const FitSession& a = full.session();
+    const FitSession& b = streaming.session();
+    assert(a.startTime == b.startTime && a.endTime == b.endTime);
+    assert(a.avgSpeed == b.avgSpeed && a.laps.size() == b.laps.size());
+    assert(a.minLat == b.minLat && a.maxLon == b.maxLon);
+
+    // Batches fed into a FitTrack match a whole-session load
+    FitTrack batched;
+    batched.appendRecords(received.data(), received.size());
+    batched.finishRecords(streaming.takeSession());
+    FitTrack loaded;
+    loaded.loadSession(full.session());
+    assert(batched.recordCount() == loaded.recordCount());
+    assert(batched.recordAt(batched.recordCount() / 2).grade ==
+           loaded.recordAt(loaded.recordCount() / 2).grade);
+
+    // A snapshot mid-stream is a finished track of the records so far and
+    // does not follow later batches
+    FitTrack growing;
+    const size_t half = received.size() / 2;
+    growing.appendRecords(received.data(), half);
+    std::unique_ptr<FitTrack> partial = growing.snapshot();
+    growing.appendRecords(received.data() + half, received.size() - half);
+    assert(partial->recordCount() == half && growing.recordCount() == received.size());
+    assert(partial->startTime() == loaded.startTime());
+    assert(partial->endTime() == loaded.recordAt(half - 1).timestamp);
+    assert(partial->recordAt(half / 2).grade == loaded.recordAt(half / 2).grade);
+    assert(!partial->pyramid().empty() && partial->hasTimeIndex());
+    assert(partial->session().totalElapsedTime > 0.0f);
+
+    // A zero batch size delivers one record at a time
+    FitParser unbatched;
+    size_t singles = 0;
+    QObject::connect(&unbatched, &FitParser::recordsDecoded, &unbatched,
+        [&](const FitRecord*, int count) {
+            assert(count == 1);
+            ++singles;
+        }, Qt::DirectConnection);
+    ok = unbatched.parseStreaming(TEST_FIT, 0);
+    assert(ok);
+    assert(singles == expected.size());
+
+    printf("PASS: test_streaming_parse (%d batches)\n", batches);
+}
+
+void test_fit_probe() {
+    FitParser parser;
+    bool ok = parser.parse(TEST_FIT);
+    assert(ok);
+    const FitSession& session = parser.session();
+
+    FitNativeDecoder decoder;
+    FitProbeInfo info;
+    ok = decoder.probe(TEST_FIT, info);
+    assert(ok);
+    assert(!info.fullScan);
+    assert(info.hasSession);
+    assert(info.startTime == session.startTime);
+    assert(info.endTime == session.endTime);
+    assert(std::abs(info.totalElapsedTime - session.totalElapsedTime) < 1e-3f);
+    assert(std::abs(info.totalDistance - session.totalDistance) < 1e-2f);
+    assert(info.firstRecordTime == session.records.front().timestamp);
+    assert(info.lastRecordTime == session.records.back().timestamp);
+
+    // Session written after the records: found by resynchronising on the tail
+    std::vector<uint8_t> fit = {14, 0x10, 0x54, 0x08, 0, 0, 0, 0, '.', 'F', 'I', 'T', 0, 0};
+    auto put32 = [&fit](uint32_t v) {
+        for (int i = 0; i < 4; ++i) fit.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    };
+    const uint32_t t0 = 1000000000;
+    fit.insert(fit.end(), {0x40, 0, 0, 20, 0, 1, 253, 4, 0x86});
+    for (uint32_t i = 0; i < 5000; ++i) {
+        fit.push_back(0x00);
+        put32(t0 + i);
+    }
+    fit.insert(fit.end(), {0x41, 0, 0, 18, 0, 3, 253, 4, 0x86, 2, 4, 0x86, 7, 4, 0x86});
+    fit.push_back(0x01);
+    put32(t0 + 5000);
+    put32(t0 + 10);
+    put32(4990000);
+    const uint32_t dataSize = static_cast<uint32_t>(fit.size() - 14);
+    for (int i = 0; i < 4; ++i) fit[4 + i] = static_cast<uint8_t>(dataSize >> (8 * i));
+    fit.insert(fit.end(), {0, 0});
+
+    FitSession decoded;
+    ok = decoder.decode(fit.data(), fit.size(), decoded);
+    assert(ok);
+    FitProbeInfo tailInfo;
+    ok = decoder.probe(fit.data(), fit.size(), tailInfo);
+    assert(ok);
+    assert(!tailInfo.fullScan && tailInfo.hasSession);
+    assert(tailInfo.startTime == decoded.startTime && tailInfo.endTime == decoded.endTime);
+    assert(tailInfo.totalElapsedTime == decoded.totalElapsedTime);
+    assert(tailInfo.firstRecordTime == decoded.records.front().timestamp);
+    assert(tailInfo.lastRecordTime == decoded.records.back().timestamp);
+
+    // Two files chained together: the walk falls back to a full scan and the
+    // second file's session wins, as in the full decode
+    QFile file(TEST_FIT);
+    bool opened = file.open(QIODevice::ReadOnly);
+    assert(opened);
+    QByteArray bytes = file.readAll();
+    QByteArray chained = bytes;
+    chained.append(bytes);
+    FitProbeInfo chainedInfo;
+    ok = decoder.probe(reinterpret_cast<const uint8_t*>(chained.constData()),
+                       static_cast<size_t>(chained.size()), chainedInfo);
+    assert(ok);
+    assert(chainedInfo.fullScan);
+    assert(chainedInfo.startTime == info.startTime && chainedInfo.endTime == info.endTime);
+    assert(chainedInfo.lastRecordTime == session.records.back().timestamp);
+
+    std::vector<uint8_t> junk(64, 0x42);
+    ok = decoder.probe(junk.data(), junk.size(), chainedInfo);
+    assert(!ok);
+
+    printf("PASS: test_fit_probe\n");
+}
+
+void test_fit_track_cache() {
+    QTemporaryDir dir;
+    assert(dir.isValid());
+    QString fitPath = dir.path() + "/ride.fit";
+    bool copied = QFile::copy(TEST_FIT, fitPath);
+    assert(copied);
+
+    FitParser parser;
+    bool ok = parser.parse(fitPath);
+    assert(ok);
+    FitTrack parsed;
+    parsed.loadSession(parser.session());
+
+    FitTrackCache cache;
+    FitTrack cached;
+    ok = cache.load(fitPath, cached);
+    assert(!ok);
+
+    ok = cache.store(fitPath, parsed);
+    assert(ok);
+    ok = cache.load(fitPath, cached);
+    assert(ok);
+
+    assert(cached.recordCount() == parsed.recordCount());
+    assert(cached.laps().size() == parsed.laps().size());
+    assert(cached.session().totalDistance == parsed.session().totalDistance);
+    assert(cached.session().minLat == parsed.session().minLat);
+    for (size_t i = 0; i < parsed.recordCount(); ++i) {
+        FitRecord a = parsed.recordAt(i);
+        FitRecord b = cached.recordAt(i);
+        assert(a.timestamp == b.timestamp && a.latitude == b.latitude);
+        assert(a.grade == b.grade && a.distance == b.distance);
+        assert(a.hasGps == b.hasGps && a.hasGrade == b.hasGrade);
+    }
+    // Peak curves come from the entry rather than being recomputed
+    for (FitChannel ch : FitPeakCurves::Channels) {
+        const std::vector<FitPeak>& want = parsed.peaks().curve(ch);
+        const std::vector<FitPeak>& got = cached.peaks().curve(ch);
+        assert(got.size() == want.size());
+        for (size_t i = 0; i < want.size(); ++i)
+            assert(got[i].duration == want[i].duration && got[i].value == want[i].value &&
+                   got[i].startTime == want[i].startTime);
+    }
+    assert(!cached.peaks().curve(FitChannel::Speed).empty());
+
+    // Entries are byte-stable: storing the restored track writes the same file
+    auto entryBytes = [&fitPath]() {
+        QFile entry(FitTrackCache::sidecarPath(fitPath));
+        return entry.open(QIODevice::ReadOnly) ? entry.readAll() : QByteArray();
+    };
+    const QByteArray first = entryBytes();
+    ok = cache.store(fitPath, cached);
+    assert(ok);
+    bool stable = !first.isEmpty() && entryBytes() == first;
+    assert(stable);
+
+    // Changing the FIT file invalidates the entry
+    QFile file(fitPath);
+    ok = file.open(QIODevice::ReadOnly);
+    assert(ok);
+    QByteArray bytes = file.readAll();
+    file.close();
+    ok = file.open(QIODevice::WriteOnly);
+    assert(ok);
+    file.write(bytes.constData(), bytes.size() - 1);
+    file.close();
+
+    FitTrack stale;
+    ok = cache.load(fitPath, stale);
+    assert(!ok);
+
+    printf("PASS: test_fit_track_cache\n");
+}
+
+void test_fit_session_registry() {
+    QTemporaryDir dir;
+    QString fitPath = dir.path() + "/ride.fit";
+    bool copied = QFile::copy(TEST_FIT, fitPath);
+    assert(copied);
+
+    FitSessionRegistry& registry = FitSessionRegistry::instance();
+    std::shared_ptr<const FitTrack> a = registry.acquire(fitPath);
+    std::shared_ptr<const FitTrack> b = registry.acquire(fitPath);
+    assert(a && a == b);
+    assert(registry.find(fitPath) == a);
+    assert(a->session().records.empty());
+    assert(a->recordCount() > 0);
+
+    // Held entries survive a prune; unused ones are dropped
+    registry.releaseUnused();
+    assert(registry.find(fitPath) == a);
+    a.reset();
+    b.reset();
+    registry.releaseUnused();
+    assert(!registry.find(fitPath));
+
+    QString error;
+    std::shared_ptr<const FitTrack> missing = registry.acquire(dir.path() + "/missing.fit", &error);
+    assert(!missing && !error.isEmpty());
+
+    // Wait for the background .fvtrack write before the directory goes away
+    QThreadPool::globalInstance()->waitForDone();
+
+    printf("PASS: test_fit_session_registry\n");
+}
+
+#ifdef HAS_FIT_SDK
+void test_native_matches_sdk() {
+    FitParser sdkParser;
+    FitParser nativeParser;
+    bool sdkOk = sdkParser.parse(TEST_FIT, FitDecoderBackend::Sdk);
+    bool nativeOk = nativeParser.parse(TEST_FIT, FitDecoderBackend::Native);
+    assert(sdkOk && nativeOk);
+
+    const FitSession& a = sdkParser.session();
+    const FitSession& b = nativeParser.session();
+
+    assert(a.records.size() == b.records.size());
+    assert(a.laps.size() == b.laps.size());
+
+    auto close = [](double x, double y, double eps) { return std::abs(x - y) <= eps; };
+
+    for (size_t i = 0; i < a.records.size(); ++i) {
+        const FitRecord& x = a.records[i];
+        const FitRecord& y = b.records[i];
+        if (x.timestamp != y.timestamp || x.hasGps != y.hasGps ||
+            x.hasHeartRate != y.hasHeartRate || x.hasCadence != y.hasCadence ||
+            x.hasPower != y.hasPower || x.hasGrade != y.hasGrade ||
+            !close(x.latitude, y.latitude, 1e-9) || !close(x.longitude, y.longitude, 1e-9) ||
+            !close(x.altitude, y.altitude, 1e-3) || !close(x.speed, y.speed, 1e-4) ||
+            !close(x.heartRate, y.heartRate, 1e-4) || !close(x.cadence, y.cadence, 1e-4) ||
+            !close(x.power, y.power, 1e-4) || !close(x.distance, y.distance, 1e-2) ||
+            !close(x.temperature, y.temperature, 1e-4) || !close(x.grade, y.grade, 1e-4)) {
+            printf("FAIL: test_native_matches_sdk - record %zu differs\n", i);
+            assert(false);
+        }
+    }
+
+    for (size_t i = 0; i < a.laps.size(); ++i) {
+        assert(a.laps[i].startTime == b.laps[i].startTime);
+        assert(a.laps[i].endTime == b.laps[i].endTime);
+        assert(a.laps[i].lapIndex == b.laps[i].lapIndex);
+        assert(close(a.laps[i].totalDistance, b.laps[i].totalDistance, 1e-2));
+        assert(close(a.laps[i].avgSpeed, b.laps[i].avgSpeed, 1e-4));
+    }
+
+    assert(a.startTime == b.startTime);
+    assert(a.endTime == b.endTime);
+    assert(close(a.totalDistance, b.totalDistance, 1e-2));
+    assert(close(a.totalElapsedTime, b.totalElapsedTime, 1e-3));
+    assert(close(a.avgSpeed, b.avgSpeed, 1e-4));
+    assert(close(a.maxSpeed, b.maxSpeed, 1e-4));
+    assert(close(a.avgHeartRate, b.avgHeartRate, 1e-4));
+    assert(close(a.totalAscent, b.totalAscent, 1e-4));
+    assert(a.minLat == b.minLat && a.maxLat == b.maxLat);
+    assert(a.minLon == b.minLon && a.maxLon == b.maxLon);
+
+    printf("PASS: test_native_matches_sdk (%zu records)\n", a.records.size());
+}
 #endif
 
 int main() {
     test_fit_record_defaults();
     test_fit_session_bounds();
     test_fit_track_interpolation();
-#ifdef HAS_FIT_SDK
+    test_fit_track_columns();
+    test_fit_track_cursor();
+    test_fit_track_time_gap();
+    test_fit_track_sample_range();
+    test_fit_lap_index();
+    test_fit_pyramid();
+    test_fit_analytics();
+    test_fit_peak_curves();
+    test_fit_derived();
+    test_fit_distance_index();
+    test_fit_climbs();
+    test_fit_segments();
+    test_fit_polyline_lod();
+    test_fit_spatial_index();
+    test_fit_grade();
+    test_fit_track_append();
     test_parse_real_fit_file();
+    test_native_decoder_crc();
+    test_streaming_parse();
+    test_fit_probe();
+    test_fit_track_cache();
+    test_fit_session_registry();
+#ifdef HAS_FIT_SDK
+    test_native_matches_sdk();
 #else
-    printf("SKIP: test_parse_real_fit_file (no FIT SDK)\n");
+    printf("SKIP: test_native_matches_sdk (no FIT SDK)\n");
 #endif
     printf("All FIT parser tests passed.\n");
     return 0;
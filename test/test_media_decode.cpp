@@ -4,6 +4,19 @@
 #include "media/MediaProbe.h"
 #include "media/VideoDecoder.h"
 #include "media/AudioDecoder.h"
+#include "media/DecoderThreadBudget.h"
+#include "media/FramePool.h"
+#include "media/FrameQueue.h"
+#include "media/FrameCompositor.h"
+#include "timeline/ClipTransform.h"
+#include <QPainter>
+#include <QTransform>
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
 
 static const char* TEST_VIDEO = "../testdata/DJI_20260210140425_0011_D.mp4";
 
@@ -91,6 +104,8 @@ void test_video_decode_10_frames() {
         assert(frame.width() == info.width);
         assert(frame.height() == info.height);
     }
+    // Each frame was released before the next, so one buffer was reused
+    assert(decoder.framePool().allocated() == 1);
 
     // Test seeking to middle
     double seekTarget = info.duration / 2.0;
@@ -104,8 +119,26 @@ void test_video_decode_10_frames() {
                decoder.currentTime(), seekFrame.width(), seekFrame.height());
     }
 
+    // The same stream left in the codec's buffers
+    YuvFrame yuv;
+    QImage fallback;
+    ok = decoder.decodeNextFrameNative(yuv, fallback);
+    assert(ok);
+    assert(yuv.isNull() != decoder.hasYuvOutput());
+    if (!yuv.isNull()) {
+        assert(yuv.width == info.width && yuv.height == info.height);
+        QImage converted;
+        ok = FrameCompositor::convert(yuv, converted);
+        assert(ok);
+        assert(converted.size() == QSize(info.width, info.height));
+    } else {
+        assert(fallback.width() == info.width);
+    }
+
+    assert(decoder.threadCount() >= 1);
     decoder.close();
     assert(!decoder.isOpen());
+    assert(DecoderThreadBudget::instance().inUse(DecodePriority::Background) == 0);
 
     printf("PASS: test_video_decode_10_frames\n\n");
 #else
@@ -113,6 +146,453 @@ void test_video_decode_10_frames() {
 #endif
 }
 
+void test_video_decode_downscaled() {
+    printf("=== test_video_decode_downscaled ===\n");
+
+#ifdef HAS_FFMPEG
+    VideoDecoder decoder;
+    decoder.setDownscale(4);
+    bool ok = decoder.open(TEST_VIDEO);
+    assert(ok);
+
+    // The stream keeps its size; frames come out at a quarter of it
+    const VideoInfo& info = decoder.info();
+    const QSize quarter((info.width + 3) / 4, (info.height + 3) / 4);
+    assert(decoder.frameSize() == quarter);
+    assert(decoder.framePool().size() == quarter);
+
+    QImage frame = decoder.decodeNextFrame();
+    assert(!frame.isNull());
+    assert(frame.size() == quarter);
+
+    // YUV frames are whatever the codec produced, at most the stream size
+    YuvFrame yuv;
+    QImage fallback;
+    ok = decoder.decodeNextFrameNative(yuv, fallback);
+    assert(ok);
+    if (!yuv.isNull()) {
+        assert(yuv.width <= info.width && yuv.width >= quarter.width());
+        printf("  Codec output %dx%d for %dx%d preview\n",
+               yuv.width, yuv.height, quarter.width(), quarter.height());
+    }
+
+    // The setting sticks across reopening
+    decoder.close();
+    assert(!decoder.frameSize().isValid());
+    assert(decoder.downscale() == 4);
+
+    printf("PASS: test_video_decode_downscaled\n\n");
+#else
+    printf("SKIP: test_video_decode_downscaled (no FFmpeg)\n\n");
+#endif
+}
+
+void test_frame_pool() {
+    printf("=== test_frame_pool ===\n");
+
+    FramePool pool(QSize(101, 7), QImage::Format_RGB32, 2);
+    assert(pool.allocated() == 2);
+    assert(pool.available() == 2);
+    assert(pool.bytesPerLine() % FramePool::Alignment == 0);
+    assert(pool.bytesPerLine() >= 101 * 4);
+
+    const uchar* first = nullptr;
+    {
+        QImage a = pool.acquire();
+        assert(a.size() == QSize(101, 7));
+        assert(a.format() == QImage::Format_RGB32);
+        assert(a.bytesPerLine() == pool.bytesPerLine());
+        assert(reinterpret_cast<quintptr>(a.constBits()) % FramePool::Alignment == 0);
+        first = a.constBits();
+        assert(pool.available() == 1);
+
+        // Painting on the only reference stays in the pooled buffer
+        a.fill(Qt::red);
+        assert(a.constBits() == first);
+
+        // Moving hands the buffer on; copies share it until the last goes
+        QImage b = std::move(a);
+        QImage c = b;
+        b = QImage();
+        assert(pool.available() == 1);
+        assert(c.constBits() == first);
+    }
+    assert(pool.available() == 2);
+
+    // Released buffers are handed out again before new ones are allocated
+    {
+        QImage a = pool.acquire();
+        QImage b = pool.acquire();
+        QImage c = pool.acquire();
+        assert(a.constBits() == first || b.constBits() == first);
+        assert(pool.allocated() == 3);
+        assert(pool.available() == 0);
+    }
+    assert(pool.available() == 3);
+
+    // Images outlive a reset and the pool itself
+    QImage survivor = pool.acquire();
+    pool.reset(QSize(16, 16), QImage::Format_ARGB32);
+    assert(pool.allocated() == 0);
+    assert(pool.acquire().size() == QSize(16, 16));
+    {
+        FramePool scoped(QSize(8, 8), QImage::Format_ARGB32);
+        survivor = scoped.acquire();
+    }
+    survivor.fill(Qt::blue);
+    assert(survivor.pixel(7, 7) == QColor(Qt::blue).rgb());
+    survivor = QImage();
+
+    FramePool empty;
+    assert(empty.acquire().isNull());
+
+    printf("PASS: test_frame_pool\n\n");
+}
+
+void test_frame_queue() {
+    printf("=== test_frame_queue ===\n");
+
+    FrameQueue queue(3);
+    assert(queue.capacity() == 3);
+    TimedFrame frame;
+    for (int i = 0; i < 3; ++i) {
+        frame.pts = i;
+        bool pushed = queue.tryPush(frame);
+        assert(pushed);
+    }
+    // A full ring leaves the frame with the caller
+    frame.pts = 3;
+    bool pushed = queue.tryPush(frame);
+    assert(!pushed);
+    assert(frame.pts == 3);
+    assert(queue.size() == 3);
+
+    TimedFrame out;
+    bool popped = queue.tryPop(out);
+    assert(popped && out.pts == 0);
+    queue.clear();
+    assert(queue.isEmpty());
+
+    // Producer thread sleeping on a full ring while the consumer drains it;
+    // frames arrive in order and the pool only holds what is in flight
+    FramePool pool(QSize(16, 16), QImage::Format_RGB32);
+    const int count = 20000;
+    std::atomic<bool> stop{false};
+    auto cancelled = [&]() { return stop.load(); };
+    std::thread producer([&]() {
+        for (int i = 0; i < count; ++i) {
+            TimedFrame tf;
+            tf.image = pool.acquire();
+            tf.pts = i;
+            while (!cancelled() && !queue.tryPush(tf))
+                queue.waitForSpace(cancelled);
+        }
+    });
+    for (int expected = 0; expected < count;) {
+        TimedFrame tf;
+        if (!queue.tryPop(tf)) continue;
+        assert(tf.pts == expected);
+        ++expected;
+    }
+    producer.join();
+    assert(pool.allocated() <= queue.capacity() + 2);
+
+    // A waiting producer returns once cancelled and woken
+    FrameQueue single(1);
+    TimedFrame filler;
+    pushed = single.tryPush(filler);
+    assert(pushed);
+    std::thread waiter([&]() {
+        bool space = single.waitForSpace(cancelled);
+        assert(!space);
+    });
+    stop = true;
+    single.wakeProducer();
+    waiter.join();
+
+    printf("PASS: test_frame_queue\n\n");
+}
+
+// Random 4:2:0 planes, readable as YUV420P or NV12
+struct TestPlanes {
+    int width, height;
+    std::vector<uint8_t> y, u, v, uv;
+
+    TestPlanes(int w, int h, unsigned seed) : width(w), height(h) {
+        std::mt19937 rng(seed);
+        const int chroma = ((w + 1) / 2) * ((h + 1) / 2);
+        y.resize(size_t(w) * h);
+        for (auto& b : y) b = static_cast<uint8_t>(rng());
+        u.resize(chroma);
+        v.resize(chroma);
+        uv.resize(chroma * 2);
+        for (int i = 0; i < chroma; ++i) {
+            u[i] = uv[2 * i] = static_cast<uint8_t>(rng());
+            v[i] = uv[2 * i + 1] = static_cast<uint8_t>(rng());
+        }
+    }
+
+    YuvFrame frame(YuvFrame::Layout layout) const {
+        YuvFrame f;
+        f.layout = layout;
+        f.width = width;
+        f.height = height;
+        f.planes[0] = y.data();
+        f.strides[0] = width;
+        if (layout == YuvFrame::Layout::NV12) {
+            f.planes[1] = uv.data();
+            f.strides[1] = (width + 1) / 2 * 2;
+        } else {
+            f.planes[1] = u.data();
+            f.planes[2] = v.data();
+            f.strides[1] = f.strides[2] = (width + 1) / 2;
+        }
+        return f;
+    }
+};
+
+void test_frame_compositor() {
+    printf("=== test_frame_compositor ===\n");
+    using namespace FrameCompositor;
+    const Isa best = bestIsa();
+    printf("  Best ISA: %s\n", isaName(best));
+
+    // Every ISA converts a row identically, odd lengths included
+    std::mt19937 rng(1);
+    std::vector<uint8_t> y(999), u(999), v(999);
+    for (int i = 0; i < 999; ++i) {
+        y[i] = static_cast<uint8_t>(rng());
+        u[i] = static_cast<uint8_t>(rng());
+        v[i] = static_cast<uint8_t>(rng());
+    }
+    for (int m = 0; m < 4; ++m) {
+        const auto matrix = m & 1 ? YuvFrame::Matrix::BT709 : YuvFrame::Matrix::BT601;
+        std::vector<uint32_t> scalar(999), vector(999);
+        setIsa(Isa::Scalar);
+        convertRow(y.data(), u.data(), v.data(), scalar.data(), 999, matrix, m >= 2);
+        for (int i = 1; i <= static_cast<int>(best); ++i) {
+            setIsa(static_cast<Isa>(i));
+            convertRow(y.data(), u.data(), v.data(), vector.data(), 999, matrix, m >= 2);
+            assert(vector == scalar);
+        }
+    }
+    setIsa(best);
+
+    // Limited-range white and black
+    uint8_t Y = 235, U = 128, V = 128;
+    uint32_t pixel = 0;
+    convertRow(&Y, &U, &V, &pixel, 1, YuvFrame::Matrix::BT709, false);
+    assert(pixel == 0xffffffffu);
+    Y = 16;
+    convertRow(&Y, &U, &V, &pixel, 1, YuvFrame::Matrix::BT709, false);
+    assert(pixel == 0xff000000u);
+
+    // NV12 and planar agree
+    TestPlanes planes(6, 4, 2);
+    const YuvFrame frame = planes.frame(YuvFrame::Layout::YUV420P);
+    QImage source, nv12;
+    bool ok = convert(frame, source);
+    assert(ok && source.size() == QSize(6, 4));
+    ok = convert(planes.frame(YuvFrame::Layout::NV12), nv12);
+    assert(ok);
+    assert(nv12 == source);
+
+    // Quarter turns, flips and whole-pixel pans land pixels exactly
+    auto check = [&](const ClipTransform& t, QSize size, auto sourceAt) {
+        QImage canvas(size, QImage::Format_ARGB32_Premultiplied);
+        bool composed = compose(frame, t, canvas);
+        assert(composed);
+        for (int cy = 0; cy < size.height(); ++cy) {
+            for (int cx = 0; cx < size.width(); ++cx) {
+                const QPoint s = sourceAt(cx, cy);
+                const QRgb expected = source.rect().contains(s) ? source.pixel(s) : 0xff000000u;
+                assert(canvas.pixel(cx, cy) == expected);
+            }
+        }
+    };
+    ClipTransform t;
+    t.rotation = 90;
+    check(t, QSize(4, 6), [](int x, int y) { return QPoint(y, 3 - x); });
+    t.rotation = -90;
+    check(t, QSize(4, 6), [](int x, int y) { return QPoint(5 - y, x); });
+    t.rotation = 180;
+    check(t, QSize(6, 4), [](int x, int y) { return QPoint(5 - x, 3 - y); });
+    t.reset();
+    t.flipH = true;
+    check(t, QSize(6, 4), [](int x, int y) { return QPoint(5 - x, y); });
+    t.reset();
+    t.panX = 2;
+    t.panY = -1;
+    check(t, QSize(6, 4), [](int x, int y) { return QPoint(x - 2, y + 1); });
+    t.panX = 1;  // odd offset into the subsampled chroma
+    t.panY = 0;
+    check(t, QSize(6, 4), [](int x, int y) { return QPoint(x - 1, y); });
+
+    // Fractional placement blends luma only, so a flat frame stays flat
+    TestPlanes flat(16, 8, 3);
+    std::fill(flat.y.begin(), flat.y.end(), uint8_t(100));
+    std::fill(flat.u.begin(), flat.u.end(), uint8_t(90));
+    std::fill(flat.v.begin(), flat.v.end(), uint8_t(160));
+    QImage flatSource;
+    ok = convert(flat.frame(YuvFrame::Layout::YUV420P), flatSource);
+    assert(ok);
+    t.reset();
+    t.scale = 1.7;
+    t.panX = 0.5;
+    QImage canvas(QSize(16, 8), QImage::Format_ARGB32_Premultiplied);
+    ok = compose(flat.frame(YuvFrame::Layout::YUV420P), t, canvas);
+    assert(ok);
+    for (int cy = 0; cy < 8; ++cy)
+        for (int cx = 1; cx < 16; ++cx) assert(canvas.pixel(cx, cy) == flatSource.pixel(0, 0));
+
+    // Against the QPainter path compose() replaces (MainWindow::applyTransform),
+    // on every ISA. A luma ramp with neutral chroma blends alike in YUV and
+    // RGB; a one-pixel slip moves it by more than the tolerance. Pixels the
+    // frame's edge crosses are skipped, as QPainter may cover them or not.
+    TestPlanes ramp(40, 16, 4);
+    for (int ry = 0; ry < 16; ++ry)
+        for (int rx = 0; rx < 40; ++rx) ramp.y[size_t(ry) * 40 + rx] = static_cast<uint8_t>(16 + 4 * rx + 3 * ry);
+    std::fill(ramp.uv.begin(), ramp.uv.end(), uint8_t(128));
+    const YuvFrame rampFrame = ramp.frame(YuvFrame::Layout::NV12);
+    QImage rampSource;
+    ok = convert(rampFrame, rampSource);
+    assert(ok);
+    auto matchesPainter = [&](const ClipTransform& pt, QSize size) {
+        QTransform placed;
+        placed.translate(size.width() / 2.0 + pt.panX, size.height() / 2.0 + pt.panY);
+        placed.rotate(pt.rotation);
+        placed.scale(pt.flipH ? -pt.scale : pt.scale, pt.flipV ? -pt.scale : pt.scale);
+        QImage painted(size, QImage::Format_ARGB32_Premultiplied);
+        painted.fill(Qt::black);
+        QPainter painter(&painted);
+        painter.setRenderHint(QPainter::SmoothPixmapTransform);
+        painter.setTransform(placed);
+        painter.drawImage(QPointF(-20.0, -8.0), rampSource);
+        painter.end();
+
+        const QRectF edge = placed.mapRect(QRectF(-20.0, -8.0, 40.0, 16.0));
+        const QRectF inside = edge.adjusted(1, 1, -1, -1);
+        const QRectF outside = edge.adjusted(-1, -1, 1, 1);
+        for (int i = 0; i <= static_cast<int>(best); ++i) {
+            setIsa(static_cast<Isa>(i));
+            QImage composed(size, QImage::Format_ARGB32_Premultiplied);
+            bool composedOk = compose(rampFrame, pt, composed);
+            assert(composedOk);
+            for (int cy = 0; cy < size.height(); ++cy) {
+                for (int cx = 0; cx < size.width(); ++cx) {
+                    const QPointF centre(cx + 0.5, cy + 0.5);
+                    if (outside.contains(centre) && !inside.contains(centre)) continue;
+                    const QRgb a = composed.pixel(cx, cy);
+                    const QRgb b = painted.pixel(cx, cy);
+                    const int diff = std::max({std::abs(qRed(a) - qRed(b)), std::abs(qGreen(a) - qGreen(b)),
+                                               std::abs(qBlue(a) - qBlue(b))});
+                    assert(diff <= 3);
+                }
+            }
+        }
+        setIsa(best);
+    };
+    t.reset();
+    matchesPainter(t, QSize(40, 16));
+    t.scale = 0.5;  // 2:1, both axes blended
+    matchesPainter(t, QSize(20, 8));
+    t.panY = 0.25;  // 2:1 on whole source rows
+    matchesPainter(t, QSize(20, 8));
+    t.scale = 1.0;  // 1:1 between pixels
+    t.panX = 0.5;
+    t.panY = 0.5;
+    matchesPainter(t, QSize(40, 16));
+    t.panX = 0.25;  // 1:1 between columns only
+    t.panY = 0;
+    matchesPainter(t, QSize(40, 16));
+    t.scale = 1.7;
+    matchesPainter(t, QSize(40, 16));
+    t.reset();
+    t.scale = 0.5;
+    t.rotation = 90;
+    matchesPainter(t, QSize(8, 20));
+    t.rotation = 180;
+    t.flipH = true;
+    t.panX = 3;
+    matchesPainter(t, QSize(20, 8));
+
+    // The vector resampling at 1:1 and 2:1 gives the scalar pixels, over rows
+    // long enough for every ISA's loads, on both chroma layouts
+    TestPlanes wide(301, 9, 5);
+    for (int layout = 0; layout < 2; ++layout) {
+        const YuvFrame wideFrame = wide.frame(layout ? YuvFrame::Layout::NV12 : YuvFrame::Layout::YUV420P);
+        for (double scale : {1.0, 0.5}) {
+            for (double pan : {0.0, 0.25, 0.5, 3.0}) {
+                t.reset();
+                t.scale = scale;
+                t.panX = pan;
+                t.panY = pan;
+                const QSize size(static_cast<int>(301 * scale), 8);
+                QImage scalar(size, QImage::Format_ARGB32_Premultiplied);
+                setIsa(Isa::Scalar);
+                ok = compose(wideFrame, t, scalar);
+                assert(ok);
+                for (int i = 1; i <= static_cast<int>(best); ++i) {
+                    setIsa(static_cast<Isa>(i));
+                    QImage vector(size, QImage::Format_ARGB32_Premultiplied);
+                    ok = compose(wideFrame, t, vector);
+                    assert(ok);
+                    assert(vector == scalar);
+                }
+            }
+        }
+    }
+    setIsa(best);
+
+    // Arbitrary angles are left to QPainter
+    t.reset();
+    t.rotation = 45;
+    assert(!supports(t));
+    ok = compose(frame, t, canvas);
+    assert(!ok);
+    t.rotation = 450;
+    assert(supports(t));
+
+    printf("PASS: test_frame_compositor\n\n");
+}
+
+void test_decoder_thread_budget() {
+    printf("=== test_decoder_thread_budget ===\n");
+
+    DecoderThreadBudget& budget = DecoderThreadBudget::instance();
+    const int savedTotal = budget.total();
+    budget.setTotal(8);
+
+    // Playback takes all but one core, even with background decoders open
+    int background = budget.acquire(DecodePriority::Background);
+    assert(background == DecoderThreadBudget::BackgroundThreads);
+    int playback = budget.acquire(DecodePriority::Playback);
+    assert(playback == 7);
+    assert(budget.inUse(DecodePriority::Playback) == 7);
+
+    // Background decoders then get the remainder, never less than one
+    int squeezed = budget.acquire(DecodePriority::Background);
+    assert(squeezed == 1);
+    budget.release(DecodePriority::Background, squeezed);
+    budget.release(DecodePriority::Background, background);
+    assert(budget.inUse(DecodePriority::Background) == 0);
+
+    // A second playback decoder shares what the first left
+    int second = budget.acquire(DecodePriority::Playback);
+    assert(second == 1);
+    budget.release(DecodePriority::Playback, second);
+    budget.release(DecodePriority::Playback, playback);
+    assert(budget.inUse(DecodePriority::Playback) == 0);
+
+    budget.setTotal(64);
+    playback = budget.acquire(DecodePriority::Playback);
+    assert(playback == DecoderThreadBudget::MaxThreads);
+    budget.release(DecodePriority::Playback, playback);
+
+    budget.setTotal(savedTotal);
+    printf("PASS: test_decoder_thread_budget\n\n");
+}
+
 void test_audio_decode() {
     printf("=== test_audio_decode ===\n");
 
@@ -162,6 +642,11 @@ void test_audio_decode() {
 int main() {
     test_media_probe();
     test_video_decode_10_frames();
+    test_video_decode_downscaled();
+    test_decoder_thread_budget();
+    test_frame_pool();
+    test_frame_queue();
+    test_frame_compositor();
     test_audio_decode();
     printf("All media decode tests passed.\n");
     return 0;